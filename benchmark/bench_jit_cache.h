@@ -0,0 +1,118 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_BENCH_JIT_CACHE
+#define FK_BENCH_JIT_CACHE
+
+// Latency of kernel cache hits while several threads look up kernels at the same time:
+// - cache/hit_contention: the sharded cache alone, with stub values, so it does not need a GPU
+// - cache/add_kernel_hit: JITExecutorCache::addKernel on kernels that are already compiled
+
+#include <benchmark/jit_bench.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jit_bench {
+    // Runs lookup(thread, i) iterations times in every thread, all of them starting at once, and
+    // reports the average latency of one lookup and the total throughput
+    template <typename Lookup>
+    void reportContendedLookups(Suite& suite, const size_t threads, const size_t iterations, Lookup&& lookup) {
+        std::atomic<size_t> ready{ 0 };
+        std::atomic<bool> start{ false };
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                ready++;
+                while (!start) {
+                    std::this_thread::yield();
+                }
+                for (size_t i = 0; i < iterations; ++i) {
+                    lookup(t, i);
+                }
+            });
+        }
+        while (ready < threads) {
+            std::this_thread::yield();
+        }
+        const auto begin = std::chrono::steady_clock::now();
+        start = true;
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        Result result;
+        result.params["threads"] = std::to_string(threads);
+        result.unit = "ns";
+        result.value = seconds * 1e9 / iterations;
+        result.metrics["lookups_per_second"] = threads * iterations / seconds;
+        suite.report(result);
+    }
+
+    inline std::vector<size_t> contentionThreads() {
+        const size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+        std::vector<size_t> threads;
+        for (size_t count = 1; count <= hardware && count <= 16; count *= 2) {
+            threads.push_back(count);
+        }
+        return threads;
+    }
+
+    inline void addCacheBenchmarks(Suite& suite) {
+        suite.add("cache/hit_contention", false, [](Suite& suite) {
+            constexpr size_t KEYS = 64;
+            fk::JitShardedCache<std::shared_ptr<const int>> cache;
+            std::vector<std::string> keys;
+            for (size_t i = 0; i < KEYS; ++i) {
+                keys.push_back("&launchTransformDPP_Kernel<stub_" + std::to_string(i) + ">");
+                cache.getOrCompile(keys.back(), [i] { return std::make_shared<const int>(static_cast<int>(i)); });
+            }
+            for (const size_t threads : contentionThreads()) {
+                reportContendedLookups(suite, threads, suite.iterations(200000), [&](const size_t t, const size_t i) {
+                    cache.getOrCompile(keys[(t * 7 + i) % KEYS], [] { return std::make_shared<const int>(0); });
+                });
+            }
+        });
+
+        suite.add("cache/add_kernel_hit", true, [](Suite& suite) {
+            const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+            std::vector<std::vector<fk::JIT_Operation_pp>> pipelines;
+            std::vector<std::string> kernelNames;
+            for (size_t combination = 0; combination < 4; ++combination) {
+                pipelines.push_back(arithmeticPipeline(raw, raw, 1, combination));
+                kernelNames.push_back(fk::jit_internal::runtimeKernelName(pipelines.back()));
+            }
+            fk::JITExecutorCache& cache = fk::JITExecutorCache::getInstance();
+            cache.addKernels([&] {
+                std::vector<fk::JITExecutorCache::PendingKernel> pending;
+                for (size_t i = 0; i < pipelines.size(); ++i) {
+                    pending.push_back({ kernelNames[i], pipelines[i] });
+                }
+                return pending;
+            }());
+            for (const size_t threads : contentionThreads()) {
+                reportContendedLookups(suite, threads, suite.iterations(50000), [&](const size_t t, const size_t i) {
+                    const size_t pipeline = (t + i) % pipelines.size();
+                    cache.addKernel(kernelNames[pipeline], pipelines[pipeline]);
+                });
+            }
+        });
+    }
+} // namespace jit_bench
+
+#endif // FK_BENCH_JIT_CACHE
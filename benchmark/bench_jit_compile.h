@@ -0,0 +1,113 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_BENCH_JIT_COMPILE
+#define FK_BENCH_JIT_COMPILE
+
+// NVRTC compile times. Only NVRTC is used, so they do not need a GPU.
+// - compile/latency: one pipeline, by the number of arithmetic operations
+// - compile/batched: total time of 1, 10 and 100 different pipelines compiled one by one, like
+//   addKernel, and in a single program, like addKernels
+// - compile/headers: one pipeline compiled with the umbrella include and with its minimal header set,
+//   which needs the embedded FKL headers
+
+#include <benchmark/jit_bench.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace jit_bench {
+    inline void addCompileBenchmarks(Suite& suite) {
+        suite.add("compile/latency", false, [](Suite& suite) {
+            const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+            const std::string& source = fk::jit_internal::jitKernelSource();
+            const std::vector<std::string> options = fk::jit_internal::defaultCompileOptions();
+            const size_t repetitions = suite.options().quick ? 1 : 3;
+            for (const size_t length : { 1, 2, 4, 8 }) {
+                const std::string nameExpression = nameExpressionOf(arithmeticPipeline(raw, raw, length));
+                Result result;
+                result.params["ops"] = std::to_string(length);
+                result.unit = "ms";
+                result.value = medianMilliseconds(repetitions, [&] {
+                    fk::jit_internal::compileNameExpression(source, nameExpression, options);
+                });
+                suite.report(result);
+            }
+        });
+
+        suite.add("compile/batched", false, [](Suite& suite) {
+            const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+            const std::string& source = fk::jit_internal::jitKernelSource();
+            const std::vector<std::string> options = fk::jit_internal::defaultCompileOptions();
+            const std::vector<size_t> counts = suite.options().quick ? std::vector<size_t>{ 1, 10 } : std::vector<size_t>{ 1, 10, 100 };
+            for (const size_t count : counts) {
+                // Enumerates the combinations by length, 4 + 16 + 64 + 256 of them
+                std::vector<std::string> nameExpressions;
+                for (size_t length = 1, combinations = 4; nameExpressions.size() < count && length <= 4; ++length, combinations *= 4) {
+                    for (size_t combination = 0; combination < combinations && nameExpressions.size() < count; ++combination) {
+                        nameExpressions.push_back(nameExpressionOf(arithmeticPipeline(raw, raw, length, combination)));
+                    }
+                }
+                const double oneByOne = medianMilliseconds(1, [&] {
+                    for (const auto& nameExpression : nameExpressions) {
+                        fk::jit_internal::compileNameExpression(source, nameExpression, options);
+                    }
+                });
+                const double batched = medianMilliseconds(1, [&] {
+                    fk::jit_internal::compileNameExpressions(source, nameExpressions, options);
+                });
+                Result result;
+                result.params["pipelines"] = std::to_string(count);
+                result.unit = "ms";
+                result.value = batched;
+                result.metrics["one_by_one_ms"] = oneByOne;
+                result.metrics["speedup"] = oneByOne / batched;
+                suite.report(result);
+            }
+        });
+
+        suite.add("compile/headers", false, [](Suite& suite) {
+            const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+            const std::vector<std::string> options = fk::jit_internal::defaultCompileOptions();
+            const size_t repetitions = suite.options().quick ? 1 : 3;
+            for (const size_t length : { 1, 8 }) {
+                const std::string nameExpression = nameExpressionOf(arithmeticPipeline(raw, raw, length));
+                const std::optional<std::vector<std::string>> headers =
+                    fk::jit_internal::minimalHeaders({ nameExpression }, fk::jit_internal::embeddedHeaderIndex());
+                Result result;
+                result.params["ops"] = std::to_string(length);
+                if (!headers) {
+                    result.skipped = true;
+                    suite.report(result);
+                    continue;
+                }
+                const std::string minimal = *fk::jit_internal::minimalKernelSource({ nameExpression });
+                const double umbrella = medianMilliseconds(repetitions, [&] {
+                    fk::jit_internal::compileNameExpression(fk::jit_internal::jitKernelSource(), nameExpression, options);
+                });
+                result.unit = "ms";
+                result.value = medianMilliseconds(repetitions, [&] {
+                    fk::jit_internal::compileNameExpression(minimal, nameExpression, options);
+                });
+                result.metrics["umbrella_ms"] = umbrella;
+                result.metrics["speedup"] = umbrella / result.value;
+                result.metrics["headers"] = static_cast<double>(fk::jit_internal::coreHeaders().size() + headers->size());
+                suite.report(result);
+            }
+        });
+    }
+} // namespace jit_bench
+
+#endif // FK_BENCH_JIT_COMPILE
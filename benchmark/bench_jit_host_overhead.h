@@ -0,0 +1,152 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_BENCH_JIT_HOST_OVERHEAD
+#define FK_BENCH_JIT_HOST_OVERHEAD
+
+// Host side work of the JIT executors that does not need a GPU:
+// - host/type_to_string and host/name_expression: building the kernel names
+// - host/arguments: marshalling the kernel arguments of a launch
+// - host/kernel_lookup: resolving the kernel of a warm launch of the templated executor, with the
+//   name expression lookup it did before, and with the compile time keyed slot it uses now
+
+#include <benchmark/jit_bench.h>
+#include <fused_kernel/core/utils/type_to_string.h>
+#include <src/jit_kernel_key.h>
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace jit_bench {
+    inline void reportSample(Suite& suite, const std::map<std::string, std::string>& params, const Sample& sample) {
+        Result result;
+        result.params = params;
+        result.unit = "ns";
+        result.value = sample.nanoseconds;
+        result.metrics["allocations"] = sample.allocations;
+        suite.report(result);
+    }
+
+    inline void addHostOverheadBenchmarks(Suite& suite) {
+        suite.add("host/type_to_string", false, [](Suite& suite) {
+            const fk::RawPtr<fk::_2D, float> raw{ nullptr, { 64, 64, 64 * sizeof(float) } };
+            const auto read_op = fk::PerThreadRead<fk::_2D, float>::build(raw);
+            const auto details = fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED>::build_details(read_op, fk::Mul<float>::build(2.f),
+                                                                                                          fk::PerThreadWrite<fk::_2D, float>::build(raw));
+            volatile size_t sink = 0;
+            reportSample(suite, { { "type", "operation" } }, measure(suite.iterations(200000), [&] {
+                sink = sink + fk::typeToString<std::decay_t<decltype(read_op)>>().size();
+            }));
+            reportSample(suite, { { "type", "details" } }, measure(suite.iterations(200000), [&] {
+                sink = sink + fk::typeToString<std::decay_t<decltype(details)>>().size();
+            }));
+        });
+
+        suite.add("host/name_expression", false, [](Suite& suite) {
+            const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+            volatile size_t sink = 0;
+            for (const size_t length : { 1, 4, 16 }) {
+                const std::vector<fk::JIT_Operation_pp> pipeline = arithmeticPipeline(raw, raw, length);
+                reportSample(suite, { { "ops", std::to_string(length) } }, measure(suite.iterations(200000), [&] {
+                    sink = sink + nameExpressionOf(pipeline).size();
+                }));
+            }
+        });
+
+        suite.add("host/arguments", false, [](Suite& suite) {
+            const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+            const auto read_op = fk::PerThreadRead<fk::_1D, float>::build(raw);
+            const auto mul_op = fk::Mul<float>::build(2.f);
+            const auto add_op = fk::Add<float>::build(5.f);
+            const auto write_op = fk::PerThreadWrite<fk::_1D, float>::build(raw);
+            const auto details = fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED>::build_details(read_op, mul_op, add_op, write_op);
+            const std::vector<fk::JIT_Operation_pp> pipeline = fk::jit_internal::buildOperationPipeline(read_op, mul_op, add_op, write_op);
+            volatile uintptr_t sink = 0;
+            // Descriptors built on every launch, like the first version of the executor
+            reportSample(suite, { { "path", "descriptors" } }, measure(suite.iterations(200000), [&] {
+                const std::vector<fk::JIT_Operation_pp> ops = fk::jit_internal::buildOperationPipeline(read_op, mul_op, add_op, write_op);
+                std::vector<void*> args = fk::jit_internal::buildKernelArguments(ops);
+                args.insert(args.begin(), (void*)&details);
+                sink = sink + reinterpret_cast<uintptr_t>(args[0]);
+            }));
+            // Runtime pipelines: pointers to the descriptors that already exist
+            reportSample(suite, { { "path", "runtime" } }, measure(suite.iterations(200000), [&] {
+                thread_local std::vector<void*> args;
+                args.clear();
+                args.push_back((void*)&details);
+                for (const auto& op : pipeline) {
+                    args.push_back(op.getData());
+                }
+                sink = sink + reinterpret_cast<uintptr_t>(args[0]);
+            }));
+            // A single packed parameter block
+            reportSample(suite, { { "path", "packed" } }, measure(suite.iterations(200000), [&] {
+                fk::JitParamBuffer& params = fk::JitParamBuffer::threadLocal();
+                params.pack(fk::JitParamView{ &details, sizeof(details), alignof(decltype(details)) }, pipeline);
+                sink = sink + params.size();
+            }));
+            // The templated executor: pointers to the operations on the stack
+            reportSample(suite, { { "path", "typed" } }, measure(suite.iterations(200000), [&] {
+                void* args[] = { (void*)&details, (void*)&read_op, (void*)&mul_op, (void*)&add_op, (void*)&write_op };
+                sink = sink + reinterpret_cast<uintptr_t>(args[0]);
+            }));
+        });
+
+        suite.add("host/kernel_lookup", false, [](Suite& suite) {
+            const fk::RawPtr<fk::_2D, float> rawIn{ nullptr, { 64, 64, 64 * sizeof(float) } };
+            const fk::RawPtr<fk::_2D, float> rawOut{ nullptr, { 64, 64, 64 * sizeof(float) } };
+            const auto read_op = fk::PerThreadRead<fk::_2D, float>::build(rawIn);
+            const auto mul_op = fk::Mul<float>::build(2.f);
+            const auto add_op = fk::Add<float>::build(5.f);
+            const auto write_op = fk::PerThreadWrite<fk::_2D, float>::build(rawOut);
+            using TDPPDetails = decltype(fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED>::build_details(read_op, mul_op, add_op, write_op));
+            // Nothing is launched, so the kernel does not need a module
+            const auto fakeKernel = std::make_shared<const fk::JitFkKernel>();
+            volatile uintptr_t sink = 0;
+
+            // Before: strings, name expression and hash map lookup on every launch
+            fk::JitShardedCache<std::shared_ptr<const fk::JitFkKernel>> cache;
+            const auto kernelName = [] {
+                return std::string("launchTransformDPP_Kernel<ParArch::GPU_NVIDIA, ") + "TF::DISABLED" + ", " + "true" + ", " +
+                       fk::typeToString<TDPPDetails>() + ", ";
+            };
+            cache.getOrCompile(fk::jit_internal::buildNameExpression(kernelName(), fk::jit_internal::buildOperationPipeline(read_op, mul_op, add_op, write_op)),
+                               [&] { return fakeKernel; });
+            reportSample(suite, { { "path", "name_expression" } }, measure(suite.iterations(200000), [&] {
+                const auto pipeline = fk::jit_internal::buildOperationPipeline(read_op, mul_op, add_op, write_op);
+                const auto kernel = *cache.find(fk::jit_internal::buildNameExpression(kernelName(), pipeline));
+                sink = sink + reinterpret_cast<uintptr_t>(kernel->getKernelFunction());
+            }));
+
+            // After: the launch guard and a few atomic loads
+            using Slot = fk::JitKernelSlot<fk::JitKernelKey<fk::TF::DISABLED, true, TDPPDetails,
+                std::decay_t<decltype(read_op)>, std::decay_t<decltype(mul_op)>, std::decay_t<decltype(add_op)>, std::decay_t<decltype(write_op)>>>;
+            const std::atomic<uint64_t> generation{ 1 };
+            std::shared_mutex launchMutex;
+            Slot::set(0, fakeKernel.get(), generation);
+            reportSample(suite, { { "path", "static_slot" } }, measure(suite.iterations(200000), [&] {
+                const std::shared_lock<std::shared_mutex> launchGuard(launchMutex);
+                const fk::JitFkKernel* kernel = Slot::get(0, generation.load(std::memory_order_acquire));
+                kernel->touch(1);
+                sink = sink + reinterpret_cast<uintptr_t>(kernel->getKernelFunction());
+            }));
+            Slot::reset();
+        });
+    }
+} // namespace jit_bench
+
+#endif // FK_BENCH_JIT_HOST_OVERHEAD
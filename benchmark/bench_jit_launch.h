@@ -0,0 +1,74 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_BENCH_JIT_LAUNCH
+#define FK_BENCH_JIT_LAUNCH
+
+// End to end launch overhead of warm kernels, with a small image so that the host side dominates:
+// - launch/typed: the templated JIT executor
+// - launch/runtime: a pipeline assembled at runtime
+// The value is the host time of one launch. us_synced also includes waiting for all the kernels.
+
+#include <benchmark/jit_bench.h>
+#include <src/jit_operation_executor.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace jit_bench {
+    template <typename Launch>
+    void reportLaunches(Suite& suite, fk::Stream_<fk::ParArch::GPU_NVIDIA_JIT>& stream, const std::string& path, Launch&& launch) {
+        // Compiles or loads the kernel
+        launch();
+        stream.sync();
+        const size_t iterations = suite.iterations(10000);
+        const auto start = std::chrono::steady_clock::now();
+        const Sample sample = measure(iterations, launch);
+        stream.sync();
+        const double syncedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Result result;
+        result.params["path"] = path;
+        result.unit = "ns";
+        result.value = sample.nanoseconds;
+        result.metrics["allocations"] = sample.allocations;
+        result.metrics["us_synced"] = syncedSeconds * 1e6 / iterations;
+        suite.report(result);
+    }
+
+    inline void addLaunchBenchmarks(Suite& suite) {
+        suite.add("launch/end_to_end", true, [](Suite& suite) {
+            constexpr uint N = 1024;
+            using JITExecutor = fk::Executor<fk::TransformDPP<fk::ParArch::GPU_NVIDIA_JIT>>;
+            fk::Stream_<fk::ParArch::GPU_NVIDIA_JIT> stream;
+            fk::Ptr1D<float> input(N);
+            fk::Ptr1D<float> output(N);
+
+            const auto read_op = fk::PerThreadRead<fk::_1D, float>::build(input.ptr());
+            const auto mul_op = fk::Mul<float>::build(2.f);
+            const auto add_op = fk::Add<float>::build(5.f);
+            const auto write_op = fk::PerThreadWrite<fk::_1D, float>::build(output.ptr());
+            reportLaunches(suite, stream, "typed", [&] {
+                JITExecutor::executeOperations(stream, read_op, mul_op, add_op, write_op);
+            });
+
+            const std::vector<fk::JIT_Operation_pp> pipeline = arithmeticPipeline(input.ptr(), output.ptr(), 2, 4);
+            reportLaunches(suite, stream, "runtime", [&] {
+                JITExecutor::executeOperations(stream, pipeline);
+            });
+        });
+    }
+} // namespace jit_bench
+
+#endif // FK_BENCH_JIT_LAUNCH
@@ -0,0 +1,240 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_BENCH_H
+#define FK_JIT_BENCH_H
+
+// Minimal benchmark harness of jit_fkl_bench. Every case reports one or more results, which are
+// printed and written as JSON, so that runs on the same host can be compared to track regressions.
+
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor_cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jit_bench {
+    // Incremented by the global operator new of jit_fkl_bench.cpp
+    inline std::atomic<size_t> allocations{ 0 };
+
+    struct Result {
+        std::string name;
+        // What the case was run with, like the number of operations of the pipeline
+        std::map<std::string, std::string> params;
+        std::string unit;
+        double value{ 0.0 };
+        // Secondary measurements of the same run
+        std::map<std::string, double> metrics;
+        bool skipped{ false };
+        std::string error;
+    };
+
+    // Time and heap allocations per iteration of a loop
+    struct Sample {
+        double nanoseconds{ 0.0 };
+        double allocations{ 0.0 };
+    };
+
+    template <typename Body>
+    Sample measure(const size_t iterations, Body&& body) {
+        const size_t allocationsBefore = allocations;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            body();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        Sample sample;
+        sample.nanoseconds = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+        sample.allocations = static_cast<double>(allocations - allocationsBefore) / iterations;
+        return sample;
+    }
+
+    // Median of repetitions, for measurements too slow to run in a loop like NVRTC compilations
+    template <typename Body>
+    double medianMilliseconds(const size_t repetitions, Body&& body) {
+        std::vector<double> times;
+        for (size_t i = 0; i < repetitions; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            const auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    // A read, length arithmetic operations and a write. The combination selects the arithmetic
+    // operations, so that pipelines of the same length have different op types.
+    inline std::vector<fk::JIT_Operation_pp> arithmeticPipeline(const fk::RawPtr<fk::_1D, float>& input,
+                                                                const fk::RawPtr<fk::_1D, float>& output,
+                                                                const size_t length, size_t combination = 0) {
+        const std::vector<fk::JIT_Operation_pp> arithmetic{ fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f)),
+                                                            fk::jit_internal::buildOperation(fk::Add<float>::build(5.f)),
+                                                            fk::jit_internal::buildOperation(fk::Sub<float>::build(1.f)),
+                                                            fk::jit_internal::buildOperation(fk::Div<float>::build(3.f)) };
+        std::vector<fk::JIT_Operation_pp> pipeline{ fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(input)) };
+        for (size_t i = 0; i < length; ++i) {
+            pipeline.push_back(arithmetic[combination % arithmetic.size()]);
+            combination /= arithmetic.size();
+        }
+        pipeline.push_back(fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(output)));
+        return pipeline;
+    }
+
+    inline std::string nameExpressionOf(const std::vector<fk::JIT_Operation_pp>& pipeline) {
+        return fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipeline), pipeline);
+    }
+
+    struct Options {
+        // Only the cases whose name contains it
+        std::string filter;
+        // Fewer sizes and iterations, for a smoke run
+        bool quick{ false };
+    };
+
+    class Suite {
+    public:
+        using Body = std::function<void(Suite&)>;
+    private:
+        struct Case {
+            std::string name;
+            bool requiresGpu;
+            Body body;
+        };
+        std::vector<Case> m_cases;
+        std::vector<Result> m_results;
+        std::map<std::string, std::string> m_environment;
+        Options m_options;
+        bool m_hasGpu{ false };
+        std::string m_currentCase;
+    public:
+        explicit Suite(const Options& options) : m_options(options) {
+            int deviceCount{ 0 };
+            m_hasGpu = cuInit(0) == CUDA_SUCCESS && cuDeviceGetCount(&deviceCount) == CUDA_SUCCESS && deviceCount > 0;
+            m_environment["gpu"] = m_hasGpu ? "available" : "none";
+        }
+
+        bool hasGpu() const { return m_hasGpu; }
+        const Options& options() const { return m_options; }
+
+        size_t iterations(const size_t full) const {
+            return m_options.quick ? std::max<size_t>(1, full / 20) : full;
+        }
+
+        void setEnvironment(const std::string& key, const std::string& value) {
+            m_environment[key] = value;
+        }
+
+        // Cases that need a device are reported as skipped on hosts without one
+        void add(const std::string& name, const bool requiresGpu, Body body) {
+            m_cases.push_back({ name, requiresGpu, std::move(body) });
+        }
+
+        void report(Result result) {
+            if (result.name.empty()) {
+                result.name = m_currentCase;
+            }
+            std::cout << result.name;
+            for (const auto& param : result.params) {
+                std::cout << " " << param.first << "=" << param.second;
+            }
+            std::cout << ": " << result.value << " " << result.unit;
+            for (const auto& metric : result.metrics) {
+                std::cout << ", " << metric.first << " " << metric.second;
+            }
+            std::cout << std::endl;
+            m_results.push_back(std::move(result));
+        }
+
+        // Returns the number of cases that failed
+        int run() {
+            int failures = 0;
+            for (const Case& benchCase : m_cases) {
+                if (benchCase.name.find(m_options.filter) == std::string::npos) {
+                    continue;
+                }
+                m_currentCase = benchCase.name;
+                if (benchCase.requiresGpu && !m_hasGpu) {
+                    Result result;
+                    result.name = benchCase.name;
+                    result.skipped = true;
+                    std::cout << benchCase.name << ": skipped, no CUDA device" << std::endl;
+                    m_results.push_back(std::move(result));
+                    continue;
+                }
+                try {
+                    benchCase.body(*this);
+                } catch (const std::exception& e) {
+                    Result result;
+                    result.name = benchCase.name;
+                    result.error = e.what();
+                    std::cout << benchCase.name << ": ERROR " << e.what() << std::endl;
+                    m_results.push_back(std::move(result));
+                    failures++;
+                }
+            }
+            return failures;
+        }
+
+        std::string toJson() const {
+            std::ostringstream json;
+            json << "{\n  \"schema\": 1,\n  \"environment\": {";
+            bool first = true;
+            for (const auto& entry : m_environment) {
+                json << (first ? "" : ",") << "\n    " << fk::jit_internal::jsonString(entry.first) << ": " << fk::jit_internal::jsonString(entry.second);
+                first = false;
+            }
+            json << "\n  },\n  \"results\": [";
+            for (size_t i = 0; i < m_results.size(); ++i) {
+                const Result& result = m_results[i];
+                json << (i == 0 ? "" : ",") << "\n    { \"name\": " << fk::jit_internal::jsonString(result.name) << ", \"params\": {";
+                first = true;
+                for (const auto& param : result.params) {
+                    json << (first ? " " : ", ") << fk::jit_internal::jsonString(param.first) << ": " << fk::jit_internal::jsonString(param.second);
+                    first = false;
+                }
+                json << " }";
+                if (result.skipped) {
+                    json << ", \"skipped\": true";
+                } else if (!result.error.empty()) {
+                    json << ", \"error\": " << fk::jit_internal::jsonString(result.error);
+                } else {
+                    json << ", \"unit\": " << fk::jit_internal::jsonString(result.unit) << ", \"value\": " << fk::jit_internal::jsonNumber(result.value) << ", \"metrics\": {";
+                    first = true;
+                    for (const auto& metric : result.metrics) {
+                        json << (first ? " " : ", ") << fk::jit_internal::jsonString(metric.first) << ": " << fk::jit_internal::jsonNumber(metric.second);
+                        first = false;
+                    }
+                    json << " }";
+                }
+                json << " }";
+            }
+            json << "\n  ]\n}\n";
+            return json.str();
+        }
+    };
+} // namespace jit_bench
+
+#endif // FK_JIT_BENCH_H
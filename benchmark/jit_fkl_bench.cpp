@@ -0,0 +1,83 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+// JIT benchmark suite.
+// Usage: jit_fkl_bench [--json <file>] [--filter <text>] [--quick]
+//   --json    Where the results are written (default: jit_fkl_bench.json)
+//   --filter  Only run the cases whose name contains the text, like "compile/" or "host/"
+//   --quick   Fewer sizes and iterations, for a smoke run
+// Cases that need a GPU are reported as skipped on hosts without one.
+
+#include <benchmark/bench_jit_compile.h>
+#include <benchmark/bench_jit_host_overhead.h>
+#include <benchmark/bench_jit_cache.h>
+#include <benchmark/bench_jit_launch.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+
+// Counts the heap allocations of the measured code. This is the only translation unit of the
+// benchmark that replaces them.
+void* operator new(size_t size) {
+    jit_bench::allocations++;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+int main(int argc, char** argv) {
+    jit_bench::Options options;
+    std::string jsonPath = "jit_fkl_bench.json";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--json <file>] [--filter <text>] [--quick]" << std::endl;
+            return 2;
+        }
+    }
+
+    jit_bench::Suite suite(options);
+    suite.setEnvironment("nvrtc", fk::jit_internal::nvrtcVersionString());
+    suite.setEnvironment("mode", options.quick ? "quick" : "full");
+    jit_bench::addCompileBenchmarks(suite);
+    jit_bench::addHostOverheadBenchmarks(suite);
+    jit_bench::addCacheBenchmarks(suite);
+    jit_bench::addLaunchBenchmarks(suite);
+    const int failures = suite.run();
+
+    std::ofstream json(jsonPath);
+    json << suite.toJson();
+    if (!json) {
+        std::cerr << "Could not write " << jsonPath << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << jsonPath << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+# Generates the source of the fkl_jit_embedded_headers library:
+# - the FKL headers, that JIT programs get from memory instead of reading them from the include path
+# - an index of the class templates, structs, aliases and kernels that each header defines, so that
+#   a program only includes the headers of the templates its kernels use
+# Usage: cmake -DFKL_INCLUDE_DIR=<fkl/include> -DOUTPUT=<source.cpp> -P FklEmbedHeaders.cmake
+
+if(NOT FKL_INCLUDE_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "FklEmbedHeaders.cmake needs FKL_INCLUDE_DIR and OUTPUT")
+endif()
+
+file(GLOB_RECURSE HEADERS "${FKL_INCLUDE_DIR}/*.h" "${FKL_INCLUDE_DIR}/*.cuh")
+list(SORT HEADERS)
+
+set(IDENTIFIER "[A-Za-z_][A-Za-z0-9_]*")
+# Template parameter lists with one level of nested template arguments
+set(TEMPLATE_PREFIX "^[ \t]*template[ \t]*<[^<>]*(<[^<>]*>[^<>]*)*>[ \t]*")
+
+set(DATA "")
+set(HEADER_TABLE "")
+set(SYMBOL_TABLE "")
+set(SYMBOLS "")
+set(INDEX 0)
+foreach(HEADER ${HEADERS})
+    file(RELATIVE_PATH NAME "${FKL_INCLUDE_DIR}" "${HEADER}")
+    file(READ "${HEADER}" CONTENT HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," CONTENT "${CONTENT}")
+    string(APPEND DATA "    const unsigned char header${INDEX}[] = { ${CONTENT}0x00 };\n")
+    string(APPEND HEADER_TABLE "                { \"${NAME}\", reinterpret_cast<const char*>(header${INDEX}) },\n")
+    math(EXPR INDEX "${INDEX} + 1")
+
+    # Forward declarations and specializations are skipped, so the header of the primary template is indexed.
+    # Lines with ';' are split by file(STRINGS), the part before it is enough.
+    file(STRINGS "${HEADER}" LINES REGEX "(struct|class|using|__global__)")
+    foreach(LINE ${LINES})
+        string(REGEX REPLACE "${TEMPLATE_PREFIX}" "" DECLARATION "${LINE}")
+        set(SYMBOL "")
+        if(DECLARATION MATCHES "^[ \t]*(struct|class)[ \t]+(${IDENTIFIER})[ \t]*(final)?[ \t]*([:{]|$)")
+            set(SYMBOL "${CMAKE_MATCH_2}")
+        elseif(DECLARATION MATCHES "^[ \t]*using[ \t]+(${IDENTIFIER})[ \t]*=")
+            set(SYMBOL "${CMAKE_MATCH_1}")
+        elseif(DECLARATION MATCHES "__global__[ \t]+void[ \t]+(${IDENTIFIER})[ \t]*\\(")
+            set(SYMBOL "${CMAKE_MATCH_1}")
+        endif()
+        if(SYMBOL)
+            list(FIND SYMBOLS "${SYMBOL}" FOUND)
+            if(FOUND EQUAL -1)
+                list(APPEND SYMBOLS "${SYMBOL}")
+                string(APPEND SYMBOL_TABLE "                { \"${SYMBOL}\", \"${NAME}\" },\n")
+            endif()
+        endif()
+    endforeach()
+endforeach()
+
+set(GENERATED "// Generated from the FKL headers by cmake/FklEmbedHeaders.cmake. Do not edit.
+#include <src/jit_embedded_headers.h>
+
+namespace {
+${DATA}} // namespace
+
+namespace fk {
+    namespace jit_internal {
+        const JitEmbeddedHeader* fklEmbeddedHeaders(size_t* count) {
+            static const JitEmbeddedHeader headers[] = {
+${HEADER_TABLE}                { nullptr, nullptr }
+            };
+            *count = sizeof(headers) / sizeof(headers[0]) - 1;
+            return headers;
+        }
+
+        const JitHeaderSymbol* fklHeaderSymbols(size_t* count) {
+            static const JitHeaderSymbol symbols[] = {
+${SYMBOL_TABLE}                { nullptr, nullptr }
+            };
+            *count = sizeof(symbols) / sizeof(symbols[0]) - 1;
+            return symbols;
+        }
+    } // namespace jit_internal
+} // namespace fk
+")
+
+# Rewritten only when it changes, so the library is not rebuilt for nothing
+file(WRITE "${OUTPUT}.tmp" "${GENERATED}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
+list(LENGTH HEADERS HEADER_COUNT)
+list(LENGTH SYMBOLS SYMBOL_COUNT)
+message(STATUS "Embedded ${HEADER_COUNT} FKL headers, ${SYMBOL_COUNT} indexed symbols")
@@ -0,0 +1,29 @@
+# Generates fkl_headers_hash.h, which defines FKL_HEADERS_HASH as the digest of the FKL headers.
+# It is part of the JIT disk cache key, so entries compiled with other headers are never reused.
+# Usage: cmake -DFKL_INCLUDE_DIR=<fkl/include> -DOUTPUT=<fkl_headers_hash.h> -P FklHeadersHash.cmake
+
+if(NOT FKL_INCLUDE_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "FklHeadersHash.cmake needs FKL_INCLUDE_DIR and OUTPUT")
+endif()
+
+file(GLOB_RECURSE HEADERS "${FKL_INCLUDE_DIR}/*.h" "${FKL_INCLUDE_DIR}/*.cuh")
+list(SORT HEADERS)
+
+set(DIGEST "")
+foreach(HEADER ${HEADERS})
+    file(RELATIVE_PATH NAME "${FKL_INCLUDE_DIR}" "${HEADER}")
+    file(SHA1 "${HEADER}" HEADER_HASH)
+    string(APPEND DIGEST "${NAME}:${HEADER_HASH};")
+endforeach()
+string(SHA1 HEADERS_HASH "${DIGEST}")
+
+set(GENERATED "// Generated from the FKL headers by cmake/FklHeadersHash.cmake. Do not edit.
+#ifndef FKL_HEADERS_HASH
+#define FKL_HEADERS_HASH \"${HEADERS_HASH}\"
+#endif
+")
+
+# Rewritten only when it changes, so the sources that include it are not rebuilt for nothing
+file(WRITE "${OUTPUT}.tmp" "${GENERATED}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,241 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_BATCH_FUSION_H
+#define FK_JIT_BATCH_FUSION_H
+
+#include <src/jit_operation_pp.h>
+#include <src/jit_kernel_params.h>
+#include <src/jit_runtime_pipeline.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fk {
+    // Classic limit of the kernel parameters of a launch, in bytes
+    constexpr size_t JIT_MAX_KERNEL_PARAM_BYTES = 4096;
+
+    struct JitBatchPolicy {
+        // Maximum number of pipelines launched by one batched kernel
+        size_t maxPlanes{ 64 };
+
+        static JitBatchPolicy fromEnvironment() {
+            JitBatchPolicy policy;
+            if (const char* maxPlanes = std::getenv("FK_JIT_BATCH_MAX_PLANES")) {
+                policy.maxPlanes = std::max<size_t>(1, static_cast<size_t>(std::strtoull(maxPlanes, nullptr, 10)));
+            }
+            return policy;
+        }
+    };
+
+    // Launches of a set of independent runtime pipelines. Each launch runs the pipelines of its indices,
+    // one per plane. Launches with a single pipeline use the regular runtime kernel.
+    struct JitBatchPlan {
+        std::vector<std::vector<size_t>> launches;
+
+        size_t kernels() const {
+            return launches.size();
+        }
+    };
+
+    namespace jit_internal {
+        // Source added to every JIT program for batched runtime pipelines. A JitBatchPlane holds the
+        // operations of one pipeline, packed like kernel parameters, and the kernel runs plane blockIdx.z.
+        // Like in the FKL batch operations, the plane is the z coordinate of the thread, so only pipelines
+        // of a single plane are batched. With thread fusion disabled the details carry no runtime data.
+        inline const char* batchPrologue() {
+            return R"(
+                namespace fk {
+                    namespace jit_internal {
+                        template <unsigned int I, typename T, typename... Ts>
+                        struct JitTypeAt { using type = typename JitTypeAt<I - 1, Ts...>::type; };
+                        template <typename T, typename... Ts>
+                        struct JitTypeAt<0, T, Ts...> { using type = T; };
+
+                        template <typename... Ts>
+                        __host__ __device__ constexpr size_t jitPackedOffset(const unsigned int index) {
+                            const size_t sizes[] = { sizeof(Ts)... };
+                            const size_t alignments[] = { alignof(Ts)... };
+                            size_t offset = 0;
+                            for (unsigned int i = 0; i < sizeof...(Ts); ++i) {
+                                offset = (offset + alignments[i] - 1) / alignments[i] * alignments[i];
+                                if (i == index) {
+                                    return offset;
+                                }
+                                offset += sizes[i];
+                            }
+                            return offset;
+                        }
+
+                        template <typename... Ts>
+                        __host__ __device__ constexpr size_t jitPackedAlignment() {
+                            const size_t alignments[] = { alignof(Ts)... };
+                            size_t alignment = 1;
+                            for (unsigned int i = 0; i < sizeof...(Ts); ++i) {
+                                alignment = alignments[i] > alignment ? alignments[i] : alignment;
+                            }
+                            return alignment;
+                        }
+
+                        template <typename TDPPDetails, typename... IOps>
+                        struct JitBatchPlane {
+                            static constexpr size_t ALIGNMENT = jitPackedAlignment<IOps...>();
+                            static constexpr size_t SIZE = (jitPackedOffset<IOps...>(sizeof...(IOps)) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+                            alignas(ALIGNMENT) unsigned char bytes[SIZE];
+
+                            template <unsigned int I, typename... Unpacked>
+                            __device__ __forceinline__ void exec(const Unpacked&... unpacked) const {
+                                if constexpr (I == sizeof...(IOps)) {
+                                    fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED, TDPPDetails>::template exec<true>(
+                                        TDPPDetails{}, unpacked...);
+                                } else {
+                                    using IOp = typename JitTypeAt<I, IOps...>::type;
+                                    this->template exec<I + 1>(unpacked..., *reinterpret_cast<const IOp*>(bytes + jitPackedOffset<IOps...>(I)));
+                                }
+                            }
+                        };
+
+                        template <unsigned int PLANES, typename Plane>
+                        struct JitBatchPlanes {
+                            Plane planes[PLANES];
+                        };
+
+                        template <unsigned int PLANES, typename TDPPDetails, typename... IOps>
+                        __global__ void launchBatchedTransformDPP_Kernel(const JitBatchPlanes<PLANES, JitBatchPlane<TDPPDetails, IOps...>> batch) {
+                            if (blockIdx.z < PLANES) {
+                                batch.planes[blockIdx.z].template exec<0>();
+                            }
+                        }
+                    } // namespace jit_internal
+                } // namespace fk
+            )";
+        }
+
+        // Layout of the operations of a pipeline in a JitBatchPlane
+        struct JitPlaneLayout {
+            size_t alignment{ 1 };
+            // Padded to the alignment, like the size of a struct
+            size_t size{ 0 };
+            std::vector<size_t> offsets;
+        };
+
+        inline JitPlaneLayout batchPlaneLayout(const std::vector<JIT_Operation_pp>& pipeline) {
+            JitPlaneLayout layout;
+            size_t offset = 0;
+            for (const auto& op : pipeline) {
+                const JitParamView param = toParamView(op);
+                offset = alignUp(offset, param.alignment);
+                layout.offsets.push_back(offset);
+                offset += param.size;
+                layout.alignment = std::max(layout.alignment, param.alignment);
+            }
+            layout.size = alignUp(offset, layout.alignment);
+            return layout;
+        }
+
+        // Pipelines of a single plane, with their grid in the read operation
+        inline bool isBatchable(const std::vector<JIT_Operation_pp>& pipeline) {
+            return pipeline.size() >= 2 && pipeline.front().hasActiveThreads() && pipeline.front().getActiveThreads()[2] == 1;
+        }
+
+        inline bool sameOperationTypes(const std::vector<JIT_Operation_pp>& a, const std::vector<JIT_Operation_pp>& b) {
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const JIT_Operation_pp& x, const JIT_Operation_pp& y) {
+                return x.getType() == y.getType();
+            });
+        }
+
+        // Batches the pipelines with the same op types, in the order they are given, so the batched kernels
+        // are the same from one frame to the next. A batch is closed when it reaches policy.maxPlanes or
+        // JIT_MAX_KERNEL_PARAM_BYTES. The pipelines must be independent, since the planes run concurrently.
+        inline JitBatchPlan planBatches(const std::vector<std::vector<JIT_Operation_pp>>& pipelines, const JitBatchPolicy& policy) {
+            JitBatchPlan plan;
+            // Launch that takes more pipelines of each signature
+            std::vector<size_t> open;
+            // JitPlaneLayout::size of the pipelines of each open launch
+            std::vector<size_t> openPlaneSizes;
+            for (size_t i = 0; i < pipelines.size(); ++i) {
+                const std::vector<JIT_Operation_pp>& pipeline = pipelines[i];
+                if (!isBatchable(pipeline)) {
+                    plan.launches.push_back({ i });
+                    continue;
+                }
+                const auto sameSignature = std::find_if(open.begin(), open.end(), [&](const size_t launch) {
+                    return sameOperationTypes(pipelines[plan.launches[launch].front()], pipeline);
+                });
+                if (sameSignature != open.end()) {
+                    const size_t openIndex = static_cast<size_t>(sameSignature - open.begin());
+                    std::vector<size_t>& launch = plan.launches[*sameSignature];
+                    const size_t bytes = (launch.size() + 1) * openPlaneSizes[openIndex];
+                    if (launch.size() < policy.maxPlanes && bytes <= JIT_MAX_KERNEL_PARAM_BYTES) {
+                        launch.push_back(i);
+                        continue;
+                    }
+                    open.erase(sameSignature);
+                    openPlaneSizes.erase(openPlaneSizes.begin() + openIndex);
+                }
+                plan.launches.push_back({ i });
+                open.push_back(plan.launches.size() - 1);
+                openPlaneSizes.push_back(batchPlaneLayout(pipeline).size);
+            }
+            return plan;
+        }
+
+        // Name expression of the batched kernel of planes pipelines with the op types of pipeline
+        inline std::string batchedNameExpression(const std::vector<JIT_Operation_pp>& pipeline, const size_t planes) {
+            const std::string types = joinOperationTypes(pipeline);
+            return "&fk::jit_internal::launchBatchedTransformDPP_Kernel<" + std::to_string(planes) +
+                   ", fk::jit_internal::RuntimeTransformDPPDetails<" + types + ">, " + types + ">";
+        }
+
+        // pipelineSignature, combined with the number of planes
+        inline uint64_t batchedSignature(const std::vector<JIT_Operation_pp>& pipeline, const size_t planes) {
+            return fnv1a64(&planes, sizeof(planes), pipelineSignature(pipeline));
+        }
+
+        // Packs the JitBatchPlanes parameter of a launch: the operations of each pipeline of the launch,
+        // one plane after the other. Padding bytes are zeroed.
+        inline void packBatch(JitParamBuffer& buffer, const std::vector<std::vector<JIT_Operation_pp>>& pipelines,
+                              const std::vector<size_t>& launch) {
+            const JitPlaneLayout layout = batchPlaneLayout(pipelines[launch.front()]);
+            if (layout.alignment > JitParamBuffer::MAX_ALIGNMENT) {
+                throw std::runtime_error("Kernel parameter alignment not supported by JitParamBuffer");
+            }
+            unsigned char* data = buffer.reserve(layout.size * launch.size());
+            memset(data, 0, layout.size * launch.size());
+            for (size_t plane = 0; plane < launch.size(); ++plane) {
+                const std::vector<JIT_Operation_pp>& pipeline = pipelines[launch[plane]];
+                for (size_t i = 0; i < pipeline.size(); ++i) {
+                    memcpy(data + plane * layout.size + layout.offsets[i], pipeline[i].getData(), pipeline[i].getSize());
+                }
+            }
+        }
+
+        // Threads of the largest plane, since planes can have different resolutions
+        inline void batchActiveThreads(const std::vector<std::vector<JIT_Operation_pp>>& pipelines, const std::vector<size_t>& launch,
+                                       unsigned int& x, unsigned int& y) {
+            x = 0;
+            y = 0;
+            for (const size_t i : launch) {
+                x = std::max(x, pipelines[i].front().getActiveThreads()[0]);
+                y = std::max(y, pipelines[i].front().getActiveThreads()[1]);
+            }
+        }
+    } // namespace jit_internal
+} // namespace fk
+
+#endif // FK_JIT_BATCH_FUSION_H
@@ -0,0 +1,270 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_BLOCK_TUNER_H
+#define FK_JIT_BLOCK_TUNER_H
+
+#include <cuda.h>
+
+#include <fused_kernel/core/utils/utils.h>
+#include <src/jit_kernel_disk_cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fk {
+    struct JitBlockShape {
+        unsigned int x{ 1 };
+        unsigned int y{ 1 };
+
+        unsigned int threads() const { return x * y; }
+        bool operator==(const JitBlockShape& other) const { return x == other.x && y == other.y; }
+    };
+
+    // A kernel and the class of input shapes a block shape is tuned for
+    struct JitTuningKey {
+        // Hash of the name expression of the kernel
+        uint64_t kernel{ 0 };
+        uint32_t shapeClass{ 0 };
+
+        bool operator==(const JitTuningKey& other) const { return kernel == other.kernel && shapeClass == other.shapeClass; }
+    };
+
+    // Time of a launch with a block shape, in any unit as long as lower is better
+    using JitBlockTimer = std::function<double(const JitBlockShape&)>;
+
+    namespace jit_internal {
+        struct JitTuningKeyHash {
+            size_t operator()(const JitTuningKey& key) const {
+                return static_cast<size_t>(key.kernel ^ (static_cast<uint64_t>(key.shapeClass) * 0x9E3779B97F4A7C15ull));
+            }
+        };
+
+        inline uint32_t ceilLog2(const uint32_t value) {
+            uint32_t log = 0;
+            while (log < 32 && (uint64_t{ 1 } << log) < value) {
+                log++;
+            }
+            return log;
+        }
+
+        // Inputs whose width and height round up to the same powers of two share the tuned block
+        inline uint32_t shapeClass(const unsigned int width, const unsigned int height, const unsigned int depth) {
+            return ceilLog2(width) | (ceilLog2(height) << 8) | (static_cast<uint32_t>(depth > 1) << 16);
+        }
+
+        // The default block, common 1D or 2D shapes, and the block size that maximizes occupancy
+        // according to the driver (0 if unknown). Shapes over maxThreadsPerBlock are left out.
+        inline std::vector<JitBlockShape> candidateBlocks(const unsigned int width, const unsigned int height,
+                                                          const JitBlockShape& defaultBlock, const int maxThreadsPerBlock,
+                                                          const int occupancyBlockSize) {
+            std::vector<JitBlockShape> shapes{ defaultBlock };
+            if (height <= 1) {
+                for (const unsigned int x : { 64u, 128u, 256u, 512u, 1024u }) {
+                    shapes.push_back({ x, 1 });
+                }
+                if (occupancyBlockSize > 0) {
+                    shapes.push_back({ static_cast<unsigned int>(occupancyBlockSize), 1 });
+                }
+            } else {
+                for (const JitBlockShape shape : { JitBlockShape{ 32, 4 }, JitBlockShape{ 32, 8 }, JitBlockShape{ 32, 16 },
+                                                   JitBlockShape{ 64, 4 }, JitBlockShape{ 64, 8 }, JitBlockShape{ 16, 16 },
+                                                   JitBlockShape{ 128, 2 }, JitBlockShape{ 256, 1 } }) {
+                    shapes.push_back(shape);
+                }
+                if (occupancyBlockSize >= 32) {
+                    shapes.push_back({ 32, static_cast<unsigned int>(occupancyBlockSize) / 32 });
+                }
+            }
+            std::vector<JitBlockShape> candidates;
+            for (const JitBlockShape& shape : shapes) {
+                const bool fits = maxThreadsPerBlock <= 0 || shape.threads() <= static_cast<unsigned int>(maxThreadsPerBlock);
+                if (fits && std::find(candidates.begin(), candidates.end(), shape) == candidates.end()) {
+                    candidates.push_back(shape);
+                }
+            }
+            return candidates;
+        }
+
+        // Milliseconds per launch, measured with driver events on the stream after a warm up launch
+        template <typename Launch>
+        double timeLaunches(CUstream stream, const int repetitions, Launch&& launch) {
+            CUevent start, stop;
+            gpuErrchk(cuEventCreate(&start, CU_EVENT_DEFAULT));
+            gpuErrchk(cuEventCreate(&stop, CU_EVENT_DEFAULT));
+            launch();
+            gpuErrchk(cuEventRecord(start, stream));
+            for (int i = 0; i < repetitions; ++i) {
+                launch();
+            }
+            gpuErrchk(cuEventRecord(stop, stream));
+            gpuErrchk(cuEventSynchronize(stop));
+            float milliseconds{ 0.f };
+            gpuErrchk(cuEventElapsedTime(&milliseconds, start, stop));
+            gpuErrchk(cuEventDestroy(start));
+            gpuErrchk(cuEventDestroy(stop));
+            return milliseconds / repetitions;
+        }
+    } // namespace jit_internal
+
+    // Opt-in empirical selection of the block shape of the JIT kernels. The first launch of a kernel
+    // for a class of input shapes times every candidate, and the fastest one is used from then on.
+    // The choices are stored in a text file, so later runs do not tune again.
+    // Tuning launches the kernel several times, so it must only be enabled for pipelines that do
+    // not write to their inputs. Enable it with FK_JIT_AUTOTUNE=1.
+    class JitBlockTuner {
+        std::filesystem::path m_path;
+        std::atomic<bool> m_enabled{ false };
+        mutable std::shared_mutex m_mutex;
+        std::unordered_map<JitTuningKey, JitBlockShape, jit_internal::JitTuningKeyHash> m_blocks;
+        // One tuning at a time, so that the timings do not disturb each other
+        std::mutex m_tuneMutex;
+        std::atomic<uint64_t> m_tunings{ 0 };
+        mutable std::atomic<uint64_t> m_tmpCounter{ 0 };
+
+        void load() {
+            std::ifstream in(m_path);
+            std::string kernel, shapeClass;
+            JitBlockShape shape;
+            while (in >> kernel >> shapeClass >> shape.x >> shape.y) {
+                const JitTuningKey key{ std::strtoull(kernel.c_str(), nullptr, 16), static_cast<uint32_t>(std::strtoul(shapeClass.c_str(), nullptr, 16)) };
+                if (shape.threads() > 0) {
+                    m_blocks[key] = shape;
+                }
+            }
+        }
+
+        // Best effort, like the disk cache. Written to a temporary file and renamed, so that other
+        // processes never read a partial file.
+        void persist() const {
+            if (m_path.empty()) {
+                return;
+            }
+            std::error_code ec;
+            std::filesystem::create_directories(m_path.parent_path(), ec);
+            std::filesystem::path tmpPath = m_path;
+            tmpPath += ".tmp." + std::to_string(jit_internal::currentProcessId()) + "." + std::to_string(m_tmpCounter++);
+            {
+                std::ofstream out(tmpPath, std::ios::trunc);
+                std::shared_lock<std::shared_mutex> lock(m_mutex);
+                for (const auto& entry : m_blocks) {
+                    out << jit_internal::toHexString(entry.first.kernel) << " " << std::hex << entry.first.shapeClass << std::dec << " "
+                        << entry.second.x << " " << entry.second.y << "\n";
+                }
+                if (!out) {
+                    out.close();
+                    std::filesystem::remove(tmpPath, ec);
+                    return;
+                }
+            }
+            std::filesystem::rename(tmpPath, m_path, ec);
+            if (ec) {
+                std::filesystem::remove(tmpPath, ec);
+            }
+        }
+    public:
+        // An empty path keeps the choices in memory only
+        explicit JitBlockTuner(const std::filesystem::path& path = {}, const bool enabled = enabledByEnvironment())
+            : m_path(path), m_enabled(enabled) {
+            if (!m_path.empty()) {
+                load();
+            }
+        }
+        JitBlockTuner(const JitBlockTuner&) = delete;
+        JitBlockTuner& operator=(const JitBlockTuner&) = delete;
+
+        static bool enabledByEnvironment() {
+            const char* autotune = std::getenv("FK_JIT_AUTOTUNE");
+            return autotune != nullptr && std::string(autotune) != "0";
+        }
+
+        bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+        void setEnabled(const bool enabled) { m_enabled = enabled; }
+        const std::filesystem::path& path() const { return m_path; }
+
+        std::optional<JitBlockShape> find(const JitTuningKey& key) const {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            const auto it = m_blocks.find(key);
+            if (it == m_blocks.end()) {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
+        // Returns the block shape tuned for key. If there is none, times every candidate with timer,
+        // stores the fastest one and persists it.
+        JitBlockShape tune(const JitTuningKey& key, const std::vector<JitBlockShape>& candidates, const JitBlockTimer& timer) {
+            if (const std::optional<JitBlockShape> tuned = find(key)) {
+                return *tuned;
+            }
+            std::lock_guard<std::mutex> tuneLock(m_tuneMutex);
+            // Another thread could have tuned it in the meantime
+            if (const std::optional<JitBlockShape> tuned = find(key)) {
+                return *tuned;
+            }
+            if (candidates.empty()) {
+                throw std::runtime_error("JitBlockTuner::tune needs at least one candidate block shape");
+            }
+            JitBlockShape best = candidates.front();
+            double bestTime = std::numeric_limits<double>::max();
+            for (const JitBlockShape& candidate : candidates) {
+                const double time = timer(candidate);
+                if (time < bestTime) {
+                    best = candidate;
+                    bestTime = time;
+                }
+            }
+            {
+                std::unique_lock<std::shared_mutex> lock(m_mutex);
+                m_blocks[key] = best;
+            }
+            m_tunings++;
+            persist();
+            return best;
+        }
+
+        size_t size() const {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            return m_blocks.size();
+        }
+
+        // Number of tunings run by this process
+        uint64_t tunings() const { return m_tunings; }
+
+        // Forgets every choice, also from the file
+        void clear() {
+            {
+                std::unique_lock<std::shared_mutex> lock(m_mutex);
+                m_blocks.clear();
+            }
+            std::error_code ec;
+            std::filesystem::remove(m_path, ec);
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_BLOCK_TUNER_H
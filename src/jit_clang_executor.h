@@ -0,0 +1,178 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_CLANG_EXECUTOR_H
+#define FK_JIT_CLANG_EXECUTOR_H
+
+#include "clang/Interpreter/Interpreter.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Error.h"
+
+#include <fused_kernel/core/utils/type_to_string.h>
+#include <src/jit_operation_pp.h>
+#include <src/jit_concurrent_cache.h>
+#include <src/jit_runtime_pipeline.h>
+
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fk {
+    namespace jit_internal {
+        // Parsed once by the interpreter. cpuTransformEntry runs the fused transform loop
+        // of FKL's CPU executor, taking the operations from an array of pointers.
+        inline const char* clangExecutorPrologue() {
+            return R"(
+                #include <fused_kernel/fused_kernel.h>
+                #include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+                #include <utility>
+                namespace fk {
+                    namespace jit_internal {
+                        template <typename... IOps, size_t... Idx>
+                        void cpuTransformEntryImpl(void** params, std::index_sequence<Idx...>) {
+                            Stream_<ParArch::CPU> stream;
+                            Executor<TransformDPP<ParArch::CPU, TF::DISABLED>>::executeOperations(
+                                stream, *static_cast<const IOps*>(params[Idx])...);
+                        }
+                        template <typename... IOps>
+                        void cpuTransformEntry(void** params) {
+                            cpuTransformEntryImpl<IOps...>(params, std::make_index_sequence<sizeof...(IOps)>{});
+                        }
+                    } // namespace jit_internal
+                } // namespace fk
+            )";
+        }
+
+        inline std::vector<std::string> clangExecutorArgs() {
+            // Optimized and auto-vectorized host code
+            std::vector<std::string> args{ "-std=c++17", "-O3", "-fvectorize", "-fslp-vectorize" };
+#if defined(FKL_INCLUDE_PATH)
+            args.push_back(std::string("-I") + FKL_INCLUDE_PATH);
+#endif
+#if defined(CUDA_INCLUDE_PATH)
+            args.push_back(std::string("-I") + CUDA_INCLUDE_PATH);
+#endif
+            return args;
+        }
+    } // namespace jit_internal
+
+    using CPUJITFunction = void (*)(void**);
+
+    // Singleton holding a single long lived clang::Interpreter, reused for all the pipelines,
+    // so that the FKL headers are only parsed once.
+    // The interpreter is not thread safe, so compilations are serialized. Lookups are not.
+    class CPUJITExecutorCache {
+        std::unique_ptr<clang::Interpreter> m_interpreter;
+        std::mutex m_interpreterMutex;
+        size_t m_functionCounter{ 0 };
+        JitShardedCache<CPUJITFunction> m_functionCache;
+        JitSignatureTable<CPUJITFunction> m_runtimeFunctions;
+
+        static void throwIfError(llvm::Error error, const std::string& what) {
+            if (error) {
+                throw std::runtime_error(what + ": " + llvm::toString(std::move(error)));
+            }
+        }
+
+        CPUJITFunction compileFunction(const std::string& nameExpression) {
+            std::lock_guard<std::mutex> lock(m_interpreterMutex);
+            // The same name expression as for NVRTC, wrapped in a C function to find it without mangling
+            const std::string functionName = "fk_cpu_jit_" + std::to_string(m_functionCounter++);
+            std::stringstream code;
+            code << "extern \"C\" void " << functionName << "(void** params) {\n"
+                 << "    constexpr auto entry = " << nameExpression << ";\n"
+                 << "    entry(params);\n"
+                 << "}\n";
+            throwIfError(m_interpreter->ParseAndExecute(code.str()), "Failed to compile CPU JIT pipeline " + nameExpression);
+            auto symbolAddress = m_interpreter->getSymbolAddress(functionName);
+            if (!symbolAddress) {
+                throw std::runtime_error("CPU JIT symbol not found " + functionName + ": " + llvm::toString(symbolAddress.takeError()));
+            }
+            return reinterpret_cast<CPUJITFunction>(symbolAddress->getValue());
+        }
+    public:
+        CPUJITExecutorCache() {
+            llvm::InitializeNativeTarget();
+            llvm::InitializeNativeTargetAsmPrinter();
+
+            const std::vector<std::string> args = jit_internal::clangExecutorArgs();
+            std::vector<const char*> argPtrs;
+            for (const auto& arg : args) {
+                argPtrs.push_back(arg.c_str());
+            }
+            clang::IncrementalCompilerBuilder builder;
+            builder.SetCompilerArgs(argPtrs);
+            auto compilerInstance = builder.CreateCpp();
+            if (!compilerInstance) {
+                throw std::runtime_error("Failed to create compiler instance: " + llvm::toString(compilerInstance.takeError()));
+            }
+            auto interpreter = clang::Interpreter::create(std::move(*compilerInstance));
+            if (!interpreter) {
+                throw std::runtime_error("Failed to create Clang interpreter: " + llvm::toString(interpreter.takeError()));
+            }
+            m_interpreter = std::move(*interpreter);
+            throwIfError(m_interpreter->ParseAndExecute(jit_internal::clangExecutorPrologue()), "Failed to parse the FKL headers");
+        }
+
+        static CPUJITExecutorCache& getInstance() {
+            static CPUJITExecutorCache instance;
+            return instance;
+        }
+
+        CPUJITFunction addFunction(const std::vector<JIT_Operation_pp>& pipeline) {
+            const uint64_t signature = jit_internal::pipelineSignature(pipeline);
+            if (const std::optional<CPUJITFunction> function = m_runtimeFunctions.find(signature, pipeline)) {
+                return *function;
+            }
+            const std::string nameExpression = jit_internal::buildNameExpression("fk::jit_internal::cpuTransformEntry<", pipeline);
+            const CPUJITFunction function = m_functionCache.getOrCompile(nameExpression, [&] { return compileFunction(nameExpression); });
+            m_runtimeFunctions.insert(signature, pipeline, function);
+            return function;
+        }
+
+        const JitShardedCache<CPUJITFunction>& getFunctionCache() const {
+            return m_functionCache;
+        }
+    };
+
+    // Host counterpart of the GPU_NVIDIA_JIT executor: fuses the pipeline into a single host loop,
+    // compiled at runtime by the Clang interpreter. It does not need a GPU.
+    struct CPUJITExecutor {
+        static void executeOperations(const std::vector<JIT_Operation_pp>& pipeline) {
+            if (pipeline.size() < 2) {
+                throw std::runtime_error("A CPU JIT pipeline needs at least a read and a write operation");
+            }
+            const CPUJITFunction function = CPUJITExecutorCache::getInstance().addFunction(pipeline);
+            thread_local std::vector<void*> params;
+            params.clear();
+            for (const auto& op : pipeline) {
+                params.push_back(op.getData());
+            }
+            function(params.data());
+        }
+
+        template <typename... IOps>
+        static void executeOperations(const IOps&... iOps) {
+            std::vector<JIT_Operation_pp> pipeline;
+            (pipeline.emplace_back(typeToString<IOps>(), &iOps, sizeof(IOps), alignof(IOps)), ...);
+            executeOperations(pipeline);
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_CLANG_EXECUTOR_H
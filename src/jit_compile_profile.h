@@ -0,0 +1,200 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_COMPILE_PROFILE_H
+#define FK_JIT_COMPILE_PROFILE_H
+
+#include <src/jit_kernel_disk_cache.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fk {
+    // NVRTC options added to the ones of every JIT program. Kernels compiled with different options
+    // are different kernels: they are cached, stored on disk and looked up in bundles separately.
+    struct JitCompileProfile {
+        // Only for reporting, two profiles with the same options share their kernels
+        std::string name{ "default" };
+        // --use_fast_math: approximate division, square root and transcendentals, and flushing denormals
+        bool fastMath{ false };
+        // --maxrregcount, 0 lets ptxas decide
+        unsigned int maxRegisters{ 0 };
+        // ptxas optimization level, from 0 to 3, or -1 for the default, which is 3
+        int optimizationLevel{ -1 };
+        // --generate-line-info, so that profilers map the SASS to the source
+        bool lineInfo{ false };
+        // --extra-device-vectorization
+        bool extraDeviceVectorization{ false };
+        // Passed as they are, after the others. They can not be empty or contain spaces.
+        std::vector<std::string> extraOptions;
+
+        // Throws if an extra option is empty or contains spaces, since the options are stored in the
+        // kernel keys separated by spaces
+        std::vector<std::string> options() const {
+            for (const auto& option : extraOptions) {
+                if (option.empty() || option.find_first_of(" \t\r\n") != std::string::npos) {
+                    throw std::runtime_error("JIT compile profile options can not be empty or contain spaces: '" + option + "'");
+                }
+            }
+            std::vector<std::string> result;
+            if (fastMath) {
+                result.push_back("--use_fast_math");
+            }
+            if (maxRegisters != 0) {
+                result.push_back("--maxrregcount=" + std::to_string(maxRegisters));
+            }
+            if (optimizationLevel >= 0) {
+                result.push_back("--ptxas-options=-O" + std::to_string(optimizationLevel < 3 ? optimizationLevel : 3));
+            }
+            if (lineInfo) {
+                result.push_back("--generate-line-info");
+            }
+            if (extraDeviceVectorization) {
+                result.push_back("--extra-device-vectorization");
+            }
+            result.insert(result.end(), extraOptions.begin(), extraOptions.end());
+            return result;
+        }
+
+        // The options of the default compilation
+        static JitCompileProfile precise() {
+            return JitCompileProfile{};
+        }
+
+        // Throughput over precision, for previews
+        static JitCompileProfile fast() {
+            JitCompileProfile profile;
+            profile.name = "fast";
+            profile.fastMath = true;
+            profile.extraDeviceVectorization = true;
+            return profile;
+        }
+
+        // Default code generation, with line information for Nsight Compute
+        static JitCompileProfile profiling() {
+            JitCompileProfile profile;
+            profile.name = "profiling";
+            profile.lineInfo = true;
+            return profile;
+        }
+
+        // One of the predefined profiles: "default" or "precise", "fast" and "profiling"
+        static JitCompileProfile named(const std::string& name) {
+            if (name == "default" || name == "precise") {
+                return precise();
+            }
+            if (name == "fast") {
+                return fast();
+            }
+            if (name == "profiling") {
+                return profiling();
+            }
+            throw std::runtime_error("Unknown JIT compile profile: " + name);
+        }
+
+        static JitCompileProfile fromEnvironment() {
+            const char* name = std::getenv("FK_JIT_PROFILE");
+            return name != nullptr ? named(name) : precise();
+        }
+    };
+
+    namespace jit_internal {
+        // Separates the name expression from the profile options in the kernel keys. Name expressions are
+        // C++ expressions, which never contain '@'.
+        constexpr const char* JIT_PROFILE_SEPARATOR = " @";
+
+        // The options of a profile as they are appended to the kernel keys, and their hash. Both are empty
+        // for a profile without options, so the keys of the default compilation are the name expressions.
+        struct JitProfileKey {
+            std::string suffix;
+            uint64_t hash{ 0 };
+
+            JitProfileKey() = default;
+            explicit JitProfileKey(const JitCompileProfile& profile) {
+                for (const auto& option : profile.options()) {
+                    suffix += (suffix.empty() ? JIT_PROFILE_SEPARATOR : " ") + option;
+                }
+                hash = suffix.empty() ? 0 : fnv1a64(suffix);
+            }
+        };
+
+        // Key of the kernel of nameExpression compiled with the profile
+        inline std::string profiledExpression(const std::string& nameExpression, const JitProfileKey& profile) {
+            return nameExpression + profile.suffix;
+        }
+
+        // Name expression of a kernel key
+        inline std::string keyNameExpression(const std::string& key) {
+            return key.substr(0, key.find(JIT_PROFILE_SEPARATOR));
+        }
+
+        // Profile options of a kernel key, empty for the default compilation
+        inline std::vector<std::string> keyProfileOptions(const std::string& key) {
+            std::vector<std::string> options;
+            const size_t separator = key.find(JIT_PROFILE_SEPARATOR);
+            if (separator == std::string::npos) {
+                return options;
+            }
+            size_t begin = separator + std::char_traits<char>::length(JIT_PROFILE_SEPARATOR);
+            while (begin < key.size()) {
+                const size_t end = std::min(key.find(' ', begin), key.size());
+                if (end > begin) {
+                    options.push_back(key.substr(begin, end - begin));
+                }
+                begin = end + 1;
+            }
+            return options;
+        }
+
+        // JitProfileKey::hash of the profile of a kernel key
+        inline uint64_t keyProfileHash(const std::string& key) {
+            const size_t separator = key.find(JIT_PROFILE_SEPARATOR);
+            return separator == std::string::npos ? 0 : fnv1a64(key.substr(separator));
+        }
+
+        // Signature of a runtime pipeline for the kernels compiled with the profile of profileHash
+        inline uint64_t profiledSignature(const uint64_t signature, const uint64_t profileHash) {
+            return profileHash == 0 ? signature : fnv1a64(&profileHash, sizeof(profileHash), signature);
+        }
+
+        // Profile selected by a JitProfileScope in the calling thread, nullptr if there is none
+        inline const JitProfileKey*& scopedProfile() {
+            thread_local const JitProfileKey* profile = nullptr;
+            return profile;
+        }
+    } // namespace jit_internal
+
+    // Compiles the kernels that the calling thread launches during its lifetime with profile, instead of
+    // the profile of the JITExecutorCache. Scopes can be nested.
+    class JitProfileScope {
+        jit_internal::JitProfileKey m_profile;
+        const jit_internal::JitProfileKey* m_previous;
+    public:
+        explicit JitProfileScope(const JitCompileProfile& profile)
+            : m_profile(profile), m_previous(jit_internal::scopedProfile()) {
+            jit_internal::scopedProfile() = &m_profile;
+        }
+        JitProfileScope(const JitProfileScope&) = delete;
+        JitProfileScope& operator=(const JitProfileScope&) = delete;
+        ~JitProfileScope() {
+            jit_internal::scopedProfile() = m_previous;
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_COMPILE_PROFILE_H
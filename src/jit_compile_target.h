@@ -0,0 +1,161 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_COMPILE_TARGET_H
+#define FK_JIT_COMPILE_TARGET_H
+
+#include <nvrtc.h>
+
+#include <src/jit_kernel_disk_cache.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fk {
+    // What NVRTC generates for a kernel: CUBIN for a real architecture, loaded by the driver without
+    // any further JIT, or PTX for a virtual architecture, which the driver JIT compiles on load.
+    // Architectures are compute capabilities as major * 10 + minor, like 86 for sm_86.
+    struct JitCompileTarget {
+        JitImageKind kind{ JitImageKind::PTX };
+        // 0 is the default virtual architecture of NVRTC
+        int arch{ 0 };
+
+        static JitCompileTarget cubin(const int arch) {
+            return { JitImageKind::CUBIN, arch };
+        }
+        static JitCompileTarget ptx(const int arch = 0) {
+            return { JitImageKind::PTX, arch };
+        }
+
+        std::string name() const {
+            if (arch == 0) {
+                return "default";
+            }
+            return (kind == JitImageKind::CUBIN ? "sm_" : "compute_") + std::to_string(arch);
+        }
+
+        // Empty for the default architecture
+        std::string option() const {
+            return arch == 0 ? std::string() : "--gpu-architecture=" + name();
+        }
+
+        // CUBIN runs on devices of the same major version and an equal or higher minor version.
+        // PTX runs on devices of an equal or higher compute capability.
+        bool canRunOn(const int deviceArch) const {
+            if (kind == JitImageKind::CUBIN) {
+                return arch / 10 == deviceArch / 10 && arch % 10 <= deviceArch % 10;
+            }
+            return arch <= deviceArch;
+        }
+
+        bool operator==(const JitCompileTarget& other) const {
+            return kind == other.kind && arch == other.arch;
+        }
+    };
+
+    namespace jit_internal {
+        // Real architectures supported by the NVRTC library in use
+        inline std::vector<int> nvrtcSupportedArchs() {
+            int numArchs{ 0 };
+            if (nvrtcGetNumSupportedArchs(&numArchs) != NVRTC_SUCCESS || numArchs <= 0) {
+                return {};
+            }
+            std::vector<int> archs(numArchs);
+            if (nvrtcGetSupportedArchs(archs.data()) != NVRTC_SUCCESS) {
+                return {};
+            }
+            return archs;
+        }
+
+        // Parses a list like "75;86" or "75,86,sm_89"
+        inline std::vector<int> parseArchList(const std::string& list) {
+            std::vector<int> archs;
+            std::string item;
+            std::stringstream ss(list);
+            while (std::getline(ss, item, list.find(';') != std::string::npos ? ';' : ',')) {
+                const size_t digits = item.find_first_of("0123456789");
+                if (digits != std::string::npos) {
+                    archs.push_back(std::atoi(item.c_str() + digits));
+                }
+            }
+            return archs;
+        }
+    } // namespace jit_internal
+
+    // Which artifacts are compiled for every kernel.
+    // By default, only the CUBIN of the current device. In multi-arch mode, a CUBIN for every listed
+    // architecture is also compiled, in the background, and stored in the disk cache, so that a cache
+    // directory shared by a heterogeneous fleet serves all its GPUs. With keepPtx, the PTX of the lowest
+    // architecture is also stored, as a forward compatible fallback for devices that have no CUBIN.
+    // From the environment: FK_JIT_ARCHS="75;86;89" and FK_JIT_KEEP_PTX=1.
+    struct JitArchConfig {
+        std::vector<int> archs;
+        bool keepPtx{ false };
+
+        static JitArchConfig fromEnvironment() {
+            JitArchConfig config;
+            if (const char* archs = std::getenv("FK_JIT_ARCHS")) {
+                config.archs = jit_internal::parseArchList(archs);
+            }
+            if (const char* keepPtx = std::getenv("FK_JIT_KEEP_PTX")) {
+                config.keepPtx = std::string(keepPtx) != "0";
+            }
+            return config;
+        }
+
+        // The targets to compile for a device, the one to load first. Architectures that NVRTC can
+        // not generate CUBIN for are skipped, and if the device is one of them, its PTX is compiled
+        // for the highest supported architecture instead.
+        std::vector<JitCompileTarget> targets(const int deviceArch, const std::vector<int>& supportedArchs) const {
+            const auto isSupported = [&](const int arch) {
+                return supportedArchs.empty() || std::find(supportedArchs.begin(), supportedArchs.end(), arch) != supportedArchs.end();
+            };
+            std::vector<JitCompileTarget> result;
+            const auto add = [&result](const JitCompileTarget& target) {
+                if (std::find(result.begin(), result.end(), target) == result.end()) {
+                    result.push_back(target);
+                }
+            };
+            if (isSupported(deviceArch)) {
+                add(JitCompileTarget::cubin(deviceArch));
+            } else {
+                int highest = 0;
+                for (const int arch : supportedArchs) {
+                    if (arch <= deviceArch) {
+                        highest = std::max(highest, arch);
+                    }
+                }
+                add(JitCompileTarget::ptx(highest));
+            }
+            for (const int arch : archs) {
+                if (isSupported(arch)) {
+                    add(JitCompileTarget::cubin(arch));
+                }
+            }
+            if (keepPtx) {
+                int lowest = deviceArch;
+                for (const int arch : archs) {
+                    lowest = std::min(lowest, arch);
+                }
+                add(JitCompileTarget::ptx(lowest));
+            }
+            return result;
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_COMPILE_TARGET_H
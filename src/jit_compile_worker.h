@@ -0,0 +1,143 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_COMPILE_WORKER_H
+#define FK_JIT_COMPILE_WORKER_H
+
+#include <src/jit_concurrent_cache.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fk {
+    // Background threads that run compilation tasks in FIFO order.
+    // Pending tasks are discarded on destruction, and their cancel callbacks are called instead,
+    // so nobody waits forever on a compilation that will never happen.
+    class JitCompileWorker {
+        struct Task {
+            std::function<void()> run;
+            std::function<void()> cancel;
+        };
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::deque<Task> m_tasks;
+        std::vector<std::thread> m_threads;
+        bool m_stop{ false };
+
+        void run() {
+            while (true) {
+                Task task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+                    if (m_stop) {
+                        return;
+                    }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                task.run();
+            }
+        }
+    public:
+        explicit JitCompileWorker(unsigned int numThreads = 1) {
+            for (unsigned int i = 0; i < (numThreads == 0 ? 1 : numThreads); ++i) {
+                m_threads.emplace_back([this] { run(); });
+            }
+        }
+        JitCompileWorker(const JitCompileWorker&) = delete;
+        JitCompileWorker& operator=(const JitCompileWorker&) = delete;
+        ~JitCompileWorker() {
+            std::deque<Task> discarded;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+                discarded.swap(m_tasks);
+            }
+            m_condition.notify_all();
+            for (auto& thread : m_threads) {
+                thread.join();
+            }
+            for (auto& task : discarded) {
+                if (task.cancel) {
+                    task.cancel();
+                }
+            }
+        }
+
+        // cancel is called instead of task if the worker is destroyed before running it
+        void submit(std::function<void()> task, std::function<void()> cancel = {}) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.push_back({ std::move(task), std::move(cancel) });
+            }
+            m_condition.notify_one();
+        }
+
+        size_t pendingTasks() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_tasks.size();
+        }
+    };
+
+    // Returns immediately with the future of the value for key. On a miss, the value is
+    // created by compiler() in one of the worker threads. Concurrent calls for the same key
+    // share the same future, like JitShardedCache::getOrCompile. If the worker is destroyed before
+    // compiling it, the waiters receive an error and the key is removed from the cache.
+    template <typename Value, size_t NUM_SHARDS, typename Compiler>
+    std::shared_future<Value> getOrCompileAsync(JitShardedCache<Value, NUM_SHARDS>& cache, JitCompileWorker& worker,
+                                                const std::string& key, Compiler compiler) {
+        using Reservation = typename JitShardedCache<Value, NUM_SHARDS>::Reservation;
+        auto reservation = std::make_shared<Reservation>(cache.reserve(key));
+        std::shared_future<Value> future = reservation->future;
+        if (reservation->isOwner()) {
+            worker.submit([&cache, key, reservation, compiler = std::move(compiler)]() mutable {
+                try {
+                    cache.fulfill(*reservation, compiler());
+                } catch (...) {
+                    cache.fail(key, *reservation, std::current_exception());
+                }
+            }, [&cache, key, reservation] {
+                cache.fail(key, *reservation, std::make_exception_ptr(
+                    std::runtime_error("The JIT compile worker stopped before compiling " + key)));
+            });
+        }
+        return future;
+    }
+
+    namespace jit_internal {
+        // Calls launch(value) when the value is available, and fallback() while it is being compiled.
+        // Compilation errors are rethrown. Returns true if launch was called.
+        template <typename Value, typename Launch, typename Fallback>
+        bool launchOrFallback(const std::shared_future<Value>& future, Launch&& launch, Fallback&& fallback) {
+            if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                fallback();
+                return false;
+            }
+            launch(future.get());
+            return true;
+        }
+    } // namespace jit_internal
+} // namespace fk
+
+#endif // FK_JIT_COMPILE_WORKER_H
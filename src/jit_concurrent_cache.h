@@ -0,0 +1,248 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_CONCURRENT_CACHE_H
+#define FK_JIT_CONCURRENT_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace fk {
+    // Error of a compiler that will fail again with the same input, like an NVRTC compile error.
+    // Only these are kept as failed entries by JitShardedCache.
+    class JitCompileError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Thread safe cache of values that are expensive to create, like compiled kernels.
+    // The keys are distributed among NUM_SHARDS shards, each one with its own reader/writer lock,
+    // so that lookups from different threads only contend when they hit the same shard, and
+    // even then they only take a shared lock.
+    // Creation is single-flight: when several threads miss on the same key at the same time,
+    // only the first one runs the compiler and the rest wait for its result.
+    // If the compiler throws, all the waiters receive the exception. A JitCompileError is kept as a
+    // failed entry: later calls receive the same exception without compiling again, until the failure
+    // is cleared with clearFailure() or clearFailures(). Any other error, like a driver running out of
+    // memory, may not happen again, so the key is removed and the next call compiles it again.
+    template <typename Value, size_t NUM_SHARDS = 16>
+    class JitShardedCache {
+        static_assert(NUM_SHARDS > 0, "JitShardedCache needs at least one shard");
+        struct Entry {
+            std::shared_future<Value> future;
+            bool failed{ false };
+        };
+        struct Shard {
+            mutable std::shared_mutex mutex;
+            std::unordered_map<std::string, Entry> entries;
+        };
+        std::array<Shard, NUM_SHARDS> m_shards;
+        std::atomic<uint64_t> m_hits{ 0 };
+        std::atomic<uint64_t> m_misses{ 0 };
+        std::atomic<uint64_t> m_waits{ 0 };
+        std::atomic<uint64_t> m_failures{ 0 };
+
+        Shard& shardFor(const std::string& key) {
+            return m_shards[std::hash<std::string>{}(key) % NUM_SHARDS];
+        }
+        const Shard& shardFor(const std::string& key) const {
+            return m_shards[std::hash<std::string>{}(key) % NUM_SHARDS];
+        }
+        static bool isReady(const std::shared_future<Value>& future) {
+            return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }
+        static bool isCompileError(const std::exception_ptr& exception) {
+            try {
+                std::rethrow_exception(exception);
+            } catch (const JitCompileError&) {
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+    public:
+        // Returns the future of the value for key. If there is none, the calling thread
+        // registers a new one and is responsible for fulfilling it, which is signaled with
+        // isOwner == true. The owner must call fulfill() or fail() with the promise.
+        struct Reservation {
+            std::shared_future<Value> future;
+            std::optional<std::promise<Value>> promise;
+            bool isOwner() const { return promise.has_value(); }
+        };
+
+        Reservation reserve(const std::string& key) {
+            Shard& shard = shardFor(key);
+            {
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+                const auto it = shard.entries.find(key);
+                if (it != shard.entries.end()) {
+                    if (isReady(it->second.future)) {
+                        m_hits++;
+                    } else {
+                        m_waits++;
+                    }
+                    return Reservation{ it->second.future, std::nullopt };
+                }
+            }
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            // Another thread could have inserted the key between the two locks
+            const auto it = shard.entries.find(key);
+            if (it != shard.entries.end()) {
+                m_waits++;
+                return Reservation{ it->second.future, std::nullopt };
+            }
+            m_misses++;
+            std::promise<Value> promise;
+            std::shared_future<Value> future = promise.get_future().share();
+            shard.entries.emplace(key, Entry{ future });
+            return Reservation{ future, std::move(promise) };
+        }
+
+        void fulfill(Reservation& reservation, Value value) {
+            reservation.promise->set_value(std::move(value));
+            reservation.promise.reset();
+        }
+
+        void fail(const std::string& key, Reservation& reservation, std::exception_ptr exception) {
+            {
+                Shard& shard = shardFor(key);
+                std::unique_lock<std::shared_mutex> lock(shard.mutex);
+                const auto it = shard.entries.find(key);
+                if (it != shard.entries.end()) {
+                    if (isCompileError(exception)) {
+                        it->second.failed = true;
+                    } else {
+                        shard.entries.erase(it);
+                    }
+                }
+            }
+            m_failures++;
+            reservation.promise->set_exception(exception);
+            reservation.promise.reset();
+        }
+
+        // Returns the cached value, or creates it with compiler() when missing.
+        template <typename Compiler>
+        Value getOrCompile(const std::string& key, Compiler&& compiler) {
+            Reservation reservation = reserve(key);
+            if (reservation.isOwner()) {
+                try {
+                    fulfill(reservation, compiler());
+                } catch (...) {
+                    fail(key, reservation, std::current_exception());
+                }
+            }
+            return reservation.future.get();
+        }
+
+        // Non blocking lookup. Entries that are still being compiled, or that failed, are reported as missing.
+        std::optional<Value> find(const std::string& key) const {
+            const Shard& shard = shardFor(key);
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            const auto it = shard.entries.find(key);
+            if (it == shard.entries.end() || it->second.failed || !isReady(it->second.future)) {
+                return std::nullopt;
+            }
+            return it->second.future.get();
+        }
+
+        bool hasFailed(const std::string& key) const {
+            const Shard& shard = shardFor(key);
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            const auto it = shard.entries.find(key);
+            return it != shard.entries.end() && it->second.failed;
+        }
+
+        // Forgets the failure of key, so that the next call compiles it again
+        bool clearFailure(const std::string& key) {
+            Shard& shard = shardFor(key);
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            const auto it = shard.entries.find(key);
+            if (it == shard.entries.end() || !it->second.failed) {
+                return false;
+            }
+            shard.entries.erase(it);
+            return true;
+        }
+
+        // Returns the number of failed entries removed
+        size_t clearFailures() {
+            size_t cleared = 0;
+            for (Shard& shard : m_shards) {
+                std::unique_lock<std::shared_mutex> lock(shard.mutex);
+                for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+                    if (it->second.failed) {
+                        it = shard.entries.erase(it);
+                        cleared++;
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+            return cleared;
+        }
+
+        bool erase(const std::string& key) {
+            Shard& shard = shardFor(key);
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            return shard.entries.erase(key) > 0;
+        }
+
+        // Erases the entry only if it is ready and holds expected
+        bool erase(const std::string& key, const Value& expected) {
+            Shard& shard = shardFor(key);
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            const auto it = shard.entries.find(key);
+            if (it == shard.entries.end() || it->second.failed || !isReady(it->second.future) || !(it->second.future.get() == expected)) {
+                return false;
+            }
+            shard.entries.erase(it);
+            return true;
+        }
+
+        void clear() {
+            for (Shard& shard : m_shards) {
+                std::unique_lock<std::shared_mutex> lock(shard.mutex);
+                shard.entries.clear();
+            }
+        }
+
+        size_t size() const {
+            size_t total = 0;
+            for (const Shard& shard : m_shards) {
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+                total += shard.entries.size();
+            }
+            return total;
+        }
+
+        uint64_t hits() const { return m_hits; }
+        uint64_t misses() const { return m_misses; }
+        uint64_t waits() const { return m_waits; }
+        uint64_t failures() const { return m_failures; }
+    };
+} // namespace fk
+
+#endif // FK_JIT_CONCURRENT_CACHE_H
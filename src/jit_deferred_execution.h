@@ -0,0 +1,237 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_DEFERRED_EXECUTION_H
+#define FK_JIT_DEFERRED_EXECUTION_H
+
+#include <src/jit_operation_pp.h>
+#include <src/jit_operation_executor.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fk {
+    // Pipelines recorded by a JitDeferredQueue, grouped so that each group runs as one fused kernel
+    struct JitFusionPlan {
+        // Indices of the submitted pipelines of each group, in submission order
+        std::vector<std::vector<size_t>> groups;
+
+        size_t kernels() const {
+            return groups.size();
+        }
+    };
+
+    namespace jit_internal {
+        // Template arguments of a PerThreadRead or PerThreadWrite op type, like "<fk::_2D, float>",
+        // or an empty string if the op is not one of them
+        inline std::string perThreadAccessArgs(const std::string& type, const char* access) {
+            const size_t position = type.find(access);
+            if (position == std::string::npos) {
+                return {};
+            }
+            const size_t open = position + std::strlen(access);
+            if (open >= type.size() || type[open] != '<') {
+                return {};
+            }
+            int depth = 0;
+            for (size_t i = open; i < type.size(); ++i) {
+                if (type[i] == '<') {
+                    depth++;
+                } else if (type[i] == '>' && --depth == 0) {
+                    return type.substr(open, i - open + 1);
+                }
+            }
+            return {};
+        }
+
+        // The first bytes of the data of a Ptr op are its pointer
+        inline bool startsWithPointer(const JIT_Operation_pp& op, const void* pointer) {
+            return op.getSize() >= sizeof(void*) && std::memcmp(op.getData(), &pointer, sizeof(void*)) == 0;
+        }
+
+        // Whether startsWithPointer sees every pointer that the op can hold: a PerThreadRead or PerThreadWrite,
+        // whose Ptr is its first member, or an op whose type names no Ptr, per thread access or batch, like the
+        // arithmetic ones. Others, like ReadBack or resize ops that embed a read, batch ops with arrays of Ptrs,
+        // or binary ops with an image operand after other members, can hold a Ptr anywhere.
+        inline bool isInspectable(const JIT_Operation_pp& op) {
+            const std::string& type = op.getType();
+            if (type.rfind("fk::Read<fk::PerThreadRead<", 0) == 0 || type.rfind("fk::Write<fk::PerThreadWrite<", 0) == 0) {
+                return true;
+            }
+            return type.find("Ptr") == std::string::npos && type.find("PerThread") == std::string::npos &&
+                   type.find("Batch") == std::string::npos;
+        }
+
+        inline const void* ptrOf(const JIT_Operation_pp& op) {
+            const void* pointer{ nullptr };
+            if (op.getSize() >= sizeof(void*)) {
+                std::memcpy(&pointer, op.getData(), sizeof(void*));
+            }
+            return pointer;
+        }
+
+        // Whether consumer reads, thread by thread, exactly what producer writes: a PerThreadWrite followed
+        // by a PerThreadRead with the same dimension and type, on the same Ptr (same data, size and pitch),
+        // and both pipelines run the same grid.
+        inline bool feedsPerThread(const std::vector<JIT_Operation_pp>& producer, const std::vector<JIT_Operation_pp>& consumer) {
+            if (producer.size() < 2 || consumer.size() < 2) {
+                return false;
+            }
+            const JIT_Operation_pp& write = producer.back();
+            const JIT_Operation_pp& read = consumer.front();
+            const std::string writeArgs = perThreadAccessArgs(write.getType(), "PerThreadWrite");
+            if (writeArgs.empty() || writeArgs != perThreadAccessArgs(read.getType(), "PerThreadRead")) {
+                return false;
+            }
+            if (write.getSize() != read.getSize() || std::memcmp(write.getData(), read.getData(), write.getSize()) != 0) {
+                return false;
+            }
+            const JIT_Operation_pp& producerRead = producer.front();
+            return producerRead.hasActiveThreads() && read.hasActiveThreads() &&
+                   std::equal(producerRead.getActiveThreads(), producerRead.getActiveThreads() + 3, read.getActiveThreads());
+        }
+
+        // Whether any op of pipeline from the op at first on uses pointer, or can not be inspected
+        inline bool usedIn(const std::vector<JIT_Operation_pp>& pipeline, const size_t first, const void* pointer) {
+            for (size_t i = first; i < pipeline.size(); ++i) {
+                if (!isInspectable(pipeline[i]) || startsWithPointer(pipeline[i], pointer)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Whether any op of the pipelines from first on uses pointer, or can not be inspected
+        inline bool usedFrom(const std::vector<std::vector<JIT_Operation_pp>>& pipelines, const size_t first, const void* pointer) {
+            for (size_t i = first; i < pipelines.size(); ++i) {
+                if (usedIn(pipelines[i], 0, pointer)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Groups consecutive pipelines where each one feeds the next one per thread, through an image that
+        // was dropped, and that is not used by a later pipeline or by another op of the next one. It only
+        // looks at the op types and data, so it does not fuse when a later op could hold the image where
+        // it can not be seen.
+        inline JitFusionPlan planVerticalFusion(const std::vector<std::vector<JIT_Operation_pp>>& pipelines,
+                                                const std::vector<const void*>& dropped) {
+            JitFusionPlan plan;
+            for (size_t i = 0; i < pipelines.size(); ++i) {
+                if (!plan.groups.empty()) {
+                    const std::vector<JIT_Operation_pp>& producer = pipelines[plan.groups.back().back()];
+                    const void* intermediate = producer.empty() ? nullptr : ptrOf(producer.back());
+                    if (feedsPerThread(producer, pipelines[i]) &&
+                        std::find(dropped.begin(), dropped.end(), intermediate) != dropped.end() &&
+                        !usedIn(pipelines[i], 1, intermediate) && !usedFrom(pipelines, i + 1, intermediate)) {
+                        plan.groups.back().push_back(i);
+                        continue;
+                    }
+                }
+                plan.groups.push_back({ i });
+            }
+            return plan;
+        }
+
+        // The pipeline of a group: the read of the first pipeline, the operations of all of them and
+        // the write of the last one. The intermediate writes and reads are dropped.
+        inline std::vector<JIT_Operation_pp> fuseGroup(const std::vector<std::vector<JIT_Operation_pp>>& pipelines,
+                                                       const std::vector<size_t>& group) {
+            if (group.size() == 1) {
+                return pipelines[group.front()];
+            }
+            std::vector<JIT_Operation_pp> fused;
+            for (size_t g = 0; g < group.size(); ++g) {
+                const std::vector<JIT_Operation_pp>& pipeline = pipelines[group[g]];
+                const size_t begin = g == 0 ? 0 : 1;
+                const size_t end = g + 1 == group.size() ? pipeline.size() : pipeline.size() - 1;
+                fused.insert(fused.end(), pipeline.begin() + begin, pipeline.begin() + end);
+            }
+            return fused;
+        }
+    } // namespace jit_internal
+
+    // Lazy execution for the GPU_NVIDIA_JIT executor. Submitted pipelines are recorded instead of launched,
+    // and flush() launches them in order. When a pipeline writes, thread by thread, an image that was
+    // dropped with drop() and that only the next pipeline reads, at the same resolution, both are fused
+    // into one kernel, so the image is neither written to nor read back from global memory. Images that
+    // are not dropped are always written.
+    // Like a stream, a queue must not be used from several threads at the same time.
+    class JitDeferredQueue {
+        std::vector<std::vector<JIT_Operation_pp>> m_pipelines;
+        std::vector<const void*> m_dropped;
+        size_t m_fusedPipelines{ 0 };
+    public:
+        void submit(std::vector<JIT_Operation_pp> pipeline) {
+            m_pipelines.push_back(std::move(pipeline));
+        }
+
+        // Typed operations are recorded as a runtime pipeline, which runs with thread fusion disabled
+        template <typename... IOps>
+        void submit(const IOps&... iOps) {
+            submit(jit_internal::buildOperationPipeline(iOps...));
+        }
+
+        // The image at data is not needed after the flush, so it is not written if the pipeline that
+        // reads it is fused with the one that writes it
+        void drop(const void* data) {
+            m_dropped.push_back(data);
+        }
+
+        size_t pending() const {
+            return m_pipelines.size();
+        }
+
+        JitFusionPlan plan() const {
+            return jit_internal::planVerticalFusion(m_pipelines, m_dropped);
+        }
+
+        // The pipelines that flush() would launch, after fusion
+        std::vector<std::vector<JIT_Operation_pp>> fusedPipelines() const {
+            std::vector<std::vector<JIT_Operation_pp>> fused;
+            for (const auto& group : plan().groups) {
+                fused.push_back(jit_internal::fuseGroup(m_pipelines, group));
+            }
+            return fused;
+        }
+
+        // Launches the recorded pipelines on stream and clears the queue, including the dropped images
+        void flush(Stream_<ParArch::GPU_NVIDIA_JIT>& stream) {
+            std::vector<std::vector<JIT_Operation_pp>> fused = fusedPipelines();
+            m_fusedPipelines += m_pipelines.size() - fused.size();
+            m_pipelines.clear();
+            m_dropped.clear();
+            for (const auto& pipeline : fused) {
+                Executor<TransformDPP<ParArch::GPU_NVIDIA_JIT>>::executeOperations(stream, pipeline);
+            }
+        }
+
+        // flush() and wait for the stream
+        void sync(Stream_<ParArch::GPU_NVIDIA_JIT>& stream) {
+            flush(stream);
+            stream.sync();
+        }
+
+        // Launches saved by fusion since the queue was created
+        size_t fusedLaunches() const {
+            return m_fusedPipelines;
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_DEFERRED_EXECUTION_H
@@ -0,0 +1,230 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_DEVICE_TABLE_H
+#define FK_JIT_DEVICE_TABLE_H
+
+#include <cuda.h>
+#include <fused_kernel/core/utils/utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fk {
+    // Selects the device of the context that is current in the calling thread
+    constexpr int JIT_CURRENT_DEVICE = -1;
+
+    namespace jit_internal {
+        // Key of a compiled kernel. Devices with the same compute capability compile the same targets,
+        // so they share the compilation.
+        inline std::string compiledKernelKey(const int arch, const std::string& nameExpression) {
+            return std::to_string(arch) + "|" + nameExpression;
+        }
+    } // namespace jit_internal
+
+    // The driver calls used by JitDeviceTable. Tests replace it with a fake driver that has the same members.
+    struct JitCudaDeviceDriver {
+        using Context = CUcontext;
+
+        int deviceCount() {
+            gpuErrchk(cuInit(0));
+            int count{ 0 };
+            gpuErrchk(cuDeviceGetCount(&count));
+            return count;
+        }
+        // Compute capability as major * 10 + minor
+        int deviceArch(const int ordinal) {
+            CUdevice device;
+            gpuErrchk(cuDeviceGet(&device, ordinal));
+            int major{ 0 }, minor{ 0 };
+            gpuErrchk(cuDeviceGetAttribute(&major, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR, device));
+            gpuErrchk(cuDeviceGetAttribute(&minor, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR, device));
+            return major * 10 + minor;
+        }
+        Context retainPrimaryContext(const int ordinal) {
+            CUdevice device;
+            gpuErrchk(cuDeviceGet(&device, ordinal));
+            CUcontext context;
+            gpuErrchk(cuDevicePrimaryCtxRetain(&context, device));
+            return context;
+        }
+        void releasePrimaryContext(const int ordinal) {
+            CUdevice device;
+            if (cuDeviceGet(&device, ordinal) == CUDA_SUCCESS) {
+                cuDevicePrimaryCtxRelease(device);
+            }
+        }
+        // Ordinal of the device of context, -1 if it can not be found
+        int contextDevice(Context context) {
+            if (cuCtxPushCurrent(context) != CUDA_SUCCESS) {
+                return -1;
+            }
+            CUdevice device;
+            const CUresult result = cuCtxGetDevice(&device);
+            CUcontext popped;
+            cuCtxPopCurrent(&popped);
+            if (result != CUDA_SUCCESS) {
+                return -1;
+            }
+            for (int ordinal = 0; ordinal < deviceCount(); ++ordinal) {
+                CUdevice candidate;
+                if (cuDeviceGet(&candidate, ordinal) == CUDA_SUCCESS && candidate == device) {
+                    return ordinal;
+                }
+            }
+            return -1;
+        }
+        Context streamContext(CUstream stream) {
+            CUcontext context;
+            gpuErrchk(cuStreamGetCtx(stream, &context));
+            return context;
+        }
+        // nullptr when the thread has no current context
+        Context currentContext() {
+            CUcontext context{ nullptr };
+            cuCtxGetCurrent(&context);
+            return context;
+        }
+    };
+
+    // Per device State for every device of the system, and the primary context of each device.
+    // The primary contexts are the ones the CUDA runtime uses, so modules loaded in them can be
+    // launched on any runtime stream of the device. They are retained the first time a device is
+    // used, so devices that are never used are not initialized.
+    template <typename State, typename Driver = JitCudaDeviceDriver>
+    class JitDeviceTable {
+    public:
+        using Context = typename Driver::Context;
+        struct Device {
+            int ordinal;
+            int arch;
+            State state;
+        };
+    private:
+        struct Entry {
+            Device device;
+            std::once_flag contextFlag;
+            // Null until the primary context is retained
+            std::atomic<Context> context{ Context{} };
+            Entry(const int ordinal, const int arch) : device{ ordinal, arch, {} } {}
+        };
+        Driver m_driver;
+        std::vector<std::unique_ptr<Entry>> m_devices;
+
+        Entry& entry(const int ordinal) {
+            if (ordinal < 0 || ordinal >= static_cast<int>(m_devices.size())) {
+                throw std::runtime_error("Invalid CUDA device ordinal for the JIT cache: " + std::to_string(ordinal));
+            }
+            return *m_devices[ordinal];
+        }
+    public:
+        explicit JitDeviceTable(Driver driver = Driver{}) : m_driver(std::move(driver)) {
+            const int count = m_driver.deviceCount();
+            if (count <= 0) {
+                throw std::runtime_error("No CUDA device found for the JIT cache");
+            }
+            for (int ordinal = 0; ordinal < count; ++ordinal) {
+                m_devices.push_back(std::make_unique<Entry>(ordinal, m_driver.deviceArch(ordinal)));
+            }
+        }
+        JitDeviceTable(const JitDeviceTable&) = delete;
+        JitDeviceTable& operator=(const JitDeviceTable&) = delete;
+        ~JitDeviceTable() {
+            for (const auto& device : m_devices) {
+                if (device->context.load() != Context{}) {
+                    m_driver.releasePrimaryContext(device->device.ordinal);
+                }
+            }
+        }
+
+        int size() const {
+            return static_cast<int>(m_devices.size());
+        }
+
+        Device& device(const int ordinal) {
+            return entry(ordinal).device;
+        }
+
+        // The primary context of the device, retained on the first call
+        Context context(const int ordinal) {
+            Entry& device = entry(ordinal);
+            std::call_once(device.contextFlag, [&] { device.context.store(m_driver.retainPrimaryContext(ordinal), std::memory_order_release); });
+            return device.context.load(std::memory_order_acquire);
+        }
+
+        // Ordinal of the device whose primary context is context. Contexts that are already known are
+        // found without driver calls. Throws for contexts that are not primary contexts.
+        int ordinalOf(Context context) {
+            if (context == Context{}) {
+                throw std::runtime_error("JIT kernels need a CUDA context of a device");
+            }
+            for (const auto& device : m_devices) {
+                if (device->context.load(std::memory_order_acquire) == context) {
+                    return device->device.ordinal;
+                }
+            }
+            const int ordinal = m_driver.contextDevice(context);
+            if (ordinal < 0 || ordinal >= size()) {
+                throw std::runtime_error("JIT kernels need a CUDA context of a device");
+            }
+            if (this->context(ordinal) != context) {
+                throw std::runtime_error("JIT kernels can only be launched in the primary context of a device, like the streams of the CUDA runtime");
+            }
+            return ordinal;
+        }
+
+        int streamDevice(CUstream stream) {
+            return ordinalOf(m_driver.streamContext(stream));
+        }
+
+        // Device of the current context, or device 0 if the thread has none
+        int currentDevice() {
+            const Context current = m_driver.currentContext();
+            return current == Context{} ? 0 : ordinalOf(current);
+        }
+
+        // JIT_CURRENT_DEVICE is replaced by currentDevice()
+        int resolve(const int ordinal) {
+            return ordinal == JIT_CURRENT_DEVICE ? currentDevice() : entry(ordinal).device.ordinal;
+        }
+
+        // Distinct compute capabilities, in device order
+        std::vector<int> archs() const {
+            std::vector<int> archs;
+            for (const auto& device : m_devices) {
+                if (std::find(archs.begin(), archs.end(), device->device.arch) == archs.end()) {
+                    archs.push_back(device->device.arch);
+                }
+            }
+            return archs;
+        }
+
+        // Number of devices whose primary context was retained
+        int retainedContexts() const {
+            return static_cast<int>(std::count_if(m_devices.begin(), m_devices.end(),
+                [](const auto& device) { return device->context.load() != Context{}; }));
+        }
+
+        Driver& getDriver() {
+            return m_driver;
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_DEVICE_TABLE_H
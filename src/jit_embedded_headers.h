@@ -0,0 +1,43 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_EMBEDDED_HEADERS_H
+#define FK_JIT_EMBEDDED_HEADERS_H
+
+#include <cstddef>
+
+namespace fk {
+    namespace jit_internal {
+        // An FKL header, by the name it is included with, like "fused_kernel/core/utils/utils.h"
+        struct JitEmbeddedHeader {
+            const char* name;
+            const char* content;
+        };
+
+        // A class template, struct or alias declared in a header, like { "Mul", "fused_kernel/algorithms/basic_ops/arithmetic.h" }
+        struct JitHeaderSymbol {
+            const char* symbol;
+            const char* header;
+        };
+
+#if defined(FK_JIT_EMBEDDED_HEADERS)
+        // Defined in the source that cmake/FklEmbedHeaders.cmake generates from the FKL headers,
+        // built into the fkl_jit_embedded_headers library
+        const JitEmbeddedHeader* fklEmbeddedHeaders(size_t* count);
+        const JitHeaderSymbol* fklHeaderSymbols(size_t* count);
+#endif
+    } // namespace jit_internal
+} // namespace fk
+
+#endif // FK_JIT_EMBEDDED_HEADERS_H
@@ -0,0 +1,331 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_GRAPH_H
+#define FK_JIT_GRAPH_H
+
+#include <cuda.h>
+#include <fused_kernel/core/utils/utils.h>
+
+#include <src/jit_kernel_params.h>
+#include <src/jit_operation_executor_cache.h>
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace fk {
+    // A JIT kernel launch recorded instead of being issued, with a copy of its parameters
+    struct JitRecordedLaunch {
+        CUfunction function{ nullptr };
+        // Keeps the module of the kernel loaded while a graph uses it, even if the cache evicts it
+        std::shared_ptr<JitModule> module;
+        // Keeps the arena block of the spilled operations allocated while a graph uses it
+        std::shared_ptr<void> arena;
+        unsigned int grid[3]{ 1, 1, 1 };
+        unsigned int block[3]{ 1, 1, 1 };
+        // The parameters, each one at an offset aligned like in a struct
+        std::vector<unsigned char> params;
+        std::vector<size_t> offsets;
+        // Pointers to each parameter in params, as cuLaunchKernel expects them
+        std::vector<void*> kernelParams;
+
+        bool sameDimensions(const JitRecordedLaunch& other) const {
+            return std::memcmp(grid, other.grid, sizeof(grid)) == 0 && std::memcmp(block, other.block, sizeof(block)) == 0;
+        }
+        bool sameParams(const JitRecordedLaunch& other) const {
+            return offsets == other.offsets && params == other.params;
+        }
+    };
+
+    // Collects the JIT kernel launches of the calling thread while it is active, see JitGraph
+    class JitLaunchRecorder {
+        std::vector<JitRecordedLaunch> m_launches;
+        size_t m_count{ 0 };
+    public:
+        void clear() {
+            m_count = 0;
+        }
+
+        // Copies the parameters. The storage of previous recordings is reused, so recording the same
+        // sequence again does not allocate.
+        void record(CUfunction function, const std::shared_ptr<JitModule>& module, const unsigned int (&grid)[3],
+                    const unsigned int (&block)[3], const JitParamView* params, const size_t paramCount) {
+            if (m_count == m_launches.size()) {
+                m_launches.emplace_back();
+            }
+            JitRecordedLaunch& launch = m_launches[m_count++];
+            launch.function = function;
+            launch.module = module;
+            launch.arena.reset();
+            std::memcpy(launch.grid, grid, sizeof(grid));
+            std::memcpy(launch.block, block, sizeof(block));
+            launch.offsets.resize(paramCount);
+            size_t size = 0;
+            for (size_t i = 0; i < paramCount; ++i) {
+                size = jit_internal::alignUp(size, params[i].alignment);
+                launch.offsets[i] = size;
+                size += params[i].size;
+            }
+            launch.params.resize(size);
+            launch.kernelParams.resize(paramCount);
+            for (size_t i = 0; i < paramCount; ++i) {
+                std::memcpy(launch.params.data() + launch.offsets[i], params[i].data, params[i].size);
+                launch.kernelParams[i] = launch.params.data() + launch.offsets[i];
+            }
+        }
+
+        size_t size() const {
+            return m_count;
+        }
+
+        JitRecordedLaunch& operator[](const size_t index) {
+            return m_launches[index];
+        }
+        const JitRecordedLaunch& operator[](const size_t index) const {
+            return m_launches[index];
+        }
+
+        // Exchanges the recordings, so that the storage of the old one is reused by the next recording
+        void swap(JitLaunchRecorder& other) {
+            m_launches.swap(other.m_launches);
+            std::swap(m_count, other.m_count);
+        }
+    };
+
+    namespace jit_internal {
+        // Recorder of the calling thread, nullptr when launches are issued to the stream
+        inline JitLaunchRecorder*& activeLaunchRecorder() {
+            thread_local JitLaunchRecorder* recorder = nullptr;
+            return recorder;
+        }
+
+        // Makes recorder the active one for its lifetime, restoring the previous one afterwards
+        class JitRecordingScope {
+            JitLaunchRecorder* m_previous;
+        public:
+            explicit JitRecordingScope(JitLaunchRecorder& recorder) : m_previous(activeLaunchRecorder()) {
+                activeLaunchRecorder() = &recorder;
+            }
+            JitRecordingScope(const JitRecordingScope&) = delete;
+            JitRecordingScope& operator=(const JitRecordingScope&) = delete;
+            ~JitRecordingScope() {
+                activeLaunchRecorder() = m_previous;
+            }
+        };
+
+        // Recording counterpart of launchRuntimeKernel
+        inline void recordRuntimeKernel(JitLaunchRecorder& recorder, const JitFkKernel& kernel, const unsigned int (&grid)[3],
+                                        const unsigned int (&block)[3], const std::vector<JIT_Operation_pp>& pipeline) {
+            thread_local std::vector<JitParamView> params;
+            params.clear();
+            for (const auto& op : pipeline) {
+                params.push_back(toParamView(op));
+            }
+            recorder.record(kernel.getKernelFunction(), kernel.getModule(), grid, block, params.data(), params.size());
+        }
+
+        inline CUDA_KERNEL_NODE_PARAMS kernelNodeParams(JitRecordedLaunch& launch) {
+            CUDA_KERNEL_NODE_PARAMS params{};
+            params.func = launch.function;
+            params.gridDimX = launch.grid[0];
+            params.gridDimY = launch.grid[1];
+            params.gridDimZ = launch.grid[2];
+            params.blockDimX = launch.block[0];
+            params.blockDimY = launch.block[1];
+            params.blockDimZ = launch.block[2];
+            params.sharedMemBytes = 0;
+            params.kernelParams = launch.kernelParams.data();
+            params.extra = nullptr;
+            return params;
+        }
+    } // namespace jit_internal
+
+    // The CUDA graph calls used by JitGraph. Tests replace it with a fake driver that has the same members.
+    struct JitCudaGraphDriver {
+        using Graph = CUgraph;
+        using Node = CUgraphNode;
+        using Exec = CUgraphExec;
+
+        Graph createGraph() {
+            CUgraph graph;
+            gpuErrchk(cuGraphCreate(&graph, 0));
+            return graph;
+        }
+        Node addKernelNode(Graph graph, const Node* dependencies, const size_t dependencyCount, const CUDA_KERNEL_NODE_PARAMS& params) {
+            CUgraphNode node;
+            gpuErrchk(cuGraphAddKernelNode(&node, graph, dependencies, dependencyCount, &params));
+            return node;
+        }
+        Exec instantiate(Graph graph) {
+            CUgraphExec exec;
+            gpuErrchk(cuGraphInstantiateWithFlags(&exec, graph, 0));
+            return exec;
+        }
+        void setKernelNodeParams(Exec exec, Node node, const CUDA_KERNEL_NODE_PARAMS& params) {
+            gpuErrchk(cuGraphExecKernelNodeSetParams(exec, node, &params));
+        }
+        void launch(Exec exec, CUstream stream) {
+            gpuErrchk(cuGraphLaunch(exec, stream));
+        }
+        void destroyExec(Exec exec) {
+            gpuErrchk(cuGraphExecDestroy(exec));
+        }
+        void destroyGraph(Graph graph) {
+            gpuErrchk(cuGraphDestroy(graph));
+        }
+    };
+
+    // Graph mode for the GPU_NVIDIA_JIT executor. record() runs a function that executes JIT pipelines,
+    // but their kernels are recorded instead of launched, and become a chain of kernel nodes of one
+    // CUDA graph. launch() replays the graph on a stream with a single driver call.
+    // Recording the same sequence again, for instance with the pointers and scalars of the next frame,
+    // only patches the parameters of the nodes that changed in the instantiated graph. A sequence with
+    // other kernels or another number of launches builds and instantiates a new graph.
+    // Launches recorded while the fused kernel is not compiled yet wait for it, even when they are
+    // executed with executeOperationsAsync. Work that is not a JIT launch is not recorded.
+    template <typename Driver = JitCudaGraphDriver>
+    class JitGraph {
+        using Graph = typename Driver::Graph;
+        using Node = typename Driver::Node;
+        using Exec = typename Driver::Exec;
+        Driver m_driver;
+        // Launches in the instantiated graph, and the ones being recorded
+        JitLaunchRecorder m_launches;
+        JitLaunchRecorder m_recording;
+        Graph m_graph{};
+        Exec m_exec{};
+        std::vector<Node> m_nodes;
+        bool m_instantiated{ false };
+        size_t m_instantiations{ 0 };
+        size_t m_patchedNodes{ 0 };
+
+        void destroy() {
+            if (m_instantiated) {
+                m_driver.destroyExec(m_exec);
+                m_driver.destroyGraph(m_graph);
+                m_nodes.clear();
+                m_instantiated = false;
+            }
+        }
+        bool sameTopology() const {
+            if (!m_instantiated || m_launches.size() != m_recording.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < m_launches.size(); ++i) {
+                if (m_launches[i].function != m_recording[i].function) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        void build() {
+            destroy();
+            m_graph = m_driver.createGraph();
+            for (size_t i = 0; i < m_recording.size(); ++i) {
+                // Every kernel depends on the previous one, like launches on the same stream
+                const Node* dependency = m_nodes.empty() ? nullptr : &m_nodes.back();
+                const CUDA_KERNEL_NODE_PARAMS params = jit_internal::kernelNodeParams(m_recording[i]);
+                m_nodes.push_back(m_driver.addKernelNode(m_graph, dependency, dependency == nullptr ? 0 : 1, params));
+            }
+            m_exec = m_driver.instantiate(m_graph);
+            m_instantiated = true;
+            m_instantiations++;
+        }
+        void patch() {
+            for (size_t i = 0; i < m_recording.size(); ++i) {
+                JitRecordedLaunch& launch = m_recording[i];
+                if (!launch.sameParams(m_launches[i]) || !launch.sameDimensions(m_launches[i])) {
+                    m_driver.setKernelNodeParams(m_exec, m_nodes[i], jit_internal::kernelNodeParams(launch));
+                    m_patchedNodes++;
+                }
+            }
+        }
+    public:
+        explicit JitGraph(Driver driver = Driver{}) : m_driver(std::move(driver)) {}
+        JitGraph(const JitGraph&) = delete;
+        JitGraph& operator=(const JitGraph&) = delete;
+        ~JitGraph() {
+            destroy();
+        }
+
+        // Records the JIT launches of executions, which is called in the calling thread, and updates
+        // the graph with them. Nothing is launched.
+        template <typename Executions>
+        void record(Executions&& executions) {
+            m_recording.clear();
+            {
+                jit_internal::JitRecordingScope scope(m_recording);
+                executions();
+            }
+            if (m_recording.size() == 0) {
+                throw std::runtime_error("JitGraph::record did not record any JIT kernel launch");
+            }
+            if (sameTopology()) {
+                patch();
+            } else {
+                build();
+            }
+            m_launches.swap(m_recording);
+        }
+
+        void launch(CUstream stream) {
+            if (!m_instantiated) {
+                throw std::runtime_error("JitGraph::launch called before record");
+            }
+            // So that the cache waits for this stream before unloading a module the graph stops using
+            for (size_t i = 0; i < m_launches.size(); ++i) {
+                if (m_launches[i].module != nullptr) {
+                    m_launches[i].module->noteLaunch(stream);
+                }
+            }
+            m_driver.launch(m_exec, stream);
+        }
+
+        // For fk::Stream_<ParArch::GPU_NVIDIA_JIT>
+        template <typename Stream>
+        void launch(Stream& stream) {
+            launch(reinterpret_cast<CUstream>(stream.getCUDAStream()));
+        }
+
+        // record() followed by launch()
+        template <typename Stream, typename Executions>
+        void replay(Stream& stream, Executions&& executions) {
+            record(std::forward<Executions>(executions));
+            launch(stream);
+        }
+
+        size_t nodes() const {
+            return m_nodes.size();
+        }
+
+        // Number of graphs built, 1 while the recorded sequence keeps the same kernels
+        size_t instantiations() const {
+            return m_instantiations;
+        }
+
+        // Number of kernel nodes updated in place since the graph was created
+        size_t patchedNodes() const {
+            return m_patchedNodes;
+        }
+
+        Driver& getDriver() {
+            return m_driver;
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_GRAPH_H
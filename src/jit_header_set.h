@@ -0,0 +1,217 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_HEADER_SET_H
+#define FK_JIT_HEADER_SET_H
+
+#include <src/jit_embedded_headers.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fk {
+    enum class JitHeaderMode {
+        // Every program includes fused_kernel/algorithms/algorithms.h
+        UMBRELLA,
+        // Programs include only the headers that declare the templates of their kernels
+        MINIMAL
+    };
+
+    struct JitHeaderPolicy {
+        // MINIMAL needs the embedded FKL headers. Without them, every program uses the umbrella include.
+        JitHeaderMode mode{ JitHeaderMode::MINIMAL };
+
+        static JitHeaderPolicy fromEnvironment() {
+            JitHeaderPolicy policy;
+            if (const char* mode = std::getenv("FK_JIT_HEADERS")) {
+                policy.mode = std::strcmp(mode, "umbrella") == 0 ? JitHeaderMode::UMBRELLA : JitHeaderMode::MINIMAL;
+            }
+            return policy;
+        }
+    };
+
+    namespace jit_internal {
+        // Included by every program: the FKL kernels and the TransformDPP used by the JIT prologues
+        inline const std::vector<std::string>& coreHeaders() {
+            static const std::vector<std::string> headers{
+                "fused_kernel/core/execution_model/executor_kernels.h",
+                "fused_kernel/core/execution_model/data_parallel_patterns.h"
+            };
+            return headers;
+        }
+
+        // Maps the templates that name expressions use to the headers that declare them
+        class JitHeaderIndex {
+            std::unordered_map<std::string, std::string> m_headers;
+        public:
+            JitHeaderIndex() = default;
+            // When a symbol is declared in several headers, the first one is kept
+            JitHeaderIndex(const JitHeaderSymbol* symbols, const size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    m_headers.emplace(symbols[i].symbol, symbols[i].header);
+                }
+            }
+
+            bool empty() const {
+                return m_headers.empty();
+            }
+
+            // nullptr if no header declares symbol
+            const std::string* find(const std::string& symbol) const {
+                const auto found = m_headers.find(symbol);
+                return found != m_headers.end() ? &found->second : nullptr;
+            }
+        };
+
+        inline bool isIdentifierChar(const char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+        }
+
+        // Templates that text names with an fk:: qualification, like Read, PerThreadRead and Mul in
+        // "fk::Read<fk::PerThreadRead<fk::_2D, float>>, fk::Binary<fk::Mul<float>>". Nested names are
+        // returned by their last identifier. The ones in fk::jit_internal come from the JIT prologues,
+        // and are not returned.
+        inline std::vector<std::string> qualifiedTemplates(const std::string& text) {
+            std::vector<std::string> templates;
+            for (size_t begin = text.find("fk::"); begin != std::string::npos; begin = text.find("fk::", begin + 1)) {
+                if (begin > 0 && isIdentifierChar(text[begin - 1])) {
+                    continue;
+                }
+                size_t end = begin + 4;
+                std::string first;
+                std::string last;
+                while (true) {
+                    const size_t identifier = end;
+                    while (end < text.size() && isIdentifierChar(text[end])) {
+                        end++;
+                    }
+                    last = text.substr(identifier, end - identifier);
+                    if (first.empty()) {
+                        first = last;
+                    }
+                    if (last.empty() || text.compare(end, 2, "::") != 0) {
+                        break;
+                    }
+                    end += 2;
+                }
+                while (end < text.size() && text[end] == ' ') {
+                    end++;
+                }
+                if (!last.empty() && first != "jit_internal" && end < text.size() && text[end] == '<' &&
+                    std::find(templates.begin(), templates.end(), last) == templates.end()) {
+                    templates.push_back(last);
+                }
+            }
+            return templates;
+        }
+
+        // Headers that the name expressions need in addition to coreHeaders(), sorted. Nothing if the
+        // index does not know one of their templates, so that the caller uses the umbrella include.
+        inline std::optional<std::vector<std::string>> minimalHeaders(const std::vector<std::string>& nameExpressions,
+                                                                      const JitHeaderIndex& index) {
+            if (index.empty()) {
+                return std::nullopt;
+            }
+            const std::vector<std::string>& core = coreHeaders();
+            std::vector<std::string> headers;
+            for (const auto& nameExpression : nameExpressions) {
+                for (const auto& symbol : qualifiedTemplates(nameExpression)) {
+                    const std::string* header = index.find(symbol);
+                    if (header == nullptr) {
+                        return std::nullopt;
+                    }
+                    if (std::find(core.begin(), core.end(), *header) == core.end()) {
+                        headers.push_back(*header);
+                    }
+                }
+            }
+            std::sort(headers.begin(), headers.end());
+            headers.erase(std::unique(headers.begin(), headers.end()), headers.end());
+            return headers;
+        }
+
+        // Whether an NVRTC log reports a name that is not declared, which is how a minimal program fails
+        // when one of its templates needs a header that the index does not know about. Other errors
+        // would fail the same way with the umbrella include.
+        inline bool isMissingDeclarationError(const std::string& log) {
+            static const char* const messages[] = { "is undefined", "has no member", "is not a template", "incomplete type is not allowed" };
+            for (const char* message : messages) {
+                if (log.find(message) != std::string::npos) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // The headers and include names passed to nvrtcCreateProgram. NVRTC resolves the includes of a
+        // program, and of the headers themselves, with them before looking in the include paths.
+        class JitHeaderSet {
+            std::vector<const char*> m_names;
+            std::vector<const char*> m_contents;
+        public:
+            JitHeaderSet() = default;
+            JitHeaderSet(const JitEmbeddedHeader* headers, const size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    m_names.push_back(headers[i].name);
+                    m_contents.push_back(headers[i].content);
+                }
+            }
+
+            int count() const {
+                return static_cast<int>(m_names.size());
+            }
+            const char* const* names() const {
+                return m_names.empty() ? nullptr : m_names.data();
+            }
+            const char* const* contents() const {
+                return m_contents.empty() ? nullptr : m_contents.data();
+            }
+        };
+
+        // The FKL headers embedded in the binary, empty when built without FK_JIT_EMBEDDED_HEADERS
+        inline const JitHeaderSet& embeddedHeaderSet() {
+#if defined(FK_JIT_EMBEDDED_HEADERS)
+            static const JitHeaderSet headers = [] {
+                size_t count{ 0 };
+                const JitEmbeddedHeader* embedded = fklEmbeddedHeaders(&count);
+                return JitHeaderSet(embedded, count);
+            }();
+#else
+            static const JitHeaderSet headers;
+#endif
+            return headers;
+        }
+
+        inline const JitHeaderIndex& embeddedHeaderIndex() {
+#if defined(FK_JIT_EMBEDDED_HEADERS)
+            static const JitHeaderIndex index = [] {
+                size_t count{ 0 };
+                const JitHeaderSymbol* symbols = fklHeaderSymbols(&count);
+                return JitHeaderIndex(symbols, count);
+            }();
+#else
+            static const JitHeaderIndex index;
+#endif
+            return index;
+        }
+    } // namespace jit_internal
+} // namespace fk
+
+#endif // FK_JIT_HEADER_SET_H
@@ -0,0 +1,280 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_KERNEL_BUNDLE_H
+#define FK_JIT_KERNEL_BUNDLE_H
+
+#include <src/jit_operation_pp.h>
+#include <src/jit_kernel_disk_cache.h>
+#include <src/jit_runtime_pipeline.h>
+#include <src/jit_batch_fusion.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fk {
+    namespace jit_internal {
+        // Bundle file layout:
+        // [JitBundleHeader][JitBundleEntry, sorted by key][lowered names and images]
+        // Entries are keyed by JitDiskCacheKey::hash(), so a bundle only serves the NVRTC version, compile
+        // options, JIT source and FKL headers it was built with. The kernels compiled in the same NVRTC
+        // program share their image.
+        struct JitBundleHeader {
+            char magic[8];
+            uint32_t formatVersion;
+            uint32_t reserved;
+            uint64_t entryCount;
+        };
+        struct JitBundleEntry {
+            uint64_t key;
+            uint32_t imageKind;
+            uint32_t reserved;
+            uint64_t loweredNameOffset;
+            uint64_t loweredNameSize;
+            uint64_t imageOffset;
+            uint64_t imageSize;
+            uint64_t imageChecksum;
+        };
+        constexpr char JIT_BUNDLE_MAGIC[8] = { 'F', 'K', 'B', 'U', 'N', 'D', 'L', 'E' };
+        constexpr uint32_t JIT_BUNDLE_FORMAT_VERSION = 1;
+
+        inline std::string trimManifest(const std::string& text) {
+            const size_t begin = text.find_first_not_of(" \t\r");
+            const size_t end = text.find_last_not_of(" \t\r");
+            return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+        }
+
+        // Name expression of a manifest line, or nothing for empty lines and comments. A line is either:
+        // - the op types of a runtime pipeline, separated by ';', as returned by JIT_Operation_pp::getType()
+        // - "batch <planes>:" followed by op types, for the kernel of executeOperationsBatch
+        // - a complete name expression, starting with '&', like the ones of variantNameExpressions
+        inline std::optional<std::string> manifestNameExpression(const std::string& line) {
+            std::string text = trimManifest(line);
+            if (text.empty() || text[0] == '#') {
+                return std::nullopt;
+            }
+            if (text[0] == '&') {
+                return text;
+            }
+            size_t planes = 0;
+            if (text.compare(0, 6, "batch ") == 0) {
+                const size_t colon = text.find(':');
+                planes = colon == std::string::npos ? 0 : static_cast<size_t>(std::strtoull(text.c_str() + 6, nullptr, 10));
+                if (planes < 2) {
+                    throw std::runtime_error("Batched pipelines need \"batch <planes>:\" with at least 2 planes: " + line);
+                }
+                text = text.substr(colon + 1);
+            }
+            std::vector<JIT_Operation_pp> pipeline;
+            size_t begin = 0;
+            while (begin <= text.size()) {
+                const size_t end = std::min(text.find(';', begin), text.size());
+                const std::string type = trimManifest(text.substr(begin, end - begin));
+                if (!type.empty()) {
+                    // Only the types are part of the name expression
+                    pipeline.emplace_back(type, "", 0);
+                }
+                begin = end + 1;
+            }
+            if (pipeline.size() < 2) {
+                throw std::runtime_error("A runtime pipeline needs at least a read and a write operation: " + line);
+            }
+            return planes != 0 ? batchedNameExpression(pipeline, planes) : buildNameExpression(runtimeKernelName(pipeline), pipeline);
+        }
+
+        // Name expressions of a manifest, without duplicates, in the order they appear
+        inline std::vector<std::string> readBundleManifest(std::istream& manifest) {
+            std::vector<std::string> nameExpressions;
+            std::string line;
+            while (std::getline(manifest, line)) {
+                if (std::optional<std::string> nameExpression = manifestNameExpression(line)) {
+                    if (std::find(nameExpressions.begin(), nameExpressions.end(), *nameExpression) == nameExpressions.end()) {
+                        nameExpressions.push_back(std::move(*nameExpression));
+                    }
+                }
+            }
+            return nameExpressions;
+        }
+    } // namespace jit_internal
+
+    // Builds a bundle file from compiled images. It does not need a GPU.
+    class JitKernelBundleWriter {
+        struct Image {
+            JitImageKind kind;
+            std::vector<char> bytes;
+        };
+        struct Kernel {
+            uint64_t key;
+            std::string loweredName;
+            size_t image;
+        };
+        std::vector<Image> m_images;
+        std::vector<Kernel> m_kernels;
+    public:
+        // Returns the index of the image, for addKernel
+        size_t addImage(const JitImageKind kind, std::vector<char> bytes) {
+            m_images.push_back({ kind, std::move(bytes) });
+            return m_images.size() - 1;
+        }
+
+        // The first kernel added with a key is kept
+        void addKernel(const uint64_t key, std::string loweredName, const size_t image) {
+            if (image >= m_images.size()) {
+                throw std::runtime_error("Kernel bundle image index out of range");
+            }
+            const bool duplicated = std::any_of(m_kernels.begin(), m_kernels.end(), [key](const Kernel& kernel) { return kernel.key == key; });
+            if (!duplicated) {
+                m_kernels.push_back({ key, std::move(loweredName), image });
+            }
+        }
+
+        size_t size() const {
+            return m_kernels.size();
+        }
+
+        // Written to a temporary file and renamed, so readers never see a partial bundle
+        void write(const std::filesystem::path& path) const {
+            using namespace jit_internal;
+            std::vector<Kernel> kernels = m_kernels;
+            std::sort(kernels.begin(), kernels.end(), [](const Kernel& a, const Kernel& b) { return a.key < b.key; });
+            JitBundleHeader header{};
+            memcpy(header.magic, JIT_BUNDLE_MAGIC, sizeof(header.magic));
+            header.formatVersion = JIT_BUNDLE_FORMAT_VERSION;
+            header.entryCount = kernels.size();
+
+            uint64_t offset = sizeof(JitBundleHeader) + kernels.size() * sizeof(JitBundleEntry);
+            std::vector<uint64_t> imageOffsets;
+            for (const auto& image : m_images) {
+                imageOffsets.push_back(offset);
+                offset += image.bytes.size();
+            }
+            std::vector<JitBundleEntry> entries;
+            for (const auto& kernel : kernels) {
+                const Image& image = m_images[kernel.image];
+                JitBundleEntry entry{};
+                entry.key = kernel.key;
+                entry.imageKind = static_cast<uint32_t>(image.kind);
+                entry.loweredNameOffset = offset;
+                entry.loweredNameSize = kernel.loweredName.size();
+                entry.imageOffset = imageOffsets[kernel.image];
+                entry.imageSize = image.bytes.size();
+                entry.imageChecksum = fnv1a64(image.bytes.data(), image.bytes.size());
+                entries.push_back(entry);
+                offset += kernel.loweredName.size();
+            }
+
+            std::filesystem::path tmpPath = path;
+            tmpPath += ".tmp." + std::to_string(currentProcessId());
+            {
+                std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(JitBundleEntry)));
+                for (const auto& image : m_images) {
+                    out.write(image.bytes.data(), static_cast<std::streamsize>(image.bytes.size()));
+                }
+                for (const auto& kernel : kernels) {
+                    out.write(kernel.loweredName.data(), static_cast<std::streamsize>(kernel.loweredName.size()));
+                }
+                if (!out) {
+                    out.close();
+                    std::error_code ec;
+                    std::filesystem::remove(tmpPath, ec);
+                    throw std::runtime_error("Failed to write the kernel bundle " + path.string());
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(tmpPath, path, ec);
+            if (ec) {
+                std::filesystem::remove(tmpPath, ec);
+                throw std::runtime_error("Failed to write the kernel bundle " + path.string());
+            }
+        }
+    };
+
+    // Read only, memory mapped bundle of compiled kernels. Images are validated when they are looked up.
+    class JitKernelBundle {
+        std::shared_ptr<const jit_internal::JitMappedFile> m_file;
+        size_t m_entryCount{ 0 };
+
+        jit_internal::JitBundleEntry entry(const size_t index) const {
+            jit_internal::JitBundleEntry result;
+            memcpy(&result, m_file->data() + sizeof(jit_internal::JitBundleHeader) + index * sizeof(jit_internal::JitBundleEntry), sizeof(result));
+            return result;
+        }
+    public:
+        // nullptr if the file does not exist or is not a bundle of this format version
+        static std::shared_ptr<const JitKernelBundle> open(const std::filesystem::path& path) {
+            using namespace jit_internal;
+            auto file = std::make_shared<JitMappedFile>(path);
+            if (!file->isValid() || file->size() < sizeof(JitBundleHeader)) {
+                return nullptr;
+            }
+            JitBundleHeader header;
+            memcpy(&header, file->data(), sizeof(header));
+            if (memcmp(header.magic, JIT_BUNDLE_MAGIC, sizeof(header.magic)) != 0 || header.formatVersion != JIT_BUNDLE_FORMAT_VERSION ||
+                header.entryCount > (file->size() - sizeof(JitBundleHeader)) / sizeof(JitBundleEntry)) {
+                return nullptr;
+            }
+            auto bundle = std::make_shared<JitKernelBundle>();
+            bundle->m_file = std::move(file);
+            bundle->m_entryCount = static_cast<size_t>(header.entryCount);
+            return bundle;
+        }
+
+        size_t size() const {
+            return m_entryCount;
+        }
+
+        std::optional<JitKernelImage> lookup(const uint64_t key) const {
+            size_t low = 0;
+            size_t high = m_entryCount;
+            while (low < high) {
+                const size_t middle = low + (high - low) / 2;
+                if (entry(middle).key < key) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            if (low == m_entryCount) {
+                return std::nullopt;
+            }
+            const jit_internal::JitBundleEntry found = entry(low);
+            const uint64_t fileSize = m_file->size();
+            const bool valid = found.key == key &&
+                               found.imageKind <= static_cast<uint32_t>(JitImageKind::CUBIN) &&
+                               found.imageSize > 0 && found.imageOffset <= fileSize && found.imageSize <= fileSize - found.imageOffset &&
+                               found.loweredNameOffset <= fileSize && found.loweredNameSize <= fileSize - found.loweredNameOffset;
+            if (!valid || jit_internal::fnv1a64(m_file->data() + found.imageOffset, static_cast<size_t>(found.imageSize)) != found.imageChecksum) {
+                return std::nullopt;
+            }
+            std::string loweredName(m_file->data() + found.loweredNameOffset, static_cast<size_t>(found.loweredNameSize));
+            return JitKernelImage(std::move(loweredName), static_cast<JitImageKind>(found.imageKind), m_file,
+                                  static_cast<size_t>(found.imageOffset), static_cast<size_t>(found.imageSize));
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_KERNEL_BUNDLE_H
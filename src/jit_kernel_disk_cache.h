@@ -0,0 +1,497 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_KERNEL_DISK_CACHE_H
+#define FK_JIT_KERNEL_DISK_CACHE_H
+
+#include <src/jit_embedded_headers.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Digest of the FKL headers, generated at build time by cmake/FklHeadersHash.cmake, and again whenever
+// a header changes, so old entries are never reused. Targets get it from the fkl_jit_headers_hash library.
+#if defined(FK_JIT_HEADERS_HASH_FILE)
+#include <fkl_headers_hash.h>
+#endif
+
+namespace fk {
+    namespace jit_internal {
+        // --- FNV-1a 64 bit hashing, used for the on-disk cache keys ---
+        constexpr uint64_t FNV1A_64_OFFSET = 14695981039346656037ull;
+        constexpr uint64_t FNV1A_64_PRIME = 1099511628211ull;
+
+        inline uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = FNV1A_64_OFFSET) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= bytes[i];
+                hash *= FNV1A_64_PRIME;
+            }
+            return hash;
+        }
+
+        inline uint64_t fnv1a64(const std::string& str, uint64_t hash = FNV1A_64_OFFSET) {
+            // The size is hashed too, so that {"ab", "c"} and {"a", "bc"} produce different keys
+            const uint64_t size = str.size();
+            hash = fnv1a64(&size, sizeof(size), hash);
+            return fnv1a64(str.data(), str.size(), hash);
+        }
+
+        inline std::string toHexString(uint64_t value) {
+            constexpr char digits[] = "0123456789abcdef";
+            std::string result(16, '0');
+            for (int i = 15; i >= 0; --i) {
+                result[i] = digits[value & 0xF];
+                value >>= 4;
+            }
+            return result;
+        }
+
+        // Digest of the FKL headers that the JIT programs include, part of every disk cache key.
+        // The embedded headers are hashed at runtime, since they are what NVRTC reads. Empty when
+        // there is no digest, which disables the disk cache instead of sharing one key for any headers.
+        inline const std::string& fklHeadersHash() {
+            static const std::string hash = [] {
+#if defined(FK_JIT_EMBEDDED_HEADERS)
+                size_t count = 0;
+                const JitEmbeddedHeader* headers = fklEmbeddedHeaders(&count);
+                uint64_t h = fnv1a64(&count, sizeof(count));
+                for (size_t i = 0; i < count; ++i) {
+                    for (const char* text : { headers[i].name, headers[i].content }) {
+                        const uint64_t size = strlen(text);
+                        h = fnv1a64(text, size, fnv1a64(&size, sizeof(size), h));
+                    }
+                }
+                return std::string("embedded-") + toHexString(h);
+#elif defined(FKL_HEADERS_HASH)
+                return std::string(FKL_HEADERS_HASH);
+#else
+                return std::string();
+#endif
+            }();
+            return hash;
+        }
+
+        inline unsigned long currentProcessId() {
+#if defined(_WIN32)
+            return static_cast<unsigned long>(GetCurrentProcessId());
+#else
+            return static_cast<unsigned long>(getpid());
+#endif
+        }
+
+        // Root of the cache of the current user: FK_JIT_CACHE_DIR, or fkl_jit_cache in %LOCALAPPDATA%,
+        // $XDG_CACHE_HOME or ~/.cache. It is never shared with other users, who could plant kernel images.
+        inline std::filesystem::path defaultCacheRoot() {
+            if (const char* dir = std::getenv("FK_JIT_CACHE_DIR")) {
+                return std::filesystem::path(dir);
+            }
+#if defined(_WIN32)
+            const char* base = std::getenv("LOCALAPPDATA");
+            if (base != nullptr && *base != '\0') {
+                return std::filesystem::path(base) / "fkl_jit_cache";
+            }
+#else
+            const char* xdg = std::getenv("XDG_CACHE_HOME");
+            if (xdg != nullptr && *xdg == '/') {
+                return std::filesystem::path(xdg) / "fkl_jit_cache";
+            }
+            const char* home = std::getenv("HOME");
+            if (home != nullptr && *home == '/') {
+                return std::filesystem::path(home) / ".cache" / "fkl_jit_cache";
+            }
+#endif
+            // No per user location, the cache is disabled
+            return {};
+        }
+
+        // Creates directory, only accessible by the current user, or checks that the existing one is a
+        // directory of the current user that nobody else can write to. Returns false when it can not be used.
+        inline bool preparePrivateDirectory(const std::filesystem::path& directory) {
+            if (directory.empty()) {
+                return false;
+            }
+            std::error_code ec;
+#if defined(_WIN32)
+            // %LOCALAPPDATA% is only accessible by its user
+            std::filesystem::create_directories(directory, ec);
+            return std::filesystem::is_directory(directory, ec);
+#else
+            if (directory.has_parent_path()) {
+                std::filesystem::create_directories(directory.parent_path(), ec);
+            }
+            if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+                return false;
+            }
+            // lstat, so that a symbolic link planted by another user is refused
+            struct stat directoryStat;
+            return lstat(directory.c_str(), &directoryStat) == 0 && S_ISDIR(directoryStat.st_mode) &&
+                   directoryStat.st_uid == geteuid() && (directoryStat.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#endif
+        }
+
+        // Read only memory mapping of a whole file. Move only.
+        class JitMappedFile {
+            const char* m_data{ nullptr };
+            size_t m_size{ 0 };
+#if defined(_WIN32)
+            HANDLE m_file{ INVALID_HANDLE_VALUE };
+            HANDLE m_mapping{ nullptr };
+#endif
+            void release() {
+#if defined(_WIN32)
+                if (m_data != nullptr) {
+                    UnmapViewOfFile(m_data);
+                }
+                if (m_mapping != nullptr) {
+                    CloseHandle(m_mapping);
+                }
+                if (m_file != INVALID_HANDLE_VALUE) {
+                    CloseHandle(m_file);
+                }
+                m_mapping = nullptr;
+                m_file = INVALID_HANDLE_VALUE;
+#else
+                if (m_data != nullptr) {
+                    munmap(const_cast<char*>(m_data), m_size);
+                }
+#endif
+                m_data = nullptr;
+                m_size = 0;
+            }
+        public:
+            JitMappedFile() = default;
+            explicit JitMappedFile(const std::filesystem::path& path) {
+#if defined(_WIN32)
+                m_file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                     nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (m_file == INVALID_HANDLE_VALUE) {
+                    return;
+                }
+                LARGE_INTEGER fileSize;
+                if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) {
+                    release();
+                    return;
+                }
+                m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (m_mapping == nullptr) {
+                    release();
+                    return;
+                }
+                m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+                if (m_data == nullptr) {
+                    release();
+                    return;
+                }
+                m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+                const int fd = open(path.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    return;
+                }
+                struct stat fileStat;
+                if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+                    close(fd);
+                    return;
+                }
+                void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                // The mapping keeps its own reference to the file
+                close(fd);
+                if (mapped == MAP_FAILED) {
+                    return;
+                }
+                m_data = static_cast<const char*>(mapped);
+                m_size = static_cast<size_t>(fileStat.st_size);
+#endif
+            }
+            JitMappedFile(const JitMappedFile&) = delete;
+            JitMappedFile& operator=(const JitMappedFile&) = delete;
+            JitMappedFile(JitMappedFile&& other) noexcept {
+                *this = std::move(other);
+            }
+            JitMappedFile& operator=(JitMappedFile&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    m_data = other.m_data;
+                    m_size = other.m_size;
+                    other.m_data = nullptr;
+                    other.m_size = 0;
+#if defined(_WIN32)
+                    m_file = other.m_file;
+                    m_mapping = other.m_mapping;
+                    other.m_file = INVALID_HANDLE_VALUE;
+                    other.m_mapping = nullptr;
+#endif
+                }
+                return *this;
+            }
+            ~JitMappedFile() {
+                release();
+            }
+
+            bool isValid() const { return m_data != nullptr; }
+            const char* data() const { return m_data; }
+            size_t size() const { return m_size; }
+        };
+
+        // On-disk entry layout:
+        // [JitDiskCacheEntryHeader][lowered name bytes][image bytes]
+        struct JitDiskCacheEntryHeader {
+            char magic[8];
+            uint32_t formatVersion;
+            uint32_t imageKind;
+            uint64_t key;
+            uint64_t loweredNameSize;
+            uint64_t imageSize;
+            uint64_t imageChecksum;
+        };
+        constexpr char JIT_DISK_CACHE_MAGIC[8] = { 'F', 'K', 'J', 'I', 'T', 'B', 'I', 'N' };
+        constexpr uint32_t JIT_DISK_CACHE_FORMAT_VERSION = 1;
+    } // namespace jit_internal
+
+    enum class JitImageKind : uint32_t { PTX = 0, CUBIN = 1 };
+
+    // Everything that affects the code generated by NVRTC for a kernel
+    struct JitDiskCacheKey {
+        std::string nameExpression;
+        std::string nvrtcVersion;
+        std::vector<std::string> options;
+        std::string arch;
+        std::string source;
+        std::string headersHash{ jit_internal::fklHeadersHash() };
+
+        uint64_t hash() const {
+            uint64_t h = jit_internal::fnv1a64(nameExpression);
+            h = jit_internal::fnv1a64(nvrtcVersion, h);
+            for (const auto& option : options) {
+                h = jit_internal::fnv1a64(option, h);
+            }
+            h = jit_internal::fnv1a64(arch, h);
+            h = jit_internal::fnv1a64(source, h);
+            return jit_internal::fnv1a64(headersHash, h);
+        }
+    };
+
+    // A compiled kernel image, either owned after an NVRTC compilation,
+    // or memory mapped from the disk cache or from a kernel bundle.
+    class JitKernelImage {
+        std::string m_loweredName;
+        JitImageKind m_kind{ JitImageKind::PTX };
+        std::vector<char> m_ownedImage;
+        jit_internal::JitMappedFile m_mappedFile;
+        // Mapping shared by all the images of a file, like a kernel bundle
+        std::shared_ptr<const jit_internal::JitMappedFile> m_sharedFile;
+        const char* m_image{ nullptr };
+        size_t m_imageSize{ 0 };
+    public:
+        JitKernelImage() = default;
+        JitKernelImage(std::string loweredName, JitImageKind kind, std::vector<char>&& image)
+            : m_loweredName(std::move(loweredName)), m_kind(kind), m_ownedImage(std::move(image)) {
+            m_image = m_ownedImage.data();
+            m_imageSize = m_ownedImage.size();
+        }
+        JitKernelImage(std::string loweredName, JitImageKind kind, jit_internal::JitMappedFile&& mappedFile,
+                       size_t imageOffset, size_t imageSize)
+            : m_loweredName(std::move(loweredName)), m_kind(kind), m_mappedFile(std::move(mappedFile)) {
+            m_image = m_mappedFile.data() + imageOffset;
+            m_imageSize = imageSize;
+        }
+        JitKernelImage(std::string loweredName, JitImageKind kind, std::shared_ptr<const jit_internal::JitMappedFile> sharedFile,
+                       size_t imageOffset, size_t imageSize)
+            : m_loweredName(std::move(loweredName)), m_kind(kind), m_sharedFile(std::move(sharedFile)) {
+            m_image = m_sharedFile->data() + imageOffset;
+            m_imageSize = imageSize;
+        }
+        JitKernelImage(const JitKernelImage&) = delete;
+        JitKernelImage& operator=(const JitKernelImage&) = delete;
+        JitKernelImage(JitKernelImage&& other) noexcept = default;
+        JitKernelImage& operator=(JitKernelImage&& other) noexcept = default;
+
+        const std::string& loweredName() const { return m_loweredName; }
+        JitImageKind kind() const { return m_kind; }
+        const char* data() const { return m_image; }
+        size_t size() const { return m_imageSize; }
+        bool isMapped() const { return m_mappedFile.isValid() || m_sharedFile != nullptr; }
+    };
+
+    // Versioned on-disk store of compiled kernel images.
+    // Entries are written to a temporary file and renamed, so concurrent processes
+    // never observe half written entries. Any entry that fails validation is removed
+    // and reported as a miss, so the caller falls back to compiling.
+    // Without a digest of the FKL headers, or when the directory is not private to the current user,
+    // the cache is always disabled.
+    class JITDiskCache {
+        std::filesystem::path m_directory;
+        bool m_private{ false };
+        bool m_enabled{ false };
+        std::atomic<uint64_t> m_hits{ 0 };
+        std::atomic<uint64_t> m_misses{ 0 };
+        std::atomic<uint64_t> m_stores{ 0 };
+        std::atomic<uint64_t> m_rejected{ 0 };
+        std::atomic<uint64_t> m_invalidations{ 0 };
+        std::atomic<uint64_t> m_tmpCounter{ 0 };
+
+        void reject(const std::filesystem::path& path) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            m_rejected++;
+            m_misses++;
+        }
+    public:
+        JITDiskCache() : JITDiskCache(jit_internal::defaultCacheRoot()) {
+            if (const char* disable = std::getenv("FK_JIT_CACHE_DISABLE")) {
+                m_enabled = m_enabled && std::string(disable) == "0";
+            }
+        }
+        explicit JITDiskCache(const std::filesystem::path& rootDirectory)
+            : m_directory(rootDirectory / ("v" + std::to_string(jit_internal::JIT_DISK_CACHE_FORMAT_VERSION))),
+              m_private(jit_internal::preparePrivateDirectory(rootDirectory)) {
+            setEnabled(true);
+        }
+
+        void setEnabled(bool enabled) { m_enabled = enabled && m_private && !jit_internal::fklHeadersHash().empty(); }
+        bool isEnabled() const { return m_enabled; }
+        // Whether the directory belongs to the current user, so other files can be stored in it too
+        bool isPrivate() const { return m_private; }
+        const std::filesystem::path& directory() const { return m_directory; }
+
+        std::filesystem::path entryPath(uint64_t key) const {
+            return m_directory / (jit_internal::toHexString(key) + ".fkjit");
+        }
+
+        std::optional<JitKernelImage> lookup(uint64_t key) {
+            if (!m_enabled) {
+                return std::nullopt;
+            }
+            const std::filesystem::path path = entryPath(key);
+            jit_internal::JitMappedFile file(path);
+            if (!file.isValid()) {
+                m_misses++;
+                return std::nullopt;
+            }
+            using Header = jit_internal::JitDiskCacheEntryHeader;
+            if (file.size() < sizeof(Header)) {
+                reject(path);
+                return std::nullopt;
+            }
+            Header header;
+            memcpy(&header, file.data(), sizeof(Header));
+            const bool validHeader =
+                memcmp(header.magic, jit_internal::JIT_DISK_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                header.formatVersion == jit_internal::JIT_DISK_CACHE_FORMAT_VERSION &&
+                header.key == key &&
+                header.imageKind <= static_cast<uint32_t>(JitImageKind::CUBIN) &&
+                header.imageSize > 0 &&
+                file.size() == sizeof(Header) + header.loweredNameSize + header.imageSize;
+            if (!validHeader) {
+                reject(path);
+                return std::nullopt;
+            }
+            const size_t imageOffset = sizeof(Header) + static_cast<size_t>(header.loweredNameSize);
+            if (jit_internal::fnv1a64(file.data() + imageOffset, static_cast<size_t>(header.imageSize)) != header.imageChecksum) {
+                reject(path);
+                return std::nullopt;
+            }
+            std::string loweredName(file.data() + sizeof(Header), static_cast<size_t>(header.loweredNameSize));
+            m_hits++;
+            return JitKernelImage(std::move(loweredName), static_cast<JitImageKind>(header.imageKind),
+                                  std::move(file), imageOffset, static_cast<size_t>(header.imageSize));
+        }
+
+        // Best effort: a failure to write the cache never fails the compilation
+        bool store(uint64_t key, const JitKernelImage& image) {
+            if (!m_enabled) {
+                return false;
+            }
+            std::error_code ec;
+            std::filesystem::create_directories(m_directory, ec);
+            if (ec) {
+                return false;
+            }
+            jit_internal::JitDiskCacheEntryHeader header;
+            memcpy(header.magic, jit_internal::JIT_DISK_CACHE_MAGIC, sizeof(header.magic));
+            header.formatVersion = jit_internal::JIT_DISK_CACHE_FORMAT_VERSION;
+            header.imageKind = static_cast<uint32_t>(image.kind());
+            header.key = key;
+            header.loweredNameSize = image.loweredName().size();
+            header.imageSize = image.size();
+            header.imageChecksum = jit_internal::fnv1a64(image.data(), image.size());
+
+            const std::filesystem::path finalPath = entryPath(key);
+            std::filesystem::path tmpPath = finalPath;
+            tmpPath += ".tmp." + std::to_string(jit_internal::currentProcessId()) + "." + std::to_string(m_tmpCounter++);
+            {
+                std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                out.write(image.loweredName().data(), static_cast<std::streamsize>(image.loweredName().size()));
+                out.write(image.data(), static_cast<std::streamsize>(image.size()));
+                if (!out) {
+                    out.close();
+                    std::filesystem::remove(tmpPath, ec);
+                    return false;
+                }
+            }
+            std::filesystem::rename(tmpPath, finalPath, ec);
+            if (ec) {
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+            m_stores++;
+            return true;
+        }
+
+        void invalidate(uint64_t key) {
+            std::error_code ec;
+            if (std::filesystem::remove(entryPath(key), ec)) {
+                m_invalidations++;
+            }
+        }
+
+        // Removes every entry of the current format version
+        void clear() {
+            std::error_code ec;
+            std::filesystem::remove_all(m_directory, ec);
+        }
+
+        uint64_t hits() const { return m_hits; }
+        uint64_t misses() const { return m_misses; }
+        uint64_t stores() const { return m_stores; }
+        uint64_t rejected() const { return m_rejected; }
+        uint64_t invalidations() const { return m_invalidations; }
+    };
+} // namespace fk
+
+#endif // FK_JIT_KERNEL_DISK_CACHE_H
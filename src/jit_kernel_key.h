@@ -0,0 +1,113 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_KERNEL_KEY_H
+#define FK_JIT_KERNEL_KEY_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace fk {
+    // Compile time key of a fused kernel launched from the templated executor.
+    // Two launches with the same key always resolve to the same kernel, so the key
+    // can select a static slot without building the name expression.
+    template <auto TFEN, bool THREAD_DIVISIBLE, typename TDPPDetails, typename... IOps>
+    struct JitKernelKey {};
+
+    class JitFkKernel;
+
+    // Devices with a higher ordinal do not use the slots, and resolve their kernels by name expression
+    constexpr int JIT_MAX_SLOT_DEVICES = 16;
+
+    // Compile profiles whose kernels a slot holds at the same time, for each device. Threads that use
+    // more profiles with the same key replace each other's kernels, and take the cold path more often.
+    constexpr int JIT_SLOT_PROFILES = 4;
+
+    // Slots per key type and device, holding the kernel once it is resolved, the JitProfileKey::hash of
+    // the profile it was compiled with, and the generation of the kernel cache it was resolved in.
+    // Evicting kernels starts a new generation, which invalidates every slot. Reading it is a few atomic
+    // loads: no strings, no hashing and no heap allocations.
+    template <typename Key>
+    struct JitKernelSlot {
+        struct Entry {
+            // Generation 0 is never current
+            std::atomic<uint64_t> generation{ 0 };
+            std::atomic<const JitFkKernel*> kernel{ nullptr };
+            std::atomic<uint64_t> profile{ 0 };
+        };
+        inline static Entry entries[JIT_MAX_SLOT_DEVICES][JIT_SLOT_PROFILES];
+        // Next entry replaced when every entry of the device holds a current kernel, under setMutex
+        inline static int nextReplaced[JIT_MAX_SLOT_DEVICES]{};
+        inline static std::mutex setMutex;
+
+        // Returns the kernel of device and profile if it was resolved in currentGeneration, nullptr otherwise.
+        // The caller must keep evicted kernels from being released while it uses it.
+        static const JitFkKernel* get(const int device, const uint64_t currentGeneration, const uint64_t profile = 0) {
+            if (device < 0 || device >= JIT_MAX_SLOT_DEVICES) {
+                return nullptr;
+            }
+            for (const Entry& entry : entries[device]) {
+                const uint64_t resolvedGeneration = entry.generation.load(std::memory_order_acquire);
+                if (resolvedGeneration != currentGeneration) {
+                    continue;
+                }
+                const JitFkKernel* resolved = entry.kernel.load(std::memory_order_acquire);
+                const uint64_t resolvedProfile = entry.profile.load(std::memory_order_acquire);
+                // set() clears the generation before changing the kernel and the profile
+                if (resolvedProfile == profile && entry.generation.load(std::memory_order_acquire) == resolvedGeneration) {
+                    return resolved;
+                }
+            }
+            return nullptr;
+        }
+        // Replaces the entry of the same profile, or else a stale one, or else the next one in turn
+        static void set(const int device, const JitFkKernel* resolved, const uint64_t resolvedGeneration, const uint64_t profile = 0) {
+            if (device < 0 || device >= JIT_MAX_SLOT_DEVICES) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(setMutex);
+            Entry* target = nullptr;
+            for (Entry& entry : entries[device]) {
+                if (entry.profile.load(std::memory_order_relaxed) == profile) {
+                    target = &entry;
+                    break;
+                }
+                if (target == nullptr && entry.generation.load(std::memory_order_relaxed) != resolvedGeneration) {
+                    target = &entry;
+                }
+            }
+            if (target == nullptr) {
+                target = &entries[device][nextReplaced[device]];
+                nextReplaced[device] = (nextReplaced[device] + 1) % JIT_SLOT_PROFILES;
+            }
+            target->generation.store(0, std::memory_order_release);
+            target->kernel.store(resolved, std::memory_order_release);
+            target->profile.store(profile, std::memory_order_release);
+            target->generation.store(resolvedGeneration, std::memory_order_release);
+        }
+        static void reset() {
+            std::lock_guard<std::mutex> lock(setMutex);
+            for (auto& deviceEntries : entries) {
+                for (Entry& entry : deviceEntries) {
+                    entry.generation.store(0, std::memory_order_release);
+                    entry.kernel.store(nullptr, std::memory_order_release);
+                    entry.profile.store(0, std::memory_order_release);
+                }
+            }
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_KERNEL_KEY_H
@@ -0,0 +1,139 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_KERNEL_PARAMS_H
+#define FK_JIT_KERNEL_PARAMS_H
+
+#include <src/jit_operation_pp.h>
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace fk {
+    // A kernel parameter described by its bytes, size and alignment
+    struct JitParamView {
+        const void* data;
+        size_t size;
+        size_t alignment;
+    };
+
+    namespace jit_internal {
+        inline size_t alignUp(const size_t offset, const size_t alignment) {
+            return (offset + alignment - 1) / alignment * alignment;
+        }
+
+        inline JitParamView toParamView(const JIT_Operation_pp& op) {
+            if (op.getAlignment() == 0) {
+                throw std::runtime_error("JIT_Operation_pp without alignment can not be packed: " + op.getType());
+            }
+            return { op.getData(), op.getSize(), op.getAlignment() };
+        }
+
+        // Computes the kernel parameter layout of (details, pipeline...), or of (pipeline...) when details is
+        // null: every parameter is placed at the next offset aligned to its alignment, like the members of a
+        // struct. onParam(index, param, offset) is called for each parameter. Returns the total size, without
+        // tail padding.
+        template <typename OnParam>
+        size_t layoutKernelParams(const JitParamView* details, const std::vector<JIT_Operation_pp>& pipeline, OnParam&& onParam) {
+            size_t offset = 0;
+            size_t index = 0;
+            const auto place = [&](const JitParamView& param) {
+                offset = alignUp(offset, param.alignment);
+                onParam(index++, param, offset);
+                offset += param.size;
+            };
+            if (details != nullptr) {
+                place(*details);
+            }
+            for (const auto& op : pipeline) {
+                place(toParamView(op));
+            }
+            return offset;
+        }
+
+        template <typename OnParam>
+        size_t layoutKernelParams(const JitParamView& details, const std::vector<JIT_Operation_pp>& pipeline, OnParam&& onParam) {
+            return layoutKernelParams(&details, pipeline, std::forward<OnParam>(onParam));
+        }
+    } // namespace jit_internal
+
+    // Contiguous storage for the parameters of a launch. The inline storage covers the
+    // classic 4KB kernel parameter limit, so it never allocates in practice. Bigger blocks
+    // grow a heap buffer once, which is reused by the following launches.
+    class JitParamBuffer {
+    public:
+        static constexpr size_t INLINE_CAPACITY = 4096;
+        static constexpr size_t MAX_ALIGNMENT = 16;
+    private:
+        alignas(MAX_ALIGNMENT) unsigned char m_inline[INLINE_CAPACITY];
+        std::unique_ptr<unsigned char[]> m_heap;
+        size_t m_heapCapacity{ 0 };
+        size_t m_size{ 0 };
+        unsigned char* m_data{ m_inline };
+    public:
+        JitParamBuffer() = default;
+        JitParamBuffer(const JitParamBuffer&) = delete;
+        JitParamBuffer& operator=(const JitParamBuffer&) = delete;
+
+        // Every launch of a thread reuses the same buffer
+        static JitParamBuffer& threadLocal() {
+            thread_local JitParamBuffer buffer;
+            return buffer;
+        }
+
+        unsigned char* reserve(const size_t size) {
+            if (size <= INLINE_CAPACITY) {
+                m_data = m_inline;
+            } else {
+                if (size > m_heapCapacity) {
+                    // operator new[] returns memory aligned to at least alignof(std::max_align_t)
+                    m_heap.reset(new unsigned char[size]);
+                    m_heapCapacity = size;
+                }
+                m_data = m_heap.get();
+            }
+            m_size = size;
+            return m_data;
+        }
+
+        // Packs the details, if not null, and the operations of the pipeline with the kernel parameter layout
+        void pack(const JitParamView* details, const std::vector<JIT_Operation_pp>& pipeline) {
+            const size_t size = jit_internal::layoutKernelParams(details, pipeline, [](size_t, const JitParamView& param, size_t) {
+                if (param.alignment > MAX_ALIGNMENT) {
+                    throw std::runtime_error("Kernel parameter alignment not supported by JitParamBuffer");
+                }
+            });
+            unsigned char* data = reserve(size);
+            // Padding bytes are zeroed so that the block is deterministic
+            memset(data, 0, size);
+            jit_internal::layoutKernelParams(details, pipeline, [data](size_t, const JitParamView& param, size_t offset) {
+                memcpy(data + offset, param.data, param.size);
+            });
+        }
+
+        void pack(const JitParamView& details, const std::vector<JIT_Operation_pp>& pipeline) {
+            pack(&details, pipeline);
+        }
+
+        unsigned char* data() { return m_data; }
+        const unsigned char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+    };
+} // namespace fk
+
+#endif // FK_JIT_KERNEL_PARAMS_H
@@ -0,0 +1,157 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_KERNEL_RESIDENCY_H
+#define FK_JIT_KERNEL_RESIDENCY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fk {
+    // Bounds of the loaded JIT modules. 0 means unlimited.
+    // From the environment: FK_JIT_CACHE_MAX_MODULES and FK_JIT_CACHE_MAX_BYTES.
+    struct JitCacheLimits {
+        size_t maxModules{ 0 };
+        size_t maxCodeBytes{ 0 };
+
+        static JitCacheLimits fromEnvironment() {
+            JitCacheLimits limits;
+            if (const char* maxModules = std::getenv("FK_JIT_CACHE_MAX_MODULES")) {
+                limits.maxModules = static_cast<size_t>(std::strtoull(maxModules, nullptr, 10));
+            }
+            if (const char* maxCodeBytes = std::getenv("FK_JIT_CACHE_MAX_BYTES")) {
+                limits.maxCodeBytes = static_cast<size_t>(std::strtoull(maxCodeBytes, nullptr, 10));
+            }
+            return limits;
+        }
+
+        bool exceeded(const size_t modules, const size_t codeBytes) const {
+            return (maxModules != 0 && modules > maxModules) || (maxCodeBytes != 0 && codeBytes > maxCodeBytes);
+        }
+    };
+
+    struct JitKernelCacheStats {
+        size_t residentModules{ 0 };
+        size_t residentBytes{ 0 };
+        uint64_t evictedModules{ 0 };
+        uint64_t evictedKernels{ 0 };
+        uint64_t hits{ 0 };
+        uint64_t misses{ 0 };
+
+        double hitRate() const {
+            const uint64_t lookups = hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+        }
+    };
+
+    // Loaded modules and the kernels that use them, for least recently launched eviction.
+    // Modules are the eviction unit, since the kernels compiled in the same batch share one.
+    // A module was launched as recently as the most recent of its kernels, as reported by
+    // Kernel::lastLaunch().
+    template <typename Kernel>
+    class JitResidencySet {
+    public:
+        struct Resident {
+            std::string key;
+            std::shared_ptr<const Kernel> kernel;
+        };
+    private:
+        struct ModuleEntry {
+            size_t codeBytes{ 0 };
+            std::vector<Resident> kernels;
+            uint64_t lastLaunch() const {
+                uint64_t last = 0;
+                for (const auto& resident : kernels) {
+                    last = std::max(last, resident.kernel->lastLaunch());
+                }
+                return last;
+            }
+        };
+        mutable std::mutex m_mutex;
+        std::unordered_map<const void*, ModuleEntry> m_modules;
+        size_t m_codeBytes{ 0 };
+        std::atomic<uint64_t> m_evictedModules{ 0 };
+        std::atomic<uint64_t> m_evictedKernels{ 0 };
+    public:
+        void add(const void* module, const size_t codeBytes, const std::string& key, std::shared_ptr<const Kernel> kernel) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto inserted = m_modules.try_emplace(module);
+            ModuleEntry& entry = inserted.first->second;
+            if (inserted.second) {
+                entry.codeBytes = codeBytes;
+                m_codeBytes += codeBytes;
+            }
+            entry.kernels.push_back({ key, std::move(kernel) });
+        }
+
+        // Removes the least recently launched modules until the limits are met, except keep,
+        // and returns their kernels. The caller releases them once they can not be in use.
+        std::vector<Resident> evict(const JitCacheLimits& limits, const void* keep = nullptr) {
+            std::vector<Resident> evicted;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (limits.exceeded(m_modules.size(), m_codeBytes)) {
+                auto victim = m_modules.end();
+                uint64_t victimLastLaunch = 0;
+                for (auto it = m_modules.begin(); it != m_modules.end(); ++it) {
+                    if (it->first == keep) {
+                        continue;
+                    }
+                    const uint64_t lastLaunch = it->second.lastLaunch();
+                    if (victim == m_modules.end() || lastLaunch < victimLastLaunch) {
+                        victim = it;
+                        victimLastLaunch = lastLaunch;
+                    }
+                }
+                if (victim == m_modules.end()) {
+                    break;
+                }
+                m_codeBytes -= victim->second.codeBytes;
+                m_evictedModules++;
+                m_evictedKernels += victim->second.kernels.size();
+                for (auto& resident : victim->second.kernels) {
+                    evicted.push_back(std::move(resident));
+                }
+                m_modules.erase(victim);
+            }
+            return evicted;
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_modules.clear();
+            m_codeBytes = 0;
+        }
+
+        size_t modules() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_modules.size();
+        }
+        size_t codeBytes() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_codeBytes;
+        }
+        uint64_t evictedModules() const { return m_evictedModules; }
+        uint64_t evictedKernels() const { return m_evictedKernels; }
+    };
+} // namespace fk
+
+#endif // FK_JIT_KERNEL_RESIDENCY_H
@@ -0,0 +1,387 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_KERNEL_TELEMETRY_H
+#define FK_JIT_KERNEL_TELEMETRY_H
+
+#include <cuda.h>
+#include <nvrtc.h>
+
+#include <src/jit_nvrtc_pch.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fk {
+    // Resource usage of a kernel reported by ptxas. -1 when the log does not report it.
+    struct JitPtxasInfo {
+        int registers{ -1 };
+        long long stackBytes{ -1 };
+        long long spillStoreBytes{ -1 };
+        long long spillLoadBytes{ -1 };
+        long long sharedBytes{ -1 };
+        long long constantBytes{ -1 };
+    };
+
+    // Attributes of a loaded kernel, from cuFuncGetAttribute
+    struct JitFunctionAttributes {
+        int registers{ 0 };
+        int localBytes{ 0 };
+        int sharedBytes{ 0 };
+        int constantBytes{ 0 };
+        int maxThreadsPerBlock{ 0 };
+        int ptxVersion{ 0 };
+        int binaryVersion{ 0 };
+    };
+
+    enum class JitKernelOrigin { COMPILED, BATCH_COMPILED, DISK_CACHE, BUNDLE };
+
+    inline const char* toString(const JitKernelOrigin origin) {
+        switch (origin) {
+        case JitKernelOrigin::COMPILED: return "compiled";
+        case JitKernelOrigin::BATCH_COMPILED: return "batch_compiled";
+        case JitKernelOrigin::BUNDLE: return "bundle";
+        default: return "disk_cache";
+        }
+    }
+
+    // Time of a compilation phase, as reported by NVRTC --time
+    struct JitCompilePhase {
+        std::string name;
+        double milliseconds{ 0.0 };
+    };
+
+    // What is known about a cached kernel, from its compilation and from the driver once loaded.
+    // The time is split into the NVRTC compilation and the driver load, which JIT compiles PTX images.
+    // When NVRTC supports --time, the compilation is also split into its phases.
+    struct JitKernelStats {
+        std::string nameExpression;
+        std::string loweredName;
+        // Like "sm_86" or "compute_86"
+        std::string target;
+        // Ordinal of the device it was last loaded in
+        int device{ 0 };
+        JitKernelOrigin origin{ JitKernelOrigin::COMPILED };
+        // Times it was compiled or loaded in this process, more than once if it was evicted
+        uint64_t loads{ 0 };
+        // Of the whole NVRTC program, which contains batchSize kernels. 0 when loaded from the disk cache.
+        double compileMilliseconds{ 0.0 };
+        // Of compileMilliseconds, the front end and the code generation that follows it (optimization,
+        // PTX generation and, for CUBIN, ptxas). 0 when NVRTC does not report its phases.
+        double parseMilliseconds{ 0.0 };
+        double codegenMilliseconds{ 0.0 };
+        std::vector<JitCompilePhase> phases;
+        size_t batchSize{ 1 };
+        double loadMilliseconds{ 0.0 };
+        // Size of the PTX or CUBIN image, shared by the kernels of the batch
+        size_t imageBytes{ 0 };
+        // The ptxas -v lines about this kernel. Empty when loaded from the disk cache or compiled to PTX.
+        std::string ptxasLog;
+        JitPtxasInfo ptxas;
+        bool hasAttributes{ false };
+        JitFunctionAttributes attributes;
+    };
+
+    namespace jit_internal {
+        inline std::string jsonString(const std::string& value) {
+            std::string escaped = "\"";
+            for (const char c : value) {
+                switch (c) {
+                case '"': escaped += "\\\""; break;
+                case '\\': escaped += "\\\\"; break;
+                case '\n': escaped += "\\n"; break;
+                case '\t': escaped += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char code[8];
+                        std::snprintf(code, sizeof(code), "\\u%04x", c);
+                        escaped += code;
+                    } else {
+                        escaped += c;
+                    }
+                }
+            }
+            return escaped + "\"";
+        }
+
+        inline std::string jsonNumber(const double value) {
+            std::ostringstream ss;
+            ss.precision(6);
+            ss << value;
+            return ss.str();
+        }
+
+        // NVRTC --time, added in CUDA 12.4. Disabled if a compilation rejects the option.
+        inline std::atomic<bool>& nvrtcPhaseTimes() {
+            static std::atomic<bool> enabled{ [] {
+                int major{ 0 }, minor{ 0 };
+                if (nvrtcVersion(&major, &minor) != NVRTC_SUCCESS) {
+                    return false;
+                }
+                return major > 12 || (major == 12 && minor >= 4);
+            }() };
+            return enabled;
+        }
+
+        inline std::vector<std::string> splitCsvLine(const std::string& line) {
+            std::vector<std::string> fields;
+            size_t begin = 0;
+            while (true) {
+                const size_t comma = line.find(',', begin);
+                std::string field = line.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin);
+                const size_t first = field.find_first_not_of(" \t\r");
+                const size_t last = field.find_last_not_of(" \t\r");
+                fields.push_back(first == std::string::npos ? std::string() : field.substr(first, last - first + 1));
+                if (comma == std::string::npos) {
+                    return fields;
+                }
+                begin = comma + 1;
+            }
+        }
+
+        inline size_t csvColumn(const std::vector<std::string>& header, const std::string& name) {
+            for (size_t i = 0; i < header.size(); ++i) {
+                std::string field = header[i];
+                std::transform(field.begin(), field.end(), field.begin(), [](const unsigned char c) { return std::tolower(c); });
+                if (field == name) {
+                    return i;
+                }
+            }
+            return header.size();
+        }
+
+        // The phases of the CSV table that --time=- writes in the program log, which is removed from it
+        inline std::vector<JitCompilePhase> extractCompilePhases(std::string& log) {
+            std::vector<JitCompilePhase> phases;
+            std::istringstream lines(log);
+            std::string remaining;
+            std::string line;
+            std::vector<std::string> header;
+            size_t phaseColumn{ 0 }, metricColumn{ 0 }, unitColumn{ 0 };
+            while (std::getline(lines, line)) {
+                const std::vector<std::string> fields = splitCsvLine(line);
+                if (header.empty()) {
+                    phaseColumn = csvColumn(fields, "phase name");
+                    metricColumn = csvColumn(fields, "metric");
+                    unitColumn = csvColumn(fields, "unit");
+                    if (phaseColumn < fields.size() && metricColumn < fields.size()) {
+                        header = fields;
+                    } else {
+                        remaining += line + "\n";
+                    }
+                    continue;
+                }
+                if (fields.size() != header.size()) {
+                    remaining += line + "\n";
+                    continue;
+                }
+                double milliseconds = std::atof(fields[metricColumn].c_str());
+                const std::string unit = unitColumn < fields.size() ? fields[unitColumn] : "ms";
+                if (unit == "s") {
+                    milliseconds *= 1e3;
+                } else if (unit == "us") {
+                    milliseconds /= 1e3;
+                }
+                phases.push_back({ fields[phaseColumn], milliseconds });
+            }
+            if (!header.empty()) {
+                log = remaining;
+            }
+            return phases;
+        }
+
+        // The front end phases, before NVVM generates the code
+        inline bool isParsePhase(const std::string& phase) {
+            std::string name = phase;
+            std::transform(name.begin(), name.end(), name.begin(), [](const unsigned char c) { return std::tolower(c); });
+            return name.find("front") != std::string::npos || name.find("cudafe") != std::string::npos ||
+                   name.find("parse") != std::string::npos || name.find("preprocess") != std::string::npos;
+        }
+
+        // The lines of a ptxas -v log about the entry function loweredName
+        inline std::string ptxasLogFor(const std::string& log, const std::string& loweredName) {
+            const std::string marker = "Compiling entry function '";
+            const size_t begin = log.find(marker + loweredName + "'");
+            if (begin == std::string::npos) {
+                return {};
+            }
+            const size_t lineBegin = log.rfind('\n', begin);
+            const size_t next = log.find(marker, begin + marker.size());
+            const size_t nextLine = next == std::string::npos ? log.size() : log.rfind('\n', next);
+            const size_t start = lineBegin == std::string::npos ? 0 : lineBegin + 1;
+            return log.substr(start, nextLine - start);
+        }
+
+        // Sum of the numbers that precede suffix, like 352 in "352 bytes cmem[0]". -1 if there is none.
+        inline long long sumNumbersBefore(const std::string& text, const std::string& suffix) {
+            long long total = -1;
+            for (size_t pos = text.find(suffix); pos != std::string::npos; pos = text.find(suffix, pos + suffix.size())) {
+                size_t digits = pos;
+                while (digits > 0 && std::isdigit(static_cast<unsigned char>(text[digits - 1]))) {
+                    digits--;
+                }
+                if (digits < pos) {
+                    total = (total < 0 ? 0 : total) + std::atoll(text.c_str() + digits);
+                }
+            }
+            return total;
+        }
+
+        inline JitPtxasInfo parsePtxasInfo(const std::string& section) {
+            JitPtxasInfo info;
+            const size_t used = section.find("Used ");
+            if (used != std::string::npos) {
+                info.registers = std::atoi(section.c_str() + used + 5);
+            }
+            info.stackBytes = sumNumbersBefore(section, " bytes stack frame");
+            info.spillStoreBytes = sumNumbersBefore(section, " bytes spill stores");
+            info.spillLoadBytes = sumNumbersBefore(section, " bytes spill loads");
+            info.sharedBytes = sumNumbersBefore(section, " bytes smem");
+            info.constantBytes = sumNumbersBefore(section, " bytes cmem");
+            return info;
+        }
+
+        inline JitFunctionAttributes functionAttributes(CUfunction function) {
+            JitFunctionAttributes attributes;
+            cuFuncGetAttribute(&attributes.registers, CU_FUNC_ATTRIBUTE_NUM_REGS, function);
+            cuFuncGetAttribute(&attributes.localBytes, CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES, function);
+            cuFuncGetAttribute(&attributes.sharedBytes, CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, function);
+            cuFuncGetAttribute(&attributes.constantBytes, CU_FUNC_ATTRIBUTE_CONST_SIZE_BYTES, function);
+            cuFuncGetAttribute(&attributes.maxThreadsPerBlock, CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK, function);
+            cuFuncGetAttribute(&attributes.ptxVersion, CU_FUNC_ATTRIBUTE_PTX_VERSION, function);
+            cuFuncGetAttribute(&attributes.binaryVersion, CU_FUNC_ATTRIBUTE_BINARY_VERSION, function);
+            return attributes;
+        }
+
+        inline std::string toJson(const JitKernelStats& stats) {
+            std::ostringstream json;
+            json << "{ \"nameExpression\": " << jsonString(stats.nameExpression)
+                 << ", \"loweredName\": " << jsonString(stats.loweredName)
+                 << ", \"target\": " << jsonString(stats.target)
+                 << ", \"device\": " << stats.device
+                 << ", \"origin\": " << jsonString(toString(stats.origin))
+                 << ", \"loads\": " << stats.loads
+                 << ", \"compileMs\": " << jsonNumber(stats.compileMilliseconds)
+                 << ", \"parseMs\": " << jsonNumber(stats.parseMilliseconds)
+                 << ", \"codegenMs\": " << jsonNumber(stats.codegenMilliseconds)
+                 << ", \"batchSize\": " << stats.batchSize
+                 << ", \"loadMs\": " << jsonNumber(stats.loadMilliseconds)
+                 << ", \"imageBytes\": " << stats.imageBytes
+                 << ", \"ptxas\": { \"registers\": " << stats.ptxas.registers
+                 << ", \"stackBytes\": " << stats.ptxas.stackBytes
+                 << ", \"spillStoreBytes\": " << stats.ptxas.spillStoreBytes
+                 << ", \"spillLoadBytes\": " << stats.ptxas.spillLoadBytes
+                 << ", \"sharedBytes\": " << stats.ptxas.sharedBytes
+                 << ", \"constantBytes\": " << stats.ptxas.constantBytes
+                 << ", \"log\": " << jsonString(stats.ptxasLog) << " }";
+            if (stats.hasAttributes) {
+                json << ", \"attributes\": { \"registers\": " << stats.attributes.registers
+                     << ", \"localBytes\": " << stats.attributes.localBytes
+                     << ", \"sharedBytes\": " << stats.attributes.sharedBytes
+                     << ", \"constantBytes\": " << stats.attributes.constantBytes
+                     << ", \"maxThreadsPerBlock\": " << stats.attributes.maxThreadsPerBlock
+                     << ", \"ptxVersion\": " << stats.attributes.ptxVersion
+                     << ", \"binaryVersion\": " << stats.attributes.binaryVersion << " }";
+            }
+            json << " }";
+            return json.str();
+        }
+
+        inline std::string toJson(const JitPchTelemetry& pch) {
+            std::ostringstream json;
+            json << "{ \"compilations\": { \"none\": " << pch.compilations[static_cast<size_t>(JitPchMode::NONE)]
+                 << ", \"create\": " << pch.compilations[static_cast<size_t>(JitPchMode::CREATE)]
+                 << ", \"use\": " << pch.compilations[static_cast<size_t>(JitPchMode::USE)] << " }"
+                 << ", \"createMs\": " << jsonNumber(pch.averageMilliseconds(JitPchMode::CREATE))
+                 << ", \"useMs\": " << jsonNumber(pch.averageMilliseconds(JitPchMode::USE))
+                 << ", \"baselineMs\": " << jsonNumber(pch.baselineMilliseconds())
+                 << ", \"savedMs\": " << jsonNumber(pch.savedMilliseconds())
+                 << ", \"discarded\": " << pch.discarded << " }";
+            return json.str();
+        }
+    } // namespace jit_internal
+
+    // Stats of every kernel loaded by the cache, by name expression. They are kept after eviction.
+    class JitKernelTelemetry {
+        mutable std::mutex m_mutex;
+        std::map<std::string, JitKernelStats> m_kernels;
+    public:
+        void record(JitKernelStats stats) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            JitKernelStats& entry = m_kernels[stats.nameExpression];
+            stats.loads = entry.loads + 1;
+            entry = std::move(stats);
+        }
+
+        std::optional<JitKernelStats> find(const std::string& nameExpression) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto it = m_kernels.find(nameExpression);
+            if (it == m_kernels.end()) {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
+        std::vector<JitKernelStats> kernels() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::vector<JitKernelStats> kernels;
+            for (const auto& entry : m_kernels) {
+                kernels.push_back(entry.second);
+            }
+            return kernels;
+        }
+
+        // With pch, the use of the precompiled headers is added after the kernels
+        std::string toJson(const std::optional<JitPchTelemetry>& pch = std::nullopt) const {
+            std::ostringstream json;
+            json << "{\n  \"kernels\": [";
+            bool first = true;
+            for (const JitKernelStats& stats : kernels()) {
+                json << (first ? "" : ",") << "\n    " << jit_internal::toJson(stats);
+                first = false;
+            }
+            json << "\n  ]";
+            if (pch) {
+                json << ",\n  \"pch\": " << jit_internal::toJson(*pch);
+            }
+            json << "\n}\n";
+            return json.str();
+        }
+
+        bool dump(const std::filesystem::path& path, const std::optional<JitPchTelemetry>& pch = std::nullopt) const {
+            std::ofstream file(path);
+            file << toJson(pch);
+            return static_cast<bool>(file);
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_kernels.clear();
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_KERNEL_TELEMETRY_H
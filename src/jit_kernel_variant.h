@@ -0,0 +1,181 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_KERNEL_VARIANT_H
+#define FK_JIT_KERNEL_VARIANT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fk {
+    // Widest vector access of the thread fused kernels, in bytes
+    constexpr unsigned int JIT_VECTOR_BYTES = 16;
+
+    // Memory layout of a Ptr read or written by a pipeline
+    struct JitPtrLayout {
+        uintptr_t address{ 0 };
+        // Bytes between rows, only relevant with more than one row
+        size_t pitch{ 0 };
+        unsigned int rows{ 1 };
+        // Bytes between planes, only relevant with more than one plane
+        size_t planePitch{ 0 };
+        unsigned int planes{ 1 };
+    };
+
+    // The Ptrs of a pipeline, bucketed by the widest aligned access that all of them allow.
+    // Both values are powers of two, up to JIT_VECTOR_BYTES.
+    struct JitAccessBucket {
+        // Alignment of every base address
+        unsigned int alignment{ JIT_VECTOR_BYTES };
+        // Every pitch and plane pitch is a multiple of it, so every row starts as aligned as the base address
+        unsigned int pitchMultiple{ JIT_VECTOR_BYTES };
+
+        bool operator==(const JitAccessBucket& other) const {
+            return alignment == other.alignment && pitchMultiple == other.pitchMultiple;
+        }
+        bool operator!=(const JitAccessBucket& other) const {
+            return !(*this == other);
+        }
+    };
+
+    // Kernel variant of a pipeline. Vectorized variants are the FKL thread fused kernels, which read
+    // and write several elements per thread with vector types. Whether the width divides the elements
+    // per thread, so the kernel can skip the checks of the last elements of a row, is the THREAD_DIVISIBLE
+    // argument that the FKL details already compute.
+    struct JitKernelVariant {
+        bool vectorized{ false };
+
+        bool operator==(const JitKernelVariant& other) const {
+            return vectorized == other.vectorized;
+        }
+    };
+
+    // Whether executors with thread fusion disabled also use the vectorized variants when the Ptrs allow it.
+    // Executors with thread fusion enabled always use them, and fall back to the scalar variant otherwise.
+    struct JitVariantPolicy {
+        bool vectorize{ false };
+
+        static JitVariantPolicy fromEnvironment() {
+            JitVariantPolicy policy;
+            if (const char* vectorize = std::getenv("FK_JIT_VECTORIZE")) {
+                policy.vectorize = std::strcmp(vectorize, "0") != 0;
+            }
+            return policy;
+        }
+    };
+
+    namespace jit_internal {
+        // Largest power of two that divides value, up to limit. 0 is divided by any of them.
+        inline unsigned int powerOfTwoDivisor(const uint64_t value, const unsigned int limit) {
+            unsigned int divisor = 1;
+            while (divisor < limit && value % (divisor * 2) == 0) {
+                divisor *= 2;
+            }
+            return divisor;
+        }
+
+        inline void addToBucket(JitAccessBucket& bucket, const JitPtrLayout& ptr) {
+            bucket.alignment = std::min(bucket.alignment, powerOfTwoDivisor(ptr.address, JIT_VECTOR_BYTES));
+            if (ptr.rows > 1) {
+                bucket.pitchMultiple = std::min(bucket.pitchMultiple, powerOfTwoDivisor(ptr.pitch, JIT_VECTOR_BYTES));
+            }
+            if (ptr.planes > 1) {
+                bucket.pitchMultiple = std::min(bucket.pitchMultiple, powerOfTwoDivisor(ptr.planePitch, JIT_VECTOR_BYTES));
+            }
+        }
+
+        inline JitAccessBucket accessBucket(const std::vector<JitPtrLayout>& ptrs) {
+            JitAccessBucket bucket;
+            for (const auto& ptr : ptrs) {
+                addToBucket(bucket, ptr);
+            }
+            return bucket;
+        }
+
+        // The vectorized variant needs every row of every Ptr aligned to the widest vector access
+        inline JitKernelVariant selectVariant(const JitAccessBucket& bucket, const bool vectorize) {
+            return { vectorize && bucket.alignment >= JIT_VECTOR_BYTES && bucket.pitchMultiple >= JIT_VECTOR_BYTES };
+        }
+
+        // Operations with a Ptr, like the FKL read and write operations: params.data and params.dims
+        template <typename IOp, typename = void>
+        struct HasPtrParams : std::false_type {};
+        template <typename IOp>
+        struct HasPtrParams<IOp, std::void_t<decltype(std::declval<const IOp&>().params.data),
+                                             decltype(std::declval<const IOp&>().params.dims.pitch)>> : std::true_type {};
+
+        template <typename Dims, typename = void>
+        struct HasRows : std::false_type {};
+        template <typename Dims>
+        struct HasRows<Dims, std::void_t<decltype(std::declval<const Dims&>().height)>> : std::true_type {};
+
+        // 3D Ptrs, like the FKL PtrDims<_3D>
+        template <typename Dims, typename = void>
+        struct HasPlanes : std::false_type {};
+        template <typename Dims>
+        struct HasPlanes<Dims, std::void_t<decltype(std::declval<const Dims&>().planes),
+                                           decltype(std::declval<const Dims&>().plane_pitch)>> : std::true_type {};
+
+        // Operations that can hold Ptrs that HasPtrParams does not see: params that are an array, like
+        // the Ptrs of the FKL batch operations, or operations with a BATCH
+        template <typename IOp, typename = void>
+        struct HasArrayParams : std::false_type {};
+        template <typename IOp>
+        struct HasArrayParams<IOp, std::void_t<decltype(std::declval<const IOp&>().params)>>
+            : std::is_array<std::remove_reference_t<decltype(std::declval<const IOp&>().params)>> {};
+        template <typename IOp, typename = void>
+        struct HasBatch : std::false_type {};
+        template <typename IOp>
+        struct HasBatch<IOp, std::void_t<decltype(IOp::Operation::BATCH)>> : std::true_type {};
+
+        template <typename IOp>
+        void addOperationToBucket(JitAccessBucket& bucket, const IOp& iOp) {
+            if constexpr (HasPtrParams<IOp>::value) {
+                JitPtrLayout layout;
+                layout.address = reinterpret_cast<uintptr_t>(iOp.params.data);
+                layout.pitch = static_cast<size_t>(iOp.params.dims.pitch);
+                using Dims = std::decay_t<decltype(iOp.params.dims)>;
+                if constexpr (HasRows<Dims>::value) {
+                    layout.rows = static_cast<unsigned int>(iOp.params.dims.height);
+                }
+                if constexpr (HasPlanes<Dims>::value) {
+                    layout.planePitch = static_cast<size_t>(iOp.params.dims.plane_pitch);
+                    layout.planes = static_cast<unsigned int>(iOp.params.dims.planes);
+                }
+                addToBucket(bucket, layout);
+            } else if constexpr (HasArrayParams<IOp>::value || HasBatch<IOp>::value) {
+                // Their Ptrs can not be inspected, so they are taken as unaligned
+                bucket.alignment = 1;
+                bucket.pitchMultiple = 1;
+            }
+        }
+
+        // Bucket of the Ptrs of the operations. Operations without a Ptr do not constrain it, and the
+        // ones whose Ptrs can not be inspected only allow the scalar variant.
+        template <typename... IOps>
+        JitAccessBucket accessBucketOf(const IOps&... iOps) {
+            JitAccessBucket bucket;
+            (addOperationToBucket(bucket, iOps), ...);
+            return bucket;
+        }
+    } // namespace jit_internal
+} // namespace fk
+
+#endif // FK_JIT_KERNEL_VARIANT_H
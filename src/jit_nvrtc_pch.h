@@ -0,0 +1,268 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_NVRTC_PCH_H
+#define FK_JIT_NVRTC_PCH_H
+
+#include <cuda.h>
+#include <nvrtc.h>
+
+#include <src/jit_kernel_disk_cache.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+// NVRTC supports precompiled headers since CUDA 12.8
+#if defined(CUDA_VERSION) && CUDA_VERSION >= 12080
+#define FK_NVRTC_PCH_AVAILABLE 1
+#endif
+
+namespace fk {
+    enum class JitPchMode : uint32_t { NONE = 0, CREATE = 1, USE = 2 };
+
+    // How a compilation uses the precompiled header, and the option to pass to NVRTC for it
+    struct JitPchUse {
+        JitPchMode mode{ JitPchMode::NONE };
+        std::string option;
+        std::filesystem::path createPath;
+    };
+
+    // Compile times split by how the precompiled header was used
+    struct JitPchTelemetry {
+        std::array<uint64_t, 3> compilations{};
+        std::array<uint64_t, 3> nanoseconds{};
+        uint64_t discarded{ 0 };
+        // Compile time of the compilations that created the PCH in earlier runs, read from its baseline file
+        uint64_t recordedBaselines{ 0 };
+        uint64_t recordedBaselineNanoseconds{ 0 };
+
+        double averageMilliseconds(const JitPchMode mode) const {
+            const size_t i = static_cast<size_t>(mode);
+            return compilations[i] == 0 ? 0.0 : nanoseconds[i] / 1e6 / compilations[i];
+        }
+
+        // Average compile time without the PCH. Before any such compilation, the one that created the
+        // PCH, which parses the same headers, in this run or else in the run that recorded it. 0 when
+        // there is none.
+        double baselineMilliseconds() const {
+            if (compilations[static_cast<size_t>(JitPchMode::NONE)] != 0) {
+                return averageMilliseconds(JitPchMode::NONE);
+            }
+            if (compilations[static_cast<size_t>(JitPchMode::CREATE)] != 0) {
+                return averageMilliseconds(JitPchMode::CREATE);
+            }
+            return recordedBaselines == 0 ? 0.0 : recordedBaselineNanoseconds / 1e6 / recordedBaselines;
+        }
+
+        // Time saved by the compilations that used the PCH, compared with baselineMilliseconds()
+        double savedMilliseconds() const {
+            const double baseline = baselineMilliseconds();
+            if (baseline == 0.0) {
+                return 0.0;
+            }
+            return (baseline - averageMilliseconds(JitPchMode::USE)) * compilations[static_cast<size_t>(JitPchMode::USE)];
+        }
+
+        JitPchTelemetry& operator+=(const JitPchTelemetry& other) {
+            for (size_t i = 0; i < compilations.size(); ++i) {
+                compilations[i] += other.compilations[i];
+                nanoseconds[i] += other.nanoseconds[i];
+            }
+            discarded += other.discarded;
+            recordedBaselines += other.recordedBaselines;
+            recordedBaselineNanoseconds += other.recordedBaselineNanoseconds;
+            return *this;
+        }
+    };
+
+    // NVRTC precompiled header of the fixed include prologue of the JIT programs.
+    // The first compilation creates it, and the following ones use it. The file is stored in the
+    // disk cache directory, named after everything that makes it valid, so it is reused by later runs.
+    // The compile time of the compilation that created it is stored next to it, in a .baseline file,
+    // so that the runs that find the PCH already created measure JitPchTelemetry::savedMilliseconds()
+    // against it, without compiling once without the PCH.
+    // When NVRTC does not support PCH, or creating or using it fails, compilations just run without it.
+    // Set FK_JIT_PCH_DISABLE=1 to disable it.
+    class JitNvrtcPch {
+        std::filesystem::path m_path;
+        std::atomic<bool> m_enabled{ false };
+        std::mutex m_mutex;
+        bool m_creating{ false };
+        std::atomic<uint64_t> m_tmpCounter{ 0 };
+        std::array<std::atomic<uint64_t>, 3> m_compilations{};
+        std::array<std::atomic<uint64_t>, 3> m_nanoseconds{};
+        std::atomic<uint64_t> m_discarded{ 0 };
+        // Read from the baseline file, 0 if there is none
+        uint64_t m_recordedBaseline{ 0 };
+
+        static bool nvrtcSupportsPch() {
+#if defined(FK_NVRTC_PCH_AVAILABLE)
+            int major{ 0 }, minor{ 0 };
+            if (nvrtcVersion(&major, &minor) != NVRTC_SUCCESS) {
+                return false;
+            }
+            return major > 12 || (major == 12 && minor >= 8);
+#else
+            return false;
+#endif
+        }
+
+        std::filesystem::path baselinePath() const {
+            std::filesystem::path path = m_path;
+            path += ".baseline";
+            return path;
+        }
+
+        // Written with a unique name and renamed, like the PCH
+        void writeBaseline(const uint64_t nanoseconds) {
+            std::filesystem::path tmpPath = baselinePath();
+            tmpPath += ".tmp." + std::to_string(jit_internal::currentProcessId()) + "." + std::to_string(m_tmpCounter++);
+            {
+                std::ofstream file(tmpPath, std::ios::trunc);
+                file << nanoseconds;
+                if (!file) {
+                    return;
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(tmpPath, baselinePath(), ec);
+            if (ec) {
+                std::filesystem::remove(tmpPath, ec);
+            }
+        }
+    public:
+        // key identifies the source prologue, the compile options and the NVRTC version
+        JitNvrtcPch(const std::filesystem::path& directory, const uint64_t key)
+            : m_path(directory / ("fkl_" + jit_internal::toHexString(key) + ".pch")) {
+            bool enabled = nvrtcSupportsPch();
+            if (const char* disable = std::getenv("FK_JIT_PCH_DISABLE")) {
+                enabled = enabled && std::string(disable) == "0";
+            }
+            m_enabled = enabled;
+            std::ifstream baseline(baselinePath());
+            if (!(baseline >> m_recordedBaseline)) {
+                m_recordedBaseline = 0;
+            }
+        }
+        JitNvrtcPch(const JitNvrtcPch&) = delete;
+        JitNvrtcPch& operator=(const JitNvrtcPch&) = delete;
+
+        bool isEnabled() const { return m_enabled; }
+        const std::filesystem::path& path() const { return m_path; }
+
+        // Decides how the next compilation uses the PCH. Only one compilation at a time creates it,
+        // the others compile without it in the meantime.
+        JitPchUse acquire() {
+            JitPchUse pchUse;
+            if (!m_enabled) {
+                return pchUse;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::error_code ec;
+            if (std::filesystem::exists(m_path, ec)) {
+                pchUse.mode = JitPchMode::USE;
+                pchUse.option = "--use-pch=" + m_path.string();
+            } else if (!m_creating) {
+                std::filesystem::create_directories(m_path.parent_path(), ec);
+                if (ec) {
+                    return pchUse;
+                }
+                m_creating = true;
+                pchUse.mode = JitPchMode::CREATE;
+                // Created with a unique name and renamed, so that other processes never see a partial file
+                pchUse.createPath = m_path;
+                pchUse.createPath += ".tmp." + std::to_string(jit_internal::currentProcessId()) + "." + std::to_string(m_tmpCounter++);
+                pchUse.option = "--create-pch=" + pchUse.createPath.string();
+            }
+            return pchUse;
+        }
+
+        // Called after a successful compilation that was asked to create the PCH
+        void finishCreate(nvrtcProgram program, const JitPchUse& pchUse) {
+            std::error_code ec;
+#if defined(FK_NVRTC_PCH_AVAILABLE)
+            const nvrtcResult status = nvrtcGetPCHCreateStatus(program);
+            if (status == NVRTC_SUCCESS && std::filesystem::exists(pchUse.createPath, ec)) {
+                std::filesystem::rename(pchUse.createPath, m_path, ec);
+            } else if (status == NVRTC_ERROR_PCH_CREATE_HEAP_EXHAUSTED) {
+                // The next compilation tries again with a heap big enough
+                size_t required{ 0 };
+                if (nvrtcGetPCHHeapSizeRequired(program, &required) == NVRTC_SUCCESS) {
+                    nvrtcSetPCHHeapSize(required);
+                }
+            } else {
+                // The headers can not be precompiled with this NVRTC, do not try again
+                m_enabled = false;
+            }
+#else
+            (void)program;
+#endif
+            std::filesystem::remove(pchUse.createPath, ec);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_creating = false;
+        }
+
+        // Called when a compilation that was asked to create the PCH fails
+        void abortCreate(const JitPchUse& pchUse) {
+            std::error_code ec;
+            std::filesystem::remove(pchUse.createPath, ec);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_creating = false;
+        }
+
+        void disable() {
+            m_enabled = false;
+        }
+
+        // Removes a PCH that NVRTC could not use, so that the next compilation creates it again
+        void discard() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::error_code ec;
+            std::filesystem::remove(m_path, ec);
+            std::filesystem::remove(baselinePath(), ec);
+            m_discarded++;
+        }
+
+        void record(const JitPchMode mode, const uint64_t nanoseconds) {
+            m_compilations[static_cast<size_t>(mode)]++;
+            m_nanoseconds[static_cast<size_t>(mode)] += nanoseconds;
+            std::error_code ec;
+            if (mode == JitPchMode::CREATE && std::filesystem::exists(m_path, ec)) {
+                writeBaseline(nanoseconds);
+            }
+        }
+
+        JitPchTelemetry telemetry() const {
+            JitPchTelemetry telemetry;
+            for (size_t i = 0; i < telemetry.compilations.size(); ++i) {
+                telemetry.compilations[i] = m_compilations[i];
+                telemetry.nanoseconds[i] = m_nanoseconds[i];
+            }
+            telemetry.discarded = m_discarded;
+            if (m_recordedBaseline != 0) {
+                telemetry.recordedBaselines = 1;
+                telemetry.recordedBaselineNanoseconds = m_recordedBaseline;
+            }
+            return telemetry;
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_NVRTC_PCH_H
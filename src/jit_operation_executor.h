@@ -17,9 +17,16 @@
 
 #include <fused_kernel/core/execution_model/executors.h>
 #include <src/jit_operation_executor_cache.h>
+#include <src/jit_kernel_key.h>
+#include <src/jit_graph.h>
+#include <src/jit_kernel_variant.h>
 
 #include <fused_kernel/core/utils/type_to_string.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 namespace fk {
     template <enum TF TFEN>
     struct Executor<TransformDPP<ParArch::GPU_NVIDIA_JIT, TFEN, void>> {
@@ -27,89 +34,314 @@ namespace fk {
     private:
         using Child = Executor<TransformDPP<ParArch::GPU_NVIDIA_JIT, TFEN>>;
         using Parent = BaseExecutor<Child>;
-        template <typename... IOps>
-        FK_HOST_FUSE void executeOperations_helper(Stream_<ParArch::GPU_NVIDIA_JIT>& stream, const IOps&... iOps) {
+        FK_HOST_FUSE std::string kernelNameWithDetails(const bool tfEnabled, const bool threadDivisible, const std::string& detailsType) {
+            std::string kernelName{ "launchTransformDPP_Kernel<ParArch::GPU_NVIDIA, " };
+            const std::string tfi = tfEnabled ? std::string("TF::ENABLED") : std::string("TF::DISABLED");
+            const std::string threadDivisibleStr = threadDivisible ? std::string("true") : std::string("false");
+            return kernelName + tfi + ", " + threadDivisibleStr + ", " + detailsType + ", ";
+        }
+        // Launches the kernel variant with thread fusion TFV
+        template <enum TF TFV, bool ASYNC, typename Fallback, typename... IOps>
+        FK_HOST_FUSE void executeVariant(Stream_<ParArch::GPU_NVIDIA_JIT>& stream, Fallback& fallback, const IOps&... iOps) {
             constexpr ParArch PA = ParArch::GPU_NVIDIA;
-            const auto tDetails = TransformDPP<PA, TFEN>::build_details(iOps...);
+            const auto tDetails = TransformDPP<PA, TFV>::build_details(iOps...);
             using TDPPDetails = std::decay_t<decltype(tDetails)>;
-            std::string detailsType = fk::typeToString<TDPPDetails>();
-            std::string kernelName{ "launchTransformDPP_Kernel<ParArch::GPU_NVIDIA, " };
-            std::string tfi;
             ActiveThreads activeThreads;
-            std::string threadDivisible;
+            bool threadDivisible;
             if constexpr (TDPPDetails::TFI::ENABLED) {
-                tfi = std::string("TF::ENABLED");
                 activeThreads = tDetails.activeThreads;
-                if (!tDetails.threadDivisible) {
-                    threadDivisible = std::string("false");
-                }
-                else {
-                    threadDivisible = std::string("true");
-                }
+                threadDivisible = tDetails.threadDivisible;
             }
             else {
-                tfi = std::string("TF::DISABLED");
                 activeThreads = get<0>(iOps...).getActiveThreads();
-                threadDivisible = std::string("true");
+                threadDivisible = true;
             }
             const CtxDim3 ctx_block = getDefaultBlockSize(activeThreads.x, activeThreads.y);
+            const JitBlockShape defaultBlock{ ctx_block.x, ctx_block.y };
+            const CUstream cuStream = reinterpret_cast<CUstream>(stream.getCUDAStream());
 
-            const dim3 block{ ctx_block.x, ctx_block.y, 1 };
-            const dim3 grid{ static_cast<uint>(ceil(activeThreads.x / static_cast<float>(block.x))),
+            const auto gridFor = [&](const JitBlockShape& block) {
+                return dim3{ static_cast<uint>(ceil(activeThreads.x / static_cast<float>(block.x))),
                              static_cast<uint>(ceil(activeThreads.y / static_cast<float>(block.y))),
                              activeThreads.z };
+            };
+            const auto launchWith = [&](const JitFkKernel& kernel, const JitBlockShape& block) {
+                const dim3 grid = gridFor(block);
+                // The kernel parameters are copied by cuLaunchKernel, so the operations can be passed directly
+                void* args[] = { const_cast<void*>(static_cast<const void*>(&tDetails)),
+                                 const_cast<void*>(static_cast<const void*>(&iOps))... };
+                kernel.getModule()->noteLaunch(cuStream);
+                gpuErrchk(cuLaunchKernel(kernel.getKernelFunction(), grid.x, grid.y, grid.z,
+                    block.x, block.y, 1, 0, cuStream, args, nullptr));
+            };
+            JITExecutorCache& cache = JITExecutorCache::getInstance();
+            // Kernels are loaded in the primary context of the device of the stream
+            const int device = cache.streamDevice(cuStream);
+            const auto launch = [&](const JitFkKernel& kernel) {
+                JitLaunchRecorder* recorder = jit_internal::activeLaunchRecorder();
+                JitBlockShape block = defaultBlock;
+                if (cache.getBlockTuner().isEnabled()) {
+                    // Recording does not launch, so it can only use a block tuned by earlier launches
+                    block = recorder != nullptr
+                        ? cache.tunedBlock(kernel, activeThreads.x, activeThreads.y, activeThreads.z).value_or(defaultBlock)
+                        : cache.tuneBlock(kernel, cuStream, activeThreads.x, activeThreads.y, activeThreads.z, defaultBlock,
+                                          [&](const JitBlockShape& candidate) { launchWith(kernel, candidate); });
+                }
+                if (recorder != nullptr) {
+                    const dim3 grid = gridFor(block);
+                    const JitParamView params[] = { { &tDetails, sizeof(TDPPDetails), alignof(TDPPDetails) },
+                                                    { &iOps, sizeof(IOps), alignof(IOps) }... };
+                    recorder->record(kernel.getKernelFunction(), kernel.getModule(), { grid.x, grid.y, grid.z }, { block.x, block.y, 1 },
+                                     params, sizeof(params) / sizeof(JitParamView));
+                    return;
+                }
+                launchWith(kernel, block);
+            };
 
-            std::string kernelNameWithDetails = kernelName + tfi + ", " + threadDivisible + ", " + typeToString<TDPPDetails>() + ", ";
-            std::vector<JIT_Operation_pp> pipeline = jit_internal::buildOperationPipeline(iOps...);
-            CUfunction kernelFunc = JITExecutorCache::getInstance().addKernel(kernelNameWithDetails, pipeline);
-            std::vector<void*> args = jit_internal::buildKernelArguments(pipeline);
-            args.insert(args.begin(), (void*)&tDetails);
-            gpuErrchk(cuLaunchKernel(kernelFunc, grid.x, grid.y, grid.z,
-                block.x, block.y, block.z, 0,
-                reinterpret_cast<CUstream>(stream.getCUDAStream()), args.data(), nullptr));
-        }
-        FK_HOST_FUSE void executeOperations_helper(Stream_<ParArch::GPU_NVIDIA_JIT>& stream, const std::vector<JIT_Operation_pp>& iOps) {
-            constexpr ParArch PA = ParArch::GPU_NVIDIA;
-            /*const auto tDetails = TransformDPP<PA, TFEN>::build_details(iOps...);
-            using TDPPDetails = std::decay_t<decltype(tDetails)>;
-            std::string detailsType = fk::typeToString<TDPPDetails>();
-            std::string kernelName{ "launchTransformDPP_Kernel<ParArch::GPU_NVIDIA, " };
-            std::string tfi;
-            ActiveThreads activeThreads;
-            std::string threadDivisible;
-            if constexpr (TDPPDetails::TFI::ENABLED) {
-                tfi = std::string("TF::ENABLED");
-                activeThreads = tDetails.activeThreads;
-                if (!tDetails.threadDivisible) {
-                    threadDivisible = std::string("false");
-                } else {
-                    threadDivisible = std::string("true");
+            // Warm path: the kernel for this instantiation is already resolved, and was not evicted since
+            using DivisibleSlot = JitKernelSlot<JitKernelKey<TFV, true, TDPPDetails, IOps...>>;
+            using NonDivisibleSlot = JitKernelSlot<JitKernelKey<TFV, false, TDPPDetails, IOps...>>;
+            {
+                const auto launchGuard = cache.launchGuard();
+                const uint64_t generation = cache.generation();
+                const uint64_t profile = cache.activeProfileHash();
+                const JitFkKernel* cachedKernel = threadDivisible ? DivisibleSlot::get(device, generation, profile)
+                                                                  : NonDivisibleSlot::get(device, generation, profile);
+                if (cachedKernel != nullptr) {
+                    cachedKernel->touch(cache.launchClock());
+                    launch(*cachedKernel);
+                    return;
                 }
+            }
+
+            // Cold path: look up or compile the kernel by its name expression.
+            // The generation is read first, so that a kernel evicted during the lookup is not used by later launches.
+            const uint64_t generation = cache.generation();
+            const auto resolve = [&](const std::shared_ptr<const JitFkKernel>& kernel) {
+                threadDivisible ? DivisibleSlot::set(device, kernel.get(), generation, kernel->getProfileHash())
+                                : NonDivisibleSlot::set(device, kernel.get(), generation, kernel->getProfileHash());
+                kernel->touch(cache.launchClock());
+                launch(*kernel);
+            };
+            const std::string kernelName = kernelNameWithDetails(TDPPDetails::TFI::ENABLED, threadDivisible, typeToString<TDPPDetails>());
+            const std::vector<JIT_Operation_pp> pipeline = jit_internal::buildOperationPipeline(iOps...);
+            if constexpr (ASYNC) {
+                // A graph can not record the fallback, so recording waits for the fused kernel
+                if (jit_internal::activeLaunchRecorder() == nullptr) {
+                    const auto kernelFuture = cache.addKernelAsync(kernelName, pipeline, device);
+                    jit_internal::launchOrFallback(kernelFuture, resolve, fallback);
+                    return;
+                }
+            }
+            resolve(cache.getKernel(kernelName, pipeline, device));
+        }
+        // Thread fusion reads and writes vectors, which is only valid if every row of every Ptr is
+        // aligned to them. That depends on the pointers and pitches, so the variant is selected for
+        // every execution, and an unaligned Ptr uses the scalar kernel even if TFEN is enabled.
+        // Operations too big for the kernel parameters are passed through the parameter arena, which only the
+        // kernels of runtime pipelines support: those pipelines run as one, with thread fusion disabled.
+        template <bool ASYNC, typename Fallback, typename... IOps>
+        FK_HOST_FUSE void executeOperations_impl(Stream_<ParArch::GPU_NVIDIA_JIT>& stream, Fallback& fallback, const IOps&... iOps) {
+            const JitParamView params[] = { { &iOps, sizeof(IOps), alignof(IOps) }... };
+            if (jit_internal::spillsParams(params, sizeof...(IOps), JITExecutorCache::getInstance().getParamArenaPolicy())) {
+                executeRuntime_impl<ASYNC>(stream, fallback, jit_internal::buildOperationPipeline(iOps...));
+                return;
+            }
+            const bool vectorize = TFEN == TF::ENABLED || JITExecutorCache::getInstance().getVariantPolicy().vectorize;
+            if (jit_internal::selectVariant(jit_internal::accessBucketOf(iOps...), vectorize).vectorized) {
+                executeVariant<TF::ENABLED, ASYNC>(stream, fallback, iOps...);
             } else {
-                tfi = std::string("TF::DISABLED");
-                activeThreads = get<0>(iOps...).getActiveThreads();
-                threadDivisible = std::string("true");
+                executeVariant<TF::DISABLED, ASYNC>(stream, fallback, iOps...);
             }
+        }
+        template <typename... IOps>
+        FK_HOST_FUSE void executeOperations_helper(Stream_<ParArch::GPU_NVIDIA_JIT>& stream, const IOps&... iOps) {
+            const auto noFallback = [] {};
+            executeOperations_impl<false>(stream, noFallback, iOps...);
+        }
+        // Pipelines assembled at runtime: the grid is computed from the ActiveThreads recorded in the
+        // first (read) operation, and all the pipelines with the same op types share one fused kernel.
+        // Thread fusion is always disabled, whatever TFEN, since it depends on compile time type information.
+        FK_HOST_FUSE void executeOperations_helper(Stream_<ParArch::GPU_NVIDIA_JIT>& stream, const std::vector<JIT_Operation_pp>& iOps) {
+            const auto noFallback = [] {};
+            executeRuntime_impl<false>(stream, noFallback, iOps);
+        }
+        template <bool ASYNC, typename Fallback>
+        FK_HOST_FUSE void executeRuntime_impl(Stream_<ParArch::GPU_NVIDIA_JIT>& stream, Fallback& fallback, const std::vector<JIT_Operation_pp>& iOps) {
+            if (iOps.size() < 2) {
+                throw std::runtime_error("A runtime pipeline needs at least a read and a write operation");
+            }
+            const JIT_Operation_pp& readOp = iOps.front();
+            if (!readOp.hasActiveThreads()) {
+                throw std::runtime_error("The first operation of a runtime pipeline must be a read operation: " + readOp.getType());
+            }
+            const ActiveThreads activeThreads(readOp.getActiveThreads()[0], readOp.getActiveThreads()[1], readOp.getActiveThreads()[2]);
             const CtxDim3 ctx_block = getDefaultBlockSize(activeThreads.x, activeThreads.y);
+            const JitBlockShape defaultBlock{ ctx_block.x, ctx_block.y };
+            const CUstream cuStream = reinterpret_cast<CUstream>(stream.getCUDAStream());
 
-            const dim3 block{ ctx_block.x, ctx_block.y, 1 };
-            const dim3 grid{ static_cast<uint>(ceil(activeThreads.x / static_cast<float>(block.x))),
+            const auto gridFor = [&](const JitBlockShape& block) {
+                return dim3{ static_cast<uint>(ceil(activeThreads.x / static_cast<float>(block.x))),
                              static_cast<uint>(ceil(activeThreads.y / static_cast<float>(block.y))),
                              activeThreads.z };
-
-            std::string kernelNameWithDetails = kernelName + tfi + ", " + threadDivisible + ", " + typeToString<TDPPDetails>() + ", ";
-            std::vector<JIT_Operation_pp> pipeline = jit_internal::buildOperationPipeline(iOps...);
-            CUfunction kernelFunc = JITExecutorCache::getInstance().addKernel(kernelNameWithDetails, pipeline);
-            std::vector<void*> args = jit_internal::buildKernelArguments(pipeline);
-            args.insert(args.begin(), &tDetails);
-            gpuErrchk(cuLaunchKernel(kernelFunc, grid.x, grid.y, grid.z,
-                block.x, block.y, block.z, 0,
-                reinterpret_cast<CUstream>(stream.getCUDAStream()), args.data(), nullptr));*/
+            };
+            JITExecutorCache& cache = JITExecutorCache::getInstance();
+            const int device = cache.streamDevice(cuStream);
+            // Operations too big for the kernel parameters are passed through the parameter arena
+            thread_local JitArenaPlan arenaPlan;
+            jit_internal::planParamArena(iOps, cache.getParamArenaPolicy(), arenaPlan);
+            const auto launchWith = [&](const JitFkKernel& kernel, const JitBlockShape& block) {
+                const dim3 grid = gridFor(block);
+                kernel.getModule()->noteLaunch(cuStream);
+                if (arenaPlan.spills()) {
+                    jit_internal::launchArenaKernel(kernel.getKernelFunction(), grid.x, grid.y, grid.z, block.x, block.y, 1, cuStream,
+                                                    cache.getParamArena(device), device, iOps, arenaPlan);
+                } else {
+                    jit_internal::launchRuntimeKernel(kernel.getKernelFunction(), grid.x, grid.y, grid.z, block.x, block.y, 1, cuStream, iOps);
+                }
+            };
+            const auto launch = [&](const JitFkKernel& kernel) {
+                JitLaunchRecorder* recorder = jit_internal::activeLaunchRecorder();
+                JitBlockShape block = defaultBlock;
+                if (cache.getBlockTuner().isEnabled()) {
+                    // Recording does not launch, so it can only use a block tuned by earlier launches
+                    block = recorder != nullptr
+                        ? cache.tunedBlock(kernel, activeThreads.x, activeThreads.y, activeThreads.z).value_or(defaultBlock)
+                        : cache.tuneBlock(kernel, cuStream, activeThreads.x, activeThreads.y, activeThreads.z, defaultBlock,
+                                          [&](const JitBlockShape& candidate) { launchWith(kernel, candidate); });
+                }
+                if (recorder != nullptr) {
+                    const dim3 grid = gridFor(block);
+                    if (!arenaPlan.spills()) {
+                        jit_internal::recordRuntimeKernel(*recorder, kernel, { grid.x, grid.y, grid.z }, { block.x, block.y, 1 }, iOps);
+                        return;
+                    }
+                    // The graph outlives the stream order of the pool, so it owns a block of its own
+                    JitParamBuffer& inlineOps = JitParamBuffer::threadLocal();
+                    JitParamBuffer& staging = jit_internal::arenaStaging();
+                    jit_internal::packArenaParams(iOps, arenaPlan, inlineOps, staging);
+                    JitContextGuard contextGuard(cache.getContext(device));
+                    std::shared_ptr<void> arena = JitParamArena::acquirePersistent(staging.data(), staging.size());
+                    const CUdeviceptr arenaPointer = reinterpret_cast<CUdeviceptr>(arena.get());
+                    const JitParamView params[] = { { &arenaPointer, sizeof(CUdeviceptr), alignof(CUdeviceptr) },
+                                                    { inlineOps.data(), arenaPlan.inlineSize, arenaPlan.inlineAlignment } };
+                    recorder->record(kernel.getKernelFunction(), kernel.getModule(), { grid.x, grid.y, grid.z }, { block.x, block.y, 1 },
+                                     params, 2);
+                    (*recorder)[recorder->size() - 1].arena = std::move(arena);
+                    return;
+                }
+                launchWith(kernel, block);
+            };
+            {
+                const auto launchGuard = cache.launchGuard();
+                const JitFkKernel* cachedKernel = arenaPlan.spills() ? cache.findArenaKernel(iOps, arenaPlan, device)
+                                                                      : cache.findRuntimeKernel(iOps, device);
+                if (cachedKernel != nullptr) {
+                    cachedKernel->touch(cache.launchClock());
+                    launch(*cachedKernel);
+                    return;
+                }
+            }
+            if constexpr (ASYNC) {
+                // A graph can not record the fallback, so recording waits for the fused kernel
+                if (jit_internal::activeLaunchRecorder() == nullptr) {
+                    const auto kernelFuture = arenaPlan.spills() ? cache.addArenaKernelAsync(iOps, arenaPlan, device)
+                                                                 : cache.addKernelAsync(jit_internal::runtimeKernelName(iOps), iOps, device);
+                    jit_internal::launchOrFallback(kernelFuture, [&](const std::shared_ptr<const JitFkKernel>& compiled) {
+                        // Found in memory by now, and registered for the warm path
+                        const std::shared_ptr<const JitFkKernel> kernel = arenaPlan.spills() ? cache.addArenaKernel(iOps, arenaPlan, device)
+                                                                                             : compiled;
+                        kernel->touch(cache.launchClock());
+                        launch(*kernel);
+                    }, fallback);
+                    return;
+                }
+            }
+            const std::shared_ptr<const JitFkKernel> kernel = arenaPlan.spills() ? cache.addArenaKernel(iOps, arenaPlan, device)
+                                                                                 : cache.addRuntimeKernel(iOps, device);
+            kernel->touch(cache.launchClock());
+            launch(*kernel);
         }
     public:
         FK_HOST_FUSE ParArch parArch() {
             return ParArch::GPU_NVIDIA_JIT;
         }
+        // Name expressions of every kernel variant that executeOperations can launch for the operations,
+        // scalar and vectorized, to compile them ahead of time. It does not need a GPU.
+        template <typename... IOps>
+        FK_HOST_FUSE std::vector<std::string> variantNameExpressions(const IOps&... iOps) {
+            constexpr ParArch PA = ParArch::GPU_NVIDIA;
+            const std::vector<JIT_Operation_pp> pipeline = jit_internal::buildOperationPipeline(iOps...);
+            std::vector<std::string> nameExpressions;
+            const auto addVariant = [&](const auto& tDetails) {
+                using TDPPDetails = std::decay_t<decltype(tDetails)>;
+                const std::string detailsType = typeToString<TDPPDetails>();
+                nameExpressions.push_back(jit_internal::buildNameExpression(kernelNameWithDetails(TDPPDetails::TFI::ENABLED, true, detailsType), pipeline));
+                if constexpr (TDPPDetails::TFI::ENABLED) {
+                    nameExpressions.push_back(jit_internal::buildNameExpression(kernelNameWithDetails(true, false, detailsType), pipeline));
+                }
+            };
+            addVariant(TransformDPP<PA, TF::DISABLED>::build_details(iOps...));
+            addVariant(TransformDPP<PA, TF::ENABLED>::build_details(iOps...));
+            // Operations that do not support thread fusion have a single variant
+            std::sort(nameExpressions.begin(), nameExpressions.end());
+            nameExpressions.erase(std::unique(nameExpressions.begin(), nameExpressions.end()), nameExpressions.end());
+            return nameExpressions;
+        }
+        // Never blocks on NVRTC. If the fused kernel is not compiled yet, its compilation is started
+        // in a background thread and fallback() is called instead, for instance to run the same
+        // operations with the ParArch::GPU_NVIDIA executor or as separate kernels.
+        // Once the kernel is ready, the following calls launch it.
+        template <typename Fallback, typename... IOps>
+        FK_HOST_FUSE void executeOperationsAsync(Stream_<ParArch::GPU_NVIDIA_JIT>& stream, Fallback&& fallback, const IOps&... iOps) {
+            executeOperations_impl<true>(stream, fallback, iOps...);
+        }
+        // Launches independent runtime pipelines, like the same pipeline on the frames of several cameras.
+        // The pipelines with the same op types run as the planes of one batched kernel, with the grid of
+        // the largest one, and the others are launched as with executeOperations. Batched kernels receive
+        // the constant operations as parameters, since each plane can have different values.
+        FK_HOST_FUSE void executeOperationsBatch(Stream_<ParArch::GPU_NVIDIA_JIT>& stream,
+                                                 const std::vector<std::vector<JIT_Operation_pp>>& pipelines) {
+            JITExecutorCache& cache = JITExecutorCache::getInstance();
+            const JitBatchPlan plan = jit_internal::planBatches(pipelines, cache.getBatchPolicy());
+            const CUstream cuStream = reinterpret_cast<CUstream>(stream.getCUDAStream());
+            const int device = cache.streamDevice(cuStream);
+            JitParamBuffer& buffer = JitParamBuffer::threadLocal();
+            for (const auto& launch : plan.launches) {
+                if (launch.size() == 1) {
+                    executeOperations_helper(stream, pipelines[launch.front()]);
+                    continue;
+                }
+                const std::vector<JIT_Operation_pp>& first = pipelines[launch.front()];
+                const auto launchBatch = [&](const JitFkKernel& kernel) {
+                    kernel.touch(cache.launchClock());
+                    unsigned int activeX, activeY;
+                    jit_internal::batchActiveThreads(pipelines, launch, activeX, activeY);
+                    const CtxDim3 block = getDefaultBlockSize(activeX, activeY);
+                    const unsigned int grid[3]{ static_cast<uint>(ceil(activeX / static_cast<float>(block.x))),
+                                                static_cast<uint>(ceil(activeY / static_cast<float>(block.y))),
+                                                static_cast<uint>(launch.size()) };
+                    jit_internal::packBatch(buffer, pipelines, launch);
+                    if (JitLaunchRecorder* recorder = jit_internal::activeLaunchRecorder()) {
+                        const JitParamView params[] = { { buffer.data(), buffer.size(), JitParamBuffer::MAX_ALIGNMENT } };
+                        recorder->record(kernel.getKernelFunction(), kernel.getModule(), grid, { block.x, block.y, 1 }, params, 1);
+                        return;
+                    }
+                    void* args[] = { buffer.data() };
+                    kernel.getModule()->noteLaunch(cuStream);
+                    gpuErrchk(cuLaunchKernel(kernel.getKernelFunction(), grid[0], grid[1], grid[2],
+                        block.x, block.y, 1, 0, cuStream, args, nullptr));
+                };
+                {
+                    const auto launchGuard = cache.launchGuard();
+                    if (const JitFkKernel* cachedKernel = cache.findBatchedKernel(first, launch.size(), device)) {
+                        launchBatch(*cachedKernel);
+                        continue;
+                    }
+                }
+                launchBatch(*cache.addBatchedKernel(first, launch.size(), device));
+            }
+        }
         DECLARE_EXECUTOR_PARENT_IMPL
     };
 } // namespace fk
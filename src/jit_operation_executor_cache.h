@@ -20,29 +20,46 @@
 #include <fused_kernel/core/utils/utils.h>
 
 #include <src/jit_operation_pp.h>
+#include <src/jit_kernel_params.h>
+#include <src/jit_runtime_pipeline.h>
+#include <src/jit_kernel_disk_cache.h>
+#include <src/jit_concurrent_cache.h>
+#include <src/jit_compile_worker.h>
+#include <src/jit_nvrtc_pch.h>
+#include <src/jit_compile_target.h>
+#include <src/jit_kernel_residency.h>
+#include <src/jit_kernel_telemetry.h>
+#include <src/jit_block_tuner.h>
+#include <src/jit_device_table.h>
+#include <src/jit_value_specialization.h>
+#include <src/jit_kernel_variant.h>
+#include <src/jit_batch_fusion.h>
+#include <src/jit_kernel_bundle.h>
+#include <src/jit_header_set.h>
+#include <src/jit_compile_profile.h>
+#include <src/jit_param_arena.h>
 
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace fk {
     namespace jit_internal {
         // --- Helper Functions for Dynamic Pipeline Construction ---
-        std::string buildNameExpression(const std::string& kernelName, const std::vector<JIT_Operation_pp>& pipeline) {
-            std::stringstream ss;
-            ss << "&" << kernelName;
-            for (size_t i = 0; i < pipeline.size(); ++i) {
-                ss << pipeline[i].getType();
-                if (i < pipeline.size() - 1) {
-                    ss << ", ";
-                }
-            }
-            ss << ">";
-            return ss.str();
-        }
-
         std::vector<void*> buildKernelArguments(const std::vector<JIT_Operation_pp>& pipeline) {
             std::vector<void*> args;
             for (const auto& op : pipeline) {
@@ -51,96 +68,425 @@ namespace fk {
             return args;
         }
 
+        template <typename IOp, typename = void>
+        struct HasActiveThreads : std::false_type {};
+        template <typename IOp>
+        struct HasActiveThreads<IOp, std::void_t<decltype(std::declval<const IOp&>().getActiveThreads())>> : std::true_type {};
+
+        // Runtime descriptor of a typed operation. Read operations also record their ActiveThreads,
+        // so that pipelines assembled at runtime can compute their grid.
+        template <typename IOp>
+        JIT_Operation_pp buildOperation(const IOp& iOp) {
+            JIT_Operation_pp op(typeToString<IOp>(), &iOp, sizeof(IOp), alignof(IOp));
+            if constexpr (HasActiveThreads<IOp>::value) {
+                const auto activeThreads = iOp.getActiveThreads();
+                op.setActiveThreads(activeThreads.x, activeThreads.y, activeThreads.z);
+            }
+            return op;
+        }
+
         template <typename... IOps>
         std::vector<JIT_Operation_pp> buildOperationPipeline(const IOps&... iOps) {
             std::vector<JIT_Operation_pp> pipeline;
-            (pipeline.emplace_back(typeToString<IOps>(), &iOps, sizeof(IOps)), ...);
+            (pipeline.push_back(buildOperation(iOps)), ...);
             return pipeline;
         }
-    } // jit_internal
-    class JitFkKernel {
-        CUmodule m_module;
-        CUfunction m_kernelFunc;
-        std::string m_nameExpression;
-        std::string m_includes{
-            R"( 
+
+        // Launches the kernel of a runtime pipeline, with all the operations packed in a single parameter
+        // block held by the thread local JitParamBuffer. It does not allocate memory.
+        inline void launchRuntimeKernel(CUfunction kernelFunc, const uint gridX, const uint gridY, const uint gridZ,
+                                        const uint blockX, const uint blockY, const uint blockZ, CUstream stream,
+                                        const std::vector<JIT_Operation_pp>& pipeline) {
+            JitParamBuffer& params = JitParamBuffer::threadLocal();
+            params.pack(nullptr, pipeline);
+            size_t paramsSize = params.size();
+            void* config[] = { CU_LAUNCH_PARAM_BUFFER_POINTER, params.data(),
+                               CU_LAUNCH_PARAM_BUFFER_SIZE, &paramsSize,
+                               CU_LAUNCH_PARAM_END };
+            gpuErrchk(cuLaunchKernel(kernelFunc, gridX, gridY, gridZ, blockX, blockY, blockZ, 0, stream, nullptr, config));
+        }
+
+        // Launches the arena kernel of a runtime pipeline: the spilled operations are copied to a block of
+        // the arena, which returns to the pool once the kernel is done
+        inline void launchArenaKernel(CUfunction kernelFunc, const uint gridX, const uint gridY, const uint gridZ,
+                                      const uint blockX, const uint blockY, const uint blockZ, CUstream stream,
+                                      JitParamArena& arena, const int device,
+                                      const std::vector<JIT_Operation_pp>& pipeline, const JitArenaPlan& plan) {
+            JitParamBuffer& inlineOps = JitParamBuffer::threadLocal();
+            JitParamBuffer& staging = arenaStaging();
+            packArenaParams(pipeline, plan, inlineOps, staging);
+            CUdeviceptr block = arena.acquire(device, stream, staging.data(), staging.size());
+            void* args[] = { &block, inlineOps.data() };
+            gpuErrchk(cuLaunchKernel(kernelFunc, gridX, gridY, gridZ, blockX, blockY, blockZ, 0, stream, args, nullptr));
+            arena.release(stream, block);
+        }
+
+        inline std::vector<std::string> defaultCompileOptions() {
+#if defined(FK_JIT_EMBEDDED_HEADERS)
+            // The FKL headers are passed to nvrtcCreateProgram, see embeddedHeaderSet()
+            return { "--std=c++17", "-DNVRTC_COMPILER" };
+#elif defined(FKL_INCLUDE_PATH)
+            return { "--std=c++17", std::string("-I") + FKL_INCLUDE_PATH, "-DNVRTC_COMPILER" };
+#else
+#error "NVRTC can not find the FKL headers: define FK_JIT_EMBEDDED_HEADERS, or FKL_INCLUDE_PATH as the FKL include directory"
+#endif
+        }
+
+        // defaultCompileOptions() followed by the options of a compile profile
+        inline std::vector<std::string> profileCompileOptions(const std::vector<std::string>& profileOptions) {
+            std::vector<std::string> options = defaultCompileOptions();
+            options.insert(options.end(), profileOptions.begin(), profileOptions.end());
+            return options;
+        }
+
+        inline std::string nvrtcVersionString() {
+            int major{ 0 }, minor{ 0 };
+            gpuErrchk(nvrtcVersion(&major, &minor));
+            return std::to_string(major) + "." + std::to_string(minor);
+        }
+
+        // Source of every JIT program: the FKL kernels, the runtime pipeline helpers, the value specialization
+        // kernel, the batched kernel and the parameter arena kernel
+        inline const std::string& jitKernelSource() {
+            static const std::string source = std::string(R"( 
                 #include <fused_kernel/core/execution_model/executor_kernels.h>
                 #include <fused_kernel/algorithms/algorithms.h>
                 #include <fused_kernel/core/execution_model/data_parallel_patterns.h>
-            )"
+            )") + runtimePipelinePrologue() + specializationPrologue() + batchPrologue() + arenaPrologue();
+            return source;
+        }
+
+        // jitKernelSource() with only the headers that the name expressions need, or nothing if the
+        // embedded header index does not know one of their templates
+        inline std::optional<std::string> minimalKernelSource(const std::vector<std::string>& nameExpressions) {
+            const std::optional<std::vector<std::string>> headers = minimalHeaders(nameExpressions, embeddedHeaderIndex());
+            if (!headers) {
+                return std::nullopt;
+            }
+            std::string source;
+            for (const auto& header : coreHeaders()) {
+                source += "#include <" + header + ">\n";
+            }
+            for (const auto& header : *headers) {
+                source += "#include <" + header + ">\n";
+            }
+            return source + runtimePipelinePrologue() + specializationPrologue() + batchPrologue() + arenaPrologue();
+        }
+
+        // Source of the program that compiles a set of name expressions
+        struct JitProgramSource {
+            std::string text;
+            // Whether it includes a minimal header set instead of the umbrella headers of jitKernelSource()
+            bool minimal{ false };
         };
-    public:
-        // Default constructor
-        JitFkKernel() : m_module(nullptr), m_kernelFunc(nullptr) {}
-        JitFkKernel(const std::string& kernelName,
-            const std::vector<JIT_Operation_pp>& pipeline) {
-            m_nameExpression = jit_internal::buildNameExpression(kernelName, pipeline);
+
+        inline JitProgramSource programSource(const std::vector<std::string>& nameExpressions, const JitHeaderMode mode) {
+            if (mode == JitHeaderMode::MINIMAL) {
+                if (std::optional<std::string> minimal = minimalKernelSource(nameExpressions)) {
+                    return { std::move(*minimal), true };
+                }
+            }
+            return { jitKernelSource(), false };
+        }
+
+        // Image of a program with several kernels, and the lowered name of each name expression
+        struct JitBatchImage {
+            std::vector<std::string> loweredNames;
+            JitImageKind kind{ JitImageKind::PTX };
+            std::vector<char> image;
+            double compileMilliseconds{ 0.0 };
+            // Reported by NVRTC --time, when it supports it
+            std::vector<JitCompilePhase> phases;
+            // NVRTC log, with the ptxas -v report when compiled to CUBIN
+            std::string log;
+        };
+
+        // Compiles all the name expressions in a single NVRTC program, so that the headers are
+        // parsed only once for all of them. It does not need a GPU.
+        // With a pch, the include prologue of source is precompiled once and reused. If a compilation
+        // with the PCH fails, it is compiled again without it, and the PCH is discarded if that works.
+        // The target selects the architecture, and whether CUBIN or PTX is generated.
+        // Throws JitCompileError with the NVRTC log if the source does not compile.
+        inline JitBatchImage compileNameExpressions(const std::string& source, const std::vector<std::string>& nameExpressions,
+                                                    const std::vector<std::string>& options, JitNvrtcPch* pch = nullptr,
+                                                    const JitCompileTarget& target = JitCompileTarget{}) {
+            if (nameExpressions.empty()) {
+                throw std::runtime_error("compileNameExpressions needs at least one name expression");
+            }
+            // Includes of the embedded FKL headers are resolved in memory
+            const JitHeaderSet& headers = embeddedHeaderSet();
             nvrtcProgram fklProg;
-            gpuErrchk(nvrtcCreateProgram(&fklProg, m_includes.c_str(), m_nameExpression.c_str(), 0, nullptr, nullptr));
-            gpuErrchk(nvrtcAddNameExpression(fklProg, m_nameExpression.c_str()));
-            const char* options[] = { "--std=c++17", "-ID:/include", "-IE:/GitHub/FKL/include", "-DNVRTC_COMPILER" };
-            nvrtcResult compile_result = nvrtcCompileProgram(fklProg, 4, options);
+            gpuErrchk(nvrtcCreateProgram(&fklProg, source.c_str(), nameExpressions.front().c_str(),
+                                         headers.count(), headers.contents(), headers.names()));
+            for (const auto& nameExpression : nameExpressions) {
+                gpuErrchk(nvrtcAddNameExpression(fklProg, nameExpression.c_str()));
+            }
+            const JitPchUse pchUse = pch != nullptr ? pch->acquire() : JitPchUse{};
+            std::vector<const char*> optionPtrs;
+            for (const auto& option : options) {
+                optionPtrs.push_back(option.c_str());
+            }
+            const std::string archOption = target.option();
+            if (!archOption.empty()) {
+                optionPtrs.push_back(archOption.c_str());
+            }
+            if (target.kind == JitImageKind::CUBIN) {
+                // Register, spill and shared memory usage of every kernel, in the log
+                optionPtrs.push_back("--ptxas-options=-v");
+            }
+            if (pchUse.mode != JitPchMode::NONE) {
+                optionPtrs.push_back(pchUse.option.c_str());
+            }
+            // Time of each phase, in the log
+            const bool phaseTimes = nvrtcPhaseTimes();
+            if (phaseTimes) {
+                optionPtrs.push_back("--time=-");
+            }
+            const auto start = std::chrono::steady_clock::now();
+            nvrtcResult compile_result = nvrtcCompileProgram(fklProg, static_cast<int>(optionPtrs.size()), optionPtrs.data());
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
             size_t log_size;
             gpuErrchk(nvrtcGetProgramLogSize(fklProg, &log_size));
+            std::vector<char> log(log_size + 1, '\0');
             if (log_size > 1) {
+                gpuErrchk(nvrtcGetProgramLog(fklProg, log.data()));
+            }
+            if (compile_result != NVRTC_SUCCESS) {
                 std::stringstream nvrtc_log;
-                std::vector<char> log(log_size);
                 const char* error_str = nvrtcGetErrorString(compile_result);
-                gpuErrchk(nvrtcGetProgramLog(fklProg, log.data()));
                 nvrtc_log << "NVRTC Error: " << error_str << std::endl;
                 nvrtc_log << "NVRTC Log:\n" << log.data() << std::endl;
-                throw std::runtime_error(nvrtc_log.str());
+                nvrtcDestroyProgram(&fklProg);
+                if (pchUse.mode == JitPchMode::CREATE) {
+                    pch->abortCreate(pchUse);
+                }
+                if (phaseTimes && compile_result == NVRTC_ERROR_INVALID_OPTION) {
+                    nvrtcPhaseTimes() = false;
+                    return compileNameExpressions(source, nameExpressions, options, pch, target);
+                }
+                if (pchUse.mode == JitPchMode::NONE) {
+                    throw JitCompileError(nvrtc_log.str());
+                }
+                // Throws again if the error is not caused by the PCH
+                JitBatchImage batch = compileNameExpressions(source, nameExpressions, options, nullptr, target);
+                if (pchUse.mode == JitPchMode::USE) {
+                    pch->discard();
+                } else {
+                    pch->disable();
+                }
+                return batch;
+            }
+            if (pch != nullptr) {
+                if (pchUse.mode == JitPchMode::CREATE) {
+                    pch->finishCreate(fklProg, pchUse);
+                }
+                pch->record(pchUse.mode, static_cast<uint64_t>(elapsed.count()));
             }
-            const char* mangled_name;
-            gpuErrchk(nvrtcGetLoweredName(fklProg, m_nameExpression.c_str(), &mangled_name));
-            size_t ptx_size;
-            gpuErrchk(nvrtcGetPTXSize(fklProg, &ptx_size));
-            std::vector<char> ptx(ptx_size);
-            gpuErrchk(nvrtcGetPTX(fklProg, ptx.data()));
-            gpuErrchk(cuModuleLoadData(&m_module, ptx.data()));
-            gpuErrchk(cuModuleGetFunction(&m_kernelFunc, m_module, mangled_name));
+            JitBatchImage batch;
+            batch.compileMilliseconds = elapsed.count() / 1e6;
+            batch.log = log.data();
+            if (phaseTimes) {
+                batch.phases = extractCompilePhases(batch.log);
+            }
+            for (const auto& nameExpression : nameExpressions) {
+                const char* mangled_name;
+                gpuErrchk(nvrtcGetLoweredName(fklProg, nameExpression.c_str(), &mangled_name));
+                // The lowered names are owned by the program, so they have to be copied before destroying it
+                batch.loweredNames.emplace_back(mangled_name);
+            }
+            batch.kind = target.kind;
+            size_t image_size;
+            if (target.kind == JitImageKind::CUBIN) {
+                gpuErrchk(nvrtcGetCUBINSize(fklProg, &image_size));
+                batch.image.resize(image_size);
+                gpuErrchk(nvrtcGetCUBIN(fklProg, batch.image.data()));
+            } else {
+                gpuErrchk(nvrtcGetPTXSize(fklProg, &image_size));
+                batch.image.resize(image_size);
+                gpuErrchk(nvrtcGetPTX(fklProg, batch.image.data()));
+            }
+            gpuErrchk(nvrtcDestroyProgram(&fklProg));
+            return batch;
         }
 
-        // Copy constructor
-        JitFkKernel(const JitFkKernel& other)
-            : m_nameExpression(other.m_nameExpression), m_includes(other.m_includes),
-            m_module(other.m_module), m_kernelFunc(other.m_kernelFunc) {}
+        // compileNameExpressions for a program source, with pch, the PCH of its include prologue. A minimal
+        // source that fails because a name is not declared, when a template needs a header that the index
+        // does not know about, is compiled again with jitKernelSource() and umbrellaPch, its PCH.
+        inline JitBatchImage compileProgramSource(const JitProgramSource& source, const std::vector<std::string>& nameExpressions,
+                                                  const std::vector<std::string>& options, JitNvrtcPch* pch = nullptr,
+                                                  JitNvrtcPch* umbrellaPch = nullptr, const JitCompileTarget& target = JitCompileTarget{}) {
+            if (!source.minimal) {
+                return compileNameExpressions(source.text, nameExpressions, options, pch, target);
+            }
+            try {
+                return compileNameExpressions(source.text, nameExpressions, options, pch, target);
+            } catch (const std::runtime_error& e) {
+                if (!isMissingDeclarationError(e.what())) {
+                    throw;
+                }
+                return compileNameExpressions(jitKernelSource(), nameExpressions, options, umbrellaPch, target);
+            }
+        }
 
-        // Move constructor
-        JitFkKernel(JitFkKernel&& other) noexcept
-            : m_module(other.m_module),
-            m_kernelFunc(other.m_kernelFunc),
-            m_nameExpression(std::move(other.m_nameExpression)),
-            m_includes(std::move(other.m_includes)) {
-            other.m_module = nullptr;
-            other.m_kernelFunc = nullptr;
+        // Compiles a single name expression with NVRTC. It does not need a GPU.
+        inline JitKernelImage compileNameExpression(const std::string& source, const std::string& nameExpression,
+                                                    const std::vector<std::string>& options, JitNvrtcPch* pch = nullptr,
+                                                    const JitCompileTarget& target = JitCompileTarget{}) {
+            JitBatchImage batch = compileNameExpressions(source, { nameExpression }, options, pch, target);
+            return JitKernelImage(std::move(batch.loweredNames.front()), batch.kind, std::move(batch.image));
         }
 
-        // Copy assignment operator
-        JitFkKernel& operator=(const JitFkKernel& other) {
-            if (this != &other) {
-                m_nameExpression = other.m_nameExpression;
-                m_includes = other.m_includes;
-                m_module = other.m_module;
-                m_kernelFunc = other.m_kernelFunc;
+        // Compile side stats of the kernel at index in the batch. They do not need a GPU.
+        inline JitKernelStats makeCompileStats(const JitBatchImage& batch, const size_t index, const std::string& nameExpression,
+                                               const JitCompileTarget& target) {
+            JitKernelStats stats;
+            stats.nameExpression = nameExpression;
+            stats.loweredName = batch.loweredNames[index];
+            stats.target = target.name();
+            stats.origin = batch.loweredNames.size() > 1 ? JitKernelOrigin::BATCH_COMPILED : JitKernelOrigin::COMPILED;
+            stats.compileMilliseconds = batch.compileMilliseconds;
+            stats.phases = batch.phases;
+            for (const JitCompilePhase& phase : batch.phases) {
+                (isParsePhase(phase.name) ? stats.parseMilliseconds : stats.codegenMilliseconds) += phase.milliseconds;
             }
-            return *this;
+            stats.batchSize = batch.loweredNames.size();
+            stats.imageBytes = batch.image.size();
+            stats.ptxasLog = ptxasLogFor(batch.log, stats.loweredName);
+            stats.ptxas = parsePtxasInfo(stats.ptxasLog);
+            return stats;
+        }
+
+        inline JitDiskCacheKey makeDiskCacheKey(const std::string& source, const std::string& nameExpression,
+                                                const std::vector<std::string>& options,
+                                                const JitCompileTarget& target = JitCompileTarget{}) {
+            static const std::string nvrtcVersion = nvrtcVersionString();
+            JitDiskCacheKey key;
+            key.nameExpression = nameExpression;
+            key.nvrtcVersion = nvrtcVersion;
+            key.options = options;
+            key.arch = target.name();
+            key.source = source;
+            return key;
         }
 
-        // Move assignment operator
-        JitFkKernel& operator=(JitFkKernel&& other) noexcept {
-            if (this != &other) {
-                m_module = other.m_module;
-                m_kernelFunc = other.m_kernelFunc;
-                m_nameExpression = std::move(other.m_nameExpression);
-                m_includes = std::move(other.m_includes);
+        // Returns the image from the disk cache when available. Otherwise compiles it and stores it.
+        inline JitKernelImage getKernelImage(JITDiskCache& diskCache, const std::string& source,
+                                             const std::string& nameExpression, const std::vector<std::string>& options,
+                                             JitNvrtcPch* pch = nullptr, const JitCompileTarget& target = JitCompileTarget{}) {
+            const uint64_t key = makeDiskCacheKey(source, nameExpression, options, target).hash();
+            if (std::optional<JitKernelImage> cached = diskCache.lookup(key)) {
+                return std::move(*cached);
+            }
+            JitKernelImage image = compileNameExpression(source, nameExpression, options, pch, target);
+            diskCache.store(key, image);
+            return image;
+        }
+    } // jit_internal
+    // Owns a loaded CUmodule. The kernels compiled in the same batch share it, and it is
+    // released when the last of them is released: by onRelease if set, which can defer
+    // unloading it until no launch can be using it, or else by unloading it right away.
+    // onRelease receives the streams that launched its kernels, so that it can wait for their work.
+    class JitModule {
+    public:
+        using OnRelease = std::function<void(CUmodule, std::vector<CUstream>)>;
+    private:
+        CUmodule m_module;
+        size_t m_codeBytes;
+        OnRelease m_onRelease;
+        mutable std::mutex m_streamsMutex;
+        mutable std::vector<CUstream> m_streams;
+        // Stream of the last launch, so that launches on the same stream do not take the mutex
+        mutable std::atomic<CUstream> m_lastStream{ nullptr };
+        mutable std::atomic<bool> m_launched{ false };
+    public:
+        explicit JitModule(CUmodule module, const size_t codeBytes = 0, OnRelease onRelease = {})
+            : m_module(module), m_codeBytes(codeBytes), m_onRelease(std::move(onRelease)) {}
+        JitModule(const JitModule&) = delete;
+        JitModule& operator=(const JitModule&) = delete;
+        ~JitModule() {
+            if (m_module != nullptr) {
+                if (m_onRelease) {
+                    m_onRelease(m_module, std::move(m_streams));
+                } else {
+                    gpuErrchk(cuModuleUnload(m_module));
+                }
+            }
+        }
 
-                other.m_module = nullptr;
-                other.m_kernelFunc = nullptr;
+        // Returns nullptr if the driver can not load the image
+        static std::shared_ptr<JitModule> load(const void* image, const size_t codeBytes = 0, OnRelease onRelease = {}) {
+            CUmodule module;
+            if (cuModuleLoadData(&module, image) != CUDA_SUCCESS) {
+                return nullptr;
             }
-            return *this;
+            return std::make_shared<JitModule>(module, codeBytes, std::move(onRelease));
         }
 
+        size_t getCodeBytes() const {
+            return m_codeBytes;
+        }
+
+        CUfunction getFunction(const std::string& loweredName) const {
+            CUfunction function;
+            gpuErrchk(cuModuleGetFunction(&function, m_module, loweredName.c_str()));
+            return function;
+        }
+
+        CUmodule get() const {
+            return m_module;
+        }
+
+        // Called before launching a kernel of the module, or a graph that uses it, on stream
+        void noteLaunch(const CUstream stream) const {
+            if (m_launched.load(std::memory_order_acquire) && m_lastStream.load(std::memory_order_relaxed) == stream) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(m_streamsMutex);
+            if (std::find(m_streams.begin(), m_streams.end(), stream) == m_streams.end()) {
+                m_streams.push_back(stream);
+            }
+            m_lastStream.store(stream, std::memory_order_relaxed);
+            m_launched.store(true, std::memory_order_release);
+        }
+    };
+
+    class JitFkKernel {
+        std::shared_ptr<JitModule> m_module;
+        CUfunction m_kernelFunc;
+        std::string m_nameExpression;
+        // Identifies the kernel in the block tuner
+        uint64_t m_nameHash{ 0 };
+        uint64_t m_profileHash{ 0 };
+        // Ordinal of the device whose primary context holds the module
+        int m_device{ 0 };
+        // Launch clock value of the last launch, for least recently launched eviction
+        mutable std::atomic<uint64_t> m_lastLaunch{ 0 };
+        bool loadImage(const JitKernelImage& image) {
+            m_module = JitModule::load(image.data(), image.size());
+            if (m_module == nullptr) {
+                return false;
+            }
+            m_kernelFunc = m_module->getFunction(image.loweredName());
+            return true;
+        }
+    public:
+        // Default constructor
+        JitFkKernel() : m_kernelFunc(nullptr) {}
+        // Kernel from an image that is already compiled. Throws if the driver can not load it.
+        JitFkKernel(const std::string& nameExpression, const JitKernelImage& image)
+            : m_kernelFunc(nullptr), m_nameExpression(nameExpression), m_nameHash(jit_internal::fnv1a64(nameExpression)),
+              m_profileHash(jit_internal::keyProfileHash(nameExpression)) {
+            if (!loadImage(image)) {
+                throw std::runtime_error("cuModuleLoadData failed for JIT kernel: " + m_nameExpression);
+            }
+        }
+
+        // Kernel of a module that contains several kernels
+        JitFkKernel(std::shared_ptr<JitModule> module, const std::string& nameExpression, const std::string& loweredName,
+                    const int device = 0)
+            : m_module(std::move(module)), m_kernelFunc(m_module->getFunction(loweredName)), m_nameExpression(nameExpression),
+              m_nameHash(jit_internal::fnv1a64(nameExpression)), m_profileHash(jit_internal::keyProfileHash(nameExpression)), m_device(device) {}
+
         CUfunction getKernelFunction() const {
             return m_kernelFunc;
         }
@@ -149,8 +495,32 @@ namespace fk {
             return m_nameExpression;
         }
 
-        ~JitFkKernel() {
-            gpuErrchk(cuModuleUnload(m_module));
+        const std::shared_ptr<JitModule>& getModule() const {
+            return m_module;
+        }
+
+        uint64_t getNameHash() const {
+            return m_nameHash;
+        }
+
+        // JitProfileKey::hash of the profile it was compiled with
+        uint64_t getProfileHash() const {
+            return m_profileHash;
+        }
+
+        int getDevice() const {
+            return m_device;
+        }
+
+        // Only writes when the clock changed, so warm launches do not contend on the cache line
+        void touch(const uint64_t launchClock) const {
+            if (m_lastLaunch.load(std::memory_order_relaxed) != launchClock) {
+                m_lastLaunch.store(launchClock, std::memory_order_relaxed);
+            }
+        }
+
+        uint64_t lastLaunch() const {
+            return m_lastLaunch.load(std::memory_order_relaxed);
         }
     };
 
@@ -188,47 +558,538 @@ namespace fk {
     template <typename... IOps>
     std::vector<fk::JIT_Operation_pp> buildOperationPipeline(const IOps&... iOps) {
         std::vector<fk::JIT_Operation_pp> pipeline;
-        (pipeline.emplace_back(fk::typeToString<IOps>(), &iOps, sizeof(IOps)), ...);
+        (pipeline.emplace_back(fk::typeToString<IOps>(), &iOps, sizeof(IOps), alignof(IOps)), ...);
         return pipeline;
     }
 
+    // Makes a CUDA context current in the calling thread for the lifetime of the guard
+    class JitContextGuard {
+    public:
+        explicit JitContextGuard(CUcontext context) {
+            gpuErrchk(cuCtxPushCurrent(context));
+        }
+        JitContextGuard(const JitContextGuard&) = delete;
+        JitContextGuard& operator=(const JitContextGuard&) = delete;
+        ~JitContextGuard() {
+            CUcontext popped;
+            cuCtxPopCurrent(&popped);
+        }
+    };
+
     // Singleton class to avoid having to create instances of Executors
-    // Rightnow it is not thread safe, it will be in the future.
+    // It is thread safe: lookups only take a shared lock on one shard of the cache, and
+    // concurrent misses on the same kernel compile it only once.
+    // Every device has its own kernels, loaded in its primary context, which is the one the CUDA
+    // runtime streams use. A kernel is compiled once for each compute capability, and loaded lazily
+    // in each device that launches it.
+    // Loaded modules can be bounded with JitCacheLimits. The least recently launched ones are evicted
+    // when a new kernel is loaded, but they are only released when no launch can be using them.
     class JITExecutorCache {
-        CUdevice m_device;
-        CUcontext m_context;
+        // Kernel of a runtime pipeline, valid while the generation is current
+        struct RuntimeKernel {
+            const JitFkKernel* kernel{ nullptr };
+            uint64_t generation{ 0 };
+        };
+        using KernelCache = JitShardedCache<std::shared_ptr<const JitFkKernel>>;
+        // A kernel compiled for a compute capability, that any device with it can load
+        struct CompiledKernel {
+            // Shared by the kernels compiled in the same batch
+            std::shared_ptr<const JitKernelImage> image;
+            // Identifies the image, so that a device loads the kernels of a batch in one module
+            uint64_t imageId{ 0 };
+            std::string loweredName;
+            JitKernelStats stats;
+            // Disk cache entry of the image, 0 if it was just compiled
+            uint64_t diskCacheKey{ 0 };
+            // Bundle entry of the image, 0 if it is not from a bundle
+            uint64_t bundleKey{ 0 };
+        };
+        // Compile targets and compiled kernels of a compute capability
+        struct ArchKernels {
+            int arch{ 0 };
+            std::vector<JitCompileTarget> targets;
+            // Precompiled header of jitKernelSource() for each target, stored with the kernel cache
+            std::vector<std::shared_ptr<JitNvrtcPch>> pchs;
+            // Precompiled headers of the minimal sources, by the key of their include prologue and target
+            std::mutex minimalPchsMutex;
+            std::unordered_map<uint64_t, std::shared_ptr<JitNvrtcPch>> minimalPchs;
+            JitShardedCache<std::shared_ptr<const CompiledKernel>> compiled;
+        };
+        // Kernels loaded in the primary context of a device
+        struct DeviceKernels {
+            KernelCache kernels;
+            JitSignatureTable<RuntimeKernel> runtimeKernels;
+            // Batched kernels, by the signature of their pipelines and their number of planes
+            JitSignatureTable<RuntimeKernel> batchedKernels;
+            JitParamArena paramArena;
+            std::mutex modulesMutex;
+            // Loaded modules by image id
+            std::unordered_map<uint64_t, std::weak_ptr<JitModule>> modules;
+        };
+        JitDeviceTable<DeviceKernels> m_devices;
+        std::vector<std::unique_ptr<ArchKernels>> m_archs;
         std::string m_includes;
-        std::unordered_map<std::string, JitFkKernel> m_kernelCache;
-        void addJITKernel(const JitFkKernel& fkKernel) {
-            m_kernelCache[fkKernel.getNameExpression()] = fkKernel;
+        JitResidencySet<JitFkKernel> m_residency;
+        std::atomic<size_t> m_maxModules{ 0 };
+        std::atomic<size_t> m_maxCodeBytes{ 0 };
+        // Evicting kernels starts a new generation, which invalidates the kernels resolved by the launch paths
+        std::atomic<uint64_t> m_generation{ 1 };
+        // Advanced by every new kernel, launches record it in the kernel they launch
+        std::atomic<uint64_t> m_launchClock{ 1 };
+        std::atomic<uint64_t> m_imageIds{ 0 };
+        // Held shared by launches that use a kernel without owning a reference to it.
+        // Evicted kernels and their modules are only released while holding it exclusively.
+        std::shared_mutex m_launchMutex;
+        std::mutex m_retiredMutex;
+        std::vector<std::shared_ptr<const JitFkKernel>> m_retiredKernels;
+        // A module that no kernel uses, with the ordinal of the device it is loaded in
+        struct RetiredModule {
+            int device{ 0 };
+            CUmodule module{ nullptr };
+            std::vector<CUstream> streams;
+        };
+        std::vector<RetiredModule> m_retiredModules;
+        // A retired module waiting for the work of its streams, recorded in events, before being unloaded.
+        // Only used by releaseRetired(), with the launch mutex held exclusively.
+        struct PendingModule {
+            int device{ 0 };
+            CUmodule module{ nullptr };
+            std::vector<CUevent> events;
+            // An event could not be recorded on one of its streams, so only synchronizing the context is safe
+            bool waitContext{ false };
+        };
+        std::vector<PendingModule> m_pendingModules;
+        JitKernelTelemetry m_telemetry;
+        JITDiskCache m_diskCache;
+        // Bundles of precompiled kernels, looked up before the disk cache
+        mutable std::shared_mutex m_bundlesMutex;
+        std::vector<std::shared_ptr<const JitKernelBundle>> m_bundles;
+        // Bundle entries that the driver could not load
+        std::unordered_set<uint64_t> m_rejectedBundleKeys;
+        // Block shapes chosen by autotuning, stored with the kernel cache
+        std::unique_ptr<JitBlockTuner> m_blockTuner;
+        std::atomic<size_t> m_maxSpecializations{ 0 };
+        std::atomic<bool> m_vectorize{ false };
+        std::atomic<size_t> m_maxBatchPlanes{ 1 };
+        std::atomic<size_t> m_paramSpillBytes{ 0 };
+        std::atomic<size_t> m_maxParamBytes{ JIT_MAX_KERNEL_PARAM_BYTES };
+        std::atomic<JitHeaderMode> m_headerMode{ JitHeaderMode::MINIMAL };
+        // Compile profile of the kernels requested outside a JitProfileScope
+        mutable std::mutex m_profileMutex;
+        JitCompileProfile m_profile;
+        jit_internal::JitProfileKey m_profileKey;
+        std::atomic<uint64_t> m_profileHash{ 0 };
+        JitSpecializationBudget m_specializations;
+        std::unique_ptr<JitCompileWorker> m_compileWorker;
+        std::once_flag m_compileWorkerFlag;
+        JitCompileWorker& getCompileWorker() {
+            std::call_once(m_compileWorkerFlag, [this] { m_compileWorker = std::make_unique<JitCompileWorker>(); });
+            return *m_compileWorker;
         }
-        bool hasJITKernel(const std::string& kernelName) const {
-            return m_kernelCache.find(kernelName) != m_kernelCache.end();
+        DeviceKernels& deviceKernels(const int device) {
+            return m_devices.device(device).state;
         }
-        CUfunction getCUfunction(const std::string& kernelNameWithDetails) const {
-            auto it = m_kernelCache.find(kernelNameWithDetails);
-            if (it != m_kernelCache.end()) {
-                return it->second.getKernelFunction();
-            } else {
-                throw std::runtime_error("JIT Kernel not found: " + kernelNameWithDetails);
+        ArchKernels& archKernels(const int arch) {
+            for (const auto& archKernels : m_archs) {
+                if (archKernels->arch == arch) {
+                    return *archKernels;
+                }
+            }
+            throw std::runtime_error("No JIT compile targets for compute capability " + std::to_string(arch));
+        }
+        // Loads the image of compiled in the primary context of device, which must be current, or returns
+        // the module already loaded for it. Modules are not unloaded when the last kernel is released,
+        // but by releaseRetired(). Returns nullptr if the driver can not load the image.
+        std::shared_ptr<JitModule> loadModule(const int device, const CompiledKernel& compiled, double* loadMilliseconds) {
+            DeviceKernels& kernels = deviceKernels(device);
+            std::lock_guard<std::mutex> lock(kernels.modulesMutex);
+            const auto found = kernels.modules.find(compiled.imageId);
+            if (found != kernels.modules.end()) {
+                if (std::shared_ptr<JitModule> module = found->second.lock()) {
+                    *loadMilliseconds = 0.0;
+                    return module;
+                }
+            }
+            const auto start = std::chrono::steady_clock::now();
+            std::shared_ptr<JitModule> module = JitModule::load(compiled.image->data(), compiled.image->size(),
+                                                                [this, device](CUmodule module, std::vector<CUstream> streams) {
+                std::lock_guard<std::mutex> lock(m_retiredMutex);
+                m_retiredModules.push_back({ device, module, std::move(streams) });
+            });
+            *loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (module != nullptr) {
+                for (auto it = kernels.modules.begin(); it != kernels.modules.end();) {
+                    it = it->second.expired() ? kernels.modules.erase(it) : std::next(it);
+                }
+                kernels.modules[compiled.imageId] = module;
+            }
+            return module;
+        }
+        // Completes the stats of a kernel that was just loaded with what the driver reports
+        void recordTelemetry(const JitFkKernel& kernel, JitKernelStats stats, const double loadMilliseconds) {
+            stats.device = kernel.getDevice();
+            stats.loadMilliseconds = loadMilliseconds;
+            stats.attributes = jit_internal::functionAttributes(kernel.getKernelFunction());
+            stats.hasAttributes = true;
+            m_telemetry.record(std::move(stats));
+        }
+        // Registers a new kernel for eviction, as the most recently launched one
+        std::shared_ptr<const JitFkKernel> admit(std::shared_ptr<const JitFkKernel> kernel) {
+            kernel->touch(++m_launchClock);
+            const std::shared_ptr<JitModule>& module = kernel->getModule();
+            m_residency.add(module.get(), module->getCodeBytes(), kernel->getNameExpression(), kernel);
+            return kernel;
+        }
+        // Evicts the least recently launched modules over the limits, except keep
+        void enforceLimits(const JitModule* keep = nullptr) {
+            std::vector<JitResidencySet<JitFkKernel>::Resident> evicted = m_residency.evict(getLimits(), keep);
+            if (evicted.empty()) {
+                return;
+            }
+            m_generation++;
+            for (int device = 0; device < m_devices.size(); ++device) {
+                deviceKernels(device).runtimeKernels.clear();
+                deviceKernels(device).batchedKernels.clear();
+            }
+            for (auto& resident : evicted) {
+                deviceKernels(resident.kernel->getDevice()).kernels.erase(resident.key, resident.kernel);
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_retiredMutex);
+                for (auto& resident : evicted) {
+                    m_retiredKernels.push_back(std::move(resident.kernel));
+                }
+            }
+            releaseRetired(false);
+        }
+        // Releases the evicted kernels, once no launch can be using them. The modules that are no longer
+        // used are unloaded once the work of the streams that launched them is done, which is recorded
+        // in an event on each stream. Without wait, it never blocks: it does nothing while a launch is in
+        // progress, and leaves the modules whose events are not complete to a later call.
+        // The calling thread must not hold a launchGuard().
+        void releaseRetired(const bool wait) {
+            std::unique_lock<std::shared_mutex> launchLock(m_launchMutex, std::defer_lock);
+            if (wait) {
+                launchLock.lock();
+            } else if (!launchLock.try_lock()) {
+                return;
+            }
+            std::vector<std::shared_ptr<const JitFkKernel>> kernels;
+            {
+                std::lock_guard<std::mutex> lock(m_retiredMutex);
+                kernels.swap(m_retiredKernels);
+            }
+            // Releasing the last kernel of a module retires the module
+            kernels.clear();
+            std::vector<RetiredModule> modules;
+            {
+                std::lock_guard<std::mutex> lock(m_retiredMutex);
+                modules.swap(m_retiredModules);
+            }
+            for (auto& retired : modules) {
+                JitContextGuard contextGuard(m_devices.context(retired.device));
+                PendingModule pending{ retired.device, retired.module, {}, false };
+                for (const CUstream stream : retired.streams) {
+                    CUevent event;
+                    gpuErrchk(cuEventCreate(&event, CU_EVENT_DISABLE_TIMING));
+                    // Fails if the stream was destroyed, maybe with work still running
+                    if (cuEventRecord(event, stream) != CUDA_SUCCESS) {
+                        gpuErrchk(cuEventDestroy(event));
+                        pending.waitContext = true;
+                        continue;
+                    }
+                    pending.events.push_back(event);
+                }
+                m_pendingModules.push_back(std::move(pending));
+            }
+            for (auto it = m_pendingModules.begin(); it != m_pendingModules.end();) {
+                JitContextGuard contextGuard(m_devices.context(it->device));
+                bool done = !it->waitContext || wait;
+                for (const CUevent event : it->events) {
+                    if (!done) {
+                        break;
+                    }
+                    if (wait) {
+                        gpuErrchk(cuEventSynchronize(event));
+                    } else {
+                        const CUresult status = cuEventQuery(event);
+                        if (status != CUDA_ERROR_NOT_READY) {
+                            gpuErrchk(status);
+                        }
+                        done = status == CUDA_SUCCESS;
+                    }
+                }
+                if (!done) {
+                    ++it;
+                    continue;
+                }
+                if (it->waitContext) {
+                    gpuErrchk(cuCtxSynchronize());
+                }
+                for (const CUevent event : it->events) {
+                    gpuErrchk(cuEventDestroy(event));
+                }
+                gpuErrchk(cuModuleUnload(it->module));
+                it = m_pendingModules.erase(it);
+            }
+        }
+        std::optional<JitKernelImage> findInBundles(const uint64_t key) const {
+            std::shared_lock<std::shared_mutex> lock(m_bundlesMutex);
+            if (m_rejectedBundleKeys.count(key) != 0) {
+                return std::nullopt;
+            }
+            for (const auto& bundle : m_bundles) {
+                if (std::optional<JitKernelImage> image = bundle->lookup(key)) {
+                    return image;
+                }
+            }
+            return std::nullopt;
+        }
+        // Looks for the kernel in the preloaded bundles and in the disk cache, trying in order the
+        // cached targets that can run on the architecture. Returns nullptr on a miss.
+        // Kernel keys are name expressions followed by the options of their compile profile.
+        std::shared_ptr<const CompiledKernel> findOnDisk(const ArchKernels& arch, const std::string& kernelKey) {
+            const std::string nameExpression = jit_internal::keyNameExpression(kernelKey);
+            const jit_internal::JitProgramSource source = jit_internal::programSource({ nameExpression }, getHeaderPolicy().mode);
+            const std::vector<std::string> options = jit_internal::profileCompileOptions(jit_internal::keyProfileOptions(kernelKey));
+            for (const auto& target : arch.targets) {
+                if (!target.canRunOn(arch.arch)) {
+                    continue;
+                }
+                const uint64_t key = jit_internal::makeDiskCacheKey(source.text, nameExpression, options, target).hash();
+                if (std::optional<JitKernelImage> bundled = findInBundles(key)) {
+                    auto compiled = std::make_shared<CompiledKernel>();
+                    compiled->loweredName = bundled->loweredName();
+                    compiled->stats.nameExpression = kernelKey;
+                    compiled->stats.loweredName = bundled->loweredName();
+                    compiled->stats.target = target.name();
+                    compiled->stats.origin = JitKernelOrigin::BUNDLE;
+                    compiled->stats.imageBytes = bundled->size();
+                    compiled->image = std::make_shared<const JitKernelImage>(std::move(*bundled));
+                    compiled->imageId = ++m_imageIds;
+                    compiled->bundleKey = key;
+                    return compiled;
+                }
+                if (std::optional<JitKernelImage> cached = m_diskCache.lookup(key)) {
+                    auto compiled = std::make_shared<CompiledKernel>();
+                    compiled->loweredName = cached->loweredName();
+                    compiled->stats.nameExpression = kernelKey;
+                    compiled->stats.loweredName = cached->loweredName();
+                    compiled->stats.target = target.name();
+                    compiled->stats.origin = JitKernelOrigin::DISK_CACHE;
+                    compiled->stats.imageBytes = cached->size();
+                    compiled->image = std::make_shared<const JitKernelImage>(std::move(*cached));
+                    compiled->imageId = ++m_imageIds;
+                    compiled->diskCacheKey = key;
+                    return compiled;
+                }
+            }
+            return nullptr;
+        }
+        // PCH of the include prologue of source for the target at index. Minimal sources with the same
+        // header set share theirs, and the others use the one of jitKernelSource().
+        JitNvrtcPch* programPch(ArchKernels& arch, const size_t targetIndex, const jit_internal::JitProgramSource& source) {
+            if (!source.minimal) {
+                return arch.pchs[targetIndex].get();
+            }
+            const uint64_t pchKey =
+                jit_internal::makeDiskCacheKey(source.text, "", jit_internal::defaultCompileOptions(), arch.targets[targetIndex]).hash();
+            std::lock_guard<std::mutex> lock(arch.minimalPchsMutex);
+            std::shared_ptr<JitNvrtcPch>& pch = arch.minimalPchs[pchKey];
+            if (pch == nullptr) {
+                pch = std::make_shared<JitNvrtcPch>(m_diskCache.directory(), pchKey);
+                if (!m_diskCache.isPrivate()) {
+                    pch->disable();
+                }
+            }
+            return pch.get();
+        }
+        // From the disk cache, or else the first target that can run on the architecture is compiled,
+        // stored and kept. The other targets, for the disk cache of other devices, are compiled and stored
+        // by the compile worker, so they do not delay the launch. It does not need a GPU.
+        std::shared_ptr<const CompiledKernel> compileForArch(ArchKernels& arch, const std::string& kernelKey) {
+            if (std::shared_ptr<const CompiledKernel> cached = findOnDisk(arch, kernelKey)) {
+                return cached;
+            }
+            const auto runnable = std::find_if(arch.targets.begin(), arch.targets.end(),
+                                               [&](const JitCompileTarget& target) { return target.canRunOn(arch.arch); });
+            if (runnable == arch.targets.end()) {
+                throw std::runtime_error("No JIT compile target can run on compute capability " + std::to_string(arch.arch) + ": " + kernelKey);
+            }
+            const size_t runnableIndex = static_cast<size_t>(runnable - arch.targets.begin());
+            const std::string nameExpression = jit_internal::keyNameExpression(kernelKey);
+            const jit_internal::JitProgramSource source = jit_internal::programSource({ nameExpression }, getHeaderPolicy().mode);
+            const std::vector<std::string> profileOptions = jit_internal::keyProfileOptions(kernelKey);
+            const std::vector<std::string> options = jit_internal::profileCompileOptions(profileOptions);
+            // The PCH is precompiled with the default options
+            const bool usePch = profileOptions.empty();
+            const auto compileTarget = [this, &arch, kernelKey, source, nameExpression, options, usePch](const size_t i) {
+                jit_internal::JitBatchImage batch =
+                    jit_internal::compileProgramSource(source, { nameExpression }, options, usePch ? programPch(arch, i, source) : nullptr,
+                                                       usePch ? arch.pchs[i].get() : nullptr, arch.targets[i]);
+                JitKernelStats stats = jit_internal::makeCompileStats(batch, 0, kernelKey, arch.targets[i]);
+                auto image = std::make_shared<const JitKernelImage>(std::move(batch.loweredNames.front()), batch.kind, std::move(batch.image));
+                // Stored with the key findOnDisk looks up, also when a minimal source fell back to jitKernelSource()
+                m_diskCache.store(jit_internal::makeDiskCacheKey(source.text, nameExpression, options, arch.targets[i]).hash(), *image);
+                return std::make_pair(std::move(stats), std::move(image));
+            };
+            auto [stats, image] = compileTarget(runnableIndex);
+            auto compiled = std::make_shared<CompiledKernel>();
+            compiled->loweredName = image->loweredName();
+            compiled->stats = std::move(stats);
+            compiled->image = std::move(image);
+            compiled->imageId = ++m_imageIds;
+            if (arch.targets.size() > 1) {
+                getCompileWorker().submit([compileTarget, runnableIndex, targets = arch.targets.size()] {
+                    for (size_t i = 0; i < targets; ++i) {
+                        if (i == runnableIndex) {
+                            continue;
+                        }
+                        // Only the disk cache misses these images, so an error must not stop the worker
+                        try {
+                            compileTarget(i);
+                        } catch (const std::exception&) {
+                        }
+                    }
+                });
+            }
+            return compiled;
+        }
+        // Loads the kernel in device, compiling it first if its architecture does not have it yet.
+        // Disk cache entries that the driver can not load are removed, and the next target is tried.
+        std::shared_ptr<const JitFkKernel> loadKernel(const int device, const std::string& nameExpression) {
+            releaseRetired(false);
+            ArchKernels& arch = archKernels(m_devices.device(device).arch);
+            const std::string key = jit_internal::compiledKernelKey(arch.arch, nameExpression);
+            while (true) {
+                const std::shared_ptr<const CompiledKernel> compiled =
+                    arch.compiled.getOrCompile(key, [&] { return compileForArch(arch, nameExpression); });
+                // Loading can happen in any launcher or worker thread
+                JitContextGuard contextGuard(m_devices.context(device));
+                double loadMilliseconds{ 0.0 };
+                if (const std::shared_ptr<JitModule> module = loadModule(device, *compiled, &loadMilliseconds)) {
+                    auto kernel = admit(std::make_shared<const JitFkKernel>(module, nameExpression, compiled->loweredName, device));
+                    recordTelemetry(*kernel, compiled->stats, loadMilliseconds);
+                    enforceLimits(module.get());
+                    return kernel;
+                }
+                arch.compiled.erase(key, compiled);
+                if (compiled->bundleKey != 0) {
+                    std::unique_lock<std::shared_mutex> lock(m_bundlesMutex);
+                    m_rejectedBundleKeys.insert(compiled->bundleKey);
+                    continue;
+                }
+                if (compiled->diskCacheKey == 0) {
+                    throw std::runtime_error("cuModuleLoadData failed for JIT kernel: " + nameExpression);
+                }
+                m_diskCache.invalidate(compiled->diskCacheKey);
+            }
+        }
+        struct PendingCompilation {
+            // Kernel key, with the options of the compile profile
+            std::string nameExpression;
+            KernelCache::Reservation* reservation;
+        };
+        // Compiles the kernels in a single NVRTC program, that device loads in a single module.
+        // Only the first target is compiled, since batches are not stored in the disk cache.
+        // The kernels of a batch are requested together, so they share the compile profile.
+        void compileBatch(const int device, ArchKernels& arch, const std::vector<PendingCompilation>& pending) {
+            std::vector<std::string> nameExpressions;
+            for (const auto& kernel : pending) {
+                nameExpressions.push_back(jit_internal::keyNameExpression(kernel.nameExpression));
+            }
+            const std::vector<std::string> profileOptions = jit_internal::keyProfileOptions(pending.front().nameExpression);
+            const jit_internal::JitProgramSource source = jit_internal::programSource(nameExpressions, getHeaderPolicy().mode);
+            const bool usePch = profileOptions.empty();
+            jit_internal::JitBatchImage batch =
+                jit_internal::compileProgramSource(source, nameExpressions, jit_internal::profileCompileOptions(profileOptions),
+                                                   usePch ? programPch(arch, 0, source) : nullptr,
+                                                   usePch ? arch.pchs.front().get() : nullptr, arch.targets.front());
+            std::vector<JitKernelStats> stats;
+            for (size_t i = 0; i < pending.size(); ++i) {
+                stats.push_back(jit_internal::makeCompileStats(batch, i, pending[i].nameExpression, arch.targets.front()));
+            }
+            const auto image = std::make_shared<const JitKernelImage>(batch.loweredNames.front(), batch.kind, std::move(batch.image));
+            const uint64_t imageId = ++m_imageIds;
+            for (size_t i = 0; i < pending.size(); ++i) {
+                auto compiled = std::make_shared<CompiledKernel>();
+                compiled->image = image;
+                compiled->imageId = imageId;
+                compiled->loweredName = batch.loweredNames[i];
+                compiled->stats = std::move(stats[i]);
+                arch.compiled.getOrCompile(jit_internal::compiledKernelKey(arch.arch, pending[i].nameExpression),
+                                           [&compiled] { return std::shared_ptr<const CompiledKernel>(std::move(compiled)); });
+            }
+            for (const auto& kernel : pending) {
+                deviceKernels(device).kernels.fulfill(*kernel.reservation, loadKernel(device, kernel.nameExpression));
             }
         }
     public:
+        using KernelFuture = std::shared_future<std::shared_ptr<const JitFkKernel>>;
+
+        // A kernel to compile with addKernels
+        struct PendingKernel {
+            std::string kernelName;
+            std::vector<JIT_Operation_pp> pipeline;
+        };
+
         JITExecutorCache() {
-            // Initialize the NVRTC context and device
-            gpuErrchk(cuInit(0));
-            gpuErrchk(cuDeviceGet(&m_device, 0));
-            gpuErrchk(cuCtxCreate(&m_context, 0, m_device));
-            m_includes =
-                std::string(R"( 
-                    #include <fused_kernel/core/execution_model/executor_kernels.h>
-                    #include <fused_kernel/algorithms/algorithms.h>
-                    #include <fused_kernel/core/execution_model/data_parallel_patterns.h>
-                )");
+            m_includes = jit_internal::jitKernelSource();
+            // CUBIN for the compute capability of each kind of device, so the driver does not JIT compile PTX on load
+            const std::vector<int> nvrtcArchs = jit_internal::nvrtcSupportedArchs();
+            const JitArchConfig archConfig = JitArchConfig::fromEnvironment();
+            std::vector<std::pair<std::string, std::shared_ptr<JitNvrtcPch>>> pchs;
+            for (const int arch : m_devices.archs()) {
+                auto archKernels = std::make_unique<ArchKernels>();
+                archKernels->arch = arch;
+                archKernels->targets = archConfig.targets(arch, nvrtcArchs);
+                // Architectures that compile the same target share its PCH
+                for (const auto& target : archKernels->targets) {
+                    const auto found = std::find_if(pchs.begin(), pchs.end(), [&](const auto& pch) { return pch.first == target.name(); });
+                    if (found != pchs.end()) {
+                        archKernels->pchs.push_back(found->second);
+                        continue;
+                    }
+                    const uint64_t pchKey = jit_internal::makeDiskCacheKey(m_includes, "", jit_internal::defaultCompileOptions(), target).hash();
+                    pchs.emplace_back(target.name(), std::make_shared<JitNvrtcPch>(m_diskCache.directory(), pchKey));
+                    // The PCH is stored with the kernels, only in a directory of the current user
+                    if (!m_diskCache.isPrivate()) {
+                        pchs.back().second->disable();
+                    }
+                    archKernels->pchs.push_back(pchs.back().second);
+                }
+                m_archs.push_back(std::move(archKernels));
+            }
+            const JitCacheLimits limits = JitCacheLimits::fromEnvironment();
+            m_maxModules = limits.maxModules;
+            m_maxCodeBytes = limits.maxCodeBytes;
+            m_blockTuner = std::make_unique<JitBlockTuner>(m_diskCache.isPrivate() ? m_diskCache.directory() / "fkl_block_tuning.txt"
+                                                                                   : std::filesystem::path());
+            m_maxSpecializations = JitSpecializationPolicy::fromEnvironment().maxPerSignature;
+            m_vectorize = JitVariantPolicy::fromEnvironment().vectorize;
+            m_maxBatchPlanes = JitBatchPolicy::fromEnvironment().maxPlanes;
+            m_headerMode = JitHeaderPolicy::fromEnvironment().mode;
+            setParamArenaPolicy(JitParamArenaPolicy::fromEnvironment());
+            setCompileProfile(JitCompileProfile::fromEnvironment());
+            if (const char* bundle = std::getenv("FK_JIT_BUNDLE")) {
+                preloadBundle(bundle);
+            }
         }
         ~JITExecutorCache() {
-            // Clean up the NVRTC context
-            gpuErrchk(cuCtxDestroy(m_context));
+            // Stop background compilations before releasing the modules and the contexts they use
+            m_compileWorker.reset();
+            if (const char* telemetryFile = std::getenv("FK_JIT_TELEMETRY_FILE")) {
+                m_telemetry.dump(telemetryFile, getPchTelemetry());
+            }
+            for (int device = 0; device < m_devices.size(); ++device) {
+                DeviceKernels& kernels = deviceKernels(device);
+                kernels.runtimeKernels.clear();
+                kernels.batchedKernels.clear();
+                kernels.kernels.clear();
+            }
+            m_residency.clear();
+            releaseRetired(true);
+            // m_devices releases the primary contexts
         }
 
         static JITExecutorCache& getInstance() {
@@ -236,13 +1097,445 @@ namespace fk {
             return instance;
         }
 
-        CUfunction addKernel(const std::string& kernelName, const std::vector<JIT_Operation_pp>& pipeline) {
-            const auto completeKernelExpression = jit_internal::buildNameExpression(kernelName, pipeline);
-            if (!hasJITKernel(completeKernelExpression)) {
-                JitFkKernel fkKernel(kernelName, pipeline);
-                addJITKernel(fkKernel);
+        // Ordinal of the device of stream, which must belong to the primary context of the device
+        int streamDevice(CUstream stream) {
+            return m_devices.streamDevice(stream);
+        }
+
+        // Primary context of the device, where its kernels are loaded
+        CUcontext getContext(const int device) {
+            return m_devices.context(device);
+        }
+
+        int getDeviceCount() const {
+            return m_devices.size();
+        }
+
+        // The returned reference keeps the kernel loaded even if it is evicted
+        std::shared_ptr<const JitFkKernel> getKernel(const std::string& kernelName, const std::vector<JIT_Operation_pp>& pipeline,
+                                                     int device = JIT_CURRENT_DEVICE) {
+            return getKernelByExpression(jit_internal::buildNameExpression(kernelName, pipeline), device);
+        }
+
+        // getKernel for a complete name expression. It is compiled with the active compile profile.
+        std::shared_ptr<const JitFkKernel> getKernelByExpression(const std::string& nameExpression, int device = JIT_CURRENT_DEVICE) {
+            device = m_devices.resolve(device);
+            const std::string kernelKey = jit_internal::profiledExpression(nameExpression, activeProfile());
+            return deviceKernels(device).kernels.getOrCompile(kernelKey, [&] {
+                return loadKernel(device, kernelKey);
+            });
+        }
+
+        // The function is valid until the kernel is evicted
+        CUfunction addKernel(const std::string& kernelName, const std::vector<JIT_Operation_pp>& pipeline, const int device = JIT_CURRENT_DEVICE) {
+            return getKernel(kernelName, pipeline, device)->getKernelFunction();
+        }
+
+        // Non blocking version of addKernel: on a miss, the kernel is compiled in a background thread.
+        // The returned future becomes ready when the kernel can be launched.
+        KernelFuture addKernelAsync(const std::string& kernelName, const std::vector<JIT_Operation_pp>& pipeline, int device = JIT_CURRENT_DEVICE) {
+            return getKernelByExpressionAsync(jit_internal::buildNameExpression(kernelName, pipeline), device);
+        }
+
+        // addKernelAsync for a complete name expression
+        KernelFuture getKernelByExpressionAsync(const std::string& nameExpression, int device = JIT_CURRENT_DEVICE) {
+            device = m_devices.resolve(device);
+            const auto completeKernelExpression = jit_internal::profiledExpression(nameExpression, activeProfile());
+            return getOrCompileAsync(deviceKernels(device).kernels, getCompileWorker(), completeKernelExpression,
+                                     [this, device, completeKernelExpression] { return loadKernel(device, completeKernelExpression); });
+        }
+
+        // Batched version of addKernel. The kernels that are neither cached in memory nor on disk
+        // are compiled together in one NVRTC program, so the FKL headers are parsed once for all
+        // of them, and loaded in one module. Returns the functions in the order of pending.
+        // Batches are not stored in the disk cache, since every entry would hold the whole module.
+        std::vector<CUfunction> addKernels(const std::vector<PendingKernel>& pending, int device = JIT_CURRENT_DEVICE) {
+            device = m_devices.resolve(device);
+            DeviceKernels& kernels = deviceKernels(device);
+            ArchKernels& arch = archKernels(m_devices.device(device).arch);
+            std::vector<std::string> nameExpressions;
+            std::vector<KernelCache::Reservation> reservations;
+            nameExpressions.reserve(pending.size());
+            reservations.reserve(pending.size());
+            std::vector<PendingCompilation> owned;
+            const jit_internal::JitProfileKey profile = activeProfile();
+            for (const auto& kernel : pending) {
+                nameExpressions.push_back(jit_internal::profiledExpression(jit_internal::buildNameExpression(kernel.kernelName, kernel.pipeline), profile));
+                reservations.push_back(kernels.kernels.reserve(nameExpressions.back()));
+                if (reservations.back().isOwner()) {
+                    owned.push_back({ nameExpressions.back(), &reservations.back() });
+                }
+            }
+            if (!owned.empty()) {
+                try {
+                    // Kernels already compiled for the architecture, by another device, or on disk are
+                    // loaded one by one, and the rest are compiled together
+                    std::vector<PendingCompilation> missing;
+                    for (auto& kernel : owned) {
+                        const std::string key = jit_internal::compiledKernelKey(arch.arch, kernel.nameExpression);
+                        if (!arch.compiled.find(key)) {
+                            if (std::shared_ptr<const CompiledKernel> cached = findOnDisk(arch, kernel.nameExpression)) {
+                                arch.compiled.getOrCompile(key, [&cached] { return cached; });
+                            }
+                        }
+                        if (arch.compiled.find(key)) {
+                            kernels.kernels.fulfill(*kernel.reservation, loadKernel(device, kernel.nameExpression));
+                        } else {
+                            missing.push_back(kernel);
+                        }
+                    }
+                    if (!missing.empty()) {
+                        compileBatch(device, arch, missing);
+                    }
+                } catch (...) {
+                    // Waiters of the kernels that were not fulfilled receive the error
+                    for (auto& kernel : owned) {
+                        if (kernel.reservation->isOwner()) {
+                            kernels.kernels.fail(kernel.nameExpression, *kernel.reservation, std::current_exception());
+                        }
+                    }
+                }
+            }
+            std::vector<CUfunction> functions;
+            functions.reserve(pending.size());
+            for (auto& reservation : reservations) {
+                functions.push_back(reservation.future.get()->getKernelFunction());
+            }
+            return functions;
+        }
+
+        // Warm lookup of the kernel of a runtime pipeline, nullptr if it is not resolved in the
+        // current generation. Call it with a launchGuard() held, and launch before releasing it.
+        const JitFkKernel* findRuntimeKernel(const std::vector<JIT_Operation_pp>& pipeline, const int device) {
+            const uint64_t currentGeneration = generation();
+            const uint64_t profile = activeProfileHash();
+            const JitSignatureTable<RuntimeKernel>& runtimeKernels = deviceKernels(device).runtimeKernels;
+            const uint64_t signature = jit_internal::pipelineSignature(pipeline);
+            const auto current = [&](const std::optional<RuntimeKernel>& found) {
+                return found && found->generation == currentGeneration && found->kernel->getProfileHash() == profile;
+            };
+            if (jit_internal::hasConstantOperations(pipeline)) {
+                const uint64_t specialization = jit_internal::specializedSignature(pipeline);
+                const std::optional<RuntimeKernel> found = runtimeKernels.find(jit_internal::profiledSignature(specialization, profile), pipeline, true);
+                if (current(found)) {
+                    return found->kernel;
+                }
+                // The generic kernel is only used when the values can not be specialized
+                if (m_specializations.allows(signature, specialization, m_maxSpecializations.load(std::memory_order_relaxed))) {
+                    return nullptr;
+                }
+            }
+            const std::optional<RuntimeKernel> found = runtimeKernels.find(jit_internal::profiledSignature(signature, profile), pipeline);
+            return current(found) ? found->kernel : nullptr;
+        }
+
+        // Kernel for a pipeline assembled at runtime. Pipelines with the same op types share it, unless
+        // some operations are constant: then the kernel is specialized for their values, within the
+        // limit of the JitSpecializationPolicy.
+        std::shared_ptr<const JitFkKernel> addRuntimeKernel(const std::vector<JIT_Operation_pp>& pipeline, int device = JIT_CURRENT_DEVICE) {
+            device = m_devices.resolve(device);
+            // Read before the lookup: if the kernel is evicted afterwards, the entry is already stale
+            const uint64_t resolvedGeneration = generation();
+            const uint64_t profile = activeProfileHash();
+            const uint64_t signature = jit_internal::pipelineSignature(pipeline);
+            if (jit_internal::hasConstantOperations(pipeline)) {
+                const uint64_t specialization = jit_internal::specializedSignature(pipeline);
+                if (m_specializations.admit(signature, specialization, m_maxSpecializations.load(std::memory_order_relaxed))) {
+                    std::shared_ptr<const JitFkKernel> kernel = getKernelByExpression(jit_internal::specializedNameExpression(pipeline), device);
+                    deviceKernels(device).runtimeKernels.insert(jit_internal::profiledSignature(specialization, profile), pipeline,
+                                                                RuntimeKernel{ kernel.get(), resolvedGeneration }, true);
+                    return kernel;
+                }
+            }
+            std::shared_ptr<const JitFkKernel> kernel = getKernel(jit_internal::runtimeKernelName(pipeline), pipeline, device);
+            deviceKernels(device).runtimeKernels.insert(jit_internal::profiledSignature(signature, profile), pipeline,
+                                                        RuntimeKernel{ kernel.get(), resolvedGeneration });
+            return kernel;
+        }
+
+        // Kernel of a runtime pipeline that passes the operations spilled by plan through the parameter arena.
+        // Call it with a launchGuard() held, and launch before releasing it.
+        const JitFkKernel* findArenaKernel(const std::vector<JIT_Operation_pp>& pipeline, const JitArenaPlan& plan, const int device) {
+            const uint64_t currentGeneration = generation();
+            const uint64_t profile = activeProfileHash();
+            const uint64_t signature = jit_internal::profiledSignature(jit_internal::arenaSignature(pipeline, plan), profile);
+            const std::optional<RuntimeKernel> found = deviceKernels(device).runtimeKernels.find(signature, pipeline);
+            return found && found->generation == currentGeneration && found->kernel->getProfileHash() == profile ? found->kernel : nullptr;
+        }
+
+        // Value specialization does not apply to it, the spilled operations are large anyway
+        std::shared_ptr<const JitFkKernel> addArenaKernel(const std::vector<JIT_Operation_pp>& pipeline, const JitArenaPlan& plan,
+                                                          int device = JIT_CURRENT_DEVICE) {
+            device = m_devices.resolve(device);
+            const uint64_t resolvedGeneration = generation();
+            const uint64_t signature = jit_internal::profiledSignature(jit_internal::arenaSignature(pipeline, plan), activeProfileHash());
+            std::shared_ptr<const JitFkKernel> kernel = getKernelByExpression(jit_internal::arenaNameExpression(pipeline, plan), device);
+            deviceKernels(device).runtimeKernels.insert(signature, pipeline, RuntimeKernel{ kernel.get(), resolvedGeneration });
+            return kernel;
+        }
+
+        // Non blocking version of addArenaKernel. Once the future is ready, addArenaKernel finds the
+        // kernel in memory and registers it for findArenaKernel.
+        KernelFuture addArenaKernelAsync(const std::vector<JIT_Operation_pp>& pipeline, const JitArenaPlan& plan,
+                                         int device = JIT_CURRENT_DEVICE) {
+            return getKernelByExpressionAsync(jit_internal::arenaNameExpression(pipeline, plan), device);
+        }
+
+        // Kernel that runs planes pipelines with the op types of pipeline, nullptr if it is not resolved in the
+        // current generation. Call it with a launchGuard() held, and launch before releasing it.
+        const JitFkKernel* findBatchedKernel(const std::vector<JIT_Operation_pp>& pipeline, const size_t planes, const int device) {
+            const uint64_t currentGeneration = generation();
+            const uint64_t profile = activeProfileHash();
+            const uint64_t signature = jit_internal::profiledSignature(jit_internal::batchedSignature(pipeline, planes), profile);
+            const std::optional<RuntimeKernel> found = deviceKernels(device).batchedKernels.find(signature, pipeline);
+            return found && found->generation == currentGeneration && found->kernel->getProfileHash() == profile ? found->kernel : nullptr;
+        }
+
+        std::shared_ptr<const JitFkKernel> addBatchedKernel(const std::vector<JIT_Operation_pp>& pipeline, const size_t planes,
+                                                            int device = JIT_CURRENT_DEVICE) {
+            device = m_devices.resolve(device);
+            const uint64_t resolvedGeneration = generation();
+            const uint64_t signature = jit_internal::profiledSignature(jit_internal::batchedSignature(pipeline, planes), activeProfileHash());
+            std::shared_ptr<const JitFkKernel> kernel = getKernelByExpression(jit_internal::batchedNameExpression(pipeline, planes), device);
+            deviceKernels(device).batchedKernels.insert(signature, pipeline, RuntimeKernel{ kernel.get(), resolvedGeneration });
+            return kernel;
+        }
+
+        JitParamArena& getParamArena(const int device) {
+            return deviceKernels(device).paramArena;
+        }
+
+        JitParamArenaPolicy getParamArenaPolicy() const {
+            return { m_paramSpillBytes.load(std::memory_order_relaxed), m_maxParamBytes.load(std::memory_order_relaxed) };
+        }
+
+        // Applies to the launches from now on. Pipelines with other plans use other kernels.
+        void setParamArenaPolicy(const JitParamArenaPolicy& policy) {
+            m_paramSpillBytes = policy.spillBytes;
+            m_maxParamBytes = policy.maxParamBytes;
+        }
+
+        JitSpecializationPolicy getSpecializationPolicy() const {
+            return { m_maxSpecializations.load() };
+        }
+
+        // Applies to the specializations created from now on
+        void setSpecializationPolicy(const JitSpecializationPolicy& policy) {
+            m_maxSpecializations = policy.maxPerSignature;
+        }
+
+        JitVariantPolicy getVariantPolicy() const {
+            return { m_vectorize.load(std::memory_order_relaxed) };
+        }
+
+        void setVariantPolicy(const JitVariantPolicy& policy) {
+            m_vectorize = policy.vectorize;
+        }
+
+        // Kernels of a bundle written by jit_fkl_bundle are loaded from it instead of being compiled, when
+        // it was built for the NVRTC version, the FKL headers and a target of the devices. Bundles
+        // preloaded first take precedence. Returns the number of kernels of the bundle.
+        size_t preloadBundle(const std::filesystem::path& path) {
+            std::shared_ptr<const JitKernelBundle> bundle = JitKernelBundle::open(path);
+            if (bundle == nullptr) {
+                throw std::runtime_error("Not a JIT kernel bundle: " + path.string());
+            }
+            std::unique_lock<std::shared_mutex> lock(m_bundlesMutex);
+            m_bundles.push_back(bundle);
+            return bundle->size();
+        }
+
+        JitBatchPolicy getBatchPolicy() const {
+            return { m_maxBatchPlanes.load(std::memory_order_relaxed) };
+        }
+
+        void setBatchPolicy(const JitBatchPolicy& policy) {
+            m_maxBatchPlanes = std::max<size_t>(1, policy.maxPlanes);
+        }
+
+        // Headers included by the programs of the kernels compiled from now on
+        JitHeaderPolicy getHeaderPolicy() const {
+            return { m_headerMode.load(std::memory_order_relaxed) };
+        }
+
+        void setHeaderPolicy(const JitHeaderPolicy& policy) {
+            m_headerMode = policy.mode;
+        }
+
+        JitCompileProfile getCompileProfile() const {
+            std::lock_guard<std::mutex> lock(m_profileMutex);
+            return m_profile;
+        }
+
+        // Profile of the kernels requested from now on outside a JitProfileScope. Kernels already
+        // compiled with other profiles stay cached, and are used again when their profile is selected.
+        void setCompileProfile(const JitCompileProfile& profile) {
+            std::lock_guard<std::mutex> lock(m_profileMutex);
+            m_profile = profile;
+            m_profileKey = jit_internal::JitProfileKey(profile);
+            m_profileHash = m_profileKey.hash;
+        }
+
+        // Profile of the JitProfileScope of the calling thread, or else the one of setCompileProfile
+        jit_internal::JitProfileKey activeProfile() const {
+            if (const jit_internal::JitProfileKey* scoped = jit_internal::scopedProfile()) {
+                return *scoped;
+            }
+            std::lock_guard<std::mutex> lock(m_profileMutex);
+            return m_profileKey;
+        }
+
+        // Hash of activeProfile(), without locking, for warm launches
+        uint64_t activeProfileHash() const {
+            if (const jit_internal::JitProfileKey* scoped = jit_internal::scopedProfile()) {
+                return scoped->hash;
+            }
+            return m_profileHash.load(std::memory_order_relaxed);
+        }
+
+        // Sets of constant values specialized so far, by pipeline signature
+        const JitSpecializationBudget& getSpecializations() const {
+            return m_specializations;
+        }
+
+        // Launches that use a kernel without owning a reference to it hold this guard from the lookup
+        // until cuLaunchKernel returns, so that evicted kernels are not released in the meantime.
+        std::shared_lock<std::shared_mutex> launchGuard() {
+            return std::shared_lock<std::shared_mutex>(m_launchMutex);
+        }
+
+        uint64_t generation() const {
+            return m_generation.load(std::memory_order_acquire);
+        }
+
+        uint64_t launchClock() const {
+            return m_launchClock.load(std::memory_order_relaxed);
+        }
+
+        JitCacheLimits getLimits() const {
+            return { m_maxModules.load(), m_maxCodeBytes.load() };
+        }
+
+        // Evicts right away if the cache is over the new limits
+        void setLimits(const JitCacheLimits& limits) {
+            m_maxModules = limits.maxModules;
+            m_maxCodeBytes = limits.maxCodeBytes;
+            enforceLimits();
+        }
+
+        // Waits until no launch is in progress to release the evicted kernels, and until the work of
+        // the streams that launched their modules is done to unload them
+        void releaseEvicted() {
+            releaseRetired(true);
+        }
+
+        // Compile time, code size and resource usage of every kernel loaded by the cache
+        const JitKernelTelemetry& getTelemetry() const {
+            return m_telemetry;
+        }
+
+        // Compilations with and without the precompiled headers of every architecture and target
+        JitPchTelemetry getPchTelemetry() {
+            JitPchTelemetry telemetry;
+            for (const auto& arch : m_archs) {
+                for (const auto& pch : arch->pchs) {
+                    if (pch != nullptr) {
+                        telemetry += pch->telemetry();
+                    }
+                }
+                std::lock_guard<std::mutex> lock(arch->minimalPchsMutex);
+                for (const auto& entry : arch->minimalPchs) {
+                    telemetry += entry.second->telemetry();
+                }
+            }
+            return telemetry;
+        }
+
+        // Devices with different compute capabilities are tuned separately
+        JitTuningKey tuningKey(const JitFkKernel& kernel, const unsigned int x, const unsigned int y, const unsigned int z) {
+            const int arch = m_devices.device(kernel.getDevice()).arch;
+            return { jit_internal::fnv1a64(&arch, sizeof(arch), kernel.getNameHash()), jit_internal::shapeClass(x, y, z) };
+        }
+
+        JitBlockTuner& getBlockTuner() {
+            return *m_blockTuner;
+        }
+
+        // Block shape tuned for launching kernel on x * y * z threads, if any
+        std::optional<JitBlockShape> tunedBlock(const JitFkKernel& kernel, const unsigned int x, const unsigned int y, const unsigned int z) {
+            return m_blockTuner->find(tuningKey(kernel, x, y, z));
+        }
+
+        // Block shape for launching kernel on x * y * z threads. The first time for the shape class of
+        // the input, every candidate block is timed on stream with launchWith, which must launch the
+        // kernel with the block shape it receives. Only call it when getBlockTuner().isEnabled().
+        JitBlockShape tuneBlock(const JitFkKernel& kernel, CUstream stream, const unsigned int x, const unsigned int y,
+                                const unsigned int z, const JitBlockShape& defaultBlock,
+                                const std::function<void(const JitBlockShape&)>& launchWith) {
+            if (const std::optional<JitBlockShape> tuned = tunedBlock(kernel, x, y, z)) {
+                return *tuned;
+            }
+            const CUfunction function = kernel.getKernelFunction();
+            int maxThreadsPerBlock{ 0 };
+            gpuErrchk(cuFuncGetAttribute(&maxThreadsPerBlock, CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK, function));
+            int minGridSize{ 0 }, occupancyBlockSize{ 0 };
+            gpuErrchk(cuOccupancyMaxPotentialBlockSize(&minGridSize, &occupancyBlockSize, function, nullptr, 0, 0));
+            const std::vector<JitBlockShape> candidates =
+                jit_internal::candidateBlocks(x, y, defaultBlock, maxThreadsPerBlock, occupancyBlockSize);
+            return m_blockTuner->tune(tuningKey(kernel, x, y, z), candidates, [&](const JitBlockShape& block) {
+                return jit_internal::timeLaunches(stream, 5, [&] { launchWith(block); });
+            });
+        }
+
+        JitKernelCacheStats getStats() {
+            JitKernelCacheStats stats;
+            stats.residentModules = m_residency.modules();
+            stats.residentBytes = m_residency.codeBytes();
+            stats.evictedModules = m_residency.evictedModules();
+            stats.evictedKernels = m_residency.evictedKernels();
+            for (int device = 0; device < m_devices.size(); ++device) {
+                stats.hits += deviceKernels(device).kernels.hits();
+                stats.misses += deviceKernels(device).kernels.misses();
+            }
+            return stats;
+        }
+
+        // Kernels loaded in the device
+        const KernelCache& getKernelCache(const int device = JIT_CURRENT_DEVICE) {
+            return deviceKernels(m_devices.resolve(device)).kernels;
+        }
+
+        // Kernels that failed to compile with an NVRTC error keep it, and every later request for them
+        // receives it without compiling again. Other errors, like the driver running out of memory, are
+        // not kept. Forgets those errors, so that the next requests try again, and
+        // returns the number of kernels forgotten.
+        size_t clearFailedKernels() {
+            size_t cleared = 0;
+            for (int device = 0; device < m_devices.size(); ++device) {
+                cleared += deviceKernels(device).kernels.clearFailures();
             }
-            return getCUfunction(completeKernelExpression);
+            for (const auto& arch : m_archs) {
+                arch->compiled.clearFailures();
+            }
+            return cleared;
+        }
+
+        JITDiskCache& getDiskCache() {
+            return m_diskCache;
+        }
+
+        // Precompiled header of the target loaded by the device
+        JitNvrtcPch& getPch(const int device = JIT_CURRENT_DEVICE) {
+            return *archKernels(getDeviceArch(device)).pchs.front();
+        }
+
+        // Compute capability of the device, as major * 10 + minor
+        int getDeviceArch(const int device = JIT_CURRENT_DEVICE) {
+            return m_devices.device(m_devices.resolve(device)).arch;
+        }
+
+        const std::vector<JitCompileTarget>& getCompileTargets(const int device = JIT_CURRENT_DEVICE) {
+            return archKernels(getDeviceArch(device)).targets;
         }
     };
 } // namespace fk
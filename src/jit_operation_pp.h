@@ -16,6 +16,7 @@
 #define FK_JIT_OPERATION_PP
 
 #include <cstring>
+#include <string>
 
 namespace fk {
     // --- Abstract Operation Definition (Hybrid C++ class) ---
@@ -24,11 +25,15 @@ namespace fk {
         std::string opType; // The C++ typename of the operation struct
         void* opData;       // A pointer to an internal copy of the data (owned)
         size_t dataSize;    // The size of the data block
+        size_t dataAlignment; // The alignment of the C++ type, needed to place it in the kernel parameters. 0 if unknown
+        unsigned int activeThreads[3]{ 0, 0, 0 }; // Threads needed by a read operation, to compute the grid at runtime
+        bool hasActiveThreadsInfo{ false };
+        bool constant{ false }; // The data is compiled into the kernel instead of passed at launch
 
     public:
         // Constructor: Performs a deep copy of the provided data.
-        JIT_Operation_pp(std::string type, const void* data, size_t size)
-            : opType(type), dataSize(size) { // Changed std::move(type) to type
+        JIT_Operation_pp(std::string type, const void* data, size_t size, size_t alignment = 0)
+            : opType(type), dataSize(size), dataAlignment(alignment) { // Changed std::move(type) to type
             // Allocate memory and copy the parameter data
             opData = new char[dataSize];
             memcpy(opData, data, dataSize);
@@ -36,7 +41,9 @@ namespace fk {
 
         // Copy Constructor: Essential for use in std::vector.
         JIT_Operation_pp(const JIT_Operation_pp& other)
-            : opType(other.opType), dataSize(other.dataSize) {
+            : opType(other.opType), dataSize(other.dataSize), dataAlignment(other.dataAlignment),
+              activeThreads{ other.activeThreads[0], other.activeThreads[1], other.activeThreads[2] },
+              hasActiveThreadsInfo(other.hasActiveThreadsInfo), constant(other.constant) {
             // Allocate and copy data for the new object
             opData = new char[dataSize];
             memcpy(opData, other.opData, dataSize);
@@ -44,7 +51,9 @@ namespace fk {
 
         // Move Constructor
         JIT_Operation_pp(JIT_Operation_pp&& other) noexcept
-            : opType(std::move(other.opType)), opData(other.opData), dataSize(other.dataSize) {
+            : opType(std::move(other.opType)), opData(other.opData), dataSize(other.dataSize), dataAlignment(other.dataAlignment),
+              activeThreads{ other.activeThreads[0], other.activeThreads[1], other.activeThreads[2] },
+              hasActiveThreadsInfo(other.hasActiveThreadsInfo), constant(other.constant) {
             // Take ownership of the other object's resources
             other.opData = nullptr;
             other.dataSize = 0;
@@ -61,6 +70,10 @@ namespace fk {
             // Copy new resources
             opType = other.opType;
             dataSize = other.dataSize;
+            dataAlignment = other.dataAlignment;
+            memcpy(activeThreads, other.activeThreads, sizeof(activeThreads));
+            hasActiveThreadsInfo = other.hasActiveThreadsInfo;
+            constant = other.constant;
             opData = new char[dataSize];
             memcpy(opData, other.opData, dataSize);
 
@@ -77,6 +90,10 @@ namespace fk {
             opType = std::move(other.opType);
             opData = other.opData;
             dataSize = other.dataSize;
+            dataAlignment = other.dataAlignment;
+            memcpy(activeThreads, other.activeThreads, sizeof(activeThreads));
+            hasActiveThreadsInfo = other.hasActiveThreadsInfo;
+            constant = other.constant;
 
             other.opData = nullptr;
             other.dataSize = 0;
@@ -94,6 +111,23 @@ namespace fk {
         // Public accessors
         const std::string& getType() const { return opType; }
         void* getData() const { return opData; }
+        size_t getSize() const { return dataSize; }
+        size_t getAlignment() const { return dataAlignment; }
+
+        void setActiveThreads(unsigned int x, unsigned int y, unsigned int z) {
+            activeThreads[0] = x;
+            activeThreads[1] = y;
+            activeThreads[2] = z;
+            hasActiveThreadsInfo = true;
+        }
+        bool hasActiveThreads() const { return hasActiveThreadsInfo; }
+        const unsigned int* getActiveThreads() const { return activeThreads; }
+
+        // Value specialization: the kernel of a runtime pipeline is compiled with the data of the
+        // constant operations as compile time constants, so pipelines with other values need
+        // another kernel. See JitSpecializationPolicy.
+        void setConstant(bool isConstant) { constant = isConstant; }
+        bool isConstant() const { return constant; }
     };
 } // namespace fk
 
@@ -0,0 +1,355 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_PARAM_ARENA_H
+#define FK_JIT_PARAM_ARENA_H
+
+#include <cuda.h>
+#include <fused_kernel/core/utils/utils.h>
+
+#include <src/jit_operation_pp.h>
+#include <src/jit_kernel_params.h>
+#include <src/jit_runtime_pipeline.h>
+#include <src/jit_batch_fusion.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fk {
+    // Operations that are too big to be kernel parameters, like LUTs or long op chains, are copied to a
+    // device buffer instead, the parameter arena, and the kernel reads them from there.
+    struct JitParamArenaPolicy {
+        // Operations bigger than this are read from the arena. 0 passes every operation as a kernel parameter.
+        size_t spillBytes{ 1024 };
+        // The operations that stay kernel parameters, with the arena pointer, are kept under this size
+        // by spilling the biggest ones
+        size_t maxParamBytes{ JIT_MAX_KERNEL_PARAM_BYTES };
+
+        static JitParamArenaPolicy fromEnvironment() {
+            JitParamArenaPolicy policy;
+            if (const char* spillBytes = std::getenv("FK_JIT_PARAM_SPILL_BYTES")) {
+                policy.spillBytes = static_cast<size_t>(std::strtoull(spillBytes, nullptr, 10));
+            }
+            if (const char* maxParamBytes = std::getenv("FK_JIT_MAX_PARAM_BYTES")) {
+                policy.maxParamBytes = static_cast<size_t>(std::strtoull(maxParamBytes, nullptr, 10));
+            }
+            return policy;
+        }
+    };
+
+    // Where each operation of a launch is passed: in the JitInlineOps kernel parameter, or in the arena.
+    // It only depends on the sizes and alignments of the operations, so every launch of a pipeline
+    // signature has the same plan and the same kernel.
+    struct JitArenaPlan {
+        std::vector<bool> spilled;
+        // Offset of each operation in the arena if it is spilled, or else in the inline block
+        std::vector<size_t> offsets;
+        size_t spilledOps{ 0 };
+        size_t arenaSize{ 0 };
+        // Of the JitInlineOps parameter, which is never empty
+        size_t inlineAlignment{ 1 };
+        size_t inlineSize{ 1 };
+
+        bool spills() const {
+            return spilledOps != 0;
+        }
+
+        // The arena pointer followed by the JitInlineOps parameter
+        size_t kernelParamBytes() const {
+            return jit_internal::alignUp(sizeof(CUdeviceptr), inlineAlignment) + inlineSize;
+        }
+    };
+
+    namespace jit_internal {
+        // Source added to every JIT program for the launches that use the parameter arena. A spilled
+        // operation is named JitSpilledOp<IOp, OFFSET>, and the kernel reads it at arena + OFFSET. The
+        // other operations are packed like struct members in one JitInlineOps parameter, where the
+        // spilled ones take no space. It uses JitTypeAt, from batchPrologue().
+        inline const char* arenaPrologue() {
+            return R"(
+                namespace fk {
+                    namespace jit_internal {
+                        template <typename IOp, size_t OFFSET>
+                        struct JitSpilledOp {};
+
+                        template <typename Op>
+                        struct JitArenaSlot {
+                            using Type = Op;
+                            static constexpr bool SPILLED = false;
+                            static constexpr size_t OFFSET = 0;
+                        };
+                        template <typename IOp, size_t ARENA_OFFSET>
+                        struct JitArenaSlot<JitSpilledOp<IOp, ARENA_OFFSET>> {
+                            using Type = IOp;
+                            static constexpr bool SPILLED = true;
+                            static constexpr size_t OFFSET = ARENA_OFFSET;
+                        };
+
+                        template <typename... Slots>
+                        __host__ __device__ constexpr size_t jitInlineOffset(const unsigned int index) {
+                            const size_t sizes[] = { (JitArenaSlot<Slots>::SPILLED ? 0 : sizeof(typename JitArenaSlot<Slots>::Type))... };
+                            const size_t alignments[] = { (JitArenaSlot<Slots>::SPILLED ? 1 : alignof(typename JitArenaSlot<Slots>::Type))... };
+                            size_t offset = 0;
+                            for (unsigned int i = 0; i < sizeof...(Slots); ++i) {
+                                offset = (offset + alignments[i] - 1) / alignments[i] * alignments[i];
+                                if (i == index) {
+                                    return offset;
+                                }
+                                offset += sizes[i];
+                            }
+                            return offset;
+                        }
+
+                        template <typename... Slots>
+                        __host__ __device__ constexpr size_t jitInlineAlignment() {
+                            const size_t alignments[] = { (JitArenaSlot<Slots>::SPILLED ? 1 : alignof(typename JitArenaSlot<Slots>::Type))... };
+                            size_t alignment = 1;
+                            for (unsigned int i = 0; i < sizeof...(Slots); ++i) {
+                                alignment = alignments[i] > alignment ? alignments[i] : alignment;
+                            }
+                            return alignment;
+                        }
+
+                        template <typename TDPPDetails, typename... Slots>
+                        struct JitInlineOps {
+                            static constexpr size_t ALIGNMENT = jitInlineAlignment<Slots...>();
+                            static constexpr size_t PACKED = (jitInlineOffset<Slots...>(sizeof...(Slots)) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+                            static constexpr size_t SIZE = PACKED > 0 ? PACKED : 1;
+                            alignas(ALIGNMENT) unsigned char bytes[SIZE];
+
+                            template <unsigned int I, typename... Unpacked>
+                            __device__ __forceinline__ void exec(const unsigned char* const arena, const Unpacked&... unpacked) const {
+                                if constexpr (I == sizeof...(Slots)) {
+                                    fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED, TDPPDetails>::template exec<true>(
+                                        TDPPDetails{}, unpacked...);
+                                } else {
+                                    using Slot = JitArenaSlot<typename JitTypeAt<I, Slots...>::type>;
+                                    const unsigned char* const data = Slot::SPILLED ? arena + Slot::OFFSET : bytes + jitInlineOffset<Slots...>(I);
+                                    this->template exec<I + 1>(arena, unpacked..., *reinterpret_cast<const typename Slot::Type*>(data));
+                                }
+                            }
+                        };
+
+                        template <typename TDPPDetails, typename... Slots>
+                        __global__ void launchArenaTransformDPP_Kernel(const unsigned char* const arena,
+                                                                       const JitInlineOps<TDPPDetails, Slots...> inlineOps) {
+                            inlineOps.template exec<0>(arena);
+                        }
+                    } // namespace jit_internal
+                } // namespace fk
+            )";
+        }
+
+        // Places the operations with the layout of JitInlineOps and of the arena
+        inline void layoutArenaPlan(const JitParamView* params, const size_t count, JitArenaPlan& plan) {
+            plan.offsets.resize(count);
+            plan.spilledOps = 0;
+            plan.arenaSize = 0;
+            plan.inlineAlignment = 1;
+            size_t inlineOffset = 0;
+            for (size_t i = 0; i < count; ++i) {
+                size_t& offset = plan.spilled[i] ? plan.arenaSize : inlineOffset;
+                offset = alignUp(offset, params[i].alignment);
+                plan.offsets[i] = offset;
+                offset += params[i].size;
+                if (plan.spilled[i]) {
+                    plan.spilledOps++;
+                } else {
+                    plan.inlineAlignment = std::max(plan.inlineAlignment, params[i].alignment);
+                }
+            }
+            plan.inlineSize = std::max<size_t>(1, alignUp(inlineOffset, plan.inlineAlignment));
+        }
+
+        // Spills the operations bigger than policy.spillBytes, and then the biggest of the others until
+        // the kernel parameters fit in policy.maxParamBytes. The storage of plan is reused.
+        inline void planParamArena(const JitParamView* params, const size_t count, const JitParamArenaPolicy& policy, JitArenaPlan& plan) {
+            plan.spilled.assign(count, false);
+            if (policy.spillBytes != 0) {
+                for (size_t i = 0; i < count; ++i) {
+                    plan.spilled[i] = params[i].size > policy.spillBytes;
+                }
+            }
+            layoutArenaPlan(params, count, plan);
+            while (policy.spillBytes != 0 && plan.kernelParamBytes() > policy.maxParamBytes) {
+                size_t biggest = count;
+                for (size_t i = 0; i < count; ++i) {
+                    if (!plan.spilled[i] && (biggest == count || params[i].size > params[biggest].size)) {
+                        biggest = i;
+                    }
+                }
+                if (biggest == count) {
+                    break;
+                }
+                plan.spilled[biggest] = true;
+                layoutArenaPlan(params, count, plan);
+            }
+        }
+
+        // Whether planParamArena spills any of the operations, without computing the plan
+        inline bool spillsParams(const JitParamView* params, const size_t count, const JitParamArenaPolicy& policy) {
+            if (policy.spillBytes == 0) {
+                return false;
+            }
+            size_t offset = 0;
+            size_t alignment = 1;
+            for (size_t i = 0; i < count; ++i) {
+                if (params[i].size > policy.spillBytes) {
+                    return true;
+                }
+                offset = alignUp(offset, params[i].alignment) + params[i].size;
+                alignment = std::max(alignment, params[i].alignment);
+            }
+            return alignUp(sizeof(CUdeviceptr), alignment) + std::max<size_t>(1, alignUp(offset, alignment)) > policy.maxParamBytes;
+        }
+
+        inline const std::vector<JitParamView>& pipelineParamViews(const std::vector<JIT_Operation_pp>& pipeline) {
+            thread_local std::vector<JitParamView> params;
+            params.clear();
+            for (const auto& op : pipeline) {
+                params.push_back(toParamView(op));
+            }
+            return params;
+        }
+
+        inline void planParamArena(const std::vector<JIT_Operation_pp>& pipeline, const JitParamArenaPolicy& policy, JitArenaPlan& plan) {
+            const std::vector<JitParamView>& params = pipelineParamViews(pipeline);
+            planParamArena(params.data(), params.size(), policy, plan);
+        }
+
+        // Name expression of the arena kernel of a runtime pipeline. The details type is the one of the
+        // generic kernel, since it only depends on the op types.
+        inline std::string arenaNameExpression(const std::vector<JIT_Operation_pp>& pipeline, const JitArenaPlan& plan) {
+            std::string expression = "&fk::jit_internal::launchArenaTransformDPP_Kernel<"
+                                     "fk::jit_internal::RuntimeTransformDPPDetails<" + joinOperationTypes(pipeline) + ">";
+            for (size_t i = 0; i < pipeline.size(); ++i) {
+                expression += ", " + (plan.spilled[i] ? "fk::jit_internal::JitSpilledOp<" + pipeline[i].getType() + ", " +
+                                                        std::to_string(plan.offsets[i]) + ">"
+                                                      : pipeline[i].getType());
+            }
+            return expression + ">";
+        }
+
+        // pipelineSignature, combined with the offsets of the spilled operations
+        inline uint64_t arenaSignature(const std::vector<JIT_Operation_pp>& pipeline, const JitArenaPlan& plan) {
+            uint64_t hash = pipelineSignature(pipeline);
+            for (size_t i = 0; i < pipeline.size(); ++i) {
+                if (plan.spilled[i]) {
+                    hash = fnv1a64(&i, sizeof(i), hash);
+                    hash = fnv1a64(&plan.offsets[i], sizeof(size_t), hash);
+                }
+            }
+            return hash;
+        }
+
+        // Copies the inline operations to inlineOps, with the layout of JitInlineOps, and the spilled ones to
+        // arena, which is uploaded as it is. Padding bytes are zeroed.
+        inline void packArenaParams(const JitParamView* params, const size_t count, const JitArenaPlan& plan,
+                                    JitParamBuffer& inlineOps, JitParamBuffer& arena) {
+            if (plan.inlineAlignment > JitParamBuffer::MAX_ALIGNMENT) {
+                throw std::runtime_error("Kernel parameter alignment not supported by JitParamBuffer");
+            }
+            unsigned char* inlineData = inlineOps.reserve(plan.inlineSize);
+            memset(inlineData, 0, plan.inlineSize);
+            unsigned char* arenaData = arena.reserve(plan.arenaSize);
+            memset(arenaData, 0, plan.arenaSize);
+            for (size_t i = 0; i < count; ++i) {
+                memcpy((plan.spilled[i] ? arenaData : inlineData) + plan.offsets[i], params[i].data, params[i].size);
+            }
+        }
+
+        inline void packArenaParams(const std::vector<JIT_Operation_pp>& pipeline, const JitArenaPlan& plan,
+                                    JitParamBuffer& inlineOps, JitParamBuffer& arena) {
+            const std::vector<JitParamView>& params = pipelineParamViews(pipeline);
+            packArenaParams(params.data(), params.size(), plan, inlineOps, arena);
+        }
+
+        // Host copy of the arena of the launches of the calling thread
+        inline JitParamBuffer& arenaStaging() {
+            thread_local JitParamBuffer staging;
+            return staging;
+        }
+    } // namespace jit_internal
+
+    // Device memory pool of the parameter arena of a device. Each launch takes a block, in the order of
+    // its stream, and returns it after the kernel, so the next launches on the stream reuse it without
+    // synchronizing. Freed blocks are kept by the pool instead of being released to the driver.
+    class JitParamArena {
+        std::once_flag m_poolFlag;
+        CUmemoryPool m_pool{ nullptr };
+
+        CUmemoryPool pool(const int device) {
+            std::call_once(m_poolFlag, [&] {
+                CUdevice cuDevice;
+                gpuErrchk(cuDeviceGet(&cuDevice, device));
+                CUmemPoolProps props{};
+                props.allocType = CU_MEM_ALLOCATION_TYPE_PINNED;
+                props.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+                props.location.id = cuDevice;
+                gpuErrchk(cuMemPoolCreate(&m_pool, &props));
+                cuuint64_t releaseThreshold = UINT64_MAX;
+                gpuErrchk(cuMemPoolSetAttribute(m_pool, CU_MEMPOOL_ATTR_RELEASE_THRESHOLD, &releaseThreshold));
+            });
+            return m_pool;
+        }
+    public:
+        JitParamArena() = default;
+        JitParamArena(const JitParamArena&) = delete;
+        JitParamArena& operator=(const JitParamArena&) = delete;
+        ~JitParamArena() {
+            if (m_pool != nullptr) {
+                cuMemPoolDestroy(m_pool);
+            }
+        }
+
+        // Block with a copy of size bytes of data, for the work submitted to stream until release(). The
+        // copy is from pageable memory, which the driver stages before returning, so data can be reused.
+        CUdeviceptr acquire(const int device, CUstream stream, const void* data, const size_t size) {
+            CUdeviceptr block;
+            gpuErrchk(cuMemAllocFromPoolAsync(&block, size, pool(device), stream));
+            gpuErrchk(cuMemcpyHtoDAsync(block, data, size, stream));
+            return block;
+        }
+
+        void release(CUstream stream, const CUdeviceptr block) {
+            gpuErrchk(cuMemFreeAsync(block, stream));
+        }
+
+        // Block for the launches of a graph, which are not ordered with any stream. It is freed with
+        // the last reference. The current context must be the one of the graph.
+        static std::shared_ptr<void> acquirePersistent(const void* data, const size_t size) {
+            CUdeviceptr block;
+            gpuErrchk(cuMemAlloc(&block, size));
+            gpuErrchk(cuMemcpyHtoD(block, data, size));
+            CUcontext context;
+            gpuErrchk(cuCtxGetCurrent(&context));
+            return std::shared_ptr<void>(reinterpret_cast<void*>(block), [context](void* pointer) {
+                if (cuCtxPushCurrent(context) == CUDA_SUCCESS) {
+                    cuMemFree(reinterpret_cast<CUdeviceptr>(pointer));
+                    CUcontext popped;
+                    cuCtxPopCurrent(&popped);
+                }
+            });
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_PARAM_ARENA_H
@@ -0,0 +1,266 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_PIPELINE_OPTIMIZER_H
+#define FK_JIT_PIPELINE_OPTIMIZER_H
+
+#include <src/jit_operation_pp.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fk {
+    struct JitOptimizerOptions {
+        // Merging floating point Mul or Add chains, or turning Div into Mul, changes the rounding of
+        // the results, like fast math. Integer chains are always merged, since they wrap around exactly.
+        bool reassociateFloatingPoint{ false };
+
+        static JitOptimizerOptions fromEnvironment() {
+            JitOptimizerOptions options;
+            if (const char* reassociate = std::getenv("FK_JIT_REASSOCIATE")) {
+                options.reassociateFloatingPoint = std::strcmp(reassociate, "0") != 0;
+            }
+            return options;
+        }
+    };
+
+    // What optimizePipeline did to a pipeline
+    struct JitOptimizationReport {
+        size_t removed{ 0 };
+        size_t merged{ 0 };
+        size_t canonicalized{ 0 };
+
+        bool changed() const {
+            return removed + merged + canonicalized != 0;
+        }
+    };
+
+    namespace jit_internal {
+        enum class JitArithmeticKind { ADD, SUB, MUL, DIV, CAST };
+
+        // An FKL arithmetic operation found in an op type string, like the fk::Mul<float> in
+        // fk::Binary<fk::Mul<float>>
+        struct JitArithmeticOp {
+            JitArithmeticKind kind;
+            // Position of the operation name, after "fk::"
+            size_t namePosition;
+            size_t nameLength;
+            std::vector<std::string> args;
+        };
+
+        inline std::string trimTypeName(const std::string& name) {
+            const size_t begin = name.find_first_not_of(' ');
+            const size_t end = name.find_last_not_of(' ');
+            return begin == std::string::npos ? std::string() : name.substr(begin, end - begin + 1);
+        }
+
+        // Template arguments of the template whose '<' is at open, split at the top level commas
+        inline std::vector<std::string> templateArguments(const std::string& type, const size_t open) {
+            std::vector<std::string> args;
+            int depth = 0;
+            size_t argBegin = open + 1;
+            for (size_t i = open; i < type.size(); ++i) {
+                const char c = type[i];
+                if (c == '<' || c == '(') {
+                    depth++;
+                } else if (c == '>' || c == ')') {
+                    if (--depth == 0) {
+                        args.push_back(trimTypeName(type.substr(argBegin, i - argBegin)));
+                        return args;
+                    }
+                } else if (c == ',' && depth == 1) {
+                    args.push_back(trimTypeName(type.substr(argBegin, i - argBegin)));
+                    argBegin = i + 1;
+                }
+            }
+            // Unbalanced type name
+            return {};
+        }
+
+        inline std::optional<JitArithmeticOp> findArithmeticOp(const std::string& type) {
+            static const std::pair<const char*, JitArithmeticKind> names[] = {
+                { "Add", JitArithmeticKind::ADD }, { "Sub", JitArithmeticKind::SUB }, { "Mul", JitArithmeticKind::MUL },
+                { "Div", JitArithmeticKind::DIV }, { "Cast", JitArithmeticKind::CAST } };
+            for (size_t position = type.find("fk::"); position != std::string::npos; position = type.find("fk::", position + 1)) {
+                const size_t namePosition = position + 4;
+                for (const auto& name : names) {
+                    const size_t length = std::strlen(name.first);
+                    if (type.compare(namePosition, length, name.first) == 0 && namePosition + length < type.size() &&
+                        type[namePosition + length] == '<') {
+                        std::vector<std::string> args = templateArguments(type, namePosition + length);
+                        if (args.empty()) {
+                            return std::nullopt;
+                        }
+                        return JitArithmeticOp{ name.second, namePosition, length, std::move(args) };
+                    }
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Calls f with a value of the scalar type named name. Returns false for other types.
+        template <typename F>
+        bool withScalarType(const std::string& name, F&& f) {
+            if (name == "float") { f(float{}); }
+            else if (name == "double") { f(double{}); }
+            else if (name == "int") { f(int{}); }
+            else if (name == "unsigned int" || name == "uint") { f(static_cast<unsigned int>(0)); }
+            else if (name == "long long") { f(static_cast<long long>(0)); }
+            else if (name == "unsigned long long") { f(static_cast<unsigned long long>(0)); }
+            else { return false; }
+            return true;
+        }
+
+        template <typename T>
+        T readScalar(const JIT_Operation_pp& op) {
+            T value;
+            std::memcpy(&value, op.getData(), sizeof(T));
+            return value;
+        }
+
+        // Integers are computed as unsigned, so that they wrap around like on the GPU
+        template <typename T>
+        T wrappingAdd(const T a, const T b) {
+            if constexpr (std::is_integral_v<T>) {
+                using U = std::make_unsigned_t<T>;
+                return static_cast<T>(static_cast<U>(a) + static_cast<U>(b));
+            } else {
+                return a + b;
+            }
+        }
+        template <typename T>
+        T wrappingMul(const T a, const T b) {
+            if constexpr (std::is_integral_v<T>) {
+                using U = std::make_unsigned_t<T>;
+                return static_cast<T>(static_cast<U>(a) * static_cast<U>(b));
+            } else {
+                return a * b;
+            }
+        }
+        template <typename T>
+        T wrappingNegate(const T a) {
+            return wrappingAdd(T{}, wrappingMul(a, static_cast<T>(-1)));
+        }
+
+        // An op of the output with the type renamed to kind, and the data replaced by value
+        template <typename T>
+        JIT_Operation_pp rewriteScalarOp(const JIT_Operation_pp& op, const JitArithmeticOp& arithmetic, const char* kind, const T value) {
+            std::string type = op.getType();
+            type.replace(arithmetic.namePosition, arithmetic.nameLength, kind);
+            JIT_Operation_pp rewritten(type, &value, sizeof(T), op.getAlignment());
+            rewritten.setConstant(op.isConstant());
+            return rewritten;
+        }
+    } // namespace jit_internal
+
+    // Host side rewriting of a runtime pipeline, before its kernel is looked up or compiled:
+    // - Sub of a scalar becomes Add of its negation, so both are the same kernel and can be merged
+    // - Cast to the same type is removed
+    // - Consecutive Add, or Mul, of the same type are merged into one, adding or multiplying their values
+    // - Constant operations (JIT_Operation_pp::setConstant) that do nothing, like Mul by 1, are removed,
+    //   unless their output type is not their input type.
+    //   Operations passed at launch are kept whatever their value, so the kernel only depends on the types.
+    // Only FKL arithmetic operations on scalar parameters are rewritten. The read and write operations,
+    // and every other operation, are copied as they are.
+    inline std::vector<JIT_Operation_pp> optimizePipeline(const std::vector<JIT_Operation_pp>& pipeline,
+                                                          const JitOptimizerOptions& options = JitOptimizerOptions::fromEnvironment(),
+                                                          JitOptimizationReport* report = nullptr) {
+        using namespace jit_internal;
+        JitOptimizationReport local;
+        JitOptimizationReport& stats = report != nullptr ? *report : local;
+        std::vector<JIT_Operation_pp> optimized;
+        optimized.reserve(pipeline.size());
+        for (const auto& input : pipeline) {
+            std::optional<JitArithmeticOp> arithmetic = findArithmeticOp(input.getType());
+            if (!arithmetic) {
+                optimized.push_back(input);
+                continue;
+            }
+            if (arithmetic->kind == JitArithmeticKind::CAST) {
+                if (arithmetic->args.size() == 2 && arithmetic->args[0] == arithmetic->args[1]) {
+                    stats.removed++;
+                } else {
+                    optimized.push_back(input);
+                }
+                continue;
+            }
+            // FKL arithmetic operations are Op<Input, Params = Input, ...>
+            const std::string& paramsType = arithmetic->args.size() > 1 ? arithmetic->args[1] : arithmetic->args[0];
+            bool handled = false;
+            withScalarType(paramsType, [&](const auto zero) {
+                using T = std::decay_t<decltype(zero)>;
+                if (input.getSize() != sizeof(T)) {
+                    return;
+                }
+                handled = true;
+                constexpr bool exact = std::is_integral_v<T>;
+                JIT_Operation_pp op = input;
+                T value = readScalar<T>(op);
+                if (arithmetic->kind == JitArithmeticKind::SUB) {
+                    value = wrappingNegate(value);
+                    op = rewriteScalarOp(op, *arithmetic, "Add", value);
+                    arithmetic = findArithmeticOp(op.getType());
+                    stats.canonicalized++;
+                } else if (arithmetic->kind == JitArithmeticKind::DIV && !exact && options.reassociateFloatingPoint && value != T{}) {
+                    value = static_cast<T>(1) / value;
+                    op = rewriteScalarOp(op, *arithmetic, "Mul", value);
+                    arithmetic = findArithmeticOp(op.getType());
+                    stats.canonicalized++;
+                }
+                const JitArithmeticKind kind = arithmetic->kind;
+                // An op that converts its input, like Mul<int, float, float>, is not removable whatever its
+                // value. The output type defaults to the input type.
+                const std::vector<std::string>& args = arithmetic->args;
+                const bool sameType = args.size() < 3 || args[0] == args[2];
+                // Add 0 is only an identity up to the sign of zero results, which pixel pipelines do not observe
+                const auto isIdentity = [kind, sameType](const T v) {
+                    return sameType && ((kind == JitArithmeticKind::ADD && v == T{}) ||
+                                        ((kind == JitArithmeticKind::MUL || kind == JitArithmeticKind::DIV) && v == static_cast<T>(1)));
+                };
+                const bool mergeable = (kind == JitArithmeticKind::ADD || kind == JitArithmeticKind::MUL) &&
+                                       (exact || options.reassociateFloatingPoint);
+                if (mergeable && !optimized.empty() && optimized.back().getType() == op.getType()) {
+                    JIT_Operation_pp& previous = optimized.back();
+                    const T previousValue = readScalar<T>(previous);
+                    const T mergedValue = kind == JitArithmeticKind::ADD ? wrappingAdd(previousValue, value) : wrappingMul(previousValue, value);
+                    const bool constant = previous.isConstant() && op.isConstant();
+                    std::memcpy(previous.getData(), &mergedValue, sizeof(T));
+                    previous.setConstant(constant);
+                    stats.merged++;
+                    if (constant && isIdentity(mergedValue)) {
+                        optimized.pop_back();
+                        stats.removed++;
+                    }
+                    return;
+                }
+                if (op.isConstant() && isIdentity(value)) {
+                    stats.removed++;
+                    return;
+                }
+                optimized.push_back(std::move(op));
+            });
+            if (!handled) {
+                optimized.push_back(input);
+            }
+        }
+        return optimized;
+    }
+} // namespace fk
+
+#endif // FK_JIT_PIPELINE_OPTIMIZER_H
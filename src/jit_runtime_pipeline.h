@@ -0,0 +1,170 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_RUNTIME_PIPELINE_H
+#define FK_JIT_RUNTIME_PIPELINE_H
+
+#include <src/jit_operation_pp.h>
+#include <src/jit_kernel_disk_cache.h>
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fk {
+    namespace jit_internal {
+        // Source added to every JIT program, so that the kernel of a runtime pipeline can be named from
+        // the op type strings alone. Runtime pipelines are launched with thread fusion disabled: it depends
+        // on the read and write types, which are only known as strings here. Their details then carry no
+        // runtime data, so the kernel builds them on the device and only takes the operations.
+        inline const char* runtimePipelinePrologue() {
+            return R"(
+                namespace fk {
+                    namespace jit_internal {
+                        template <typename T> T&& jitDeclval() noexcept;
+                        template <typename... IOps>
+                        using RuntimeTransformDPPDetails =
+                            decltype(fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED>::build_details(jitDeclval<const IOps&>()...));
+
+                        template <typename TDPPDetails, typename... IOps>
+                        __global__ void launchRuntimeTransformDPP_Kernel(const IOps... iOps) {
+                            fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED, TDPPDetails>::template exec<true>(
+                                TDPPDetails{}, iOps...);
+                        }
+                    } // namespace jit_internal
+                } // namespace fk
+            )";
+        }
+
+        inline std::string joinOperationTypes(const std::vector<JIT_Operation_pp>& pipeline) {
+            std::string types;
+            for (size_t i = 0; i < pipeline.size(); ++i) {
+                types += pipeline[i].getType();
+                if (i < pipeline.size() - 1) {
+                    types += ", ";
+                }
+            }
+            return types;
+        }
+
+        // Name expression of the instantiation of kernelName with the op types of the pipeline.
+        // Shared by the NVRTC and the Clang interpreter backends.
+        inline std::string buildNameExpression(const std::string& kernelName, const std::vector<JIT_Operation_pp>& pipeline) {
+            return "&" + kernelName + joinOperationTypes(pipeline) + ">";
+        }
+
+        // Kernel name for buildNameExpression, for a pipeline only known at runtime
+        inline std::string runtimeKernelName(const std::vector<JIT_Operation_pp>& pipeline) {
+            return "fk::jit_internal::launchRuntimeTransformDPP_Kernel<fk::jit_internal::RuntimeTransformDPPDetails<" +
+                   joinOperationTypes(pipeline) + ">, ";
+        }
+
+        // Hash of the op types of the pipeline. Pipelines with the same signature share the kernel,
+        // whatever their parameter values. It does not allocate memory.
+        inline uint64_t pipelineSignature(const std::vector<JIT_Operation_pp>& pipeline) {
+            uint64_t hash = FNV1A_64_OFFSET;
+            for (const auto& op : pipeline) {
+                hash = fnv1a64(op.getType(), hash);
+            }
+            return hash;
+        }
+    } // namespace jit_internal
+
+    // Kernels of runtime pipelines indexed by their signature, so that a warm launch
+    // neither builds the name expression nor allocates memory.
+    // Specialized entries also match the data of the constant operations, see JIT_Operation_pp::setConstant.
+    template <typename Value>
+    class JitSignatureTable {
+        struct Entry {
+            std::vector<std::string> types;
+            bool specialized{ false };
+            // Data of each operation that is constant in a specialized entry, empty for the others
+            std::vector<std::string> constants;
+            Value value;
+            bool matches(const std::vector<JIT_Operation_pp>& pipeline, const bool isSpecialized) const {
+                if (types.size() != pipeline.size() || specialized != isSpecialized) {
+                    return false;
+                }
+                for (size_t i = 0; i < types.size(); ++i) {
+                    if (types[i] != pipeline[i].getType()) {
+                        return false;
+                    }
+                    if (specialized) {
+                        const bool constant = pipeline[i].isConstant();
+                        if (constant != !constants[i].empty() ||
+                            (constant && (constants[i].size() != pipeline[i].getSize() ||
+                                          memcmp(constants[i].data(), pipeline[i].getData(), constants[i].size()) != 0))) {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            }
+        };
+        mutable std::shared_mutex m_mutex;
+        std::unordered_multimap<uint64_t, Entry> m_entries;
+    public:
+        std::optional<Value> find(const uint64_t signature, const std::vector<JIT_Operation_pp>& pipeline, const bool specialized = false) const {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            const auto range = m_entries.equal_range(signature);
+            for (auto it = range.first; it != range.second; ++it) {
+                // Compare the types, in case of hash collisions
+                if (it->second.matches(pipeline, specialized)) {
+                    return it->second.value;
+                }
+            }
+            return std::nullopt;
+        }
+
+        void insert(const uint64_t signature, const std::vector<JIT_Operation_pp>& pipeline, Value value, const bool specialized = false) {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            const auto range = m_entries.equal_range(signature);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second.matches(pipeline, specialized)) {
+                    it->second.value = std::move(value);
+                    return;
+                }
+            }
+            Entry entry;
+            entry.specialized = specialized;
+            for (const auto& op : pipeline) {
+                entry.types.push_back(op.getType());
+                if (specialized) {
+                    const char* data = static_cast<const char*>(op.getData());
+                    entry.constants.push_back(op.isConstant() ? std::string(data, op.getSize()) : std::string());
+                }
+            }
+            entry.value = std::move(value);
+            m_entries.emplace(signature, std::move(entry));
+        }
+
+        void clear() {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            m_entries.clear();
+        }
+
+        size_t size() const {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            return m_entries.size();
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_RUNTIME_PIPELINE_H
@@ -0,0 +1,195 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_JIT_VALUE_SPECIALIZATION_H
+#define FK_JIT_VALUE_SPECIALIZATION_H
+
+#include <src/jit_operation_pp.h>
+#include <src/jit_runtime_pipeline.h>
+#include <src/jit_kernel_disk_cache.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fk {
+    namespace jit_internal {
+        // Source added to every JIT program for value specialization. A constant operation is named
+        // JitConstantOp<IOp, Words...>, where the words are the bytes of its data. The kernel still
+        // receives every operation as a parameter, with the same layout as the generic kernel, but it
+        // rebuilds the constant ones from the words, so NVRTC folds their values and never loads them.
+        inline const char* specializationPrologue() {
+            return R"(
+                namespace fk {
+                    namespace jit_internal {
+                        template <typename IOp, unsigned int... Words>
+                        struct JitConstantOp {};
+
+                        template <typename Op>
+                        struct JitSpecializedOp {
+                            using Type = Op;
+                            static __device__ __forceinline__ const Op& get(const Op& op) { return op; }
+                        };
+                        template <typename IOp, unsigned int... Words>
+                        struct JitSpecializedOp<JitConstantOp<IOp, Words...>> {
+                            using Type = IOp;
+                            static __device__ __forceinline__ IOp get(const IOp&) {
+                                constexpr unsigned int words[] = { Words... };
+                                static_assert(sizeof(words) >= sizeof(IOp), "Missing words of a constant operation");
+                                IOp op;
+                                memcpy(&op, words, sizeof(IOp));
+                                return op;
+                            }
+                        };
+
+                        template <bool THREAD_DIVISIBLE, typename TDPPDetails, typename... Ops>
+                        __global__ void launchSpecializedTransformDPP_Kernel(const typename JitSpecializedOp<Ops>::Type... operations) {
+                            fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED, TDPPDetails>::template exec<THREAD_DIVISIBLE>(
+                                TDPPDetails{}, JitSpecializedOp<Ops>::get(operations)...);
+                        }
+                    } // namespace jit_internal
+                } // namespace fk
+            )";
+        }
+
+        inline bool hasConstantOperations(const std::vector<JIT_Operation_pp>& pipeline) {
+            for (const auto& op : pipeline) {
+                if (op.isConstant()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // JitConstantOp type of a constant operation, with its bytes as 32 bit words. Padding up to
+        // the last word is zero.
+        inline std::string constantOperationType(const JIT_Operation_pp& op) {
+            std::string type = "fk::jit_internal::JitConstantOp<" + op.getType();
+            const unsigned char* bytes = static_cast<const unsigned char*>(op.getData());
+            for (size_t offset = 0; offset < op.getSize(); offset += sizeof(uint32_t)) {
+                uint32_t word{ 0 };
+                memcpy(&word, bytes + offset, std::min(sizeof(uint32_t), op.getSize() - offset));
+                char hex[16];
+                std::snprintf(hex, sizeof(hex), ", 0x%08xu", static_cast<unsigned int>(word));
+                type += hex;
+            }
+            return type + ">";
+        }
+
+        // Name expression of the kernel of a runtime pipeline with its constant operations baked in.
+        // The details type is the one of the generic kernel, since it only depends on the op types.
+        inline std::string specializedNameExpression(const std::vector<JIT_Operation_pp>& pipeline) {
+            std::string expression = "&fk::jit_internal::launchSpecializedTransformDPP_Kernel<true, "
+                                     "fk::jit_internal::RuntimeTransformDPPDetails<" + joinOperationTypes(pipeline) + ">";
+            for (const auto& op : pipeline) {
+                expression += ", " + (op.isConstant() ? constantOperationType(op) : op.getType());
+            }
+            return expression + ">";
+        }
+
+        // pipelineSignature, combined with the position and the data of the constant operations
+        inline uint64_t specializedSignature(const std::vector<JIT_Operation_pp>& pipeline) {
+            uint64_t hash = pipelineSignature(pipeline);
+            for (size_t i = 0; i < pipeline.size(); ++i) {
+                if (pipeline[i].isConstant()) {
+                    hash = fnv1a64(&i, sizeof(i), hash);
+                    hash = fnv1a64(pipeline[i].getData(), pipeline[i].getSize(), hash);
+                }
+            }
+            return hash;
+        }
+    } // namespace jit_internal
+
+    // Every distinct set of constant values compiles a new kernel, so the number of specializations
+    // of a pipeline signature is bounded. Over the limit, the pipeline uses the generic kernel,
+    // which receives every operation as a parameter. A limit of 0 disables value specialization.
+    struct JitSpecializationPolicy {
+        size_t maxPerSignature{ 8 };
+
+        static JitSpecializationPolicy fromEnvironment() {
+            JitSpecializationPolicy policy;
+            if (const char* maxPerSignature = std::getenv("FK_JIT_MAX_SPECIALIZATIONS")) {
+                policy.maxPerSignature = static_cast<size_t>(std::strtoull(maxPerSignature, nullptr, 10));
+            }
+            return policy;
+        }
+    };
+
+    // The sets of constant values specialized for each pipeline signature. A set that was admitted
+    // once stays admitted, even if its kernel is evicted, so it is compiled again when needed.
+    class JitSpecializationBudget {
+        mutable std::shared_mutex m_mutex;
+        std::unordered_map<uint64_t, std::unordered_set<uint64_t>> m_specializations;
+    public:
+        // Whether admit would accept the specialization, without recording it
+        bool allows(const uint64_t signature, const uint64_t specialization, const size_t limit) const {
+            if (limit == 0) {
+                return false;
+            }
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            const auto found = m_specializations.find(signature);
+            if (found == m_specializations.end()) {
+                return true;
+            }
+            return found->second.count(specialization) != 0 || found->second.size() < limit;
+        }
+
+        // Records the specialization if it is known already or the signature is under the limit
+        bool admit(const uint64_t signature, const uint64_t specialization, const size_t limit) {
+            if (limit == 0) {
+                return false;
+            }
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            auto& specializations = m_specializations[signature];
+            if (specializations.count(specialization) != 0) {
+                return true;
+            }
+            if (specializations.size() >= limit) {
+                return false;
+            }
+            specializations.insert(specialization);
+            return true;
+        }
+
+        size_t specializations(const uint64_t signature) const {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            const auto found = m_specializations.find(signature);
+            return found == m_specializations.end() ? 0 : found->second.size();
+        }
+
+        size_t size() const {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            size_t total = 0;
+            for (const auto& signature : m_specializations) {
+                total += signature.second.size();
+            }
+            return total;
+        }
+
+        void clear() {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            m_specializations.clear();
+        }
+    };
+} // namespace fk
+
+#endif // FK_JIT_VALUE_SPECIALIZATION_H
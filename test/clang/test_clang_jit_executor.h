@@ -0,0 +1,89 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_CLANG_JIT_EXECUTOR_H
+#define FK_TEST_CLANG_JIT_EXECUTOR_H
+
+// __ONLY_CPU__
+// Fused host pipelines compiled by the Clang interpreter. It does not need a GPU.
+
+#include "clang/Interpreter/Interpreter.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_clang_executor.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace test_clang_jit_executor {
+    template <typename IOp>
+    fk::JIT_Operation_pp makeOp(const IOp& iOp) {
+        return fk::JIT_Operation_pp(fk::typeToString<IOp>(), &iOp, sizeof(IOp), alignof(IOp));
+    }
+} // namespace test_clang_jit_executor
+
+int launch() {
+    using namespace test_clang_jit_executor;
+    constexpr uint N = 1000;
+    std::vector<float> input(N);
+    for (uint i = 0; i < N; ++i) {
+        input[i] = static_cast<float>(i);
+    }
+    std::vector<float> outputA(N, 0.f);
+    std::vector<float> outputB(N, 0.f);
+
+    const fk::RawPtr<fk::_1D, float> rawIn{ input.data(), { N, N * sizeof(float) } };
+    const fk::RawPtr<fk::_1D, float> rawOutA{ outputA.data(), { N, N * sizeof(float) } };
+    const fk::RawPtr<fk::_1D, float> rawOutB{ outputB.data(), { N, N * sizeof(float) } };
+
+    const auto readOp = fk::PerThreadRead<fk::_1D, float>::build(rawIn);
+    const auto mulA = fk::Mul<float>::build(2.f);
+    const auto addA = fk::Add<float>::build(5.f);
+    const auto writeA = fk::PerThreadWrite<fk::_1D, float>::build(rawOutA);
+    const auto mulB = fk::Mul<float>::build(3.f);
+    const auto addB = fk::Add<float>::build(-1.f);
+    const auto writeB = fk::PerThreadWrite<fk::_1D, float>::build(rawOutB);
+
+    const auto& functionCache = fk::CPUJITExecutorCache::getInstance().getFunctionCache();
+    const size_t functionsBefore = functionCache.size();
+
+    // Pipeline assembled at runtime, and the same pipeline from typed operations
+    const std::vector<fk::JIT_Operation_pp> pipelineA{ makeOp(readOp), makeOp(mulA), makeOp(addA), makeOp(writeA) };
+    fk::CPUJITExecutor::executeOperations(pipelineA);
+    fk::CPUJITExecutor::executeOperations(readOp, mulB, addB, writeB);
+
+    // Both configurations have the same op-type signature, so they share the same function
+    const size_t functionsCompiled = functionCache.size() - functionsBefore;
+    if (functionsCompiled != 1) {
+        std::cout << "ERROR: expected one fused function, " << functionsCompiled << " were compiled" << std::endl;
+        return 1;
+    }
+
+    for (uint i = 0; i < N; ++i) {
+        const float expectedA = i * 2.f + 5.f;
+        const float expectedB = i * 3.f - 1.f;
+        if (std::abs(outputA[i] - expectedA) > 0.001f || std::abs(outputB[i] - expectedB) > 0.001f) {
+            std::cout << "ERROR: wrong result at " << i << ": " << outputA[i] << " (expected " << expectedA
+                      << "), " << outputB[i] << " (expected " << expectedB << ")" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "SUCCESS: two pipelines executed on the host with a single JIT compiled function" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_CLANG_JIT_EXECUTOR_H
@@ -0,0 +1,131 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_BATCH_FUSION
+#define FK_TEST_JIT_BATCH_FUSION
+
+// __ONLY_CPU__
+// Batch planning and parameter packing of independent runtime pipelines launched as one kernel
+
+#include "main.h"
+#include <src/jit_batch_fusion.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace test_jit_batch_fusion {
+    // Same members as the FKL RawPtr<_2D, T>
+    struct Ptr {
+        void* data;
+        unsigned int width;
+        unsigned int height;
+        unsigned int pitch;
+    };
+
+    float frames[64][16];
+
+    inline std::vector<fk::JIT_Operation_pp> camera(const size_t index, const float gain, const unsigned int width = 16,
+                                                    const char* scalar = "float") {
+        const Ptr input{ frames[index], width, 1, width * 4 };
+        const Ptr output{ frames[index] + 8, width, 1, width * 4 };
+        fk::JIT_Operation_pp read("fk::Read<fk::PerThreadRead<fk::_2D, float>>", &input, sizeof(input), alignof(Ptr));
+        read.setActiveThreads(width, 1, 1);
+        const fk::JIT_Operation_pp mul(std::string("fk::Binary<fk::Mul<") + scalar + ">>", &gain, sizeof(gain), alignof(float));
+        const fk::JIT_Operation_pp write("fk::Write<fk::PerThreadWrite<fk::_2D, float>>", &output, sizeof(output), alignof(Ptr));
+        return { read, mul, write };
+    }
+} // namespace test_jit_batch_fusion
+
+int launch() {
+    using namespace test_jit_batch_fusion;
+    using fk::jit_internal::planBatches;
+    using Pipelines = std::vector<std::vector<fk::JIT_Operation_pp>>;
+    const fk::JitBatchPolicy policy;
+
+    // Ops packed like struct members: the float after the first Ptr, the second Ptr aligned to 8 bytes
+    const fk::jit_internal::JitPlaneLayout layout = fk::jit_internal::batchPlaneLayout(camera(0, 2.f));
+    CHECK(layout.alignment == alignof(Ptr) && layout.offsets[1] == sizeof(Ptr));
+    CHECK(layout.offsets[2] == fk::jit_internal::alignUp(sizeof(Ptr) + sizeof(float), alignof(Ptr)));
+    CHECK(layout.size == layout.offsets[2] + sizeof(Ptr) && layout.size % layout.alignment == 0);
+
+    // 16 cameras with the same pipeline: one kernel with 16 planes
+    Pipelines cameras;
+    for (size_t i = 0; i < 16; ++i) {
+        cameras.push_back(camera(i, static_cast<float>(i)));
+    }
+    const fk::JitBatchPlan batched = planBatches(cameras, policy);
+    CHECK(batched.kernels() == 1 && batched.launches[0].size() == 16 && batched.launches[0][15] == 15);
+    CHECK(fk::jit_internal::batchedNameExpression(cameras[0], 16).find("launchBatchedTransformDPP_Kernel<16, ") != std::string::npos);
+    // Warm batched launches find their kernel by signature: the same op types, whatever the values
+    using fk::jit_internal::batchedSignature;
+    CHECK(batchedSignature(cameras[0], 16) == batchedSignature(cameras[1], 16));
+    CHECK(batchedSignature(cameras[0], 16) != batchedSignature(cameras[0], 4) &&
+          batchedSignature(cameras[0], 16) != fk::jit_internal::pipelineSignature(cameras[0]));
+
+    // The parameters of plane i are the ops of pipeline i, at the plane layout
+    fk::JitParamBuffer buffer;
+    fk::jit_internal::packBatch(buffer, cameras, batched.launches[0]);
+    CHECK(buffer.size() == 16 * layout.size);
+    for (size_t plane = 0; plane < 16; ++plane) {
+        float gain;
+        std::memcpy(&gain, buffer.data() + plane * layout.size + layout.offsets[1], sizeof(float));
+        void* data;
+        std::memcpy(&data, buffer.data() + plane * layout.size + layout.offsets[2], sizeof(void*));
+        CHECK(gain == static_cast<float>(plane) && data == frames[plane] + 8);
+    }
+
+    // Different op types are batched separately, keeping the order in which each signature appears
+    Pipelines mixed{ camera(0, 1.f), camera(1, 1.f, 16, "double"), camera(2, 1.f), camera(3, 1.f, 16, "double"), camera(4, 1.f) };
+    const fk::JitBatchPlan bySignature = planBatches(mixed, policy);
+    CHECK(bySignature.kernels() == 2 && bySignature.launches[0] == (std::vector<size_t>{ 0, 2, 4 }));
+    CHECK(bySignature.launches[1] == (std::vector<size_t>{ 1, 3 }));
+
+    // Planes of different resolution share a kernel with the grid of the largest one
+    const Pipelines resolutions{ camera(0, 1.f, 8), camera(1, 1.f, 16) };
+    unsigned int x, y;
+    fk::jit_internal::batchActiveThreads(resolutions, planBatches(resolutions, policy).launches[0], x, y);
+    CHECK(planBatches(resolutions, policy).kernels() == 1 && x == 16 && y == 1);
+
+    // Pipelines with several planes of their own, or without a read operation, are launched alone
+    Pipelines volumes{ camera(0, 1.f), camera(1, 1.f) };
+    volumes[1][0].setActiveThreads(16, 1, 4);
+    CHECK(planBatches(volumes, policy).kernels() == 2);
+
+    // Batches are split at maxPlanes and at the kernel parameter limit
+    fk::JitBatchPolicy four;
+    four.maxPlanes = 4;
+    const fk::JitBatchPlan split = planBatches(cameras, four);
+    CHECK(split.kernels() == 4 && split.launches[3] == (std::vector<size_t>{ 12, 13, 14, 15 }));
+    const float lut[64]{};
+    Pipelines many;
+    for (size_t i = 0; i < 64; ++i) {
+        many.push_back(camera(i, 1.f));
+        many.back().insert(many.back().begin() + 1, fk::JIT_Operation_pp("fk::Binary<fk::Lut<float, 64>>", lut, sizeof(lut), alignof(float)));
+    }
+    const size_t planeSize = fk::jit_internal::batchPlaneLayout(many[0]).size;
+    const fk::JitBatchPlan limited = planBatches(many, policy);
+    CHECK(limited.kernels() > 1 && limited.launches[0].size() == fk::JIT_MAX_KERNEL_PARAM_BYTES / planeSize);
+    for (const auto& launch : limited.launches) {
+        CHECK(launch.size() * planeSize <= fk::JIT_MAX_KERNEL_PARAM_BYTES);
+    }
+
+    std::cout << "SUCCESS: " << cameras.size() << " pipelines in " << batched.kernels() << " launch, "
+              << many.size() << " pipelines in " << limited.kernels() << " launches" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_BATCH_FUSION
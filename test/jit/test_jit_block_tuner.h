@@ -0,0 +1,95 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_BLOCK_TUNER
+#define FK_TEST_JIT_BLOCK_TUNER
+
+// __ONLY_CPU__
+// Block shape selection and persistence of the autotuner, timed with a fake timer instead of the GPU
+
+#include "main.h"
+#include <src/jit_block_tuner.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int launch() {
+    const auto contains = [](const std::vector<fk::JitBlockShape>& shapes, const fk::JitBlockShape& shape) {
+        return std::find(shapes.begin(), shapes.end(), shape) != shapes.end();
+    };
+
+    // Candidates: the default block first, no duplicates, none over the limit of the kernel
+    const std::vector<fk::JitBlockShape> linear = fk::jit_internal::candidateBlocks(1 << 20, 1, { 256, 1 }, 512, 384);
+    CHECK(linear.front() == (fk::JitBlockShape{ 256, 1 }));
+    CHECK(std::count(linear.begin(), linear.end(), fk::JitBlockShape{ 256, 1 }) == 1);
+    CHECK(contains(linear, { 384, 1 }) && contains(linear, { 512, 1 }) && !contains(linear, { 1024, 1 }));
+    const std::vector<fk::JitBlockShape> planar = fk::jit_internal::candidateBlocks(1920, 1080, { 32, 8 }, 1024, 768);
+    CHECK(planar.front() == (fk::JitBlockShape{ 32, 8 }) && contains(planar, { 32, 24 }) && contains(planar, { 16, 16 }));
+    CHECK(std::all_of(planar.begin(), planar.end(), [](const fk::JitBlockShape& shape) { return shape.threads() <= 1024; }));
+
+    // Shape classes: the same for sizes that round up to the same powers of two
+    CHECK(fk::jit_internal::shapeClass(1920, 1080, 1) == fk::jit_internal::shapeClass(2048, 1025, 1));
+    CHECK(fk::jit_internal::shapeClass(1920, 1080, 1) != fk::jit_internal::shapeClass(1920, 1080, 3));
+    CHECK(fk::jit_internal::shapeClass(1920, 540, 1) != fk::jit_internal::shapeClass(540, 1920, 1));
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "fkl_test_block_tuner" / "tuning.txt";
+    std::error_code ec;
+    std::filesystem::remove_all(path.parent_path(), ec);
+
+    // The fake timer makes 64x4 the fastest shape
+    int timings = 0;
+    const fk::JitBlockTimer timer = [&timings](const fk::JitBlockShape& shape) {
+        timings++;
+        return shape == fk::JitBlockShape{ 64, 4 } ? 1.0 : 2.0 + shape.threads() / 1024.0;
+    };
+    const fk::JitTuningKey key{ 0x0123456789abcdefull, fk::jit_internal::shapeClass(1920, 1080, 1) };
+    const fk::JitTuningKey otherKey{ 0xfedcba9876543210ull, fk::jit_internal::shapeClass(100, 1, 1) };
+    {
+        fk::JitBlockTuner tuner(path, true);
+        CHECK(tuner.isEnabled() && !tuner.find(key));
+        CHECK(tuner.tune(key, planar, timer) == (fk::JitBlockShape{ 64, 4 }));
+        CHECK(timings == static_cast<int>(planar.size()));
+        // Tuned already: the timer is not called again
+        CHECK(tuner.tune(key, planar, timer) == (fk::JitBlockShape{ 64, 4 }) && timings == static_cast<int>(planar.size()));
+        // Ties keep the first candidate, which is the default block
+        CHECK(tuner.tune(otherKey, linear, [](const fk::JitBlockShape&) { return 1.0; }) == linear.front());
+        CHECK(tuner.size() == 2 && tuner.tunings() == 2);
+    }
+
+    // A new tuner, as in a later run, reads the choices from the file
+    {
+        fk::JitBlockTuner tuner(path, true);
+        CHECK(tuner.size() == 2 && tuner.find(key) == (fk::JitBlockShape{ 64, 4 }) && tuner.find(otherKey) == linear.front());
+        const int before = timings;
+        CHECK(tuner.tune(key, planar, timer) == (fk::JitBlockShape{ 64, 4 }) && timings == before && tuner.tunings() == 0);
+        tuner.clear();
+        CHECK(tuner.size() == 0 && !std::filesystem::exists(path));
+    }
+
+    // Without a path, the choices only live in memory
+    {
+        fk::JitBlockTuner tuner({}, false);
+        CHECK(!tuner.isEnabled());
+        CHECK(tuner.tune(key, planar, timer) == (fk::JitBlockShape{ 64, 4 }) && tuner.size() == 1);
+    }
+    std::filesystem::remove_all(path.parent_path(), ec);
+
+    std::cout << "SUCCESS: " << planar.size() << " candidate blocks for 1920x1080" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_BLOCK_TUNER
@@ -0,0 +1,110 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_COMPILE_PROFILE
+#define FK_TEST_JIT_COMPILE_PROFILE
+
+// __ONLY_CPU__
+// NVRTC options of the compile profiles, and the kernel keys that keep their kernels apart
+
+#include "main.h"
+#include <src/jit_compile_profile.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int launch() {
+    using namespace fk::jit_internal;
+    const std::string nameExpression = "&launchTransformDPP_Kernel<ParArch::GPU_NVIDIA, TF::DISABLED, true, fk::Read<int>>";
+
+    // The default compilation keeps the name expression as the key
+    const JitProfileKey precise(fk::JitCompileProfile::precise());
+    CHECK(fk::JitCompileProfile::precise().options().empty());
+    CHECK(precise.suffix.empty() && precise.hash == 0);
+    CHECK(profiledExpression(nameExpression, precise) == nameExpression);
+    CHECK(keyNameExpression(nameExpression) == nameExpression && keyProfileOptions(nameExpression).empty() &&
+                  keyProfileHash(nameExpression) == 0);
+
+    // Keys of other profiles carry their options
+    const fk::JitCompileProfile fast = fk::JitCompileProfile::named("fast");
+    CHECK(fast.name == "fast" && fast.options() == std::vector<std::string>({ "--use_fast_math", "--extra-device-vectorization" }));
+    const JitProfileKey fastKey(fast);
+    const std::string fastExpression = profiledExpression(nameExpression, fastKey);
+    CHECK(fastExpression != nameExpression && fastKey.hash != 0);
+    CHECK(keyNameExpression(fastExpression) == nameExpression);
+    CHECK(keyProfileOptions(fastExpression) == fast.options());
+    CHECK(keyProfileHash(fastExpression) == fastKey.hash);
+
+    fk::JitCompileProfile custom;
+    custom.name = "archival";
+    custom.maxRegisters = 64;
+    custom.optimizationLevel = 5;
+    custom.lineInfo = true;
+    custom.extraOptions = { "--fmad=false" };
+    CHECK(custom.options() == std::vector<std::string>({ "--maxrregcount=64", "--ptxas-options=-O3", "--generate-line-info", "--fmad=false" }));
+    const JitProfileKey customKey(custom);
+    CHECK(keyProfileOptions(profiledExpression(nameExpression, customKey)) == custom.options() && customKey.hash != fastKey.hash);
+
+    // Profiles are told apart by their options, not by their names
+    fk::JitCompileProfile renamed = fast;
+    renamed.name = "preview";
+    CHECK(JitProfileKey(renamed).suffix == fastKey.suffix);
+    CHECK(fk::JitCompileProfile::named("profiling").options() == std::vector<std::string>({ "--generate-line-info" }));
+    bool unknown = false;
+    try {
+        fk::JitCompileProfile::named("turbo");
+    } catch (const std::runtime_error&) {
+        unknown = true;
+    }
+    CHECK(unknown);
+
+    // Options with spaces would be split by the option parsing of NVRTC
+    for (const std::string& invalid : { std::string("--fmad false"), std::string("") }) {
+        fk::JitCompileProfile spaced;
+        spaced.extraOptions = { invalid };
+        bool rejected = false;
+        try {
+            spaced.options();
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        CHECK(rejected);
+    }
+
+    // Runtime pipelines have a signature per profile
+    const uint64_t signature = 1234567;
+    CHECK(profiledSignature(signature, 0) == signature);
+    CHECK(profiledSignature(signature, fastKey.hash) != signature &&
+                  profiledSignature(signature, fastKey.hash) != profiledSignature(signature, customKey.hash));
+
+    // Nested scopes restore the enclosing profile
+    CHECK(scopedProfile() == nullptr);
+    {
+        fk::JitProfileScope previewScope(fast);
+        CHECK(scopedProfile() != nullptr && scopedProfile()->hash == fastKey.hash);
+        {
+            fk::JitProfileScope archivalScope(custom);
+            CHECK(scopedProfile()->suffix == customKey.suffix);
+        }
+        CHECK(scopedProfile()->hash == fastKey.hash);
+    }
+    CHECK(scopedProfile() == nullptr);
+
+    std::cout << "SUCCESS: kernel key of the fast profile: " << fastExpression << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_COMPILE_PROFILE
@@ -0,0 +1,130 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_COMPILE_WORKER
+#define FK_TEST_JIT_COMPILE_WORKER
+
+// __ONLY_CPU__
+// Background compilation with fallback, with a stub compiler instead of NVRTC
+
+#include "main.h"
+#include <src/jit_compile_worker.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+int launch() {
+    fk::JitShardedCache<std::shared_ptr<const std::string>> cache;
+    fk::JitCompileWorker worker;
+
+    // The stub compiler does not finish until the test allows it
+    std::promise<void> allowCompilation;
+    std::shared_future<void> compilationAllowed = allowCompilation.get_future().share();
+    std::atomic<int> compilations{ 0 };
+    const auto stubCompiler = [&compilations, compilationAllowed] {
+        compilationAllowed.wait();
+        compilations++;
+        return std::make_shared<const std::string>("fused_kernel");
+    };
+
+    int fusedLaunches = 0;
+    int fallbackLaunches = 0;
+    const auto execute = [&] {
+        const auto future = fk::getOrCompileAsync(cache, worker, "pipeline", stubCompiler);
+        fk::jit_internal::launchOrFallback(future,
+            [&](const auto& kernel) { if (*kernel == "fused_kernel") { fusedLaunches++; } },
+            [&] { fallbackLaunches++; });
+    };
+
+    // While the kernel is compiling, every call runs the fallback and no call blocks
+    for (int i = 0; i < 10; ++i) {
+        execute();
+    }
+    CHECK(fallbackLaunches == 10 && fusedLaunches == 0);
+
+    // Once the kernel is ready, the following calls switch to it
+    allowCompilation.set_value();
+    fk::getOrCompileAsync(cache, worker, "pipeline", stubCompiler).wait();
+    for (int i = 0; i < 10; ++i) {
+        execute();
+    }
+    CHECK(fallbackLaunches == 10 && fusedLaunches == 10 && compilations == 1);
+
+    // Compilation errors reach the callers of the async path, which do not compile the kernel again,
+    // instead of silently running the fallback forever
+    std::atomic<int> failingCompilations{ 0 };
+    const auto failingCompiler = [&failingCompilations]() -> std::shared_ptr<const std::string> {
+        failingCompilations++;
+        throw fk::JitCompileError("Stub compilation error");
+    };
+    fk::getOrCompileAsync(cache, worker, "failing_pipeline", failingCompiler).wait();
+    int errors = 0;
+    int failingFallbacks = 0;
+    for (int i = 0; i < 10; ++i) {
+        try {
+            fk::jit_internal::launchOrFallback(fk::getOrCompileAsync(cache, worker, "failing_pipeline", failingCompiler),
+                                               [](const auto&) {}, [&] { failingFallbacks++; });
+        } catch (const std::runtime_error&) {
+            errors++;
+        }
+    }
+    CHECK(errors == 10 && failingFallbacks == 0 && failingCompilations == 1);
+
+    // Once the failure is cleared, the next call compiles again
+    CHECK(cache.clearFailure("failing_pipeline"));
+    fk::getOrCompileAsync(cache, worker, "failing_pipeline", failingCompiler).wait();
+    CHECK(failingCompilations == 2);
+
+    // Compilations still pending when the worker is destroyed fail with an error, instead of a broken
+    // promise, and are not kept as failed entries
+    {
+        auto stoppingWorker = std::make_unique<fk::JitCompileWorker>();
+        std::promise<void> allowRunning;
+        std::shared_future<void> runningAllowed = allowRunning.get_future().share();
+        auto runningStarted = std::make_shared<std::promise<void>>();
+        const auto running = fk::getOrCompileAsync(cache, *stoppingWorker, "running_pipeline", [runningAllowed, runningStarted] {
+            runningStarted->set_value();
+            runningAllowed.wait();
+            return std::make_shared<const std::string>("running_kernel");
+        });
+        runningStarted->get_future().wait();
+        const auto pending = fk::getOrCompileAsync(cache, *stoppingWorker, "pending_pipeline", stubCompiler);
+        std::thread allower([&allowRunning] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            allowRunning.set_value();
+        });
+        stoppingWorker.reset();
+        allower.join();
+        bool stopped = false;
+        try {
+            pending.get();
+        } catch (const std::runtime_error&) {
+            stopped = true;
+        }
+        CHECK(*running.get() == "running_kernel" && stopped);
+        CHECK(!cache.hasFailed("pending_pipeline") && !cache.find("pending_pipeline").has_value());
+    }
+
+    std::cout << "SUCCESS: " << fallbackLaunches << " fallback launches while compiling, then "
+              << fusedLaunches << " fused launches" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_COMPILE_WORKER
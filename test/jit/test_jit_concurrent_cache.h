@@ -0,0 +1,136 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_CONCURRENT_CACHE
+#define FK_TEST_JIT_CONCURRENT_CACHE
+
+// __ONLY_CPU__
+// Multi-threaded stress test of the JIT kernel cache, with a stub compiler instead of NVRTC
+
+#include "main.h"
+#include <src/jit_concurrent_cache.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+int launch() {
+    constexpr int NUM_THREADS = 16;
+    constexpr int NUM_KEYS = 64;
+    constexpr int LOOKUPS_PER_THREAD = 4000;
+
+    fk::JitShardedCache<std::shared_ptr<const std::string>> cache;
+    std::vector<std::atomic<int>> compilations(NUM_KEYS);
+    for (auto& count : compilations) {
+        count = 0;
+    }
+    std::atomic<int> errors{ 0 };
+    std::atomic<bool> start{ false };
+
+    // Stub compiler: slow enough to make concurrent misses on the same key very likely
+    const auto stubCompiler = [&](int keyIndex) {
+        compilations[keyIndex]++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return std::make_shared<const std::string>("kernel_" + std::to_string(keyIndex));
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            while (!start) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < LOOKUPS_PER_THREAD; ++i) {
+                // All threads walk the keys in the same order at first, so that they collide
+                const int keyIndex = (i + (i >= NUM_KEYS ? t * 7 : 0)) % NUM_KEYS;
+                const std::string key = "key_" + std::to_string(keyIndex);
+                const auto value = cache.getOrCompile(key, [&] { return stubCompiler(keyIndex); });
+                if (*value != "kernel_" + std::to_string(keyIndex)) {
+                    errors++;
+                }
+            }
+        });
+    }
+    start = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Each key is compiled once, however many threads miss it at the same time
+    for (int k = 0; k < NUM_KEYS; ++k) {
+        CHECK(compilations[k] == 1);
+    }
+    CHECK(errors == 0 && cache.size() == NUM_KEYS && cache.misses() == NUM_KEYS);
+
+    // A compile error is reported to every waiter, and to later calls without compiling again,
+    // until the failure is cleared
+    std::atomic<int> failedCalls{ 0 };
+    std::atomic<int> failingCompilations{ 0 };
+    threads.clear();
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&] {
+            try {
+                cache.getOrCompile("failing_key", [&]() -> std::shared_ptr<const std::string> {
+                    failingCompilations++;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    throw fk::JitCompileError("Stub compilation error");
+                });
+            } catch (const std::runtime_error&) {
+                failedCalls++;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(failedCalls == NUM_THREADS && failingCompilations == 1);
+    CHECK(!cache.find("failing_key").has_value() && cache.hasFailed("failing_key"));
+    bool rethrown = false;
+    try {
+        cache.getOrCompile("failing_key", [&]() -> std::shared_ptr<const std::string> {
+            failingCompilations++;
+            return std::make_shared<const std::string>("not compiled");
+        });
+    } catch (const std::runtime_error&) {
+        rethrown = true;
+    }
+    CHECK(rethrown && failingCompilations == 1);
+    CHECK(cache.clearFailure("failing_key") && !cache.hasFailed("failing_key"));
+    const auto retried = cache.getOrCompile("failing_key", [] { return std::make_shared<const std::string>("recovered"); });
+    CHECK(*retried == "recovered");
+
+    // Other errors, like the driver running out of memory, are reported to the waiters but not kept
+    bool transientThrown = false;
+    try {
+        cache.getOrCompile("transient_key", []() -> std::shared_ptr<const std::string> {
+            throw std::runtime_error("Stub out of memory error");
+        });
+    } catch (const std::runtime_error&) {
+        transientThrown = true;
+    }
+    CHECK(transientThrown && !cache.hasFailed("transient_key") && !cache.find("transient_key").has_value());
+    const auto transientRetried = cache.getOrCompile("transient_key", [] { return std::make_shared<const std::string>("recovered"); });
+    CHECK(*transientRetried == "recovered");
+
+    std::cout << "SUCCESS: " << NUM_THREADS * LOOKUPS_PER_THREAD << " lookups, " << cache.misses() << " compilations, "
+              << cache.waits() << " waits on in-flight compilations" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_CONCURRENT_CACHE
@@ -0,0 +1,146 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_DEFERRED_EXECUTION
+#define FK_TEST_JIT_DEFERRED_EXECUTION
+
+// __ONLY_CPU__
+// Dependency analysis and fusion plan of the pipelines recorded by a JitDeferredQueue
+
+#include "main.h"
+#include <src/jit_deferred_execution.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace test_jit_deferred_execution {
+    // Same members as the FKL RawPtr<_2D, T>
+    struct Ptr {
+        void* data;
+        unsigned int width;
+        unsigned int height;
+        unsigned int pitch;
+    };
+
+    float x[64], y[64], z[64], w[64];
+
+    inline fk::JIT_Operation_pp readOp(void* data, const unsigned int width, const std::string& type = "float") {
+        const Ptr ptr{ data, width, 4, width * 4 };
+        fk::JIT_Operation_pp op("fk::Read<fk::PerThreadRead<fk::_2D, " + type + ">>", &ptr, sizeof(ptr), alignof(Ptr));
+        op.setActiveThreads(width, 4, 1);
+        return op;
+    }
+
+    inline fk::JIT_Operation_pp writeOp(void* data, const unsigned int width, const std::string& type = "float") {
+        const Ptr ptr{ data, width, 4, width * 4 };
+        return fk::JIT_Operation_pp("fk::Write<fk::PerThreadWrite<fk::_2D, " + type + ">>", &ptr, sizeof(ptr), alignof(Ptr));
+    }
+
+    inline fk::JIT_Operation_pp mulOp(const float value) {
+        return fk::JIT_Operation_pp("fk::Binary<fk::Mul<float>>", &value, sizeof(value), alignof(float));
+    }
+
+    // An operation that also reads an image, like a binary operation with an image as its second operand
+    inline fk::JIT_Operation_pp imageOperandOp(void* data, const unsigned int width) {
+        const Ptr ptr{ data, width, 4, width * 4 };
+        return fk::JIT_Operation_pp("fk::Binary<fk::Add<fk::RawPtr<fk::_2D, float>>>", &ptr, sizeof(ptr), alignof(Ptr));
+    }
+
+    // An operation that embeds a read, with its Ptr after other members
+    inline fk::JIT_Operation_pp readBackOp(void* data, const unsigned int width) {
+        struct ReadBack {
+            float scale[2];
+            Ptr ptr;
+        };
+        const ReadBack readBack{ { 1.f, 1.f }, { data, width, 4, width * 4 } };
+        return fk::JIT_Operation_pp("fk::ReadBack<fk::Resize<fk::InterpolationType::INTER_LINEAR, fk::Read<fk::PerThreadRead<fk::_2D, float>>>>",
+                                    &readBack, sizeof(readBack), alignof(ReadBack));
+    }
+
+    inline float valueOf(const fk::JIT_Operation_pp& op) {
+        float value;
+        std::memcpy(&value, op.getData(), sizeof(float));
+        return value;
+    }
+
+    inline std::vector<fk::JIT_Operation_pp> pipeline(void* input, void* output, const float value, const unsigned int width = 16) {
+        return { readOp(input, width), mulOp(value), writeOp(output, width) };
+    }
+} // namespace test_jit_deferred_execution
+
+int launch() {
+    using namespace test_jit_deferred_execution;
+    using fk::jit_internal::planVerticalFusion;
+    using Pipelines = std::vector<std::vector<fk::JIT_Operation_pp>>;
+
+    CHECK(fk::jit_internal::perThreadAccessArgs("fk::Read<fk::PerThreadRead<fk::_2D, fk::Vec<float, 3>>>", "PerThreadRead") ==
+                   "<fk::_2D, fk::Vec<float, 3>>");
+    CHECK(fk::jit_internal::perThreadAccessArgs("fk::Binary<fk::Mul<float>>", "PerThreadRead").empty());
+    CHECK(fk::jit_internal::isInspectable(readOp(x, 16)) && fk::jit_internal::isInspectable(mulOp(2.f)));
+    CHECK(!fk::jit_internal::isInspectable(imageOperandOp(x, 16)) && !fk::jit_internal::isInspectable(readBackOp(x, 16)));
+
+    // x -> y -> z: y is dropped and only read by the second pipeline, so both run as one kernel
+    const Pipelines chain{ pipeline(x, y, 2.f), pipeline(y, z, 3.f) };
+    const fk::JitFusionPlan fused = planVerticalFusion(chain, { y });
+    CHECK(fused.kernels() == 1 && fused.groups[0] == (std::vector<size_t>{ 0, 1 }));
+    const std::vector<fk::JIT_Operation_pp> merged = fk::jit_internal::fuseGroup(chain, fused.groups[0]);
+    CHECK(merged.size() == 4 && merged[0].getType() == chain[0][0].getType() && merged[3].getType() == chain[1][2].getType());
+    CHECK(fk::jit_internal::ptrOf(merged[0]) == x && fk::jit_internal::ptrOf(merged[3]) == z && merged[0].hasActiveThreads());
+    CHECK(valueOf(merged[1]) == 2.f && valueOf(merged[2]) == 3.f);
+
+    // Longer chains are fused into a single kernel, independent pipelines are not
+    CHECK(planVerticalFusion({ pipeline(x, y, 2.f), pipeline(y, z, 3.f), pipeline(z, w, 4.f) }, { y, z }).kernels() == 1);
+    CHECK(planVerticalFusion({ pipeline(x, y, 2.f), pipeline(z, w, 3.f) }, { y, z }).kernels() == 2);
+
+    // An intermediate image that is not dropped, or that is read again later, is still written
+    CHECK(planVerticalFusion(chain, {}).kernels() == 2);
+    const fk::JitFusionPlan reused = planVerticalFusion({ pipeline(x, y, 2.f), pipeline(y, z, 3.f), pipeline(y, w, 4.f) }, { y, z });
+    CHECK(reused.kernels() == 3);
+    // Also when the consumer itself reads it again after its first read
+    const Pipelines reread{ pipeline(x, y, 2.f), { readOp(y, 16), imageOperandOp(y, 16), writeOp(z, 16) } };
+    CHECK(planVerticalFusion(reread, { y }).kernels() == 2);
+    // Ops that can hold a Ptr where it can not be seen prevent the fusion, whatever image they read
+    const Pipelines otherOperand{ pipeline(x, y, 2.f), { readOp(y, 16), imageOperandOp(w, 16), writeOp(z, 16) } };
+    CHECK(planVerticalFusion(otherOperand, { y }).kernels() == 2);
+    const Pipelines laterReadBack{ pipeline(x, y, 2.f), pipeline(y, z, 3.f), { readOp(w, 16), readBackOp(y, 16), writeOp(x, 16) } };
+    CHECK(planVerticalFusion(laterReadBack, { y }).kernels() == 3);
+
+    // Different resolution, element type or grid: the second pipeline does not read what the first one wrote per thread
+    CHECK(planVerticalFusion({ pipeline(x, y, 2.f, 16), pipeline(y, z, 3.f, 8) }, { y }).kernels() == 2);
+    const Pipelines retyped{ { readOp(x, 16), mulOp(2.f), writeOp(y, 16, "uchar") }, { readOp(y, 16, "float"), mulOp(3.f), writeOp(z, 16) } };
+    CHECK(planVerticalFusion(retyped, { y }).kernels() == 2);
+    Pipelines regridded = chain;
+    regridded[0][0].setActiveThreads(8, 4, 1);
+    CHECK(planVerticalFusion(regridded, { y }).kernels() == 2);
+
+    // The queue records the pipelines and plans them without launching anything
+    fk::JitDeferredQueue queue;
+    queue.submit(pipeline(x, y, 2.f));
+    queue.submit(pipeline(y, z, 3.f));
+    queue.submit(pipeline(z, w, 4.f));
+    CHECK(queue.pending() == 3 && queue.plan().kernels() == 3);
+    queue.drop(y);
+    const Pipelines planned = queue.fusedPipelines();
+    CHECK(planned.size() == 2 && planned[0].size() == 4 && planned[1].size() == 3);
+    queue.drop(z);
+    CHECK(queue.plan().kernels() == 1 && queue.fusedPipelines()[0].size() == 5);
+    CHECK(fk::jit_internal::ptrOf(planned[0].back()) == z && queue.fusedLaunches() == 0);
+
+    std::cout << "SUCCESS: " << chain.size() << " recorded pipelines fused into " << fused.kernels() << " kernel" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_DEFERRED_EXECUTION
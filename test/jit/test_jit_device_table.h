@@ -0,0 +1,163 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_DEVICE_TABLE
+#define FK_TEST_JIT_DEVICE_TABLE
+
+// __ONLY_CPU__
+// Per device bookkeeping of the JIT cache, with a fake driver that enumerates four devices
+
+#include "main.h"
+#include <src/jit_device_table.h>
+#include <src/jit_kernel_key.h>
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace test_jit_device_table {
+    struct DriverCalls {
+        int retained{ 0 };
+        int released{ 0 };
+        int contextLookups{ 0 };
+    };
+
+    // The primary context of device i is 100 + i, and user created contexts are 200 + i.
+    // Streams are identified by the context they belong to.
+    struct FakeDeviceDriver {
+        using Context = int;
+        std::vector<int> archs{ 86, 86, 89, 86 };
+        std::shared_ptr<DriverCalls> calls = std::make_shared<DriverCalls>();
+        int current{ 0 };
+
+        int deviceCount() { return static_cast<int>(archs.size()); }
+        int deviceArch(const int ordinal) { return archs[ordinal]; }
+        Context retainPrimaryContext(const int ordinal) {
+            calls->retained++;
+            return 100 + ordinal;
+        }
+        void releasePrimaryContext(int) { calls->released++; }
+        int contextDevice(const Context context) {
+            calls->contextLookups++;
+            return context % 100 < deviceCount() ? context % 100 : -1;
+        }
+        Context streamContext(CUstream stream) { return static_cast<Context>(reinterpret_cast<uintptr_t>(stream)); }
+        Context currentContext() { return current; }
+    };
+
+    struct DeviceState {
+        int loadedKernels{ 0 };
+    };
+
+    inline CUstream streamOf(const int context) {
+        return reinterpret_cast<CUstream>(static_cast<uintptr_t>(context));
+    }
+
+    template <typename Function>
+    bool throws(Function&& function) {
+        try {
+            function();
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    }
+
+    struct SlotKey {};
+} // namespace test_jit_device_table
+
+int launch() {
+    using namespace test_jit_device_table;
+    std::shared_ptr<DriverCalls> calls;
+    {
+        fk::JitDeviceTable<DeviceState, FakeDeviceDriver> devices;
+        calls = devices.getDriver().calls;
+        CHECK(devices.size() == 4);
+        CHECK((devices.archs() == std::vector<int>{ 86, 89 }));
+        // Nothing is initialized until a device is used
+        CHECK(devices.retainedContexts() == 0);
+
+        // Devices with the same compute capability share the compiled kernels
+        const std::string nameExpression = "&genericKernel<Read, Mul, Write>";
+        CHECK(fk::jit_internal::compiledKernelKey(devices.device(0).arch, nameExpression) ==
+                      fk::jit_internal::compiledKernelKey(devices.device(3).arch, nameExpression));
+        CHECK(fk::jit_internal::compiledKernelKey(devices.device(0).arch, nameExpression) !=
+                      fk::jit_internal::compiledKernelKey(devices.device(2).arch, nameExpression));
+
+        // The device of a stream, found with the driver the first time only
+        CHECK(devices.streamDevice(streamOf(102)) == 2);
+        CHECK(devices.retainedContexts() == 1 && calls->retained == 1 && calls->contextLookups == 1);
+        CHECK(devices.streamDevice(streamOf(102)) == 2 && calls->contextLookups == 1);
+        CHECK(devices.context(2) == 102 && calls->retained == 1);
+        CHECK(devices.streamDevice(streamOf(103)) == 3 && devices.retainedContexts() == 2);
+
+        // Each device keeps its own state
+        devices.device(2).state.loadedKernels++;
+        devices.device(3).state.loadedKernels += 2;
+        CHECK(devices.device(0).state.loadedKernels == 0 && devices.device(2).state.loadedKernels == 1);
+
+        // Contexts that are not primary contexts, or not contexts at all, are rejected
+        CHECK(throws([&] { devices.streamDevice(streamOf(201)); }));
+        CHECK(throws([&] { devices.streamDevice(streamOf(0)); }));
+        CHECK(throws([&] { devices.device(4); }));
+        CHECK(devices.retainedContexts() == 3);
+
+        // The current device: device 0 without a current context
+        CHECK(devices.resolve(fk::JIT_CURRENT_DEVICE) == 0);
+        devices.getDriver().current = 103;
+        CHECK(devices.resolve(fk::JIT_CURRENT_DEVICE) == 3 && devices.resolve(1) == 1);
+    }
+    // Every retained primary context is released
+    CHECK(calls->released == 3);
+
+    // The launch slots of a kernel are separate for each device
+    using Slot = fk::JitKernelSlot<SlotKey>;
+    const auto* kernel0 = reinterpret_cast<const fk::JitFkKernel*>(0x10);
+    const auto* kernel1 = reinterpret_cast<const fk::JitFkKernel*>(0x20);
+    Slot::set(0, kernel0, 1);
+    Slot::set(1, kernel1, 1);
+    CHECK(Slot::get(0, 1) == kernel0 && Slot::get(1, 1) == kernel1 && Slot::get(2, 1) == nullptr);
+    CHECK(Slot::get(1, 2) == nullptr);
+    Slot::set(fk::JIT_MAX_SLOT_DEVICES, kernel0, 1);
+    CHECK(Slot::get(fk::JIT_MAX_SLOT_DEVICES, 1) == nullptr);
+    Slot::reset();
+    CHECK(Slot::get(0, 1) == nullptr);
+
+    // Threads with different compile profiles keep their kernels side by side
+    Slot::set(0, kernel0, 1, 10);
+    Slot::set(0, kernel1, 1, 20);
+    CHECK(Slot::get(0, 1, 10) == kernel0 && Slot::get(0, 1, 20) == kernel1);
+    CHECK(Slot::get(0, 1, 30) == nullptr && Slot::get(0, 1) == nullptr);
+    Slot::set(0, kernel1, 1, 10);
+    CHECK(Slot::get(0, 1, 10) == kernel1);
+    // A profile beyond JIT_SLOT_PROFILES replaces one of the others
+    for (uint64_t profile = 30; profile < 30 + fk::JIT_SLOT_PROFILES; ++profile) {
+        Slot::set(0, kernel0, 1, profile);
+    }
+    int resolvedProfiles = 0;
+    for (uint64_t profile : { 10, 20, 30, 31, 32, 33 }) {
+        resolvedProfiles += Slot::get(0, 1, profile) != nullptr ? 1 : 0;
+    }
+    CHECK(resolvedProfiles == fk::JIT_SLOT_PROFILES && Slot::get(0, 1, 33) == kernel0);
+    Slot::reset();
+    CHECK(Slot::get(0, 1, 33) == nullptr);
+
+    std::cout << "SUCCESS: 4 devices, 2 architectures" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_DEVICE_TABLE
@@ -0,0 +1,176 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_GRAPH
+#define FK_TEST_JIT_GRAPH
+
+// __ONLY_CPU__
+// Graph construction and parameter patching of JitGraph, with a fake driver instead of the CUDA graph API
+
+#include "main.h"
+#include <src/jit_graph.h>
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace test_jit_graph {
+    struct KernelArgs {
+        float* input;
+        float scale;
+    };
+
+    // What the fake driver received for a kernel node
+    struct NodeState {
+        CUfunction function;
+        int dependencies;
+        unsigned int gridX;
+        KernelArgs args;
+    };
+
+    // Every graph, node and exec is an index. Parameters are read like the driver does, through kernelParams.
+    struct FakeDriver {
+        using Graph = int;
+        using Node = int;
+        using Exec = int;
+        std::vector<NodeState> nodes;
+        int graphs{ 0 };
+        int destroyedGraphs{ 0 };
+        int destroyedExecs{ 0 };
+        int updates{ 0 };
+        std::vector<int> launches;
+
+        static NodeState toState(const CUDA_KERNEL_NODE_PARAMS& params, const int dependencies) {
+            KernelArgs args;
+            std::memcpy(&args, params.kernelParams[1], sizeof(KernelArgs));
+            return { params.func, dependencies, params.gridDimX, args };
+        }
+        Graph createGraph() {
+            nodes.clear();
+            return graphs++;
+        }
+        Node addKernelNode(Graph, const Node* dependencies, const size_t dependencyCount, const CUDA_KERNEL_NODE_PARAMS& params) {
+            nodes.push_back(toState(params, dependencyCount == 0 ? -1 : *dependencies));
+            return static_cast<int>(nodes.size()) - 1;
+        }
+        Exec instantiate(Graph graph) {
+            return graph;
+        }
+        void setKernelNodeParams(Exec, Node node, const CUDA_KERNEL_NODE_PARAMS& params) {
+            nodes[node] = toState(params, nodes[node].dependencies);
+            updates++;
+        }
+        void launch(Exec exec, CUstream) {
+            launches.push_back(exec);
+        }
+        void destroyExec(Exec) {
+            destroyedExecs++;
+        }
+        void destroyGraph(Graph) {
+            destroyedGraphs++;
+        }
+    };
+
+    // What the executor does for a launch while a graph is recording
+    inline void execute(CUfunction function, const unsigned int gridX, const KernelArgs& args) {
+        const int details = 0;
+        const fk::JitParamView params[] = { { &details, sizeof(details), alignof(int) },
+                                            { &args, sizeof(KernelArgs), alignof(KernelArgs) } };
+        fk::jit_internal::activeLaunchRecorder()->record(function, nullptr, { gridX, 1, 1 }, { 256, 1, 1 }, params, 2);
+    }
+} // namespace test_jit_graph
+
+int launch() {
+    using namespace test_jit_graph;
+    CUfunction scale = reinterpret_cast<CUfunction>(0x1000);
+    CUfunction add = reinterpret_cast<CUfunction>(0x2000);
+    float frames[2][64];
+
+    fk::JitGraph<FakeDriver> graph;
+    const FakeDriver& driver = graph.getDriver();
+    CHECK(fk::jit_internal::activeLaunchRecorder() == nullptr);
+    bool launchedBeforeRecord = false;
+    try {
+        graph.launch(static_cast<CUstream>(nullptr));
+    } catch (const std::runtime_error&) {
+        launchedBeforeRecord = true;
+    }
+    CHECK(launchedBeforeRecord);
+
+    // First recording: a chain of two kernel nodes, instantiated once
+    const auto frame = [&](float* input, const float factor) {
+        graph.record([&] {
+            execute(scale, 1, { input, factor });
+            execute(add, 1, { input, 1.f });
+        });
+    };
+    frame(frames[0], 2.f);
+    CHECK(fk::jit_internal::activeLaunchRecorder() == nullptr);
+    CHECK(graph.nodes() == 2 && graph.instantiations() == 1 && driver.nodes.size() == 2);
+    CHECK(driver.nodes[0].function == scale && driver.nodes[0].dependencies == -1);
+    CHECK(driver.nodes[1].function == add && driver.nodes[1].dependencies == 0);
+    CHECK(driver.nodes[0].args.input == frames[0] && driver.nodes[0].args.scale == 2.f);
+    graph.launch(static_cast<CUstream>(nullptr));
+    CHECK(driver.launches.size() == 1);
+
+    // Same sequence with new parameters: only the nodes that changed are patched
+    frame(frames[1], 2.f);
+    CHECK(graph.instantiations() == 1 && driver.updates == 2 && graph.patchedNodes() == 2);
+    CHECK(driver.nodes[0].args.input == frames[1] && driver.nodes[1].args.input == frames[1]);
+    frame(frames[1], 3.f);
+    CHECK(graph.instantiations() == 1 && driver.updates == 3 && driver.nodes[0].args.scale == 3.f);
+    frame(frames[1], 3.f);
+    CHECK(driver.updates == 3);
+
+    // The grid is patched too
+    graph.record([&] {
+        execute(scale, 4, { frames[1], 3.f });
+        execute(add, 1, { frames[1], 1.f });
+    });
+    CHECK(graph.instantiations() == 1 && driver.updates == 4 && driver.nodes[0].gridX == 4);
+
+    // Other kernels or another number of launches build a new graph
+    graph.record([&] {
+        execute(add, 1, { frames[0], 1.f });
+        execute(scale, 1, { frames[0], 2.f });
+    });
+    CHECK(graph.instantiations() == 2 && driver.destroyedExecs == 1 && driver.destroyedGraphs == 1);
+    CHECK(driver.nodes[0].function == add && driver.nodes[1].function == scale);
+    graph.record([&] {
+        execute(add, 1, { frames[0], 1.f });
+        execute(scale, 1, { frames[0], 2.f });
+        execute(scale, 1, { frames[0], 4.f });
+    });
+    CHECK(graph.instantiations() == 3 && graph.nodes() == 3 && driver.nodes[2].dependencies == 1);
+
+    // A failed recording leaves the graph as it was and stops recording
+    bool failed = false;
+    try {
+        graph.record([&] {
+            execute(scale, 1, { frames[0], 2.f });
+            throw std::runtime_error("pipeline error");
+        });
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    CHECK(failed && fk::jit_internal::activeLaunchRecorder() == nullptr && graph.nodes() == 3);
+    graph.launch(static_cast<CUstream>(nullptr));
+    CHECK(driver.launches.size() == 2 && driver.launches.back() == 2);
+
+    std::cout << "SUCCESS: " << graph.instantiations() << " instantiations and " << graph.patchedNodes() << " patched nodes" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_GRAPH
@@ -0,0 +1,120 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_HEADER_SET
+#define FK_TEST_JIT_HEADER_SET
+
+// __ONLY_CPU__
+// Minimal header sets of name expressions, and the headers passed to NVRTC
+
+#include "main.h"
+#include <src/jit_header_set.h>
+#include <src/jit_runtime_pipeline.h>
+#include <src/jit_batch_fusion.h>
+
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace test_jit_header_set {
+    const char* const ARITHMETIC = "fused_kernel/algorithms/basic_ops/arithmetic.h";
+    const char* const MEMORY = "fused_kernel/core/execution_model/memory_operations.h";
+    const char* const OPERATION_TYPES = "fused_kernel/core/execution_model/operation_model/operation_types.h";
+
+    const fk::jit_internal::JitHeaderSymbol SYMBOLS[] = {
+        { "launchTransformDPP_Kernel", "fused_kernel/core/execution_model/executor_kernels.h" },
+        { "Read", OPERATION_TYPES },
+        { "Write", OPERATION_TYPES },
+        { "Binary", OPERATION_TYPES },
+        { "PerThreadRead", MEMORY },
+        { "PerThreadWrite", MEMORY },
+        { "Mul", ARITHMETIC },
+        { "Add", ARITHMETIC },
+        // Specializations in other headers do not replace the primary template
+        { "Mul", "fused_kernel/algorithms/basic_ops/arithmetic_specializations.h" }
+    };
+
+    inline std::vector<fk::JIT_Operation_pp> typesOnly(const std::vector<std::string>& types) {
+        std::vector<fk::JIT_Operation_pp> pipeline;
+        for (const auto& type : types) {
+            pipeline.emplace_back(type, "", 0);
+        }
+        return pipeline;
+    }
+
+    inline bool contains(const std::vector<std::string>& values, const std::string& value) {
+        for (const auto& current : values) {
+            if (current == value) {
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace test_jit_header_set
+
+int launch() {
+    using namespace test_jit_header_set;
+    using fk::jit_internal::minimalHeaders;
+
+    const auto pipeline = typesOnly({ "fk::Read<fk::PerThreadRead<fk::_2D, float>>", "fk::Binary<fk::Mul<float>>",
+                                      "fk::Write<fk::PerThreadWrite<fk::_2D, float>>" });
+    const std::string runtimeExpression = fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipeline), pipeline);
+
+    // Only the fk:: templates, each once, and not the ones of the JIT prologues
+    const std::vector<std::string> templates = fk::jit_internal::qualifiedTemplates(runtimeExpression);
+    CHECK(contains(templates, "Read") && contains(templates, "PerThreadRead") && contains(templates, "Binary") &&
+                  contains(templates, "Mul") && contains(templates, "Write") && contains(templates, "PerThreadWrite"));
+    CHECK(!contains(templates, "RuntimeTransformDPPDetails") && !contains(templates, "_2D") && !contains(templates, "GPU_NVIDIA"));
+    CHECK(templates.size() == 6);
+    CHECK(fk::jit_internal::qualifiedTemplates("fk::Vec<int>, myfk::Add<int>, ::fk::Sub <int>, fk::Size") ==
+                  std::vector<std::string>({ "Vec", "Sub" }));
+
+    // Sorted headers without the core ones, which every program includes
+    const fk::jit_internal::JitHeaderIndex index(SYMBOLS, sizeof(SYMBOLS) / sizeof(SYMBOLS[0]));
+    const std::optional<std::vector<std::string>> headers = minimalHeaders({ runtimeExpression }, index);
+    CHECK(headers && *headers == std::vector<std::string>({ ARITHMETIC, MEMORY, OPERATION_TYPES }));
+
+    // A batch of kernels includes the union of their headers
+    const auto addPipeline = typesOnly({ "fk::Read<fk::PerThreadRead<fk::_2D, float>>", "fk::Binary<fk::Add<float>>",
+                                         "fk::Write<fk::PerThreadWrite<fk::_2D, float>>" });
+    const std::string batchedExpression = fk::jit_internal::batchedNameExpression(addPipeline, 4);
+    const std::optional<std::vector<std::string>> batchHeaders = minimalHeaders({ runtimeExpression, batchedExpression }, index);
+    CHECK(batchHeaders && *batchHeaders == *headers);
+
+    // Unknown templates, or no index, need the umbrella include
+    CHECK(!minimalHeaders({ runtimeExpression, "&fk::launchTransformDPP_Kernel<fk::Unary<fk::Cast<float, int>>>" }, index));
+    CHECK(!minimalHeaders({ runtimeExpression }, fk::jit_internal::JitHeaderIndex{}));
+
+    // Only errors about undeclared names are worth compiling again with the umbrella include
+    CHECK(fk::jit_internal::isMissingDeclarationError("kernel.cu(12): error: namespace \"fk\" has no member \"Saturate\""));
+    CHECK(fk::jit_internal::isMissingDeclarationError("kernel.cu(3): error: identifier \"Lut\" is undefined"));
+    CHECK(!fk::jit_internal::isMissingDeclarationError("kernel.cu(40): error: static assertion failed with \"Wrong type\""));
+
+    // Arrays for nvrtcCreateProgram
+    const fk::jit_internal::JitEmbeddedHeader embedded[] = { { "fused_kernel/a.h", "#pragma once" }, { "fused_kernel/b.h", "#include <fused_kernel/a.h>" } };
+    const fk::jit_internal::JitHeaderSet headerSet(embedded, 2);
+    CHECK(headerSet.count() == 2 && headerSet.names()[1] == embedded[1].name && headerSet.contents()[0] == embedded[0].content);
+    const fk::jit_internal::JitHeaderSet noHeaders;
+    CHECK(noHeaders.count() == 0 && noHeaders.names() == nullptr && noHeaders.contents() == nullptr);
+#if !defined(FK_JIT_EMBEDDED_HEADERS)
+    CHECK(fk::jit_internal::embeddedHeaderSet().count() == 0 && fk::jit_internal::embeddedHeaderIndex().empty());
+#endif
+
+    std::cout << "SUCCESS: " << headers->size() << " headers instead of the umbrella include, "
+              << fk::jit_internal::embeddedHeaderSet().count() << " embedded FKL headers" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_HEADER_SET
@@ -0,0 +1,125 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_KERNEL_BUNDLE
+#define FK_TEST_JIT_KERNEL_BUNDLE
+
+// __ONLY_CPU__
+// Pipeline manifests and the kernel bundle files written by jit_fkl_bundle
+
+#include "main.h"
+#include <src/jit_kernel_bundle.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace test_jit_kernel_bundle {
+    const char* const READ = "fk::Read<fk::PerThreadRead<fk::_2D, float>>";
+    const char* const MUL = "fk::Binary<fk::Mul<float>>";
+    const char* const WRITE = "fk::Write<fk::PerThreadWrite<fk::_2D, float>>";
+
+    inline std::vector<fk::JIT_Operation_pp> typesOnly(const std::vector<std::string>& types) {
+        std::vector<fk::JIT_Operation_pp> pipeline;
+        for (const auto& type : types) {
+            pipeline.emplace_back(type, "", 0);
+        }
+        return pipeline;
+    }
+
+    inline std::vector<char> bytes(const std::string& text) {
+        return std::vector<char>(text.begin(), text.end());
+    }
+
+    inline std::string imageText(const fk::JitKernelImage& image) {
+        return std::string(image.data(), image.size());
+    }
+} // namespace test_jit_kernel_bundle
+
+int launch() {
+    using namespace test_jit_kernel_bundle;
+    using fk::jit_internal::manifestNameExpression;
+
+    // Manifest lines: the op types of a runtime pipeline, a batched pipeline or a complete name expression
+    const auto pipeline = typesOnly({ READ, MUL, WRITE });
+    const std::string runtimeExpression = fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipeline), pipeline);
+    CHECK(manifestNameExpression(std::string(READ) + " ; " + MUL + ";" + WRITE + "\r") == runtimeExpression);
+    CHECK(manifestNameExpression(std::string("batch 16: ") + READ + ";" + MUL + ";" + WRITE) ==
+                 fk::jit_internal::batchedNameExpression(pipeline, 16));
+    CHECK(manifestNameExpression("  &fk::launchTransformDPP_Kernel<int>") == std::string("&fk::launchTransformDPP_Kernel<int>"));
+    CHECK(!manifestNameExpression("# cameras") && !manifestNameExpression("   "));
+    bool rejected = false;
+    try {
+        manifestNameExpression(READ);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    CHECK(rejected);
+
+    std::stringstream manifest;
+    manifest << "# Camera pipelines\n" << READ << ";" << MUL << ";" << WRITE << "\n\n"
+             << READ << "; " << MUL << "; " << WRITE << "\n" << "batch 4:" << READ << ";" << WRITE << "\n";
+    const std::vector<std::string> nameExpressions = fk::jit_internal::readBundleManifest(manifest);
+    CHECK(nameExpressions.size() == 2 && nameExpressions[0] == runtimeExpression);
+
+    // Kernels compiled in the same program share the image
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "fkl_test_jit_kernel_bundle.fkbundle";
+    fk::JitKernelBundleWriter writer;
+    const size_t batch = writer.addImage(fk::JitImageKind::CUBIN, bytes("cubin of two kernels"));
+    const size_t ptx = writer.addImage(fk::JitImageKind::PTX, bytes("ptx"));
+    writer.addKernel(30, "_Z7kernelA", batch);
+    writer.addKernel(10, "_Z7kernelB", batch);
+    writer.addKernel(20, "_Z7kernelC", ptx);
+    writer.addKernel(20, "_Z9duplicate", batch);
+    CHECK(writer.size() == 3);
+    writer.write(path);
+
+    std::shared_ptr<const fk::JitKernelBundle> bundle = fk::JitKernelBundle::open(path);
+    CHECK(bundle != nullptr && bundle->size() == 3);
+    const std::optional<fk::JitKernelImage> a = bundle->lookup(30);
+    const std::optional<fk::JitKernelImage> b = bundle->lookup(10);
+    const std::optional<fk::JitKernelImage> c = bundle->lookup(20);
+    CHECK(a && a->loweredName() == "_Z7kernelA" && a->kind() == fk::JitImageKind::CUBIN && a->isMapped());
+    CHECK(b && b->loweredName() == "_Z7kernelB" && b->data() == a->data() && imageText(*b) == "cubin of two kernels");
+    CHECK(c && c->loweredName() == "_Z7kernelC" && c->kind() == fk::JitImageKind::PTX && imageText(*c) == "ptx");
+    CHECK(!bundle->lookup(5) && !bundle->lookup(25) && !bundle->lookup(40));
+    bundle.reset();
+    // The images keep the mapping alive
+    CHECK(imageText(*a) == "cubin of two kernels");
+
+    // Corrupt images are not returned, and other files are not bundles
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(sizeof(fk::jit_internal::JitBundleHeader) + 3 * sizeof(fk::jit_internal::JitBundleEntry)));
+        file.put('X');
+    }
+    bundle = fk::JitKernelBundle::open(path);
+    CHECK(bundle != nullptr && !bundle->lookup(30) && bundle->lookup(20));
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << "not a bundle, but long enough to hold a header";
+    }
+    CHECK(fk::JitKernelBundle::open(path) == nullptr);
+    CHECK(fk::JitKernelBundle::open(path.string() + ".missing") == nullptr);
+    std::filesystem::remove(path);
+
+    std::cout << "SUCCESS: " << nameExpressions.size() << " manifest pipelines, bundle with 3 kernels in 2 images" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_KERNEL_BUNDLE
@@ -0,0 +1,124 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_KERNEL_PARAMS
+#define FK_TEST_JIT_KERNEL_PARAMS
+
+// __ONLY_CPU__
+// The packed parameter block must have the same layout as a struct with the same members
+
+#include <src/jit_kernel_params.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace test_kernel_params {
+    struct DetailsLike { unsigned int x, y, z; bool threadDivisible; };
+    struct CharOp { char c; };
+    struct alignas(16) VectorOp { float v[4]; };
+    struct DoubleOp { double d; int i; };
+    struct ShortOp { short s; };
+
+    // Same order as the kernel parameters
+    struct ExpectedLayout {
+        DetailsLike details;
+        CharOp charOp;
+        VectorOp vectorOp;
+        DoubleOp doubleOp;
+        ShortOp shortOp;
+    };
+
+    template <typename T>
+    fk::JIT_Operation_pp makeOp(const T& op) {
+        return fk::JIT_Operation_pp("", &op, sizeof(T), alignof(T));
+    }
+} // namespace test_kernel_params
+
+int launch() {
+    using namespace test_kernel_params;
+    ExpectedLayout expected;
+    memset(&expected, 0, sizeof(expected));
+    expected.details = { 64, 32, 1, true };
+    expected.charOp = { 'j' };
+    expected.vectorOp = { { 1.f, 2.f, 3.f, 4.f } };
+    expected.doubleOp = { 3.5, -7 };
+    expected.shortOp = { 42 };
+
+    const std::vector<fk::JIT_Operation_pp> pipeline{ makeOp(expected.charOp), makeOp(expected.vectorOp),
+                                                      makeOp(expected.doubleOp), makeOp(expected.shortOp) };
+    const fk::JitParamView details{ &expected.details, sizeof(DetailsLike), alignof(DetailsLike) };
+
+    // Offsets
+    const size_t expectedOffsets[] = { offsetof(ExpectedLayout, details), offsetof(ExpectedLayout, charOp),
+                                       offsetof(ExpectedLayout, vectorOp), offsetof(ExpectedLayout, doubleOp),
+                                       offsetof(ExpectedLayout, shortOp) };
+    bool offsetsMatch = true;
+    const size_t size = fk::jit_internal::layoutKernelParams(details, pipeline,
+        [&](size_t index, const fk::JitParamView&, size_t offset) { offsetsMatch &= expectedOffsets[index] == offset; });
+    if (!offsetsMatch || size != offsetof(ExpectedLayout, shortOp) + sizeof(ShortOp)) {
+        std::cout << "ERROR: parameter offsets do not match the struct layout" << std::endl;
+        return 1;
+    }
+
+    // Contents, including zeroed padding
+    fk::JitParamBuffer& buffer = fk::JitParamBuffer::threadLocal();
+    buffer.pack(details, pipeline);
+    if (buffer.size() != size || memcmp(buffer.data(), &expected, size) != 0) {
+        std::cout << "ERROR: packed parameters do not match the struct contents" << std::endl;
+        return 1;
+    }
+    if (reinterpret_cast<uintptr_t>(buffer.data()) % fk::JitParamBuffer::MAX_ALIGNMENT != 0) {
+        std::cout << "ERROR: parameter buffer is not aligned" << std::endl;
+        return 1;
+    }
+
+    // Launches reuse the same storage
+    const unsigned char* firstData = buffer.data();
+    buffer.pack(details, pipeline);
+    if (buffer.data() != firstData) {
+        std::cout << "ERROR: parameter buffer was reallocated" << std::endl;
+        return 1;
+    }
+
+    // Blocks bigger than the inline storage grow the heap buffer once
+    struct BigOp { unsigned char bytes[3000]; };
+    BigOp bigOp;
+    memset(bigOp.bytes, 7, sizeof(bigOp.bytes));
+    const std::vector<fk::JIT_Operation_pp> bigPipeline{ makeOp(bigOp), makeOp(bigOp) };
+    buffer.pack(details, bigPipeline);
+    const unsigned char* heapData = buffer.data();
+    buffer.pack(details, bigPipeline);
+    if (buffer.data() != heapData || buffer.size() != sizeof(DetailsLike) + 2 * sizeof(BigOp) ||
+        buffer.data()[buffer.size() - 1] != 7) {
+        std::cout << "ERROR: big parameter blocks are not handled correctly" << std::endl;
+        return 1;
+    }
+
+    // Operations without alignment information can not be packed
+    const std::vector<fk::JIT_Operation_pp> unknownAlignment{ fk::JIT_Operation_pp("", &expected.charOp, sizeof(CharOp)) };
+    try {
+        buffer.pack(details, unknownAlignment);
+        std::cout << "ERROR: operation without alignment was packed" << std::endl;
+        return 1;
+    } catch (const std::runtime_error&) {}
+
+    std::cout << "SUCCESS: packed " << size << " bytes of kernel parameters" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_KERNEL_PARAMS
@@ -0,0 +1,82 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_KERNEL_RESIDENCY
+#define FK_TEST_JIT_KERNEL_RESIDENCY
+
+// __ONLY_CPU__
+// Least recently launched eviction of JIT modules, with stub kernels instead of loaded modules
+
+#include "main.h"
+#include <src/jit_kernel_residency.h>
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace test_kernel_residency {
+    struct StubKernel {
+        uint64_t launch{ 0 };
+        uint64_t lastLaunch() const { return launch; }
+    };
+} // namespace test_kernel_residency
+
+int launch() {
+    using test_kernel_residency::StubKernel;
+    fk::JitResidencySet<StubKernel> residency;
+    // Module addresses only identify the modules
+    const int modules[4]{};
+    const auto kernelA = std::make_shared<StubKernel>(StubKernel{ 1 });
+    const auto kernelB = std::make_shared<StubKernel>(StubKernel{ 2 });
+    const auto kernelC = std::make_shared<StubKernel>(StubKernel{ 3 });
+    // Two kernels of the same batch share module 2
+    const auto kernelD = std::make_shared<StubKernel>(StubKernel{ 4 });
+    residency.add(&modules[0], 100, "a", kernelA);
+    residency.add(&modules[1], 200, "b", kernelB);
+    residency.add(&modules[2], 300, "c", kernelC);
+    residency.add(&modules[2], 300, "d", kernelD);
+    CHECK(residency.modules() == 3 && residency.codeBytes() == 600);
+
+    // Within the limits, nothing is evicted
+    CHECK(residency.evict(fk::JitCacheLimits{ 3, 600 }).empty());
+    CHECK(residency.evict(fk::JitCacheLimits{}).empty());
+
+    // A launch makes module 0 the most recently launched, so module 1 goes first
+    kernelA->launch = 10;
+    std::vector<fk::JitResidencySet<StubKernel>::Resident> evicted = residency.evict(fk::JitCacheLimits{ 2, 0 });
+    CHECK(evicted.size() == 1 && evicted[0].key == "b" && evicted[0].kernel == kernelB);
+    CHECK(residency.modules() == 2 && residency.codeBytes() == 400);
+
+    // The byte limit evicts both kernels of module 2, unless it is the one to keep
+    evicted = residency.evict(fk::JitCacheLimits{ 0, 150 }, &modules[2]);
+    CHECK(evicted.size() == 1 && evicted[0].key == "a");
+    CHECK(residency.modules() == 1 && residency.codeBytes() == 300);
+    // The kept module stays even over the limit
+    CHECK(residency.evict(fk::JitCacheLimits{ 0, 150 }, &modules[2]).empty());
+    evicted = residency.evict(fk::JitCacheLimits{ 0, 150 });
+    CHECK(evicted.size() == 2 && residency.modules() == 0 && residency.codeBytes() == 0);
+
+    CHECK(residency.evictedModules() == 3 && residency.evictedKernels() == 4);
+
+    const fk::JitKernelCacheStats stats{ 0, 0, 3, 4, 3, 1 };
+    CHECK(stats.hitRate() == 0.75);
+    CHECK(fk::JitKernelCacheStats{}.hitRate() == 0.0);
+
+    std::cout << "SUCCESS: least recently launched modules evicted within the limits" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_KERNEL_RESIDENCY
@@ -0,0 +1,133 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_KERNEL_VARIANT
+#define FK_TEST_JIT_KERNEL_VARIANT
+
+// __ONLY_CPU__
+// Selection of the scalar or vectorized kernel variant from the alignment and pitch of the Ptrs of a pipeline
+
+#include "main.h"
+#include <src/jit_kernel_variant.h>
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace test_jit_kernel_variant {
+    // Same members as the FKL RawPtr and PtrDims
+    struct Dims1D {
+        unsigned int width;
+        unsigned int pitch;
+    };
+    struct Dims2D {
+        unsigned int width;
+        unsigned int height;
+        unsigned int pitch;
+    };
+    struct Dims3D {
+        unsigned int width;
+        unsigned int height;
+        unsigned int planes;
+        unsigned int color_planes;
+        unsigned int pitch;
+        unsigned int plane_pitch;
+    };
+    template <typename Dims>
+    struct RawPtr {
+        float* data;
+        Dims dims;
+    };
+    template <typename Dims>
+    struct PtrOp {
+        RawPtr<Dims> params;
+    };
+    struct ScalarOp {
+        float params;
+    };
+    // Like the FKL batch operations, with one Ptr per plane
+    struct BatchPtrOp {
+        RawPtr<Dims2D> params[4];
+    };
+    struct BatchOperation {
+        static constexpr size_t BATCH = 4;
+    };
+    struct BatchOp {
+        using Operation = BatchOperation;
+        float* params;
+    };
+
+    inline float* at(const uintptr_t address) {
+        return reinterpret_cast<float*>(address);
+    }
+} // namespace test_jit_kernel_variant
+
+int launch() {
+    using namespace test_jit_kernel_variant;
+    using fk::jit_internal::accessBucketOf;
+    using fk::jit_internal::selectVariant;
+
+    CHECK(fk::jit_internal::powerOfTwoDivisor(0, 16) == 16 && fk::jit_internal::powerOfTwoDivisor(24, 16) == 8);
+    CHECK(fk::jit_internal::powerOfTwoDivisor(7, 16) == 1 && fk::jit_internal::powerOfTwoDivisor(4096, 16) == 16);
+    CHECK((fk::jit_internal::HasPtrParams<PtrOp<Dims2D>>::value && !fk::jit_internal::HasPtrParams<ScalarOp>::value));
+
+    // cudaMallocPitch like allocations: every row is aligned
+    const PtrOp<Dims2D> input{ { at(0x10000), { 1920, 1080, 2048 * 4 } } };
+    const PtrOp<Dims2D> output{ { at(0x80000), { 1920, 1080, 1920 * 4 } } };
+    const fk::JitAccessBucket aligned = accessBucketOf(input, ScalarOp{ 2.f }, output);
+    CHECK(aligned.alignment == 16 && aligned.pitchMultiple == 16);
+    CHECK(selectVariant(aligned, true).vectorized && !selectVariant(aligned, false).vectorized);
+
+    // A crop that starts at x = 1 is only aligned to the element size
+    const PtrOp<Dims2D> crop{ { at(0x10004), { 640, 480, 2048 * 4 } } };
+    const fk::JitAccessBucket cropped = accessBucketOf(crop, ScalarOp{ 2.f }, output);
+    CHECK(cropped.alignment == 4 && cropped.pitchMultiple == 16 && !selectVariant(cropped, true).vectorized);
+
+    // Rows of 3 floats: the second row is not aligned, even if the first one is
+    const PtrOp<Dims2D> packed{ { at(0x10000), { 3, 8, 3 * 4 } } };
+    const fk::JitAccessBucket packedBucket = accessBucketOf(packed, output);
+    CHECK(packedBucket.alignment == 16 && packedBucket.pitchMultiple == 4 && !selectVariant(packedBucket, true).vectorized);
+
+    // A single row, or a 1D Ptr, does not depend on the pitch
+    const PtrOp<Dims2D> row{ { at(0x10000), { 3, 1, 3 * 4 } } };
+    const PtrOp<Dims1D> linear{ { at(0x20000), { 3, 3 * 4 } } };
+    CHECK(selectVariant(accessBucketOf(row, linear), true).vectorized);
+
+    // Planes whose size is not a multiple of the vector access, even with aligned rows
+    const PtrOp<Dims3D> volume{ { at(0x10000), { 16, 3, 4, 1, 16 * 4, 16 * 4 * 3 + 8 } } };
+    const fk::JitAccessBucket volumeBucket = accessBucketOf(volume, output);
+    CHECK(volumeBucket.alignment == 16 && volumeBucket.pitchMultiple == 8 && !selectVariant(volumeBucket, true).vectorized);
+    const PtrOp<Dims3D> plane{ { at(0x10000), { 16, 3, 1, 1, 16 * 4, 16 * 4 * 3 + 8 } } };
+    CHECK(selectVariant(accessBucketOf(plane, output), true).vectorized);
+
+    // The Ptrs of batch operations are not inspected, so they only allow the scalar variant
+    BatchPtrOp batch;
+    for (auto& ptr : batch.params) {
+        ptr = input.params;
+    }
+    CHECK((fk::jit_internal::HasArrayParams<BatchPtrOp>::value && !fk::jit_internal::HasArrayParams<ScalarOp>::value));
+    CHECK(!selectVariant(accessBucketOf(batch, output), true).vectorized);
+    CHECK(fk::jit_internal::HasBatch<BatchOp>::value && !selectVariant(accessBucketOf(BatchOp{ at(0x10000) }), true).vectorized);
+
+    // Without Ptrs nothing prevents vector accesses, and the selection only depends on the bucket
+    CHECK(accessBucketOf(ScalarOp{ 1.f }) == fk::JitAccessBucket{});
+    const std::vector<fk::JitPtrLayout> layouts{ { 0x10000, 2048 * 4, 1080 }, { 0x10004, 2048 * 4, 480 } };
+    CHECK(fk::jit_internal::accessBucket(layouts) == cropped);
+    CHECK(accessBucketOf(crop, ScalarOp{ 2.f }, output) == cropped);
+
+    std::cout << "SUCCESS: aligned pipelines use the vectorized variant, crops and packed rows the scalar one" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_KERNEL_VARIANT
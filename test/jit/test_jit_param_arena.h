@@ -0,0 +1,133 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_PARAM_ARENA
+#define FK_TEST_JIT_PARAM_ARENA
+
+// __ONLY_CPU__
+// Operations spilled to the parameter arena, and the layout of the ones that stay kernel parameters
+
+#include "main.h"
+#include <src/jit_param_arena.h>
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace test_jit_param_arena {
+    struct ReadOp { const float* data; unsigned int width, height; };
+    struct LutOp { float table[512]; };
+    struct alignas(16) ScaleOp { float scale[4]; };
+    struct ChainOp { unsigned char bytes[1000]; };
+    struct WriteOp { float* data; unsigned int pitch; };
+
+    // JitInlineOps of (ReadOp, spilled LutOp, ScaleOp, WriteOp)
+    struct ExpectedInline {
+        ReadOp read;
+        ScaleOp scale;
+        WriteOp write;
+    };
+
+    template <typename T>
+    fk::JIT_Operation_pp makeOp(const std::string& type, const T& op) {
+        return fk::JIT_Operation_pp(type, &op, sizeof(T), alignof(T));
+    }
+
+    inline bool spillsAsPlanned(const std::vector<fk::JIT_Operation_pp>& pipeline, const fk::JitParamArenaPolicy& policy,
+                                fk::JitArenaPlan& plan) {
+        fk::jit_internal::planParamArena(pipeline, policy, plan);
+        const std::vector<fk::JitParamView>& params = fk::jit_internal::pipelineParamViews(pipeline);
+        return fk::jit_internal::spillsParams(params.data(), params.size(), policy) == plan.spills();
+    }
+} // namespace test_jit_param_arena
+
+int launch() {
+    using namespace test_jit_param_arena;
+    const fk::JitParamArenaPolicy policy;
+    fk::JitArenaPlan plan;
+
+    ExpectedInline expected;
+    memset(&expected, 0, sizeof(expected));
+    expected.read = { nullptr, 1920, 1080 };
+    expected.scale = { { 1.f, 0.5f, 0.25f, 2.f } };
+    expected.write = { nullptr, 7680 };
+    LutOp lut;
+    for (int i = 0; i < 512; ++i) {
+        lut.table[i] = static_cast<float>(i) / 511.f;
+    }
+
+    // Small operations stay kernel parameters
+    const std::vector<fk::JIT_Operation_pp> small{ makeOp("fk::Read<R>", expected.read), makeOp("fk::Binary<S>", expected.scale),
+                                                   makeOp("fk::Write<W>", expected.write) };
+    CHECK(spillsAsPlanned(small, policy, plan) && !plan.spills());
+
+    // A LUT bigger than spillBytes goes to the arena, the other operations are packed without it
+    const std::vector<fk::JIT_Operation_pp> withLut{ makeOp("fk::Read<R>", expected.read), makeOp("fk::Unary<L>", lut),
+                                                     makeOp("fk::Binary<S>", expected.scale), makeOp("fk::Write<W>", expected.write) };
+    CHECK(spillsAsPlanned(withLut, policy, plan) && plan.spilledOps == 1);
+    CHECK(!plan.spilled[0] && plan.spilled[1] && !plan.spilled[2] && !plan.spilled[3]);
+    CHECK(plan.offsets[0] == offsetof(ExpectedInline, read) && plan.offsets[1] == 0 &&
+                plan.offsets[2] == offsetof(ExpectedInline, scale) && plan.offsets[3] == offsetof(ExpectedInline, write));
+    CHECK(plan.arenaSize == sizeof(LutOp) && plan.inlineSize == sizeof(ExpectedInline) && plan.inlineAlignment == alignof(ExpectedInline));
+    CHECK(plan.kernelParamBytes() == 16 + sizeof(ExpectedInline));
+
+    fk::JitParamBuffer inlineOps;
+    fk::JitParamBuffer arena;
+    fk::jit_internal::packArenaParams(withLut, plan, inlineOps, arena);
+    CHECK(inlineOps.size() == sizeof(ExpectedInline) && memcmp(inlineOps.data(), &expected, sizeof(ExpectedInline)) == 0);
+    CHECK(arena.size() == sizeof(LutOp) && memcmp(arena.data(), &lut, sizeof(LutOp)) == 0);
+
+    // The kernel names the spilled operations with their offset, and has a signature of its own
+    const std::string nameExpression = fk::jit_internal::arenaNameExpression(withLut, plan);
+    CHECK(nameExpression == "&fk::jit_internal::launchArenaTransformDPP_Kernel<fk::jit_internal::RuntimeTransformDPPDetails<"
+                                  "fk::Read<R>, fk::Unary<L>, fk::Binary<S>, fk::Write<W>>, fk::Read<R>, "
+                                  "fk::jit_internal::JitSpilledOp<fk::Unary<L>, 0>, fk::Binary<S>, fk::Write<W>>");
+    const uint64_t signature = fk::jit_internal::arenaSignature(withLut, plan);
+    CHECK(signature != fk::jit_internal::pipelineSignature(withLut));
+
+    // Operations under spillBytes are spilled, biggest first, when they do not fit together
+    ChainOp chain;
+    memset(chain.bytes, 3, sizeof(chain.bytes));
+    std::vector<fk::JIT_Operation_pp> longChain{ makeOp("fk::Read<R>", expected.read) };
+    for (int i = 0; i < 5; ++i) {
+        longChain.push_back(makeOp("fk::Unary<C>", chain));
+    }
+    longChain.push_back(makeOp("fk::Write<W>", expected.write));
+    CHECK(spillsAsPlanned(longChain, policy, plan) && plan.spilledOps == 1 && plan.spilled[1]);
+    CHECK(plan.kernelParamBytes() <= policy.maxParamBytes && plan.arenaSize == sizeof(ChainOp));
+    fk::JitParamArenaPolicy tight = policy;
+    tight.maxParamBytes = 1024;
+    CHECK(spillsAsPlanned(longChain, tight, plan) && plan.spilledOps == 5 && !plan.spilled[0] && !plan.spilled[6]);
+    CHECK(plan.arenaSize == 5 * sizeof(ChainOp) && plan.offsets[5] == 4 * sizeof(ChainOp));
+    CHECK(fk::jit_internal::arenaSignature(longChain, plan) != signature);
+
+    // A spillBytes of 0 disables the arena
+    fk::JitParamArenaPolicy disabled = policy;
+    disabled.spillBytes = 0;
+    CHECK(spillsAsPlanned(withLut, disabled, plan) && !plan.spills());
+    CHECK(spillsAsPlanned(longChain, disabled, plan) && !plan.spills());
+
+    // The inline parameter is never empty
+    const std::vector<fk::JIT_Operation_pp> onlyLut{ makeOp("fk::Unary<L>", lut), makeOp("fk::Unary<L>", lut) };
+    CHECK(spillsAsPlanned(onlyLut, policy, plan) && plan.spilledOps == 2 && plan.inlineSize == 1 && plan.inlineAlignment == 1);
+    CHECK(plan.offsets[1] == sizeof(LutOp) && plan.arenaSize == 2 * sizeof(LutOp));
+
+    std::cout << "SUCCESS: " << sizeof(LutOp) << " byte LUT read from the arena, "
+              << sizeof(ExpectedInline) << " bytes of inline operations" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_PARAM_ARENA
@@ -0,0 +1,183 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_PIPELINE_OPTIMIZER
+#define FK_TEST_JIT_PIPELINE_OPTIMIZER
+
+// __ONLY_CPU__
+// Canonicalization, merging and removal of arithmetic operations of runtime pipelines
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor_cache.h>
+#include <src/jit_pipeline_optimizer.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace test_jit_pipeline_optimizer {
+    struct Ptr {
+        void* data;
+        unsigned int width;
+    };
+    struct Empty {};
+
+    const char* const READ = "fk::Read<fk::PerThreadRead<fk::_2D, float>>";
+    const char* const WRITE = "fk::Write<fk::PerThreadWrite<fk::_2D, float>>";
+
+    inline fk::JIT_Operation_pp ptrOp(const char* type) {
+        static float buffer[4];
+        const Ptr ptr{ buffer, 4 };
+        fk::JIT_Operation_pp op(type, &ptr, sizeof(ptr), alignof(Ptr));
+        op.setActiveThreads(4, 1, 1);
+        return op;
+    }
+
+    template <typename T>
+    fk::JIT_Operation_pp scalarOp(const std::string& kind, const std::string& type, const T value, const bool constant = false) {
+        fk::JIT_Operation_pp op("fk::Binary<fk::" + kind + "<" + type + ">>", &value, sizeof(T), alignof(T));
+        op.setConstant(constant);
+        return op;
+    }
+
+    inline fk::JIT_Operation_pp castOp(const std::string& from, const std::string& to) {
+        const Empty empty;
+        return fk::JIT_Operation_pp("fk::Unary<fk::Cast<" + from + ", " + to + ">>", &empty, sizeof(empty), alignof(Empty));
+    }
+
+    template <typename T>
+    T valueOf(const fk::JIT_Operation_pp& op) {
+        T value;
+        std::memcpy(&value, op.getData(), sizeof(T));
+        return value;
+    }
+
+    inline std::vector<fk::JIT_Operation_pp> wrap(std::vector<fk::JIT_Operation_pp> ops) {
+        ops.insert(ops.begin(), ptrOp(READ));
+        ops.push_back(ptrOp(WRITE));
+        return ops;
+    }
+
+    // Between the read and write operations of FKL, with the type names of buildOperation
+    inline std::vector<fk::JIT_Operation_pp> wrapFkl(std::vector<fk::JIT_Operation_pp> ops) {
+        // Nothing is launched, the pointers are not used
+        const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+        ops.insert(ops.begin(), fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(raw)));
+        ops.push_back(fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(raw)));
+        return ops;
+    }
+} // namespace test_jit_pipeline_optimizer
+
+int launch() {
+    using namespace test_jit_pipeline_optimizer;
+    const fk::JitOptimizerOptions exact;
+    fk::JitOptimizerOptions fastMath;
+    fastMath.reassociateFloatingPoint = true;
+
+    // Parsing of the op types
+    const auto mul = fk::jit_internal::findArithmeticOp("fk::Binary<fk::Mul<float, float, float>>");
+    CHECK(mul && mul->kind == fk::jit_internal::JitArithmeticKind::MUL && mul->args.size() == 3 && mul->args[1] == "float");
+    const auto cast = fk::jit_internal::findArithmeticOp("fk::Unary<fk::Cast<fk::Vec<float, 3>, unsigned int>>");
+    CHECK(cast && cast->args.size() == 2 && cast->args[0] == "fk::Vec<float, 3>" && cast->args[1] == "unsigned int");
+    CHECK(!fk::jit_internal::findArithmeticOp(READ) && !fk::jit_internal::findArithmeticOp("fk::Binary<fk::Multiply<float>>"));
+
+    // Sub becomes Add of the negation, so both pipelines compile the same kernel
+    fk::JitOptimizationReport report;
+    const auto subtracted = fk::optimizePipeline(wrap({ scalarOp("Sub", "float", 3.f) }), exact, &report);
+    const auto added = fk::optimizePipeline(wrap({ scalarOp("Add", "float", -3.f) }), exact);
+    CHECK(subtracted.size() == 3 && report.canonicalized == 1 && report.merged == 0 && report.removed == 0);
+    CHECK(subtracted[1].getType() == "fk::Binary<fk::Add<float>>" && valueOf<float>(subtracted[1]) == -3.f);
+    CHECK(subtracted[1].getType() == added[1].getType());
+    // Read and write operations are copied as they are
+    CHECK(subtracted[0].getType() == READ && subtracted[0].hasActiveThreads() && subtracted[2].getType() == WRITE);
+
+    // Floating point chains are only merged with reassociation, integer chains always
+    const auto floatChain = wrap({ scalarOp("Mul", "float", 2.f), scalarOp("Mul", "float", 4.f), scalarOp("Add", "float", 1.f),
+                                   scalarOp("Sub", "float", 0.5f) });
+    CHECK(fk::optimizePipeline(floatChain, exact).size() == 6);
+    report = {};
+    const auto mergedFloats = fk::optimizePipeline(floatChain, fastMath, &report);
+    CHECK(mergedFloats.size() == 4 && report.merged == 2 && report.canonicalized == 1);
+    CHECK(valueOf<float>(mergedFloats[1]) == 8.f && valueOf<float>(mergedFloats[2]) == 0.5f);
+    const auto mergedInts = fk::optimizePipeline(wrap({ scalarOp("Add", "int", 5), scalarOp("Sub", "int", 7) }), exact);
+    CHECK(mergedInts.size() == 3 && valueOf<int>(mergedInts[1]) == -2);
+    const auto mergedUnsigned = fk::optimizePipeline(wrap({ scalarOp("Add", "unsigned int", 5u), scalarOp("Sub", "unsigned int", 7u) }), exact);
+    CHECK(mergedUnsigned.size() == 3 && valueOf<unsigned int>(mergedUnsigned[1]) + 2u == 0u);
+    // Different types are not merged
+    CHECK(fk::optimizePipeline(wrap({ scalarOp("Add", "int", 5), scalarOp("Add", "float", 1.f) }), fastMath).size() == 4);
+    // Division only becomes a multiplication with reassociation
+    const auto divided = fk::optimizePipeline(wrap({ scalarOp("Div", "float", 4.f) }), fastMath);
+    CHECK(divided[1].getType() == "fk::Binary<fk::Mul<float>>" && valueOf<float>(divided[1]) == 0.25f);
+    CHECK(fk::optimizePipeline(wrap({ scalarOp("Div", "float", 4.f) }), exact)[1].getType() == "fk::Binary<fk::Div<float>>");
+
+    // Identities: only removed when the operation is constant, so the kernel does not depend on launch values
+    CHECK(fk::optimizePipeline(wrap({ scalarOp("Mul", "float", 1.f) }), exact).size() == 3);
+    report = {};
+    CHECK(fk::optimizePipeline(wrap({ scalarOp("Mul", "float", 1.f, true), scalarOp("Div", "int", 1, true) }), exact, &report).size() == 2);
+    CHECK(report.removed == 2);
+    // A merge of constants that cancels out is removed, a merge with a launch value is not constant
+    CHECK(fk::optimizePipeline(wrap({ scalarOp("Add", "int", 3, true), scalarOp("Sub", "int", 3, true) }), exact).size() == 2);
+    const auto mixed = fk::optimizePipeline(wrap({ scalarOp("Add", "int", 3, true), scalarOp("Add", "int", 4) }), exact);
+    CHECK(mixed.size() == 3 && !mixed[1].isConstant() && valueOf<int>(mixed[1]) == 7);
+    // Identities that convert the element type are kept, also when a merge cancels out
+    CHECK(fk::optimizePipeline(wrap({ scalarOp("Mul", "int, float, float", 1.f, true) }), exact).size() == 3);
+    const auto converted = fk::optimizePipeline(wrap({ scalarOp("Mul", "int, float, float", 2.f, true),
+                                                       scalarOp("Mul", "int, float, float", 0.5f, true) }), fastMath);
+    CHECK(converted.size() == 3 && converted[1].getType() == "fk::Binary<fk::Mul<int, float, float>>" && valueOf<float>(converted[1]) == 1.f);
+
+    // Casts to the same type are removed
+    report = {};
+    const auto casts = fk::optimizePipeline(wrap({ castOp("float", "float"), castOp("float", "int") }), exact, &report);
+    CHECK(casts.size() == 3 && casts[1].getType() == "fk::Unary<fk::Cast<float, int>>" && report.removed == 1);
+
+    // Vector parameters are not rewritten
+    const float vector3[3]{ 1.f, 1.f, 1.f };
+    fk::JIT_Operation_pp vectorMul("fk::Binary<fk::Mul<fk::Vec<float, 3>>>", vector3, sizeof(vector3), alignof(float));
+    vectorMul.setConstant(true);
+    report = {};
+    CHECK(fk::optimizePipeline(wrap({ vectorMul }), fastMath, &report).size() == 3 && !report.changed());
+
+    // The same rewrites on FKL operations: the rewritten types are the ones FKL gives to the result
+    using fk::jit_internal::buildOperation;
+    const std::string fklAdd = buildOperation(fk::Add<float>::build(1.f)).getType();
+    const std::string fklMul = buildOperation(fk::Mul<float>::build(1.f)).getType();
+    CHECK(fk::jit_internal::findArithmeticOp(fklMul) && !fk::jit_internal::findArithmeticOp(wrapFkl({})[0].getType()));
+    report = {};
+    const auto fklSubtracted = fk::optimizePipeline(wrapFkl({ buildOperation(fk::Sub<float>::build(3.f)) }), exact, &report);
+    CHECK(fklSubtracted.size() == 3 && report.canonicalized == 1);
+    CHECK(fklSubtracted[1].getType() == fklAdd && valueOf<float>(fklSubtracted[1]) == -3.f);
+    CHECK(fklSubtracted[0].getType() == wrapFkl({})[0].getType() && fklSubtracted[0].hasActiveThreads());
+    const auto fklMerged = fk::optimizePipeline(wrapFkl({ buildOperation(fk::Mul<float>::build(2.f)), buildOperation(fk::Mul<float>::build(4.f)),
+                                                          buildOperation(fk::Div<float>::build(2.f)) }), fastMath);
+    CHECK(fklMerged.size() == 3 && fklMerged[1].getType() == fklMul && valueOf<float>(fklMerged[1]) == 4.f);
+    CHECK(fk::optimizePipeline(wrapFkl({ buildOperation(fk::Mul<float>::build(2.f)), buildOperation(fk::Mul<float>::build(4.f)) }), exact)
+              .size() == 4);
+    const auto fklInts = fk::optimizePipeline(wrapFkl({ buildOperation(fk::Add<int>::build(5)), buildOperation(fk::Sub<int>::build(7)) }), exact);
+    CHECK(fklInts.size() == 3 && fklInts[1].getType() == buildOperation(fk::Add<int>::build(0)).getType() && valueOf<int>(fklInts[1]) == -2);
+    fk::JIT_Operation_pp fklIdentity = buildOperation(fk::Mul<float>::build(1.f));
+    fklIdentity.setConstant(true);
+    CHECK(fk::optimizePipeline(wrapFkl({ fklIdentity }), exact).size() == 2);
+    fk::JIT_Operation_pp fklConversion = buildOperation(fk::Mul<int, float, float>::build(1.f));
+    fklConversion.setConstant(true);
+    CHECK(fk::optimizePipeline(wrapFkl({ fklConversion }), exact).size() == 3);
+
+    std::cout << "SUCCESS: " << floatChain.size() << " operations optimized to " << mergedFloats.size() << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_PIPELINE_OPTIMIZER
@@ -0,0 +1,114 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_VALUE_SPECIALIZATION
+#define FK_TEST_JIT_VALUE_SPECIALIZATION
+
+// __ONLY_CPU__
+// Name expressions, cache keys and limits of the kernels specialized for constant operation values
+
+#include "main.h"
+#include <src/jit_value_specialization.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace test_jit_value_specialization {
+    struct ReadParams {
+        float* data;
+        unsigned int size;
+    };
+    struct Pixel {
+        unsigned char r, g, b, a, x, y;
+    };
+
+    inline std::vector<fk::JIT_Operation_pp> pipeline(const float mul, const float add, const bool constantMul, const bool constantAdd) {
+        static float buffer[16];
+        const ReadParams read{ buffer, 16 };
+        std::vector<fk::JIT_Operation_pp> ops;
+        ops.emplace_back("fk::Read<float>", &read, sizeof(read), alignof(ReadParams));
+        ops.emplace_back("fk::Binary<fk::Mul<float>>", &mul, sizeof(mul), alignof(float));
+        ops.emplace_back("fk::Binary<fk::Add<float>>", &add, sizeof(add), alignof(float));
+        ops.emplace_back("fk::Write<float>", &read, sizeof(read), alignof(ReadParams));
+        ops[1].setConstant(constantMul);
+        ops[2].setConstant(constantAdd);
+        return ops;
+    }
+} // namespace test_jit_value_specialization
+
+int launch() {
+    using namespace test_jit_value_specialization;
+
+    // The data is encoded as 32 bit words, the last one padded with zeros
+    const std::vector<fk::JIT_Operation_pp> a = pipeline(2.f, 1.f, true, false);
+    CHECK(fk::jit_internal::hasConstantOperations(a) && !fk::jit_internal::hasConstantOperations(pipeline(2.f, 1.f, false, false)));
+    CHECK(fk::jit_internal::constantOperationType(a[1]) == "fk::jit_internal::JitConstantOp<fk::Binary<fk::Mul<float>>, 0x40000000u>");
+    const Pixel pixel{ 1, 2, 3, 4, 5, 6 };
+    const fk::JIT_Operation_pp pixelOp("Pixel", &pixel, sizeof(pixel), 1);
+    CHECK(fk::jit_internal::constantOperationType(pixelOp) == "fk::jit_internal::JitConstantOp<Pixel, 0x04030201u, 0x00000605u>");
+
+    // Only the constant operations are replaced, and the details are the ones of the generic kernel
+    const std::string expression = fk::jit_internal::specializedNameExpression(a);
+    CHECK(expression ==
+        "&fk::jit_internal::launchSpecializedTransformDPP_Kernel<true, fk::jit_internal::RuntimeTransformDPPDetails<"
+        "fk::Read<float>, fk::Binary<fk::Mul<float>>, fk::Binary<fk::Add<float>>, fk::Write<float>>, "
+        "fk::Read<float>, fk::jit_internal::JitConstantOp<fk::Binary<fk::Mul<float>>, 0x40000000u>, fk::Binary<fk::Add<float>>, fk::Write<float>>");
+
+    // The key of a specialization depends on the constant values and which operations are constant,
+    // but not on the values passed at launch
+    const uint64_t signature = fk::jit_internal::pipelineSignature(a);
+    const uint64_t specialization = fk::jit_internal::specializedSignature(a);
+    CHECK(specialization != signature);
+    CHECK(specialization == fk::jit_internal::specializedSignature(pipeline(2.f, 5.f, true, false)));
+    CHECK(specialization != fk::jit_internal::specializedSignature(pipeline(3.f, 1.f, true, false)));
+    CHECK(specialization != fk::jit_internal::specializedSignature(pipeline(2.f, 1.f, true, true)));
+    CHECK(signature == fk::jit_internal::pipelineSignature(pipeline(3.f, 1.f, false, true)));
+
+    // Specialized entries only match pipelines with the same constants, generic entries match any values
+    fk::JitSignatureTable<int> table;
+    table.insert(signature, a, 1);
+    table.insert(specialization, a, 2, true);
+    CHECK(table.size() == 2);
+    CHECK(table.find(signature, pipeline(7.f, 7.f, true, false)) == 1);
+    CHECK(table.find(specialization, pipeline(2.f, 7.f, true, false), true) == 2);
+    // Same key as if the hashes collided: the values are compared
+    CHECK(!table.find(specialization, pipeline(3.f, 1.f, true, false), true));
+    CHECK(!table.find(specialization, pipeline(2.f, 1.f, true, true), true));
+    CHECK(!table.find(specialization, a));
+
+    // The budget bounds the value sets of each signature, and keeps accepting the ones admitted
+    fk::JitSpecializationBudget budget;
+    const uint64_t other = fk::jit_internal::specializedSignature(pipeline(3.f, 1.f, true, false));
+    const uint64_t third = fk::jit_internal::specializedSignature(pipeline(4.f, 1.f, true, false));
+    CHECK(budget.allows(signature, specialization, 2) && budget.admit(signature, specialization, 2));
+    CHECK(budget.admit(signature, specialization, 2) && budget.specializations(signature) == 1);
+    CHECK(budget.admit(signature, other, 2));
+    CHECK(!budget.allows(signature, third, 2) && !budget.admit(signature, third, 2));
+    CHECK(budget.allows(signature, other, 2) && budget.admit(signature, other, 2));
+    CHECK(budget.admit(signature + 1, third, 2) && budget.size() == 3);
+    // A limit of 0 disables specialization
+    CHECK(!budget.allows(signature, specialization, 0) && !budget.admit(signature, specialization, 0));
+    budget.clear();
+    CHECK(budget.size() == 0 && budget.specializations(signature) == 0);
+
+    // Copies keep the constant flag
+    const std::vector<fk::JIT_Operation_pp> copy = a;
+    CHECK(copy[1].isConstant() && !copy[2].isConstant());
+
+    std::cout << "SUCCESS: " << expression << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_VALUE_SPECIALIZATION
@@ -15,4 +15,15 @@
 
 #pragma once
 
-int launch();
\ No newline at end of file
+#include <iostream>
+
+int launch();
+
+// Fails the test, returning 1 from the enclosing function, when condition does not hold
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cout << "ERROR: " << #condition << " failed at line " << __LINE__ << std::endl; \
+            return 1; \
+        } \
+    } while (0)
@@ -0,0 +1,70 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_ARENA_COMPILE
+#define FK_TEST_JIT_ARENA_COMPILE
+
+// __ONLY_CPU__
+// Arena kernels of real FKL operations compiled by NVRTC. It only uses NVRTC, so it runs on hosts without a GPU
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int launch() {
+    const std::vector<int> nvrtcArchs = fk::jit_internal::nvrtcSupportedArchs();
+    CHECK(!nvrtcArchs.empty());
+    const fk::JitCompileTarget target = fk::JitCompileTarget::cubin(nvrtcArchs.front());
+
+    // Nothing is launched, the pointers are not used
+    const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+    const std::vector<fk::JIT_Operation_pp> pipeline{ fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(raw)),
+                                                      fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f)),
+                                                      fk::jit_internal::buildOperation(fk::Add<float>::build(5.f)),
+                                                      fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(raw)) };
+    const std::string& source = fk::jit_internal::jitKernelSource();
+    const std::vector<std::string> options = fk::jit_internal::defaultCompileOptions();
+
+    // The pointer operations go to the arena, the arithmetic ones stay in the inline parameter
+    fk::JitParamArenaPolicy mixed;
+    mixed.spillBytes = sizeof(float);
+    fk::JitArenaPlan plan;
+    fk::jit_internal::planParamArena(pipeline, mixed, plan);
+    CHECK(plan.spilled[0] && !plan.spilled[1] && !plan.spilled[2] && plan.spilled[3]);
+    const fk::JitKernelImage mixedImage =
+        fk::jit_internal::compileNameExpression(source, fk::jit_internal::arenaNameExpression(pipeline, plan), options, nullptr, target);
+    CHECK(mixedImage.size() > 4 && memcmp(mixedImage.data(), "\x7f" "ELF", 4) == 0);
+    CHECK(!mixedImage.loweredName().empty());
+
+    // Every operation spilled, with an empty inline parameter
+    fk::JitParamArenaPolicy all;
+    all.spillBytes = 1;
+    fk::jit_internal::planParamArena(pipeline, all, plan);
+    CHECK(plan.spilledOps == pipeline.size() && plan.inlineSize == 1);
+    const fk::JitKernelImage allImage =
+        fk::jit_internal::compileNameExpression(source, fk::jit_internal::arenaNameExpression(pipeline, plan), options, nullptr, target);
+    CHECK(allImage.size() > 4 && allImage.loweredName() != mixedImage.loweredName());
+
+    std::cout << "SUCCESS: arena kernels compiled for sm_" << nvrtcArchs.front() << " without a GPU" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_ARENA_COMPILE
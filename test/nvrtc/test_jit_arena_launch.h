@@ -0,0 +1,115 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_ARENA_LAUNCH
+#define FK_TEST_JIT_ARENA_LAUNCH
+
+// __ONLY_CPU__
+// A runtime pipeline launched with its operations in the parameter arena, compared with the inline launch
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace test_jit_arena_launch {
+    std::vector<fk::JIT_Operation_pp> assemblePipeline(fk::Ptr1D<float>& input, fk::Ptr1D<float>& output) {
+        return { fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(input)),
+                 fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f)),
+                 fk::jit_internal::buildOperation(fk::Add<float>::build(5.f)),
+                 fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(output)) };
+    }
+} // namespace test_jit_arena_launch
+
+int launch() {
+    constexpr uint N = 1000;
+    fk::Stream_<fk::ParArch::GPU_NVIDIA_JIT> stream;
+    fk::Ptr1D<float> input(N);
+    for (uint i = 0; i < N; ++i) {
+        input.at(fk::Point(i)) = static_cast<float>(i);
+    }
+    input.upload(stream);
+    fk::Ptr1D<float> inlineOutput(N);
+    fk::Ptr1D<float> mixedOutput(N);
+    fk::Ptr1D<float> spilledOutput(N);
+
+    using JITExecutor = fk::Executor<fk::TransformDPP<fk::ParArch::GPU_NVIDIA_JIT>>;
+    fk::JITExecutorCache& cache = fk::JITExecutorCache::getInstance();
+    const fk::JitParamArenaPolicy policy = cache.getParamArenaPolicy();
+
+    fk::JitParamArenaPolicy inlinePolicy;
+    inlinePolicy.spillBytes = 0;
+    cache.setParamArenaPolicy(inlinePolicy);
+    JITExecutor::executeOperations(stream, test_jit_arena_launch::assemblePipeline(input, inlineOutput));
+
+    // The pointer operations are read from the arena, the arithmetic ones are kernel parameters
+    fk::JitParamArenaPolicy mixedPolicy;
+    mixedPolicy.spillBytes = sizeof(float);
+    const std::vector<fk::JIT_Operation_pp> mixed = test_jit_arena_launch::assemblePipeline(input, mixedOutput);
+    fk::JitArenaPlan plan;
+    fk::jit_internal::planParamArena(mixed, mixedPolicy, plan);
+    CHECK(plan.spills() && plan.spilledOps < mixed.size());
+    cache.setParamArenaPolicy(mixedPolicy);
+    JITExecutor::executeOperations(stream, mixed);
+
+    fk::JitParamArenaPolicy spillAll;
+    spillAll.spillBytes = 1;
+    cache.setParamArenaPolicy(spillAll);
+    JITExecutor::executeOperations(stream, test_jit_arena_launch::assemblePipeline(input, spilledOutput));
+
+    // executeOperationsAsync calls the fallback while the arena kernel compiles, instead of blocking
+    fk::Ptr1D<float> asyncOutput(N);
+    const auto asyncRead = fk::PerThreadRead<fk::_1D, float>::build(input);
+    const auto asyncSub = fk::Sub<float>::build(1.f);
+    const auto asyncWrite = fk::PerThreadWrite<fk::_1D, float>::build(asyncOutput);
+    int fallbacks = 0;
+    bool launched = false;
+    for (int attempt = 0; attempt < 6000 && !launched; ++attempt) {
+        launched = true;
+        JITExecutor::executeOperationsAsync(stream, [&] { fallbacks++; launched = false; }, asyncRead, asyncSub, asyncWrite);
+        if (!launched) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    CHECK(launched);
+    cache.setParamArenaPolicy(policy);
+
+    inlineOutput.download(stream);
+    mixedOutput.download(stream);
+    spilledOutput.download(stream);
+    asyncOutput.download(stream);
+    stream.sync();
+
+    for (uint i = 0; i < N; ++i) {
+        const float expected = i * 2.f + 5.f;
+        const float inlineValue = inlineOutput.at(fk::Point(i));
+        CHECK(std::abs(inlineValue - expected) < 0.001f);
+        CHECK(mixedOutput.at(fk::Point(i)) == inlineValue && spilledOutput.at(fk::Point(i)) == inlineValue);
+        CHECK(asyncOutput.at(fk::Point(i)) == static_cast<float>(i) - 1.f);
+    }
+
+    std::cout << "SUCCESS: " << plan.spilledOps << " and " << mixed.size()
+              << " operations read from the arena give the results of the inline launch, and the async launch ran "
+              << fallbacks << " fallbacks while compiling" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_ARENA_LAUNCH
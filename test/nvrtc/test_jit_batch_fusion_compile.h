@@ -0,0 +1,59 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_BATCH_FUSION_COMPILE
+#define FK_TEST_JIT_BATCH_FUSION_COMPILE
+
+// __ONLY_CPU__
+// Batched kernels of real FKL operations compiled by NVRTC. It only uses NVRTC, so it runs on hosts without a GPU
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int launch() {
+    const std::vector<int> nvrtcArchs = fk::jit_internal::nvrtcSupportedArchs();
+    CHECK(!nvrtcArchs.empty());
+    const fk::JitCompileTarget target = fk::JitCompileTarget::cubin(nvrtcArchs.front());
+
+    // Nothing is launched, the pointers are not used
+    const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+    const std::vector<fk::JIT_Operation_pp> pipeline{ fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(raw)),
+                                                      fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f)),
+                                                      fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(raw)) };
+    CHECK(fk::jit_internal::isBatchable(pipeline));
+    const std::string& source = fk::jit_internal::jitKernelSource();
+    const std::vector<std::string> options = fk::jit_internal::defaultCompileOptions();
+
+    // A batch of two planes and the largest one of the policy, in one program
+    const std::vector<std::string> nameExpressions{ fk::jit_internal::batchedNameExpression(pipeline, 2),
+                                                    fk::jit_internal::batchedNameExpression(pipeline, fk::JitBatchPolicy{}.maxPlanes) };
+    const fk::jit_internal::JitBatchImage batch =
+        fk::jit_internal::compileNameExpressions(source, nameExpressions, options, nullptr, target);
+    CHECK(batch.kind == fk::JitImageKind::CUBIN && batch.loweredNames.size() == nameExpressions.size());
+    CHECK(!batch.loweredNames[0].empty() && batch.loweredNames[0] != batch.loweredNames[1]);
+    CHECK(batch.image.size() > 4 && memcmp(batch.image.data(), "\x7f" "ELF", 4) == 0);
+
+    std::cout << "SUCCESS: batched kernels compiled for sm_" << nvrtcArchs.front() << " without a GPU" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_BATCH_FUSION_COMPILE
@@ -0,0 +1,88 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_BATCH_FUSION_LAUNCH
+#define FK_TEST_JIT_BATCH_FUSION_LAUNCH
+
+// __ONLY_CPU__
+// Pipelines of several sizes launched as the planes of one batched kernel
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace test_jit_batch_fusion_launch {
+    std::vector<fk::JIT_Operation_pp> camera(fk::Ptr1D<float>& input, fk::Ptr1D<float>& output, const float gain) {
+        return { fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(input)),
+                 fk::jit_internal::buildOperation(fk::Mul<float>::build(gain)),
+                 fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(output)) };
+    }
+} // namespace test_jit_batch_fusion_launch
+
+int launch() {
+    // The planes are smaller and larger than the block, and the grid is the one of the largest
+    const std::vector<uint> sizes{ 1000, 17, 256, 1, 4099, 640 };
+    constexpr float OUTPUT_CANARY = -1.f;
+    fk::Stream_<fk::ParArch::GPU_NVIDIA_JIT> stream;
+    std::vector<fk::Ptr1D<float>> inputs;
+    std::vector<fk::Ptr1D<float>> outputs;
+    for (size_t plane = 0; plane < sizes.size(); ++plane) {
+        inputs.emplace_back(sizes[plane]);
+        outputs.emplace_back(sizes[plane]);
+        for (uint i = 0; i < sizes[plane]; ++i) {
+            inputs[plane].at(fk::Point(i)) = static_cast<float>(i);
+            outputs[plane].at(fk::Point(i)) = OUTPUT_CANARY;
+        }
+        inputs[plane].upload(stream);
+        outputs[plane].upload(stream);
+    }
+    std::vector<std::vector<fk::JIT_Operation_pp>> pipelines;
+    for (size_t plane = 0; plane < sizes.size(); ++plane) {
+        pipelines.push_back(test_jit_batch_fusion_launch::camera(inputs[plane], outputs[plane], static_cast<float>(plane + 1)));
+    }
+
+    fk::JITExecutorCache& cache = fk::JITExecutorCache::getInstance();
+    const fk::JitBatchPlan plan = fk::jit_internal::planBatches(pipelines, cache.getBatchPolicy());
+    CHECK(plan.kernels() == 1 && plan.launches[0].size() == sizes.size());
+
+    using JITExecutor = fk::Executor<fk::TransformDPP<fk::ParArch::GPU_NVIDIA_JIT>>;
+    JITExecutor::executeOperationsBatch(stream, pipelines);
+    for (auto& output : outputs) {
+        output.download(stream);
+    }
+    stream.sync();
+
+    // Every element of every plane has the gain of its plane. One that no thread wrote keeps the canary.
+    for (size_t plane = 0; plane < sizes.size(); ++plane) {
+        for (uint i = 0; i < sizes[plane]; ++i) {
+            const float expected = i * static_cast<float>(plane + 1);
+            if (std::abs(outputs[plane].at(fk::Point(i)) - expected) > 0.001f) {
+                std::cout << "ERROR: plane " << plane << " has " << outputs[plane].at(fk::Point(i)) << " at " << i
+                          << ", expected " << expected << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    std::cout << "SUCCESS: " << sizes.size() << " pipelines of different sizes launched as one batched kernel" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_BATCH_FUSION_LAUNCH
@@ -0,0 +1,86 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_BATCHED_COMPILE
+#define FK_TEST_JIT_BATCHED_COMPILE
+
+// __ONLY_CPU__
+
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <iostream>
+#include <set>
+#include <vector>
+
+int launch() {
+    // Nothing is launched, the pointers are not used
+    const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+    const auto read_op = fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(raw));
+    const auto write_op = fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(raw));
+    const auto mul_op = fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f));
+    const auto add_op = fk::jit_internal::buildOperation(fk::Add<float>::build(5.f));
+
+    const std::vector<std::vector<fk::JIT_Operation_pp>> pipelines{ { read_op, mul_op, write_op },
+                                                                    { read_op, add_op, write_op },
+                                                                    { read_op, mul_op, add_op, write_op } };
+    std::vector<fk::JITExecutorCache::PendingKernel> pending;
+    for (const auto& pipeline : pipelines) {
+        pending.push_back({ fk::jit_internal::runtimeKernelName(pipeline), pipeline });
+    }
+    // The same pipeline twice in a batch is compiled once
+    pending.push_back(pending.front());
+
+    // Only the batch goes through NVRTC
+    auto& executorCache = fk::JITExecutorCache::getInstance();
+    executorCache.getDiskCache().clear();
+    const std::vector<CUfunction> functions = executorCache.addKernels(pending);
+    if (functions.size() != pending.size() || functions.front() != functions.back()) {
+        std::cout << "ERROR: wrong functions returned by addKernels" << std::endl;
+        return 1;
+    }
+    const std::set<CUfunction> distinct(functions.begin(), functions.end());
+    if (distinct.size() != pipelines.size() || distinct.count(nullptr) != 0) {
+        std::cout << "ERROR: expected " << pipelines.size() << " different kernels" << std::endl;
+        return 1;
+    }
+
+    // All the kernels live in the same module
+    std::set<CUmodule> modules;
+    for (const auto& kernel : pending) {
+        const auto cached = executorCache.getKernelCache().find(fk::jit_internal::buildNameExpression(kernel.kernelName, kernel.pipeline));
+        if (!cached) {
+            std::cout << "ERROR: batched kernel not found in the cache" << std::endl;
+            return 1;
+        }
+        modules.insert((*cached)->getModule()->get());
+    }
+    if (modules.size() != 1) {
+        std::cout << "ERROR: batched kernels were loaded in " << modules.size() << " modules" << std::endl;
+        return 1;
+    }
+
+    // A second batch only hits the cache
+    if (executorCache.addKernels(pending) != functions) {
+        std::cout << "ERROR: cached kernels changed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: " << pipelines.size() << " kernels compiled in a single NVRTC program" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_BATCHED_COMPILE
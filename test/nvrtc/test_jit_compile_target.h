@@ -0,0 +1,90 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_COMPILE_TARGET
+#define FK_TEST_JIT_COMPILE_TARGET
+
+// __ONLY_CPU__
+// CUBIN and PTX generation for explicit architectures. It only uses NVRTC, so it runs on hosts without a GPU
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int launch() {
+    // Target selection
+    const std::vector<int> supported{ 75, 80, 86, 89, 90 };
+    const fk::JitArchConfig singleArch;
+    CHECK(singleArch.targets(86, supported) == std::vector<fk::JitCompileTarget>{ fk::JitCompileTarget::cubin(86) });
+    const fk::JitArchConfig multiArch{ { 75, 86, 90 }, true };
+    const std::vector<fk::JitCompileTarget> fleetTargets = multiArch.targets(86, supported);
+    CHECK((fleetTargets == std::vector<fk::JitCompileTarget>{ fk::JitCompileTarget::cubin(86), fk::JitCompileTarget::cubin(75),
+                                                                     fk::JitCompileTarget::cubin(90), fk::JitCompileTarget::ptx(75) }));
+    // A device newer than NVRTC gets PTX of the highest supported architecture
+    CHECK(singleArch.targets(100, supported) == std::vector<fk::JitCompileTarget>{ fk::JitCompileTarget::ptx(90) });
+    CHECK(fk::JitCompileTarget::cubin(80).canRunOn(86) && !fk::JitCompileTarget::cubin(86).canRunOn(80));
+    CHECK(!fk::JitCompileTarget::cubin(86).canRunOn(90) && fk::JitCompileTarget::ptx(75).canRunOn(90));
+    CHECK(fk::jit_internal::parseArchList("75;sm_86") == (std::vector<int>{ 75, 86 }));
+
+    // Compilation for the lowest architecture supported by this NVRTC
+    const std::vector<int> nvrtcArchs = fk::jit_internal::nvrtcSupportedArchs();
+    CHECK(!nvrtcArchs.empty());
+    const int arch = nvrtcArchs.front();
+
+    const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+    const std::vector<fk::JIT_Operation_pp> pipeline{ fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(raw)),
+                                                      fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f)),
+                                                      fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(raw)) };
+    const std::string nameExpression = fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipeline), pipeline);
+    const std::string& source = fk::jit_internal::jitKernelSource();
+    const std::vector<std::string> options = fk::jit_internal::defaultCompileOptions();
+
+    const fk::JitKernelImage cubin =
+        fk::jit_internal::compileNameExpression(source, nameExpression, options, nullptr, fk::JitCompileTarget::cubin(arch));
+    CHECK(cubin.kind() == fk::JitImageKind::CUBIN);
+    CHECK(cubin.size() > 4 && memcmp(cubin.data(), "\x7f" "ELF", 4) == 0);
+
+    const fk::JitKernelImage ptx =
+        fk::jit_internal::compileNameExpression(source, nameExpression, options, nullptr, fk::JitCompileTarget::ptx(arch));
+    CHECK(ptx.kind() == fk::JitImageKind::PTX);
+    CHECK(std::string(ptx.data(), ptx.size()).find(".target sm_" + std::to_string(arch)) != std::string::npos);
+    CHECK(ptx.loweredName() == cubin.loweredName());
+
+    // Every target is a different disk cache entry
+    const uint64_t cubinKey = fk::jit_internal::makeDiskCacheKey(source, nameExpression, options, fk::JitCompileTarget::cubin(arch)).hash();
+    const uint64_t ptxKey = fk::jit_internal::makeDiskCacheKey(source, nameExpression, options, fk::JitCompileTarget::ptx(arch)).hash();
+    CHECK(cubinKey != ptxKey);
+
+    // The scalar and vectorized variants of a typed pipeline, compiled together
+    using JITExecutor = fk::Executor<fk::TransformDPP<fk::ParArch::GPU_NVIDIA_JIT, fk::TF::ENABLED>>;
+    const std::vector<std::string> variants = JITExecutor::variantNameExpressions(fk::PerThreadRead<fk::_1D, float>::build(raw),
+                                                                                  fk::Mul<float>::build(2.f),
+                                                                                  fk::PerThreadWrite<fk::_1D, float>::build(raw));
+    CHECK(variants.size() == 3);
+    const fk::jit_internal::JitBatchImage variantBatch =
+        fk::jit_internal::compileNameExpressions(source, variants, options, nullptr, fk::JitCompileTarget::cubin(arch));
+    CHECK(variantBatch.loweredNames.size() == variants.size() && variantBatch.kind == fk::JitImageKind::CUBIN);
+
+    std::cout << "SUCCESS: compiled " << cubin.size() << " bytes of sm_" << arch << " CUBIN without a GPU" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_COMPILE_TARGET
@@ -0,0 +1,117 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_DISK_CACHE
+#define FK_TEST_JIT_DISK_CACHE
+
+// __ONLY_CPU__
+// This test only uses NVRTC, so it runs on hosts without a GPU
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <fused_kernel/core/utils/type_to_string.h>
+#include <src/jit_operation_executor_cache.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int launch() {
+    // No device memory is needed, only the types of the operations
+    const fk::RawPtr<fk::_1D, float> rawIn{ nullptr, { 256, 256 * sizeof(float) } };
+    const fk::RawPtr<fk::_1D, float> rawOut{ nullptr, { 256, 256 * sizeof(float) } };
+    const auto read_op = fk::PerThreadRead<fk::_1D, float>::build(rawIn);
+    const auto mul_op = fk::Mul<float>::build(2.f);
+    const auto add_op = fk::Add<float>::build(5.f);
+    const auto write_op = fk::PerThreadWrite<fk::_1D, float>::build(rawOut);
+
+    const auto tDetails = fk::TransformDPP<fk::ParArch::GPU_NVIDIA, fk::TF::DISABLED>::build_details(read_op, mul_op, add_op, write_op);
+    using TDPPDetails = std::decay_t<decltype(tDetails)>;
+    const std::string kernelName = "launchTransformDPP_Kernel<ParArch::GPU_NVIDIA, TF::DISABLED, true, " +
+                                   fk::typeToString<TDPPDetails>() + ", ";
+    const auto pipeline = fk::jit_internal::buildOperationPipeline(read_op, mul_op, add_op, write_op);
+    const std::string nameExpression = fk::jit_internal::buildNameExpression(kernelName, pipeline);
+    const std::string source = R"(
+        #include <fused_kernel/core/execution_model/executor_kernels.h>
+        #include <fused_kernel/algorithms/algorithms.h>
+        #include <fused_kernel/core/execution_model/data_parallel_patterns.h>
+    )";
+    const std::vector<std::string> options = fk::jit_internal::defaultCompileOptions();
+
+    const std::filesystem::path cacheDir = std::filesystem::temp_directory_path() / "fkl_jit_disk_cache_test";
+    fk::JITDiskCache diskCache(cacheDir);
+    diskCache.clear();
+
+    // First request: miss, compile and store
+    std::string ptx;
+    std::string loweredName;
+    {
+        const fk::JitKernelImage image = fk::jit_internal::getKernelImage(diskCache, source, nameExpression, options);
+        CHECK(!image.isMapped());
+        CHECK(image.kind() == fk::JitImageKind::PTX);
+        ptx = std::string(image.data(), image.size());
+        loweredName = image.loweredName();
+        CHECK(ptx.find(".entry " + loweredName) != std::string::npos);
+        CHECK(diskCache.misses() == 1 && diskCache.hits() == 0 && diskCache.stores() == 1);
+    }
+
+    // Second request: hit, served from the memory mapped entry
+    const uint64_t key = fk::jit_internal::makeDiskCacheKey(source, nameExpression, options).hash();
+    {
+        const fk::JitKernelImage image = fk::jit_internal::getKernelImage(diskCache, source, nameExpression, options);
+        CHECK(image.isMapped());
+        CHECK(std::string(image.data(), image.size()) == ptx);
+        CHECK(image.loweredName() == loweredName);
+        CHECK(diskCache.misses() == 1 && diskCache.hits() == 1 && diskCache.stores() == 1);
+    }
+
+    // Different compile options produce a different key
+    std::vector<std::string> otherOptions = options;
+    otherOptions.push_back("-DFK_JIT_DISK_CACHE_TEST");
+    CHECK(fk::jit_internal::makeDiskCacheKey(source, nameExpression, otherOptions).hash() != key);
+
+    // Corrupt entry: rejected, removed and compiled again
+    {
+        std::fstream entry(diskCache.entryPath(key), std::ios::in | std::ios::out | std::ios::binary);
+        entry.seekp(-2, std::ios::end);
+        entry.put('#');
+    }
+    CHECK(!diskCache.lookup(key).has_value());
+    CHECK(diskCache.rejected() == 1);
+    CHECK(!std::filesystem::exists(diskCache.entryPath(key)));
+    {
+        const fk::JitKernelImage image = fk::jit_internal::getKernelImage(diskCache, source, nameExpression, options);
+        CHECK(!image.isMapped());
+        CHECK(std::string(image.data(), image.size()) == ptx);
+        CHECK(diskCache.stores() == 2);
+    }
+
+    // Invalidation
+    diskCache.invalidate(key);
+    CHECK(diskCache.invalidations() == 1);
+    CHECK(!diskCache.lookup(key).has_value());
+
+    diskCache.clear();
+    std::cout << "SUCCESS: disk cache hits " << diskCache.hits() << ", misses " << diskCache.misses()
+              << ", stores " << diskCache.stores() << ", rejected " << diskCache.rejected() << std::endl;
+    return 0;
+}
+
+#undef CHECK_DISK_CACHE
+
+#endif // FK_TEST_JIT_DISK_CACHE
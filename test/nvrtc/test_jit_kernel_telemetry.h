@@ -0,0 +1,104 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_KERNEL_TELEMETRY
+#define FK_TEST_JIT_KERNEL_TELEMETRY
+
+// __ONLY_CPU__
+// Compile side telemetry of the JIT kernels. It only uses NVRTC, so it runs on hosts without a GPU
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor_cache.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+int launch() {
+    // ptxas -v log of a program with two kernels
+    const std::string log =
+        "ptxas info    : 0 bytes gmem\n"
+        "ptxas info    : Compiling entry function '_Z1av' for 'sm_86'\n"
+        "ptxas info    : Function properties for _Z1av\n"
+        "    0 bytes stack frame, 0 bytes spill stores, 0 bytes spill loads\n"
+        "ptxas info    : Used 12 registers, 360 bytes cmem[0]\n"
+        "ptxas info    : Compiling entry function '_Z1bv' for 'sm_86'\n"
+        "ptxas info    : Function properties for _Z1bv\n"
+        "    40 bytes stack frame, 16 bytes spill stores, 8 bytes spill loads\n"
+        "ptxas info    : Used 255 registers, 1024 bytes smem, 360 bytes cmem[0], 8 bytes cmem[2]\n";
+    const fk::JitPtxasInfo first = fk::jit_internal::parsePtxasInfo(fk::jit_internal::ptxasLogFor(log, "_Z1av"));
+    CHECK(first.registers == 12 && first.spillStoreBytes == 0 && first.sharedBytes == -1 && first.constantBytes == 360);
+    const fk::JitPtxasInfo second = fk::jit_internal::parsePtxasInfo(fk::jit_internal::ptxasLogFor(log, "_Z1bv"));
+    CHECK(second.registers == 255 && second.stackBytes == 40 && second.spillStoreBytes == 16 && second.spillLoadBytes == 8);
+    CHECK(second.sharedBytes == 1024 && second.constantBytes == 368);
+    CHECK(fk::jit_internal::ptxasLogFor(log, "_Z1cv").empty());
+
+    // The --time=- table is taken out of the log, and its phases are split into parsing and code generation
+    std::string timedLog = log +
+        "source file name , phase name , arch , tool , metric , unit\n"
+        "fkl , NVVM front end , compute_86 , nvrtc , 120.5 , ms\n"
+        "fkl , NVVM optimizer , compute_86 , nvrtc , 30 , ms\n"
+        "fkl , ptxas , sm_86 , nvrtc , 0.01 , s\n";
+    const std::vector<fk::JitCompilePhase> phases = fk::jit_internal::extractCompilePhases(timedLog);
+    CHECK(timedLog == log && phases.size() == 3 && phases[0].name == "NVVM front end" && phases[2].milliseconds == 10.0);
+    CHECK(fk::jit_internal::isParsePhase(phases[0].name) && !fk::jit_internal::isParsePhase(phases[1].name) &&
+          !fk::jit_internal::isParsePhase(phases[2].name));
+    std::string untimedLog = log;
+    CHECK(fk::jit_internal::extractCompilePhases(untimedLog).empty() && untimedLog == log);
+
+    // A real compilation, to CUBIN for the lowest architecture supported by this NVRTC
+    const std::vector<int> nvrtcArchs = fk::jit_internal::nvrtcSupportedArchs();
+    CHECK(!nvrtcArchs.empty());
+    const fk::JitCompileTarget target = fk::JitCompileTarget::cubin(nvrtcArchs.front());
+    const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+    const auto read_op = fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(raw));
+    const auto write_op = fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(raw));
+    const std::vector<std::vector<fk::JIT_Operation_pp>> pipelines{ { read_op, fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f)), write_op },
+                                                                    { read_op, fk::jit_internal::buildOperation(fk::Add<float>::build(5.f)), write_op } };
+    std::vector<std::string> nameExpressions;
+    for (const auto& pipeline : pipelines) {
+        nameExpressions.push_back(fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipeline), pipeline));
+    }
+    const fk::jit_internal::JitBatchImage batch = fk::jit_internal::compileNameExpressions(
+        fk::jit_internal::jitKernelSource(), nameExpressions, fk::jit_internal::defaultCompileOptions(), nullptr, target);
+    CHECK(batch.compileMilliseconds > 0.0);
+    const bool phaseTimes = fk::jit_internal::nvrtcPhaseTimes();
+    CHECK(!phaseTimes || (!batch.phases.empty() && batch.log.find("phase name") == std::string::npos));
+
+    fk::JitKernelTelemetry telemetry;
+    for (size_t i = 0; i < nameExpressions.size(); ++i) {
+        const fk::JitKernelStats stats = fk::jit_internal::makeCompileStats(batch, i, nameExpressions[i], target);
+        CHECK(stats.origin == fk::JitKernelOrigin::BATCH_COMPILED && stats.batchSize == 2);
+        CHECK(stats.imageBytes == batch.image.size() && stats.target == target.name());
+        // Every kernel gets its own part of the ptxas report
+        CHECK(stats.ptxasLog.find(batch.loweredNames[i]) != std::string::npos);
+        CHECK(stats.ptxas.registers > 0 && stats.ptxas.spillStoreBytes >= 0);
+        CHECK(!phaseTimes || stats.parseMilliseconds + stats.codegenMilliseconds > 0.0);
+        telemetry.record(stats);
+    }
+    telemetry.record(fk::jit_internal::makeCompileStats(batch, 0, nameExpressions[0], target));
+    CHECK(telemetry.kernels().size() == 2);
+    CHECK(telemetry.find(nameExpressions[0])->loads == 2 && telemetry.find(nameExpressions[1])->loads == 1);
+    const std::string json = telemetry.toJson();
+    CHECK(json.find(batch.loweredNames[1]) != std::string::npos && json.find("\"attributes\"") == std::string::npos);
+
+    std::cout << "SUCCESS: " << telemetry.find(nameExpressions[0])->ptxas.registers << " registers, compiled in "
+              << batch.compileMilliseconds << " ms" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_KERNEL_TELEMETRY
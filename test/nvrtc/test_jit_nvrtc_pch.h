@@ -0,0 +1,106 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_NVRTC_PCH
+#define FK_TEST_JIT_NVRTC_PCH
+
+// __ONLY_CPU__
+// This test only uses NVRTC, so it runs on hosts without a GPU
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor_cache.h>
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int launch() {
+    // No device memory is needed, only the types of the operations
+    const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+    const auto read_op = fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(raw));
+    const auto write_op = fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(raw));
+    const auto mul_op = fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f));
+    const auto add_op = fk::jit_internal::buildOperation(fk::Add<float>::build(5.f));
+    const std::vector<std::vector<fk::JIT_Operation_pp>> pipelines{ { read_op, mul_op, write_op },
+                                                                    { read_op, add_op, write_op },
+                                                                    { read_op, mul_op, add_op, write_op } };
+
+    const std::string& source = fk::jit_internal::jitKernelSource();
+    const std::vector<std::string> options = fk::jit_internal::defaultCompileOptions();
+    const std::filesystem::path pchDir = std::filesystem::temp_directory_path() / "fkl_jit_pch_test";
+    std::filesystem::remove_all(pchDir);
+    fk::JitNvrtcPch pch(pchDir, fk::jit_internal::makeDiskCacheKey(source, "", options).hash());
+    const bool enabled = pch.isEnabled();
+
+    // Reference without PCH, then the same kernels with it
+    const fk::JitKernelImage reference = fk::jit_internal::compileNameExpression(
+        source, fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipelines[0]), pipelines[0]), options);
+    for (const auto& pipeline : pipelines) {
+        const std::string nameExpression = fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipeline), pipeline);
+        const fk::JitKernelImage image = fk::jit_internal::compileNameExpression(source, nameExpression, options, &pch);
+        CHECK(std::string(image.data(), image.size()).find(".entry " + image.loweredName()) != std::string::npos);
+    }
+    const fk::JitKernelImage withPch = fk::jit_internal::compileNameExpression(
+        source, fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipelines[0]), pipelines[0]), options, &pch);
+    CHECK(withPch.loweredName() == reference.loweredName());
+
+    const fk::JitPchTelemetry telemetry = pch.telemetry();
+    const uint64_t total = telemetry.compilations[0] + telemetry.compilations[1] + telemetry.compilations[2];
+    CHECK(total == pipelines.size() + 1);
+    if (!enabled) {
+        // Clean fallback: everything compiles without PCH
+        CHECK(telemetry.compilations[static_cast<size_t>(fk::JitPchMode::NONE)] == total);
+        std::cout << "SUCCESS: NVRTC PCH not supported, " << total << " kernels compiled without it" << std::endl;
+        return 0;
+    }
+    if (pch.isEnabled()) {
+        // Created by the first compilation, or the next one if the PCH heap had to grow, and used by the rest
+        CHECK(telemetry.compilations[static_cast<size_t>(fk::JitPchMode::CREATE)] >= 1);
+        CHECK(telemetry.compilations[static_cast<size_t>(fk::JitPchMode::USE)] >= 1);
+        CHECK(telemetry.compilations[static_cast<size_t>(fk::JitPchMode::NONE)] == 0);
+        CHECK(std::filesystem::exists(pch.path()));
+        // The compilation that created the PCH is the baseline of the ones that used it
+        CHECK(telemetry.baselineMilliseconds() == telemetry.averageMilliseconds(fk::JitPchMode::CREATE));
+        CHECK(telemetry.savedMilliseconds() > 0.0);
+
+        // A run that finds the PCH uses it from its first compilation, and reads the baseline recorded
+        // by the run that created it
+        CHECK(std::filesystem::exists(std::filesystem::path(pch.path().string() + ".baseline")));
+        fk::JitNvrtcPch existing(pchDir, fk::jit_internal::makeDiskCacheKey(source, "", options).hash());
+        for (const auto& pipeline : pipelines) {
+            fk::jit_internal::compileNameExpression(
+                source, fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipeline), pipeline), options, &existing);
+        }
+        const fk::JitPchTelemetry existingTelemetry = existing.telemetry();
+        CHECK(existingTelemetry.compilations[static_cast<size_t>(fk::JitPchMode::NONE)] == 0);
+        CHECK(existingTelemetry.compilations[static_cast<size_t>(fk::JitPchMode::USE)] == pipelines.size());
+        CHECK(existingTelemetry.recordedBaselines == 1 && existingTelemetry.baselineMilliseconds() > 0.0);
+        CHECK(existingTelemetry.savedMilliseconds() > 0.0);
+
+        const std::string json = fk::JitKernelTelemetry{}.toJson(existingTelemetry);
+        CHECK(json.find("\"pch\"") != std::string::npos && json.find("\"savedMs\"") != std::string::npos);
+    }
+
+    std::cout << "SUCCESS: average compile time " << telemetry.averageMilliseconds(fk::JitPchMode::CREATE) << " ms creating the PCH, "
+              << telemetry.averageMilliseconds(fk::JitPchMode::USE) << " ms using it, " << telemetry.savedMilliseconds() << " ms saved"
+              << std::endl;
+    std::filesystem::remove_all(pchDir);
+    return 0;
+}
+
+#endif // FK_TEST_JIT_NVRTC_PCH
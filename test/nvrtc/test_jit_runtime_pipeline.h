@@ -0,0 +1,88 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_RUNTIME_PIPELINE
+#define FK_TEST_JIT_RUNTIME_PIPELINE
+
+// __ONLY_CPU__
+
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace test_runtime_pipeline {
+    // Simulates a pipeline read from a configuration file: each operation is converted to its
+    // runtime descriptor on its own, and the pipeline is assembled at runtime.
+    std::vector<fk::JIT_Operation_pp> assemblePipeline(fk::Ptr1D<float>& input, fk::Ptr1D<float>& output,
+                                                       const float mulValue, const float addValue) {
+        std::vector<fk::JIT_Operation_pp> pipeline;
+        pipeline.push_back(fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(input)));
+        pipeline.push_back(fk::jit_internal::buildOperation(fk::Mul<float>::build(mulValue)));
+        pipeline.push_back(fk::jit_internal::buildOperation(fk::Add<float>::build(addValue)));
+        pipeline.push_back(fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(output)));
+        return pipeline;
+    }
+} // namespace test_runtime_pipeline
+
+int launch() {
+    constexpr uint N = 1000;
+    fk::Stream_<fk::ParArch::GPU_NVIDIA_JIT> stream;
+    fk::Ptr1D<float> input(N);
+    for (uint i = 0; i < N; ++i) {
+        input.at(fk::Point(i)) = static_cast<float>(i);
+    }
+    input.upload(stream);
+    fk::Ptr1D<float> outputA(N);
+    fk::Ptr1D<float> outputB(N);
+
+    const size_t kernelsBefore = fk::JITExecutorCache::getInstance().getKernelCache().size();
+
+    using JITExecutor = fk::Executor<fk::TransformDPP<fk::ParArch::GPU_NVIDIA_JIT>>;
+    const auto pipelineA = test_runtime_pipeline::assemblePipeline(input, outputA, 2.f, 5.f);
+    const auto pipelineB = test_runtime_pipeline::assemblePipeline(input, outputB, 3.f, -1.f);
+    JITExecutor::executeOperations(stream, pipelineA);
+    JITExecutor::executeOperations(stream, pipelineB);
+
+    outputA.download(stream);
+    outputB.download(stream);
+    stream.sync();
+
+    // Both configurations have the same op-type signature, so they share the same kernel
+    const size_t kernelsCompiled = fk::JITExecutorCache::getInstance().getKernelCache().size() - kernelsBefore;
+    if (kernelsCompiled != 1) {
+        std::cout << "ERROR: expected one fused kernel, " << kernelsCompiled << " were compiled" << std::endl;
+        return 1;
+    }
+
+    for (uint i = 0; i < N; ++i) {
+        const float expectedA = i * 2.f + 5.f;
+        const float expectedB = i * 3.f - 1.f;
+        if (std::abs(outputA.at(fk::Point(i)) - expectedA) > 0.001f ||
+            std::abs(outputB.at(fk::Point(i)) - expectedB) > 0.001f) {
+            std::cout << "ERROR: wrong result at " << i << ": " << outputA.at(fk::Point(i)) << " (expected " << expectedA
+                      << "), " << outputB.at(fk::Point(i)) << " (expected " << expectedB << ")" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "SUCCESS: two runtime configurations executed with a single fused kernel" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_RUNTIME_PIPELINE
@@ -0,0 +1,57 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_SPECIALIZATION_COMPILE
+#define FK_TEST_JIT_SPECIALIZATION_COMPILE
+
+// __ONLY_CPU__
+// Kernels specialized for constant FKL operations compiled by NVRTC. It only uses NVRTC, so it runs on hosts without a GPU
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int launch() {
+    const std::vector<int> nvrtcArchs = fk::jit_internal::nvrtcSupportedArchs();
+    CHECK(!nvrtcArchs.empty());
+    const fk::JitCompileTarget target = fk::JitCompileTarget::cubin(nvrtcArchs.front());
+
+    // Nothing is launched, the pointers are not used
+    const fk::RawPtr<fk::_1D, float> raw{ nullptr, { 256, 256 * sizeof(float) } };
+    std::vector<fk::JIT_Operation_pp> pipeline{ fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(raw)),
+                                                fk::jit_internal::buildOperation(fk::Mul<float>::build(2.f)),
+                                                fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(raw)) };
+    pipeline[1].setConstant(true);
+    const std::string specialized = fk::jit_internal::specializedNameExpression(pipeline);
+    CHECK(specialized.find("JitConstantOp<") != std::string::npos);
+    const std::string generic = fk::jit_internal::buildNameExpression(fk::jit_internal::runtimeKernelName(pipeline), pipeline);
+
+    // The operation rebuilt from its words on the device, and the generic kernel, in the same program
+    const fk::jit_internal::JitBatchImage batch = fk::jit_internal::compileNameExpressions(
+        fk::jit_internal::jitKernelSource(), { specialized, generic }, fk::jit_internal::defaultCompileOptions(), nullptr, target);
+    CHECK(batch.image.size() > 4 && memcmp(batch.image.data(), "\x7f" "ELF", 4) == 0);
+    CHECK(batch.loweredNames.size() == 2 && !batch.loweredNames[0].empty() && batch.loweredNames[0] != batch.loweredNames[1]);
+
+    std::cout << "SUCCESS: specialized kernel compiled for sm_" << nvrtcArchs.front() << " without a GPU" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_SPECIALIZATION_COMPILE
@@ -0,0 +1,79 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+#ifndef FK_TEST_JIT_SPECIALIZATION_LAUNCH
+#define FK_TEST_JIT_SPECIALIZATION_LAUNCH
+
+// __ONLY_CPU__
+// Runtime pipelines with a constant operation launched with their specialized kernels
+
+#include "main.h"
+#include <fused_kernel/core/utils/utils.h>
+#include <fused_kernel/fused_kernel.h>
+#include <fused_kernel/algorithms/basic_ops/arithmetic.h>
+#include <src/jit_operation_executor.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace test_jit_specialization_launch {
+    std::vector<fk::JIT_Operation_pp> constantGain(fk::Ptr1D<float>& input, fk::Ptr1D<float>& output, const float gain) {
+        std::vector<fk::JIT_Operation_pp> pipeline{ fk::jit_internal::buildOperation(fk::PerThreadRead<fk::_1D, float>::build(input)),
+                                                    fk::jit_internal::buildOperation(fk::Mul<float>::build(gain)),
+                                                    fk::jit_internal::buildOperation(fk::PerThreadWrite<fk::_1D, float>::build(output)) };
+        pipeline[1].setConstant(true);
+        return pipeline;
+    }
+} // namespace test_jit_specialization_launch
+
+int launch() {
+    constexpr uint N = 1000;
+    fk::Stream_<fk::ParArch::GPU_NVIDIA_JIT> stream;
+    fk::Ptr1D<float> input(N);
+    for (uint i = 0; i < N; ++i) {
+        input.at(fk::Point(i)) = static_cast<float>(i);
+    }
+    input.upload(stream);
+    fk::Ptr1D<float> doubled(N);
+    fk::Ptr1D<float> tripled(N);
+
+    using JITExecutor = fk::Executor<fk::TransformDPP<fk::ParArch::GPU_NVIDIA_JIT>>;
+    fk::JITExecutorCache& cache = fk::JITExecutorCache::getInstance();
+    const fk::JitSpecializationPolicy policy = cache.getSpecializationPolicy();
+    cache.setSpecializationPolicy(fk::JitSpecializationPolicy{});
+
+    // Each constant value has its own kernel
+    const std::vector<fk::JIT_Operation_pp> doubling = test_jit_specialization_launch::constantGain(input, doubled, 2.f);
+    const std::vector<fk::JIT_Operation_pp> tripling = test_jit_specialization_launch::constantGain(input, tripled, 3.f);
+    JITExecutor::executeOperations(stream, doubling);
+    JITExecutor::executeOperations(stream, tripling);
+    cache.setSpecializationPolicy(policy);
+    CHECK(cache.getKernelCache().find(fk::jit_internal::specializedNameExpression(doubling)).has_value());
+    CHECK(cache.getKernelCache().find(fk::jit_internal::specializedNameExpression(tripling)).has_value());
+
+    doubled.download(stream);
+    tripled.download(stream);
+    stream.sync();
+
+    for (uint i = 0; i < N; ++i) {
+        CHECK(std::abs(doubled.at(fk::Point(i)) - i * 2.f) < 0.001f);
+        CHECK(std::abs(tripled.at(fk::Point(i)) - i * 3.f) < 0.001f);
+    }
+
+    std::cout << "SUCCESS: " << N << " elements computed by the kernels specialized for two constant gains" << std::endl;
+    return 0;
+}
+
+#endif // FK_TEST_JIT_SPECIALIZATION_LAUNCH
@@ -0,0 +1,199 @@
+/* Copyright 2025 Grup Mediapro S.L.U (Oscar Amoros Huguet)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License. */
+
+// Ahead of time compiler of JIT kernels.
+// Usage: jit_fkl_bundle --manifest <file> --archs <list> --output <file> [--ptx] [--profile <name>] [--jobs <n>]
+//                       [--kernels-per-program <n>]
+//   --manifest             Pipelines to compile, see fk::jit_internal::manifestNameExpression
+//   --archs                Compute capabilities to generate CUBIN for, like "75;86;89" (default: FK_JIT_ARCHS)
+//   --output               Bundle to write, for JITExecutorCache::preloadBundle or FK_JIT_BUNDLE
+//   --ptx                  Also add the PTX of the lowest architecture, for newer devices
+//   --profile              Compile profile of the kernels, see fk::JitCompileProfile::named (default: FK_JIT_PROFILE)
+//   --jobs                 Parallel NVRTC compilations (default: the number of cores)
+//   --kernels-per-program  Kernels compiled in one NVRTC program, which parses the FKL headers once (default: 8)
+// It only uses NVRTC, so it runs on hosts without a GPU.
+
+#include <src/jit_operation_executor_cache.h>
+#include <src/jit_kernel_bundle.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct Options {
+        std::string manifest;
+        std::string output;
+        std::vector<int> archs;
+        bool ptx{ false };
+        fk::JitCompileProfile profile;
+        size_t jobs{ std::max(1u, std::thread::hardware_concurrency()) };
+        size_t kernelsPerProgram{ 8 };
+    };
+
+    // The kernels of one NVRTC program for one target
+    struct Job {
+        fk::JitCompileTarget target;
+        std::vector<std::string> nameExpressions;
+        fk::jit_internal::JitBatchImage batch;
+        std::string error;
+    };
+
+    bool parseArguments(const int argc, char** argv, Options& options) {
+        options.archs = fk::JitArchConfig::fromEnvironment().archs;
+        options.profile = fk::JitCompileProfile::fromEnvironment();
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--manifest" && hasValue) {
+                options.manifest = argv[++i];
+            } else if (arg == "--output" && hasValue) {
+                options.output = argv[++i];
+            } else if (arg == "--archs" && hasValue) {
+                options.archs = fk::jit_internal::parseArchList(argv[++i]);
+            } else if (arg == "--ptx") {
+                options.ptx = true;
+            } else if (arg == "--profile" && hasValue) {
+                options.profile = fk::JitCompileProfile::named(argv[++i]);
+            } else if (arg == "--jobs" && hasValue) {
+                options.jobs = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+            } else if (arg == "--kernels-per-program" && hasValue) {
+                options.kernelsPerProgram = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+            } else {
+                return false;
+            }
+        }
+        return !options.manifest.empty() && !options.output.empty() && !options.archs.empty();
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    bool validArguments = false;
+    try {
+        validArguments = parseArguments(argc, argv, options);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+    if (!validArguments) {
+        std::cerr << "Usage: " << argv[0] << " --manifest <file> --archs <list> --output <file>"
+                  << " [--ptx] [--profile <name>] [--jobs <n>] [--kernels-per-program <n>]" << std::endl;
+        return 2;
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> nameExpressions;
+    try {
+        std::ifstream manifest(options.manifest);
+        if (!manifest) {
+            std::cerr << "Could not read " << options.manifest << std::endl;
+            return 1;
+        }
+        nameExpressions = fk::jit_internal::readBundleManifest(manifest);
+    } catch (const std::exception& e) {
+        std::cerr << options.manifest << ": " << e.what() << std::endl;
+        return 1;
+    }
+    if (nameExpressions.empty()) {
+        std::cerr << options.manifest << " has no pipelines" << std::endl;
+        return 1;
+    }
+
+    const std::vector<int> supportedArchs = fk::jit_internal::nvrtcSupportedArchs();
+    std::vector<fk::JitCompileTarget> targets;
+    for (const int arch : options.archs) {
+        if (!supportedArchs.empty() && std::find(supportedArchs.begin(), supportedArchs.end(), arch) == supportedArchs.end()) {
+            std::cerr << "NVRTC " << fk::jit_internal::nvrtcVersionString() << " can not generate CUBIN for sm_" << arch << std::endl;
+            return 1;
+        }
+        targets.push_back(fk::JitCompileTarget::cubin(arch));
+    }
+    if (options.ptx) {
+        targets.push_back(fk::JitCompileTarget::ptx(*std::min_element(options.archs.begin(), options.archs.end())));
+    }
+
+    std::vector<Job> jobs;
+    for (const auto& target : targets) {
+        for (size_t first = 0; first < nameExpressions.size(); first += options.kernelsPerProgram) {
+            const size_t last = std::min(nameExpressions.size(), first + options.kernelsPerProgram);
+            Job job;
+            job.target = target;
+            job.nameExpressions.assign(nameExpressions.begin() + first, nameExpressions.begin() + last);
+            jobs.push_back(std::move(job));
+        }
+    }
+
+    // The cache keys must match the ones of JITExecutorCache, so the same sources and options are used
+    const fk::JitHeaderMode headerMode = fk::JitHeaderPolicy::fromEnvironment().mode;
+    const std::vector<std::string> compileOptions = fk::jit_internal::profileCompileOptions(options.profile.options());
+    std::atomic<size_t> nextJob{ 0 };
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(options.jobs, jobs.size()); ++i) {
+        workers.emplace_back([&] {
+            for (size_t index = nextJob++; index < jobs.size(); index = nextJob++) {
+                Job& job = jobs[index];
+                try {
+                    job.batch = fk::jit_internal::compileProgramSource(fk::jit_internal::programSource(job.nameExpressions, headerMode),
+                                                                       job.nameExpressions, compileOptions, nullptr, nullptr, job.target);
+                } catch (const std::exception& e) {
+                    job.error = e.what();
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    fk::JitKernelBundleWriter writer;
+    int failures = 0;
+    for (auto& job : jobs) {
+        if (!job.error.empty()) {
+            std::cerr << "Failed to compile for " << job.target.name() << ":\n";
+            for (const auto& nameExpression : job.nameExpressions) {
+                std::cerr << "  " << nameExpression << "\n";
+            }
+            std::cerr << job.error << std::endl;
+            failures++;
+            continue;
+        }
+        const size_t image = writer.addImage(job.batch.kind, std::move(job.batch.image));
+        for (size_t i = 0; i < job.nameExpressions.size(); ++i) {
+            // With minimal headers, each kernel is looked up with the source of its own headers
+            const std::string source = fk::jit_internal::programSource({ job.nameExpressions[i] }, headerMode).text;
+            const uint64_t key = fk::jit_internal::makeDiskCacheKey(source, job.nameExpressions[i], compileOptions, job.target).hash();
+            writer.addKernel(key, job.batch.loweredNames[i], image);
+        }
+    }
+    if (failures != 0) {
+        return 1;
+    }
+    try {
+        writer.write(options.output);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << writer.size() << " kernels (" << nameExpressions.size() << " pipelines, " << targets.size()
+              << " targets) to " << options.output << " in " << seconds << " s" << std::endl;
+    return 0;
+}